@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 #include "config.h"
+#include "PulseTrain.h"
 
 // ============================================
 // A-OK AC114-01B PROTOCOL SPECIFICATIONS
@@ -54,6 +55,13 @@ public:
     bool sendProgram(int repeats = AOK_REPEAT_COUNT);
     bool sendCommand(uint8_t command, int repeats = AOK_REPEAT_COUNT);
 
+    // Forma de onda de una repetición (AGC + 65 bits), sin transmitir
+    bool encodeCommand(uint8_t command, PulseTrain& train);
+    void encodeFrame(const uint8_t* frame, PulseTrain& train);
+
+    // Reproduce una repetición ya codificada (configura y restaura el CC1101)
+    bool transmitPulses(const uint32_t* pulses, uint16_t count, int repeats = AOK_REPEAT_COUNT);
+
     // Learn remote ID from captured signal (optional)
     bool learnFromCapture(const uint8_t* capturedData, uint16_t length);
 
@@ -80,12 +88,6 @@ private:
     // Transmit frame
     bool transmitFrame(uint8_t* frame, int repeats);
 
-    // Send single bit (0 or 1)
-    void sendBit(bool bit);
-
-    // Send AGC preamble
-    void sendAGC();
-
     // Configure CC1101 for A-OK transmission
     void configureTransmitter();
     void restoreConfig();
@@ -0,0 +1,62 @@
+#ifndef BOOT_MANAGER_H
+#define BOOT_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include "config.h"
+
+// ============================================
+// ARRANQUE POR ETAPAS
+// Storage, radio, WiFi y NTP arrancan en paralelo; cada subsistema
+// publica un bit de disponibilidad en lugar de bloquear initSystem()
+// ============================================
+#define BOOT_STORAGE_READY      (1 << 0)
+#define BOOT_RADIO_READY        (1 << 1)
+#define BOOT_WIFI_READY         (1 << 2)
+#define BOOT_TIME_READY         (1 << 3)
+#define BOOT_RADIO_DONE         (1 << 4)    // Init de radio terminado (con o sin CC1101)
+
+#define BOOT_TASK_STACK         4096
+#define BOOT_RADIO_WAIT_MS      1000        // Espera máxima de un comando RF por la radio
+
+class BootManager {
+public:
+    BootManager();
+
+    // Inicialización (crear el event group lo antes posible en setup)
+    void begin();
+
+    // Tareas de arranque en segundo plano
+    void startRadio(SystemConfig* config);
+    void startTimeSync(SystemConfig* config);
+
+    // Bits de disponibilidad
+    void setReady(EventBits_t bits);
+    void clearReady(EventBits_t bits);
+    bool isReady(EventBits_t bits);
+    bool waitFor(EventBits_t bits, uint32_t timeoutMs);
+
+    // Métricas de arranque (ms desde reset)
+    unsigned long getRadioReadyMs() const { return radioReadyMs; }
+    unsigned long getWifiReadyMs() const { return wifiReadyMs; }
+    unsigned long getTimeReadyMs() const { return timeReadyMs; }
+
+    String getStatusString();
+
+private:
+    EventGroupHandle_t readyBits;
+    SystemConfig* sysConfig;
+
+    volatile unsigned long radioReadyMs;
+    volatile unsigned long wifiReadyMs;
+    volatile unsigned long timeReadyMs;
+
+    static void radioTask(void* param);
+    static void onTimeSynced();
+};
+
+// Instancia global
+extern BootManager bootManager;
+
+#endif // BOOT_MANAGER_H
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 #include "config.h"
+#include "PulseTrain.h"
+#include "PulseTrace.h"
 
 class CC1101_RF {
 public:
@@ -24,11 +26,48 @@ public:
     void stopCapture();
     bool isCapturing();
     bool captureSignal(RFSignal* signal, unsigned long timeout = RF_CAPTURE_TIMEOUT);
+    int getLastCaptureRssi() const { return lastCaptureRssi; }
+
+    // Captura continua en formato PulseTrace: cada señal capturada durante
+    // durationMs es un segmento. Retorna los segmentos grabados o -1 si falla.
+    int recordTrace(Print& out, unsigned long durationMs, uint32_t startUnix = 0,
+                    uint32_t maxBytes = TRACE_MAX_BYTES);
+
+    // Escucha continua (RxMonitor): con la radio libre la ISR deja cada
+    // duración en un anillo que se vacía desde loop(). Cualquier otro uso de
+    // la radio (TX, captura, cambio de frecuencia) la suspende; la
+    // frecuencia de escucha no cambia getFrequency().
+    bool startListening(float freq, int modulation);
+    void suspendListening();
+    bool isListening() const { return listening; }
+    uint16_t readListened(uint16_t* out, uint16_t maxCount);     // Separador largo = 0xFFFF
+    unsigned long getLastRadioUse() const { return lastRadioUse; }
+    uint32_t getListenOverruns() const { return listenOverruns; }
+    uint32_t getListenNoise() const { return listenNoise; }     // Ráfagas descartadas por el squelch
 
     // Transmisión de señales
     bool transmitSignal(const RFSignal* signal, int repeats = RF_REPEAT_TRANSMIT);
     bool transmitRaw(const uint8_t* data, uint16_t length, int repeats = RF_REPEAT_TRANSMIT, bool inverted = false);
 
+    // Reproduce una repetición ya codificada (formato PulseTrain) en OOK async
+    // a la frecuencia actual; transmitRaw = encodeRaw + transmitPulses
+    bool transmitPulses(const uint32_t* pulses, uint16_t count, int repeats = RF_REPEAT_TRANSMIT);
+
+    // Forma de onda de una repetición de transmitRaw (sin transmitir)
+    static bool encodeRaw(const uint8_t* data, uint16_t length, bool inverted, PulseTrain& train);
+
+    // Ráfaga de TX (planificador): entre transmisiones la radio conserva el
+    // perfil cargado y la restauración a RX se hace una vez, en endBurst().
+    // Fuera de una ráfaga cada transmisión configura y restaura como siempre.
+    static uint32_t makeTxProfile(float freq, int modulation, uint8_t mode);
+    void beginBurst();
+    void endBurst();
+    bool isBurst() const { return burst; }
+    bool isTxProfileLoaded(uint32_t profile) const { return burst && loadedTxProfile == profile; }
+    void setTxProfileLoaded(uint32_t profile) { loadedTxProfile = profile; }
+    void deferRestore() { restorePending = true; }
+    void restoreDefaults();     // Init + 433.92 MHz ASK/OOK (estado tras A-OK/Dooya)
+
     // Detección automática de frecuencia
     float scanForSignal(float* frequencies, int count, unsigned long timeout = 3000);
     bool autoDetectSettings(RFSignal* signal, unsigned long timeout = 5000);
@@ -54,11 +93,17 @@ private:
     bool capturing;
     bool connected;
 
+    // Perfil de TX en los registros del CC1101 (0 = desconocido)
+    uint32_t loadedTxProfile;
+    bool burst;
+    bool restorePending;
+
     // Buffer para captura raw
     volatile uint8_t captureBuffer[RF_MAX_SIGNAL_LENGTH];
     volatile uint16_t captureIndex;
     volatile unsigned long lastPulse;
     volatile bool captureComplete;
+    int lastCaptureRssi;        // RSSI al detectar la última señal capturada
 
     // Pre-buffer circular para capturar preámbulo/wake-up
     static const uint16_t PRE_BUFFER_SIZE = 200;  // 100 pulsos de preámbulo max
@@ -67,8 +112,19 @@ private:
     volatile bool preBufferFull;
     volatile bool preCapturing;  // Captura continua antes de señal fuerte
 
+    // Escucha continua: anillo de duraciones (productor ISR, consumidor loop)
+    volatile uint16_t listenRing[RX_RING_SIZE];
+    volatile uint16_t listenHead;
+    volatile uint16_t listenTail;
+    volatile uint32_t listenOverruns;
+    volatile uint32_t listenNoise;
+    volatile bool squelched;        // Último alto sin carrier sense
+    volatile bool listening;
+    unsigned long lastRadioUse;     // millis() del último uso ajeno a la escucha
+
     // Métodos internos
     void configureReceiver();
+    void configureReceiver(float freq, int modulation);
     void configureTransmitter();
     bool waitForSignal(unsigned long timeout);
     void processRawSignal(RFSignal* signal);
@@ -79,6 +135,9 @@ private:
     void onInterrupt();
     void onPreCaptureInterrupt();  // Para captura continua de preámbulo
     static void IRAM_ATTR handlePreCaptureInterrupt();
+    void onListenInterrupt();
+    void pushListened(uint16_t duration);
+    static void IRAM_ATTR handleListenInterrupt();
 };
 
 // Instancia global
@@ -0,0 +1,93 @@
+#ifndef COVER_POSITIONS_H
+#define COVER_POSITIONS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// POSICIÓN DE CORTINAS POR TIEMPO
+// Las cortinas con recorrido medido guardan la posición de partida y la
+// hora del último comando transmitido; la posición actual se calcula al
+// vuelo. Un único plazo (el más próximo entre todas las cortinas en
+// movimiento) decide cuándo loop() trabaja: stops programados, fin de
+// recorrido y publicación de la posición cada COVER_POSITION_PUBLISH_MS.
+// ============================================
+
+// position 0-100; state = opening, closing, open, closed o stopped
+typedef void (*CoverPositionCallback)(const char* deviceId, uint8_t position, const char* state);
+
+class CoverPositions {
+public:
+    CoverPositions();
+
+    void begin();               // Posiciones guardadas (después de Storage)
+    void loop();
+
+    // Notificación de Storage (misma semántica que MQTTTopicCache)
+    void onDeviceChanged(const char* id, const SavedDevice* device);
+
+    // Comando ya transmitido al dispositivo. Devuelve true si tiene modelo
+    // de posición: el estado se publica desde aquí.
+    bool onCommandSent(const char* deviceId, const char* command);
+
+    // Abre o cierra hacia position (0-100) y programa el stop
+    bool setPosition(const char* deviceId, uint8_t position);
+
+    int8_t getPosition(const char* deviceId);      // -1 sin modelo de posición
+    void publishAll();                              // Al conectar
+
+    void setPublishCallback(CoverPositionCallback callback) { onPublish = callback; }
+
+    static bool isValidTravel(uint32_t ms);         // 0 (sin medir) o dentro de límites
+    static bool hasTravel(const SavedDevice* device);
+
+private:
+    struct Cover {
+        char id[37];
+        uint32_t openMs;
+        uint32_t closeMs;
+        uint16_t position;          // Décimas de %: 0 = cerrada, 1000 = abierta
+        uint16_t startPosition;     // Al arrancar el movimiento en curso
+        int8_t direction;           // +1 abriendo, -1 cerrando, 0 quieta
+        int8_t target;              // set_position a la espera de su comando (-1 = ninguno)
+        bool stopping;              // Stop programado en la ráfaga en curso
+        bool seen;                  // Reconstrucción de la tabla
+        unsigned long startedAt;
+        unsigned long stopAt;       // Stop programado (0 = hasta el final del recorrido)
+        unsigned long publishedAt;
+    };
+
+    Cover covers[MAX_DEVICES];
+    uint8_t coverCount;
+    uint32_t generation;            // storage.getCatalogGeneration() de la tabla
+    bool stale;
+
+    // Plazo compartido
+    bool pending;
+    unsigned long nextDeadline;
+    bool saveDirty;
+    unsigned long saveAt;
+
+    CoverPositionCallback onPublish;
+
+    void ensure();
+    static bool visit(const SavedDevice* device, void* context);
+    Cover* find(const char* deviceId);
+    void remove(Cover* cover);
+
+    uint16_t current(const Cover& cover, unsigned long now) const;
+    void start(Cover& cover, int8_t direction, unsigned long at);
+    void halt(Cover& cover, uint16_t position, unsigned long now);
+    unsigned long deadline(const Cover& cover) const;
+    void schedule();
+
+    void publish(Cover& cover, unsigned long now);
+    bool send(const char* deviceId, const char* command);
+    void save();
+    static void onSent(const char* deviceId, const char* command);
+};
+
+// Instancia global
+extern CoverPositions coverPositions;
+
+#endif // COVER_POSITIONS_H
@@ -0,0 +1,31 @@
+#ifndef CRON_SPEC_H
+#define CRON_SPEC_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "config.h"
+
+// ============================================
+// EXPRESIÓN CRON DE 5 CAMPOS
+// "minuto hora día mes díaSemana" como máscaras de bits. next() busca el
+// próximo instante en hora local (TZ del proceso): si la zona horaria se
+// pierde, una regla de las 07:00 dispara a las 07:00 UTC.
+// ============================================
+struct CronSpec {
+    uint64_t minutes;           // Bit n = minuto n
+    uint32_t hours;             // Bit n = hora n
+    uint32_t monthDays;         // Bit n = día n (1-31)
+    uint16_t months;            // Bit n = mes n (1-12)
+    uint8_t weekdays;           // Bit n = día n (0 = domingo)
+    bool anyMonthDay;           // "*": con ambos restringidos vale cualquiera (cron)
+    bool anyWeekday;
+
+    bool parse(const char* text);
+    bool dayMatches(const struct tm& date) const;
+    time_t next(time_t after) const;    // 0 = sin disparo en SCHEDULE_SEARCH_DAYS
+
+    // Lista de "*", "n", "a-b", con paso opcional "/n"
+    static bool parseField(const char* text, uint8_t low, uint8_t high, uint64_t* mask, bool* any);
+};
+
+#endif // CRON_SPEC_H
@@ -0,0 +1,38 @@
+#ifndef DEVICE_GROUPS_H
+#define DEVICE_GROUPS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "TxScheduler.h"
+
+// ============================================
+// COMANDOS DE GRUPO / HABITACIÓN
+// Un mensaje mueve todos los miembros: se resuelven en una sola pasada por
+// devices.json y se encolan juntos en el planificador de TX, que los
+// transmite en una ráfaga ordenada por perfil de radio.
+// ============================================
+class DeviceGroups {
+public:
+    DeviceGroups();
+
+    // Devuelven cuántos miembros aceptaron el comando y quedaron en cola
+    uint8_t sendToRoom(const char* room, const char* command, TxDoneCallback onSent);
+    uint8_t sendToGroup(const char* groupId, const char* command, TxDoneCallback onSent);
+
+private:
+    // Contexto de la pasada por devices.json
+    const char* command;
+    const char* room;
+    char (*groupIds)[37];
+    uint8_t groupIdCount;
+    TxDoneCallback onSent;
+    uint8_t queued;
+
+    uint8_t resolve(const char* target);
+    static bool visit(const SavedDevice* device, void* context);
+};
+
+// Instancia global
+extern DeviceGroups deviceGroups;
+
+#endif // DEVICE_GROUPS_H
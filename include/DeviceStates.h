@@ -0,0 +1,48 @@
+#ifndef DEVICE_STATES_H
+#define DEVICE_STATES_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// ÚLTIMO ESTADO DE CADA DISPOSITIVO
+// Una entrada por dispositivo: un estado nuevo reemplaza al anterior, así
+// un corte largo de WiFi o del broker no acumula mensajes. La tabla se
+// guarda en states.json (diferido, como mucho una escritura cada
+// STATE_SAVE_MS) y MQTTClient la republica por tandas al reconectar,
+// también después de un reinicio.
+// ============================================
+class DeviceStates {
+public:
+    DeviceStates();
+
+    void begin();               // Carga states.json (después de Storage)
+    void loop();                // Guardado diferido
+    void flush();               // Guardar ya (antes de reiniciar)
+
+    // Devuelve true si el estado cambió
+    bool record(const char* deviceId, const char* state);
+    const char* get(const char* deviceId) const;     // nullptr = desconocido
+
+    // Notificación de Storage: dispositivo borrado o datos de usuario borrados
+    void onDeviceChanged(const char* id, const SavedDevice* device);
+
+    uint8_t getCount() const { return count; }
+
+private:
+    DeviceStateRecord entries[MAX_DEVICES];
+    uint8_t count;
+
+    bool dirty;
+    unsigned long saveAt;
+
+    int16_t indexOf(const char* deviceId) const;
+    void remove(uint8_t index);
+    void prune();
+    static bool isStorable(const char* state);
+};
+
+// Instancia global
+extern DeviceStates deviceStates;
+
+#endif // DEVICE_STATES_H
@@ -28,6 +28,12 @@ public:
     // Comando genérico
     bool sendCommand(uint8_t command);
 
+    // Frame FSK de un comando (DOOYA_BIDIR_FRAME_LEN bytes), sin transmitir
+    void encodeFrame(uint8_t command, uint8_t* out);
+
+    // Transmite un frame ya armado con encodeFrame (configura el CC1101 en FSK)
+    bool transmitFrame(const uint8_t* frame);
+
     // Utilidades
     String getStatusString();
     String getFrameHex();
@@ -42,7 +48,6 @@ private:
 
     // Métodos internos
     void buildFrame(uint8_t command);
-    bool transmitFrame();
 
     // Configuración CC1101 para FSK
     void configureFSK();
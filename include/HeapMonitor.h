@@ -0,0 +1,93 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// SEGUIMIENTO DE HEAP
+// Cada subsistema envuelve sus puntos de entrada en un HeapScope: se
+// cuentan las llamadas, los bytes retenidos al salir y los fallos de
+// asignación ocurridos dentro. Además se guardan las marcas mínimas de
+// heap libre y de mayor bloque, y se avisa cuando la fragmentación
+// supera HEAP_FRAG_ALERT_PCT (un DynamicJsonDocument de 32 KB falla
+// mucho antes de quedarse sin heap total).
+// ============================================
+enum HeapSubsystem {
+    HEAP_OTHER = 0,
+    HEAP_MQTT,
+    HEAP_WEB,
+    HEAP_STORAGE,
+    HEAP_RF,
+    HEAP_SUBSYSTEM_COUNT
+};
+
+struct HeapSubsystemStats {
+    uint32_t calls;
+    int32_t retainedBytes;      // Suma de (libre al entrar - libre al salir)
+    uint32_t peakRetained;      // Mayor retención de una sola llamada
+    uint32_t allocFailures;
+};
+
+class HeapMonitor {
+public:
+    HeapMonitor();
+
+    // Registra el callback de asignaciones fallidas del IDF
+    void begin();
+
+    // Muestreo periódico y detección de fragmentación (llamar desde loop())
+    void loop();
+
+    // Usados por HeapScope
+    HeapSubsystem enter(HeapSubsystem subsystem, uint32_t* freeBefore);
+    void leave(HeapSubsystem subsystem, HeapSubsystem previous, uint32_t freeBefore);
+
+    const HeapSubsystemStats& getStats(HeapSubsystem subsystem) const;
+    static const char* getSubsystemName(HeapSubsystem subsystem);
+
+    uint32_t getFree() const;
+    uint32_t getLargestBlock() const;
+    uint32_t getMinFree() const;
+    uint32_t getMinLargestBlock() const { return minLargestBlock; }
+    uint8_t getFragmentation() const;       // 0-100: 1 - mayor bloque / libre
+    uint32_t getAllocFailures() const { return allocFailures; }
+    bool isAlertActive() const { return alertActive; }
+
+    // Se llama al activarse o despejarse la alerta
+    void setAlertCallback(void (*callback)(bool active, uint8_t fragmentation));
+
+    String getStatusString();
+
+private:
+    HeapSubsystemStats stats[HEAP_SUBSYSTEM_COUNT];
+    volatile HeapSubsystem current;
+
+    uint32_t minLargestBlock;
+    volatile uint32_t allocFailures;
+    bool alertActive;
+    unsigned long lastCheck;
+
+    void (*onAlert)(bool active, uint8_t fragmentation);
+
+    void sample();
+    static void onAllocFailed(size_t size, uint32_t caps, const char* functionName);
+};
+
+// Atribuye las asignaciones de un bloque a un subsistema:
+// { HeapScope heap(HEAP_STORAGE); ... }
+class HeapScope {
+public:
+    explicit HeapScope(HeapSubsystem subsystem);
+    ~HeapScope();
+
+private:
+    HeapSubsystem subsystem;
+    HeapSubsystem previous;
+    uint32_t freeBefore;
+};
+
+// Instancia global
+extern HeapMonitor heapMonitor;
+
+#endif // HEAP_MONITOR_H
@@ -0,0 +1,87 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// ============================================
+// LOGGER CON NIVELES Y SALIDA DIFERIDA
+// Las macros LOG_x formatean la línea en un buffer circular en RAM y
+// vuelven enseguida; una tarea de baja prioridad la escribe por Serial.
+// Así el UART (115200 baud, ~1 ms por línea) nunca bloquea el camino TX.
+// Los niveles por encima de LOG_LEVEL (config.h) no se compilan.
+// ============================================
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+#define LOG_LEVEL_VERBOSE   5
+
+#define LOG_ENABLED(level)  ((level) <= LOG_LEVEL)
+
+// El tag debe ser un literal: LOG_I("RF", "Frecuencia %.2f MHz", freq)
+#define LOG_AT(level, tag, fmt, ...) \
+    do { if (LOG_ENABLED(level)) logger.write(level, "[" tag "] " fmt, ##__VA_ARGS__); } while (0)
+
+#define LOG_E(tag, fmt, ...)    LOG_AT(LOG_LEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#define LOG_W(tag, fmt, ...)    LOG_AT(LOG_LEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#define LOG_I(tag, fmt, ...)    LOG_AT(LOG_LEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#define LOG_D(tag, fmt, ...)    LOG_AT(LOG_LEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define LOG_V(tag, fmt, ...)    LOG_AT(LOG_LEVEL_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+struct LogLine {
+    uint32_t seq;
+    uint32_t ms;
+    uint8_t level;
+    char text[LOG_LINE_MAX];
+};
+
+class Logger {
+public:
+    Logger();
+
+    // Lanza la tarea que vacía el buffer hacia Serial
+    void begin();
+
+    // Sin bloqueo: varios productores reservan su entrada con un contador atómico
+    void write(uint8_t level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    // Vacía lo pendiente hacia Serial en el contexto del llamador (p.ej. antes de reiniciar)
+    void flush();
+
+    // Lectura no destructiva: devuelve la línea en `cursor` y lo avanza.
+    // Las líneas ya sobrescritas se saltan y se suman a `skipped`.
+    bool read(uint32_t& cursor, LogLine& line, uint32_t* skipped = nullptr);
+
+    uint32_t getHead() const { return head.load(std::memory_order_acquire); }
+    uint32_t getOldest() const;
+    uint32_t getDropped() const { return dropped; }
+
+    static char levelChar(uint8_t level);
+    static size_t formatHex(char* out, size_t outSize, const uint8_t* data, size_t length);
+
+private:
+    struct Entry {
+        std::atomic<uint32_t> seq;      // ticket + 1 cuando la línea está completa, 0 mientras se escribe
+        uint32_t ms;
+        uint8_t level;
+        char text[LOG_LINE_MAX];
+    };
+
+    Entry entries[LOG_RING_SIZE];
+    std::atomic<uint32_t> head;
+
+    uint32_t serialCursor;
+    uint32_t dropped;               // Líneas sobrescritas antes de llegar a Serial
+    bool taskStarted;
+
+    bool readEntry(uint32_t ticket, LogLine& line);
+    static void drainTask(void* param);
+};
+
+// Instancia global
+extern Logger logger;
+
+#endif // LOGGER_H
@@ -5,68 +5,178 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
 #include "config.h"
 #include "Storage.h"
 
+// ============================================
+// CLIENTE MQTT
+// Una tarea propia (MQTT_TASK_CORE) es la única que usa PubSubClient:
+// conecta, atiende el socket y vacía la cola de salida. El resto del
+// firmware solo encola con publish(), así un broker lento no frena la
+// radio. Los comandos recibidos vuelven a loop() por una cola de entrada.
+// ============================================
 class MQTTClientManager {
 public:
     MQTTClientManager();
 
-    // Inicialización
+    // Inicialización (arranca la tarea MQTT la primera vez)
     bool begin(SystemConfig* config);
     void stop();
 
     // Conexión
-    bool connect();
-    void disconnect();
     bool isConnected();
-    void loop();
+    void loop();                // Comandos recibidos y publicaciones periódicas
 
-    // Home Assistant Discovery
-    void publishDiscovery();
+    // Cola de salida
+    uint8_t getQueueDepth() const;
+
+    // Home Assistant Discovery: trabajo incremental avanzado por loop().
+    // force = republicar también las configs sin cambios
+    void publishDiscovery(bool force = false);
+    bool isDiscoveryRunning() const { return discoveryRunning; }
     void removeDiscovery();
+    void removeSceneDiscovery(const char* sceneId);
 
-    // Publicación de estado
+    // Publicación de estado. El último estado de cada dispositivo queda en
+    // DeviceStates: sin conexión no se encola, se republica al reconectar
     void publishDeviceState(const char* deviceId, const char* state);
-    void publishAllStates();
+    void publishCoverPosition(const char* deviceId, uint8_t position, const char* state);
+    void publishAllStates();        // Replay por tandas desde loop()
     void publishSystemStatus();
 
-    // Callbacks
-    void setCommandCallback(void (*callback)(const char* deviceId, const char* command));
-
 private:
     WiFiClient wifiClient;
     PubSubClient mqtt;
     SystemConfig* sysConfig;
 
-    bool enabled;
+    std::atomic<bool> enabled;
+    std::atomic<bool> reconfigure;      // begin() pide a la tarea aplicar pendingConnection
+    volatile bool linkUp;               // Conectado (escrito solo por la tarea)
+    volatile bool connectedEvent;       // La tarea avisa a loop() de una nueva conexión
+    bool taskStarted;
     unsigned long lastReconnectAttempt;
     unsigned long lastStatusPublish;
-
-    void (*onCommand)(const char* deviceId, const char* command);
+    unsigned long lastMetricsPublish;
+
+    // Trabajo de discovery: elementos del sistema y luego uno por dispositivo
+    bool discoveryRunning;
+    bool discoveryForce;
+    bool discoveryDirty;                // Hashes sin guardar en DISCOVERY_FILE
+    uint16_t discoveryItem;
+    uint16_t discoveryPublished;
+    uint16_t discoverySkipped;
+    unsigned long lastDiscoveryTick;
+    DiscoveryHash discoveryHashes[DISCOVERY_HASH_MAX];
+    uint16_t discoveryHashCount;
+
+    // Replay de estados al conectar: un dispositivo de la caché de topics por paso
+    bool replayRunning;
+    uint16_t replayItem;
+    uint16_t replayPublished;
+
+    // Cola de salida: topic y payload en un bloque, en orden FIFO
+    struct Outbound {
+        char* data;
+        uint16_t topicLength;
+        uint16_t size;
+        uint32_t hash;              // FNV-1a del topic (coalescencia)
+        bool retained;
+    };
+    Outbound queue[MQTT_QUEUE_DEPTH];
+    uint8_t queueHead;
+    volatile uint8_t queueCount;
+    size_t queueBytes;
+    uint8_t queuePeak;
+    SemaphoreHandle_t queueLock;        // Secciones cortas: nunca E/S de red
+    SemaphoreHandle_t queueFreed;       // Binario: drainQueue() liberó lugares
+
+    // Cola de entrada (tarea MQTT -> loop())
+    struct Inbound {
+        char topic[MQTT_INBOX_TOPIC_MAX];
+        char payload[MQTT_INBOX_PAYLOAD_MAX];
+    };
+    QueueHandle_t inbox;
+
+    // Datos de conexión de la tarea. begin() no espera a la tarea (que
+    // puede estar bloqueada en connect()): escribe pendingConnection y la
+    // tarea la copia en connection, con pendingSeq como seqlock
+    struct Connection {
+        char server[sizeof(SystemConfig::mqtt_server)];
+        uint16_t port;
+        char clientId[sizeof(SystemConfig::mqtt_client_id)];
+        char user[sizeof(SystemConfig::mqtt_user)];
+        char password[sizeof(SystemConfig::mqtt_password)];
+        char baseTopic[64];
+        char availabilityTopic[72];
+    };
+    Connection pendingConnection;       // Escrita solo por begin()
+    Connection connection;              // Solo la tarea
+    std::atomic<uint32_t> pendingSeq;   // Impar mientras begin() escribe
 
     // Topics
     String baseTopic;
     String commandTopic;
     String stateTopic;
     String availabilityTopic;
+    String systemTopicPrefix;
+    String roomTopicPrefix;
+    String groupTopicPrefix;
+    String sceneTopicPrefix;
 
     // Métodos internos
+    bool publish(const char* topic, const char* payload, bool retained);
+    bool enqueue(const Outbound& entry);
+    Outbound* findRetained(const Outbound& entry);
+    bool evictTransient();
+    void updateQueueGauges();
+    bool waitForQueue(uint8_t slots, unsigned long timeoutMs);
+    void publishMetrics();
     void setupTopics();
+
+    // Tarea MQTT
+    static void mqttTask(void* param);
+    void service();
+    bool loadConnection();
+    bool connect();
+    void closeConnection();
     void subscribe();
-    void handleMessage(char* topic, uint8_t* payload, unsigned int length);
+    void drainQueue(uint8_t maxMessages);
+
+    void handleMessage(const char* topic, const char* message);
     static void mqttCallback(char* topic, uint8_t* payload, unsigned int length);
     void processDeviceCommand(const char* deviceId, const char* command);
     void processSignalCommand(const char* deviceId, int signalIndex, const char* command);
+    void processGroupCommand(const char* name, bool isRoom, const char* command);
+    void processSceneCommand(const char* name);
+    void processPositionCommand(const char* deviceId, const char* payload);
+    static void onCommandSent(const char* deviceId, const char* command);
+    static void onCoverPosition(const char* deviceId, uint8_t position, const char* state);
+    static void onRemoteTrigger(const char* deviceId, uint8_t signal);
     void processSystemCommand(const char* command, const char* payload);
-    void publishSystemButtons();
-    void publishDiagnosticSensors();
+    void publishState(const char* deviceId, const char* state);
+    void replayStep();
 
     // Home Assistant Discovery
+    void discoveryStep();
+    void finishDiscovery();
+    bool publishDiscoveryItem(uint16_t item);
+    bool publishConfig(const char* topic, const String& payload);
+    void publishSystemDiscovery(uint8_t index);
+    void publishSystemButton(const char* name, const char* idSuffix, const char* command,
+                             const char* icon, const char* deviceClass);
+    void publishHeapAlertDiscovery();
+    void publishDiagnosticSensor(const char* name, const char* idSuffix, const char* valueTemplate,
+                                 const char* unit, const char* deviceClass, const char* icon);
     void publishCoverDiscovery(const SavedDevice* device);
     void publishGateDiscovery(const SavedDevice* device);
     void publishSwitchDiscovery(const SavedDevice* device);
     void publishButtonDiscovery(const SavedDevice* device, uint8_t signalIndex);
+    void publishTriggerDiscovery(const SavedDevice* device);
+    void publishSceneDiscovery(uint8_t index);
     void removeCoverDiscovery(const char* deviceId);
     void removeSwitchDiscovery(const char* deviceId);
     void removeButtonDiscovery(const char* deviceId, uint8_t signalIndex);
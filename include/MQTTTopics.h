@@ -0,0 +1,104 @@
+#ifndef MQTT_TOPICS_H
+#define MQTT_TOPICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// CACHÉ DE TOPICS MQTT POR DISPOSITIVO
+// Los topics de estado, comando, comando por señal y discovery se arman
+// una sola vez en un bloque contiguo (arena) cuando cambia el catálogo.
+// Los topics entrantes se resuelven por hash FNV-1a en una tabla abierta
+// y se verifican con strcmp, sin String ni substring en el camino MQTT.
+// ============================================
+#define MQTT_TOPIC_NONE         0xFFFF
+#define MQTT_TOPIC_SIGNALS      4
+#define MQTT_TOPIC_HASH_SLOTS   512     // Potencia de 2, > MAX_DEVICES * 6 rutas
+#define MQTT_ROUTE_POSITION     -2      // signalIndex de <base>/<id>/position/set
+
+struct DeviceTopics {
+    char id[37];
+    uint8_t type;
+    uint8_t signalMask;             // Bit i = señal i válida
+    bool travel;                    // Cortina con recorrido medido (posición)
+    uint32_t idHash;
+
+    // Offsets dentro de la arena (MQTT_TOPIC_NONE si no aplica)
+    uint16_t state;
+    uint16_t set;
+    uint16_t discovery;             // cover/switch (vacío para dispositivos de botones)
+    uint16_t signalSet[MQTT_TOPIC_SIGNALS];
+    uint16_t signalDiscovery[MQTT_TOPIC_SIGNALS];   // button por señal
+    uint16_t position;              // Solo cortinas con recorrido medido
+    uint16_t positionSet;
+    uint16_t remote;                // Pulsaciones de un control físico (RxMonitor)
+    uint16_t triggerDiscovery[MQTT_TOPIC_SIGNALS];  // device_automation por señal reconocible
+};
+
+class MQTTTopicCache {
+public:
+    MQTTTopicCache();
+
+    // base = "rf_controller/<client_id>"; invalida la caché
+    void begin(const char* baseTopic, const char* clientId);
+
+    // Notificación de Storage: device == nullptr si se eliminó;
+    // id == nullptr si cambió todo el catálogo (restore, borrado)
+    void onDeviceChanged(const char* id, const SavedDevice* device);
+    void invalidate() { dirty = true; }
+
+    // Reconstruye si el catálogo cambió desde la última vez
+    bool ensure();
+
+    // Resuelve un topic entrante <base>/<id>/set, <base>/<id>/<n>/set o
+    // <base>/<id>/position/set. Devuelve el dispositivo y signalIndex
+    // (-1 = comando de dispositivo, MQTT_ROUTE_POSITION = posición).
+    const DeviceTopics* match(const char* topic, int8_t* signalIndex);
+
+    const DeviceTopics* find(const char* deviceId);
+    const DeviceTopics* at(uint16_t index) const { return index < deviceCount ? &devices[index] : nullptr; }
+    const char* topic(uint16_t offset) const;
+
+    const char* getStateTopic(const char* deviceId);
+    static const char* getComponent(uint8_t type);     // cover, switch o nullptr (botones)
+    static uint8_t getTriggerMask(uint8_t type, uint8_t signalMask);   // Señales que reconoce RxMonitor
+
+    uint16_t getDeviceCount() const { return deviceCount; }
+    size_t getArenaSize() const { return arenaSize; }
+
+    static uint32_t hash(const char* text);
+
+private:
+    struct Route {
+        uint32_t hash;
+        uint16_t topic;
+        uint8_t device;
+        int8_t signal;
+    };
+
+    char base[96];
+    char clientId[32];
+
+    DeviceTopics devices[MAX_DEVICES];
+    uint16_t deviceCount;
+
+    // Un único bloque: rutas seguidas del texto de los topics
+    uint8_t* block;
+    Route* routes;
+    uint16_t routeCount;
+    char* arena;
+    size_t arenaSize;
+
+    uint16_t slots[MQTT_TOPIC_HASH_SLOTS];     // Índice de ruta + 1 (0 = libre)
+    bool dirty;
+
+    void release();
+    size_t layout(bool fill, uint16_t* routesNeeded);
+    uint16_t append(bool fill, size_t* used, const char* format, ...) __attribute__((format(printf, 4, 5)));
+    void addRoute(uint16_t topicOffset, uint8_t device, int8_t signal);
+};
+
+// Instancia global
+extern MQTTTopicCache mqttTopics;
+
+#endif // MQTT_TOPICS_H
@@ -0,0 +1,98 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// MÉTRICAS
+// Contadores e histogramas de latencia con buckets fijos (µs), sin
+// memoria dinámica. Se exportan como texto Prometheus en /metrics y, en
+// forma compacta, por MQTT (<base>/metrics).
+// ============================================
+enum MetricCounter {
+    METRIC_COMMANDS = 0,        // Comandos recibidos (MQTT, HTTP)
+    METRIC_RF_TX_ERRORS,
+    METRIC_STORAGE_ERRORS,
+    METRIC_JSON_ERRORS,
+    METRIC_MQTT_PUBLISH_ERRORS,
+    METRIC_MQTT_QUEUE_DROPS,        // Descartados por cola llena
+    METRIC_MQTT_QUEUE_COALESCED,    // Retenidos reemplazados por un valor más nuevo
+    METRIC_MQTT_INBOX_DROPS,        // Comandos recibidos descartados
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricHistogram {
+    METRIC_CMD_TO_RF_US = 0,    // Recepción del comando -> inicio de TX
+    METRIC_RF_AIR_US,           // Duración de la transmisión
+    METRIC_STORAGE_READ_US,
+    METRIC_STORAGE_WRITE_US,
+    METRIC_JSON_PARSE_US,
+    METRIC_MQTT_PUBLISH_US,
+    METRIC_HTTP_HANDLER_US,
+    METRIC_HISTOGRAM_COUNT
+};
+
+enum MetricGauge {
+    METRIC_MQTT_QUEUE_DEPTH = 0,
+    METRIC_MQTT_QUEUE_BYTES,
+    METRIC_MQTT_QUEUE_PEAK,
+    METRIC_BOOT_RADIO_READY_MS,     // Reset -> primer comando RF posible
+    METRIC_GAUGE_COUNT
+};
+
+#define METRIC_BUCKETS      10      // Último bucket = +Inf
+
+struct MetricHistogramData {
+    uint32_t buckets[METRIC_BUCKETS];
+    uint32_t count;
+    uint64_t sumUs;
+    uint32_t maxUs;
+};
+
+class Metrics {
+public:
+    Metrics();
+
+    void increment(MetricCounter counter, uint32_t amount = 1);
+    void observe(MetricHistogram histogram, uint32_t valueUs);
+    void setGauge(MetricGauge gauge, uint32_t value);
+
+    // Camino de un comando: recepción -> inicio TX -> fin TX
+    void commandReceived();
+    void txStarted();
+    void txFinished(bool success);
+
+    uint32_t getCounter(MetricCounter counter) const;
+    const MetricHistogramData& getHistogram(MetricHistogram histogram) const;
+    uint32_t getGauge(MetricGauge gauge) const;
+    static uint32_t getBucketBound(uint8_t bucket);
+
+    void writePrometheus(Print& out);
+    String toCompactJson();    // Payload MQTT: {"h":{"cmd_rf":[n,media,max],...},...}
+
+private:
+    uint32_t counters[METRIC_COUNTER_COUNT];
+    MetricHistogramData histograms[METRIC_HISTOGRAM_COUNT];
+    uint32_t gauges[METRIC_GAUGE_COUNT];
+
+    unsigned long commandStartUs;
+    bool commandPending;
+    unsigned long txStartUs;
+};
+
+// Mide el tiempo de un bloque: { MetricScope scope(METRIC_STORAGE_READ_US); ... }
+class MetricScope {
+public:
+    explicit MetricScope(MetricHistogram histogram);
+    ~MetricScope();
+
+private:
+    MetricHistogram histogram;
+    unsigned long startUs;
+};
+
+// Instancia global
+extern Metrics metrics;
+
+#endif // METRICS_H
@@ -0,0 +1,86 @@
+#ifndef PULSE_TRACE_H
+#define PULSE_TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// FORMATO PULSETRACE (.ptr)
+// Grabación binaria de pulsos RX para análisis fuera del dispositivo y
+// reproducción en el build nativo. Little endian.
+//
+//   Cabecera (24 bytes):
+//     "PTRC" | version u8 | modulation u8 | flags u8 | rssi i8
+//     frequency_khz u32 | start_unix u32 (0 = sin NTP) | start_millis u32 | reservado u32
+//   Cuerpo: varints LEB128
+//     0, offset_ms, rssi (1 byte)   -> inicio de segmento (una ráfaga capturada)
+//     duración en µs (> 0)          -> pulso; los niveles alternan desde el
+//                                      indicado por PULSE_TRACE_FLAG_START_HIGH
+// ============================================
+#define PULSE_TRACE_MAGIC           "PTRC"
+#define PULSE_TRACE_VERSION         1
+#define PULSE_TRACE_HEADER_SIZE     24
+#define PULSE_TRACE_FLAG_START_HIGH 0x01
+
+struct PulseTraceHeader {
+    uint8_t version;
+    uint8_t modulation;
+    uint8_t flags;
+    int8_t rssi;
+    uint32_t frequencyKHz;
+    uint32_t startUnix;
+    uint32_t startMillis;
+};
+
+struct PulseTraceSegment {
+    uint32_t offsetMs;      // Desde start_millis
+    int8_t rssi;
+};
+
+class PulseTraceWriter {
+public:
+    explicit PulseTraceWriter(Print& out);
+
+    bool begin(const PulseTraceHeader& header);
+    bool beginSegment(uint32_t offsetMs, int8_t rssi);
+    bool addPulse(uint32_t durationUs);
+
+    // Un RFSignal capturado (duraciones de 16 bits big endian) como segmento
+    bool addSignal(const RFSignal* signal, uint32_t offsetMs, int8_t rssi);
+
+    uint32_t getBytesWritten() const { return bytesWritten; }
+    uint32_t getPulseCount() const { return pulseCount; }
+    uint16_t getSegmentCount() const { return segmentCount; }
+
+private:
+    Print& out;
+    uint32_t bytesWritten;
+    uint32_t pulseCount;
+    uint16_t segmentCount;
+    bool ok;
+
+    void writeByte(uint8_t value);
+    void writeU32(uint32_t value);
+    void writeVarint(uint32_t value);
+};
+
+class PulseTraceReader {
+public:
+    explicit PulseTraceReader(Stream& in);
+
+    bool begin(PulseTraceHeader& header);
+
+    // Lee el próximo segmento; si tiene más de maxPulses el resto se descarta
+    // (count indica los guardados). Retorna false al final del archivo.
+    bool readSegment(PulseTraceSegment& segment, uint32_t* pulses, uint16_t maxPulses, uint16_t& count);
+
+private:
+    Stream& in;
+    bool segmentPending;    // Ya se leyó el marcador 0 del próximo segmento
+
+    bool readByte(uint8_t& value);
+    bool readU32(uint32_t& value);
+    bool readVarint(uint32_t& value);
+};
+
+#endif // PULSE_TRACE_H
@@ -0,0 +1,52 @@
+#ifndef PULSE_TRAIN_H
+#define PULSE_TRAIN_H
+
+#include <Arduino.h>
+
+// ============================================
+// TREN DE PULSOS TX
+// Los encoders de protocolo generan aquí la forma de onda (nivel + duración)
+// y la reproducción temporizada queda separada en play(). Así la salida de
+// cada encoder se puede comparar pulso a pulso sin transmitir.
+// ============================================
+#define PULSE_TRAIN_MAX_PULSES  512         // Somfy completo ~390, A-OK/raw por repetición <= 256
+
+// Formato de cada pulso: bit 31 = nivel, bits 0-30 = µs
+#define PULSE_LEVEL_BIT         0x80000000UL
+#define PULSE_DURATION_MASK     0x7FFFFFFFUL
+
+class PulseTrain {
+public:
+    PulseTrain();
+
+    void clear();
+
+    // Agrega un pulso; si el nivel coincide con el anterior se suman las duraciones
+    bool add(bool level, uint32_t durationUs);
+    bool high(uint32_t durationUs) { return add(true, durationUs); }
+    bool low(uint32_t durationUs) { return add(false, durationUs); }
+
+    uint16_t size() const { return count; }
+    bool getLevel(uint16_t index) const;
+    uint32_t getDuration(uint16_t index) const;
+    uint32_t getTotalDuration() const;
+    bool isOverflowed() const { return overflowed; }
+
+    // Pulsos crudos, para guardar una copia compacta (ver Scenes)
+    const uint32_t* data() const { return pulses; }
+
+    // Reproduce el tren en un pin con plazos absolutos (sin deriva acumulada)
+    // y deja el pin en LOW. El manejo de interrupciones queda a cargo del llamador.
+    void play(uint8_t pin) const { play(pin, pulses, count); }
+    static void play(uint8_t pin, const uint32_t* pulses, uint16_t count);
+
+    // "+640 -640 ..." (signo = nivel), para comparar formas de onda
+    String toString() const;
+
+private:
+    uint32_t pulses[PULSE_TRAIN_MAX_PULSES];
+    uint16_t count;
+    bool overflowed;
+};
+
+#endif // PULSE_TRAIN_H
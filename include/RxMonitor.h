@@ -0,0 +1,67 @@
+#ifndef RX_MONITOR_H
+#define RX_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "SignalIndex.h"
+#include "TxScheduler.h"
+#include "SomfyRTS.h"
+
+// ============================================
+// RECONOCIMIENTO DE CONTROLES FÍSICOS
+// Mientras nadie usa la radio el CC1101 escucha en la frecuencia por
+// defecto (CC1101_RF::startListening). loop() arma los frames entre
+// separadores de SIGNAL_FP_GAP_US, calcula la huella de cada uno y la busca
+// en signalIndex. Las repeticiones de una pulsación cuentan una sola vez:
+// el estado sale por el mismo camino que un comando enviado y el trigger
+// de Home Assistant por <base>/<id>/remote. Los frames Somfy RTS no tienen
+// huella fija (rolling code): se decodifican y somfyRemotes sigue el
+// rolling code de cada control.
+// ============================================
+typedef void (*RemoteTriggerCallback)(const char* deviceId, uint8_t signal);
+
+class RxMonitor {
+public:
+    RxMonitor();
+
+    void begin(SystemConfig* config);
+    void loop();
+
+    // Comando reconocido (señal con comando propio) y pulsación de cualquier señal
+    void setCommandCallback(TxDoneCallback callback) { onCommand = callback; }
+    void setTriggerCallback(RemoteTriggerCallback callback) { onTrigger = callback; }
+
+    uint32_t getFrameCount() const { return frameCount; }
+    uint32_t getMatchCount() const { return matchCount; }
+
+private:
+    SystemConfig* sysConfig;
+    float listenFrequency;          // Frecuencia de la escucha en curso
+    TxDoneCallback onCommand;
+    RemoteTriggerCallback onTrigger;
+
+    // Frame en armado (duraciones entre separadores)
+    uint16_t frame[RF_MAX_SIGNAL_LENGTH / 2];
+    uint16_t frameLength;
+    bool frameOverflow;             // Más largo que el buffer (ruido): se descarta
+    unsigned long lastReadAt;       // millis() de la última duración leída
+
+    // Última pulsación reconocida: sus repeticiones la extienden
+    SignalFingerprint lastPress;
+    unsigned long lastPressAt;
+    bool pressing;
+
+    uint32_t frameCount;
+    uint32_t matchCount;
+
+    void addDuration(uint16_t duration);
+    void endFrame();
+    void processFrame();
+    void processSomfy(const SomfyFrame& somfy);
+    float getListenFrequency();
+};
+
+// Instancia global
+extern RxMonitor rxMonitor;
+
+#endif // RX_MONITOR_H
@@ -0,0 +1,119 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "PulseTrain.h"
+#include "TxScheduler.h"
+
+// ============================================
+// ESCENAS
+// scenes.json guarda pasos (dispositivo, comando, pausa). Al guardar (y al
+// arrancar) se compilan en una sola pasada por devices.json: cada paso queda
+// como forma de onda lista para reproducir (o frame FSK en Dooya). Los pasos
+// entre dos pausas forman un tramo que se ordena por perfil de radio y sale
+// en una ráfaga; ejecutar una escena no lee Storage ni codifica.
+//
+// Somfy: la forma de onda depende del rolling code, así que se precompila
+// con el próximo código y se vuelve a codificar desde loop() tras cada uso.
+// ============================================
+class Scenes {
+public:
+    Scenes();
+
+    bool begin();               // Compila scenes.json (después de Storage)
+    bool reload();              // Tras guardar scenes.json
+    void loop();                // Tramos pendientes y recompilación diferida
+
+    // Arranca la escena; el primer tramo sale en el próximo loop()
+    bool run(const char* sceneId);
+    bool isRunning() const { return active >= 0; }
+
+    // Escenas compiladas (discovery y API)
+    uint8_t getCount() const { return sceneCount; }
+    const char* getId(uint8_t index) const;
+    const char* getName(uint8_t index) const;
+    int8_t find(const char* sceneId) const;
+    size_t getCompiledBytes() const { return compiledBytes; }
+
+    // Se llama por cada paso transmitido, al cerrar su tramo
+    void setStepCallback(TxDoneCallback callback) { onStep = callback; }
+
+private:
+    enum StepKind {
+        STEP_NONE = 0,          // No compilado (dispositivo o comando inválido)
+        STEP_RAW,               // Señal capturada: OOK async a su frecuencia
+        STEP_AOK,
+        STEP_SOMFY,
+        STEP_DOOYA
+    };
+
+    struct SceneStep {
+        char deviceId[37];
+        char command[24];
+        uint8_t kind;
+        uint32_t profile;       // CC1101_RF::makeTxProfile
+        uint16_t pauseMs;       // Pausa tras el paso (cierra el tramo)
+
+        uint32_t* pulses;       // Formato PulseTrain (malloc)
+        uint16_t pulseCount;
+        float frequency;        // STEP_RAW
+        uint8_t modulation;     // STEP_RAW
+        uint8_t frame[DOOYA_BIDIR_FRAME_LEN];   // STEP_DOOYA
+
+        int8_t somfySlot;       // STEP_SOMFY: índice en somfyRemotes
+        uint8_t somfyCommand;
+        uint8_t codeOffset;     // Pasos anteriores del mismo control en la escena
+        uint16_t encodedCode;   // Rolling code con el que se codificó
+    };
+
+    struct Scene {
+        char id[SCENE_ID_LENGTH];
+        char name[SCENE_NAME_LENGTH];
+        uint16_t first;         // Índice en steps[]
+        uint8_t stepCount;
+    };
+
+    // Rolling code vigente por control Somfy usado en alguna escena
+    struct SomfySlot {
+        char deviceId[37];
+        SomfyRemote remote;
+        bool dirty;             // Pendiente de guardar en Storage
+    };
+
+    Scene entries[MAX_SCENES];
+    uint8_t sceneCount;
+    SceneStep* steps;           // Todas las escenas, en orden de ejecución
+    uint16_t stepTotal;
+    SomfySlot somfyRemotes[SCENE_MAX_SOMFY];
+    uint8_t somfyCount;
+    size_t compiledBytes;
+    uint32_t compiledGeneration;        // storage.getCatalogGeneration() al compilar
+    uint32_t seenGeneration;            // Recompilación diferida: último cambio visto
+    unsigned long seenAt;
+    bool reencodePending;
+    PulseTrain* scratch;                // Solo durante compile()
+
+    // Ejecución en curso
+    int8_t active;
+    uint8_t nextStep;
+    unsigned long nextAt;
+
+    TxDoneCallback onStep;
+
+    bool compile();
+    void release();
+    static bool visit(const SavedDevice* device, void* context);
+    void compileStep(SceneStep& step, const SavedDevice* device);
+    bool storePulses(SceneStep& step, const PulseTrain& train);
+    void orderScene(Scene& scene);
+    void encodeSomfy();
+    void playSegment();
+    bool playStep(SceneStep& step);
+    void persistSomfy();
+};
+
+// Instancia global
+extern Scenes scenes;
+
+#endif // SCENES_H
@@ -0,0 +1,99 @@
+#ifndef SCHEDULES_H
+#define SCHEDULES_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <time.h>
+#include "config.h"
+#include "TxScheduler.h"
+#include "CronSpec.h"
+
+// ============================================
+// PROGRAMACIONES
+// schedules.json guarda reglas cron ("30 21 * * 1-5") o de salida/puesta
+// del sol con desplazamiento ("sun": "sunset", "offset": -15, "days":
+// "1-5"), calculadas en el equipo con la hora local de TimeManager y la
+// lat/long de la configuración. Cada regla guarda su próximo disparo y un
+// min-heap por ese instante deja la comprobación de loop() en O(1): solo
+// se mira la raíz. Al disparar se recalcula esa regla y se reordena.
+// Funcionan sin broker: el destino va directo al planificador de TX.
+// ============================================
+class Schedules {
+public:
+    Schedules();
+
+    bool begin(SystemConfig* config);  // Carga schedules.json (después de Storage)
+    bool reload();                      // Tras guardar schedules.json
+    void reschedule();                  // Cambio de zona horaria o ubicación
+    void loop();
+
+    // Reglas cargadas (API)
+    uint8_t getCount() const { return ruleCount; }
+    const char* getId(uint8_t index) const;
+    time_t getNextFire(uint8_t index) const;    // 0 = sin próximo disparo
+
+    // Próxima salida/puesta del sol (UTC) para una fecha local; 0 si no ocurre
+    static time_t sunEvent(int year, int month, int day, int dayOfYear,
+                           float latitude, float longitude, bool sunrise);
+
+    // Se llama por cada dispositivo transmitido por una regla
+    void setCommandCallback(TxDoneCallback callback) { onCommand = callback; }
+
+private:
+    enum RuleKind {
+        RULE_CRON = 0,
+        RULE_SUNRISE,
+        RULE_SUNSET
+    };
+
+    enum TargetKind {
+        TARGET_DEVICE = 0,
+        TARGET_ROOM,
+        TARGET_GROUP,
+        TARGET_SCENE
+    };
+
+    struct Rule {
+        char id[SCHEDULE_ID_LENGTH];
+        char target[37];
+        char command[24];
+        int8_t position;            // set_position (0-100) en lugar de command; -1 = no
+
+        uint8_t kind;
+        int16_t offsetMin;          // Solo reglas de sol
+        uint8_t targetKind;
+
+        CronSpec cron;              // Reglas de sol: solo weekdays/anyWeekday
+
+        time_t nextFire;            // 0 = nunca
+    };
+
+    SystemConfig* sysConfig;
+    Rule rules[MAX_SCHEDULES];
+    uint8_t ruleCount;
+
+    // Min-heap de índices en rules[] por nextFire
+    uint8_t heap[MAX_SCHEDULES];
+    uint8_t heapCount;
+    bool scheduled;                 // Próximos disparos calculados con hora válida
+
+    TxDoneCallback onCommand;
+
+    bool load();
+    bool parseRule(JsonObject object, Rule& rule);
+
+    time_t nextFire(const Rule& rule, time_t after) const;
+    time_t nextSun(const Rule& rule, time_t after) const;
+
+    void schedule(time_t now);
+    void siftUp(uint8_t position);
+    void siftDown(uint8_t position);
+    bool earlier(uint8_t a, uint8_t b) const;
+
+    void fire(const Rule& rule);
+};
+
+// Instancia global
+extern Schedules schedules;
+
+#endif // SCHEDULES_H
@@ -0,0 +1,81 @@
+#ifndef SIGNAL_INDEX_H
+#define SIGNAL_INDEX_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// ÍNDICE DE HUELLAS DE SEÑALES
+// Cada señal guardada se reduce a una huella: el primer frame completo
+// (entre separadores de SIGNAL_FP_GAP_US), con cada duración reemplazada
+// por el cluster al que pertenece, y el pulso base (cluster más corto).
+// El índice en RAM responde al capturar "coincide con el dispositivo X,
+// botón Y" sin leer devices.json y detecta señales repetidas. Las cortinas
+// A-OK (código fijo) entran con la forma de onda de sus comandos.
+// La búsqueda por hash es O(1): RxMonitor la usa en cada frame recibido.
+// ============================================
+
+struct SignalFingerprint {
+    uint32_t hash;          // FNV-1a de la secuencia de símbolos del frame
+    uint16_t base;          // µs del cluster más corto
+    uint16_t symbols;       // Duraciones en el frame
+    uint8_t clusters;
+};
+
+struct SignalMatch {
+    const char* deviceId;   // Válido hasta el próximo cambio en devices.json
+    uint8_t type;           // DeviceType
+    uint8_t signal;         // Índice de señal (A-OK: 0/1/2 = subir/bajar/parar)
+};
+
+class SignalIndex {
+public:
+    SignalIndex();
+
+    void begin();               // Indexa devices.json (después de Storage)
+
+    // Notificación de Storage (misma semántica que CoverPositions)
+    void onDeviceChanged(const char* id, const SavedDevice* device);
+
+    // false si la señal es muy corta o parece ruido
+    static bool fingerprint(const RFSignal* signal, SignalFingerprint* out);
+    static bool fingerprint(const uint16_t* durations, uint16_t count, SignalFingerprint* out);
+    static bool matches(const SignalFingerprint& a, const SignalFingerprint& b);
+
+    // Señales guardadas con la misma huella
+    uint8_t find(const SignalFingerprint& fp, SignalMatch* out, uint8_t maxMatches);
+
+    // Recorrido del índice (reporte de duplicados)
+    uint16_t getCount();
+    bool getEntry(uint16_t index, SignalMatch* match, SignalFingerprint* fp);
+
+private:
+    struct Entry {
+        SignalFingerprint fp;
+        uint8_t device;         // Índice en ids[]
+        uint8_t signal;
+    };
+
+    char ids[MAX_DEVICES][37];  // "" = libre
+    uint8_t types[MAX_DEVICES];
+    uint8_t idCount;
+    Entry entries[SIGNAL_INDEX_MAX];
+    uint16_t entryCount;
+
+    uint16_t slots[SIGNAL_INDEX_SLOTS];     // Índice de entrada + 1 (0 = libre)
+
+    uint32_t generation;        // storage.getCatalogGeneration() del índice
+    bool stale;
+
+    void ensure();
+    static bool visit(const SavedDevice* device, void* context);
+    void add(const SavedDevice* device);
+    static uint8_t aokFingerprints(const SavedDevice* device, SignalFingerprint* fps);
+    void remove(const char* id);
+    void rehash();
+};
+
+// Instancia global
+extern SignalIndex signalIndex;
+
+#endif // SIGNAL_INDEX_H
@@ -3,6 +3,15 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "PulseTrain.h"
+
+// Frame recibido de un control físico, ya desofuscado y verificado
+struct SomfyFrame {
+    uint32_t address;       // 24 bits
+    uint16_t rollingCode;
+    uint8_t command;        // SOMFY_CMD_*
+    uint8_t key;
+};
 
 class SomfyRTS {
 public:
@@ -28,6 +37,19 @@ public:
     // Comando genérico
     bool sendCommand(uint8_t command);
 
+    // Forma de onda del comando con el rolling code actual (sin transmitir
+    // ni incrementar el rolling code)
+    bool encodeCommand(uint8_t command, PulseTrain& train);
+
+    // Reproduce una forma de onda ya codificada (no toca el rolling code)
+    bool transmitPulses(const uint32_t* pulses, uint16_t count);
+
+    // Recepción: frame de 7 bytes tal como sale al aire, o las duraciones de
+    // un frame de RxMonitor (del LOW del sync por software al separador
+    // siguiente). false si no es Manchester Somfy o el checksum no cierra.
+    static bool decodeFrame(const uint8_t* raw, SomfyFrame* out);
+    static bool decodePulses(const uint16_t* durations, uint16_t count, SomfyFrame* out);
+
     // Utilidades
     void incrementRollingCode();
     String getStatusString();
@@ -45,13 +67,8 @@ private:
     // Métodos internos
     void buildFrame(uint8_t command);
     void obfuscateFrame();
-    void transmitFrame(bool isFirstFrame);
-    void sendBit(bool bit);
-    void sendHardwareSync(int count);
-    void sendSoftwareSync();
-
-    // Timing preciso
-    void delayMicrosecondsPrecise(unsigned long us);
+    static void deobfuscateFrame(uint8_t* frame);
+    void encodeFrame(bool isFirstFrame, PulseTrain& train);
 };
 
 // Instancia global
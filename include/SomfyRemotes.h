@@ -0,0 +1,79 @@
+#ifndef SOMFY_REMOTES_H
+#define SOMFY_REMOTES_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "SomfyRTS.h"
+
+// ============================================
+// CONTROLES SOMFY FÍSICOS
+// Último rolling code de cada control Somfy escuchado por RxMonitor. Un
+// frame con el mismo código es una repetición de la pulsación y uno
+// anterior, una retransmisión vieja: ninguno de los dos cuenta. Si la
+// dirección es la de una cortina Somfy guardada, su rolling code se
+// adelanta para que el control virtual no quede detrás del motor; el código
+// adelantado queda en RAM y se guarda diferido (SOMFY_RC_SAVE_MS).
+// ============================================
+struct SomfyRemoteSeen {
+    uint32_t address;
+    uint16_t rollingCode;       // Último recibido
+    uint8_t command;            // SOMFY_CMD_* de la última pulsación
+    unsigned long lastSeen;     // millis()
+};
+
+class SomfyRemotes {
+public:
+    SomfyRemotes();
+
+    void begin();               // Cortinas Somfy del catálogo (después de Storage)
+    void loop();                // Guardado diferido de rolling codes adelantados
+    void flush();               // Guardar ya (antes de reiniciar)
+
+    // Notificación de Storage (misma semántica que SignalIndex)
+    void onDeviceChanged(const char* id, const SavedDevice* device);
+
+    // true si el frame es una pulsación nueva de ese control
+    bool track(const SomfyFrame& frame);
+
+    // Cortinas Somfy guardadas con esa dirección (ids válidos hasta el
+    // próximo cambio en devices.json)
+    uint8_t findDevices(uint32_t address, const char** ids, uint8_t maxIds);
+    bool hasDevices();
+
+    // Envíos: parten del rolling code adelantado aunque no esté guardado
+    void applyRollingCode(const char* id, SomfyRemote* remote) const;
+
+    uint8_t getCount() const { return count; }
+    const SomfyRemoteSeen* get(uint8_t index) const;
+
+private:
+    SomfyRemoteSeen remotes[SOMFY_REMOTES_MAX];
+    uint8_t count;
+
+    // Cortinas Somfy del catálogo
+    struct Device {
+        char id[37];
+        uint32_t address;
+        uint16_t rollingCode;   // Próximo a transmitir
+        bool pending;           // Adelantado y sin guardar
+    };
+
+    Device devices[MAX_DEVICES];
+    uint8_t deviceCount;
+    uint32_t generation;        // storage.getCatalogGeneration() de la tabla
+    bool stale;
+    bool dirty;                 // Algún rolling code sin guardar
+    unsigned long saveAt;
+
+    void ensure();
+    static bool visit(const SavedDevice* device, void* context);
+    void add(const SavedDevice* device);
+    void remove(const char* id);
+    Device* find(const char* id);
+    void syncRollingCode(uint32_t address, uint16_t rollingCode);
+};
+
+// Instancia global
+extern SomfyRemotes somfyRemotes;
+
+#endif // SOMFY_REMOTES_H
@@ -21,14 +21,22 @@ public:
     void setDefaultConfig(SystemConfig* config);
 
     // Dispositivos guardados
-    bool loadDevices(SavedDevice* devices, uint8_t* count);
-    bool saveDevices(const SavedDevice* devices, uint8_t count);
+    bool loadDevices(SavedDevice* devices, uint16_t* count);
+    bool saveDevices(const SavedDevice* devices, uint16_t count);
     bool addDevice(const SavedDevice* device);
     bool updateDevice(const char* id, const SavedDevice* device);
     bool deleteDevice(const char* id);
     bool getDevice(const char* id, SavedDevice* device);
-    uint8_t getDeviceCount();
-    bool getDeviceByIndex(uint8_t index, SavedDevice* device);
+    uint16_t getDeviceCount();          // O(1): leído de la cabecera del catálogo
+    uint32_t getCatalogGeneration();    // Cambia en cada escritura de devices.json
+    bool getDeviceByIndex(uint16_t index, SavedDevice* device);
+
+    // Una sola pasada por devices.json; el visitante devuelve false para cortar
+    bool forEachDevice(bool (*visitor)(const SavedDevice* device, void* context), void* context);
+
+    // Aviso tras cada escritura de devices.json: device == nullptr si se
+    // eliminó; id == nullptr si cambió el catálogo completo
+    void setDeviceChangeCallback(void (*callback)(const char* id, const SavedDevice* device));
 
     // Señales RF
     bool saveSignalToDevice(const char* deviceId, uint8_t signalIndex,
@@ -38,14 +46,47 @@ public:
     bool updateSignalInverted(const char* deviceId, uint8_t signalIndex, bool inverted);
 
     // Somfy RTS
-    bool updateSomfyRollingCode(const char* deviceId, uint16_t newRollingCode);
+    // forwardOnly: no retrocede si otro camino ya guardó un código más nuevo
+    bool updateSomfyRollingCode(const char* deviceId, uint16_t newRollingCode, bool forwardOnly = false);
+
+    // Grupos de dispositivos (groups.json): [{"id","name","members":[ids]}]
+    bool loadGroupMembers(const char* groupId, char members[][37], uint8_t maxMembers, uint8_t* count);
+    String getGroupsJson();
+    bool saveGroups(const String& json);    // Valida y reemplaza todos los grupos
+
+    // Escenas (scenes.json): [{"id","name","steps":[{"device","command","delay"}]}]
+    String getScenesJson();
+    bool saveScenes(const String& json);    // Valida y reemplaza todas las escenas
+
+    // Programaciones (schedules.json): [{"id","cron"|"sun","offset","days",
+    // "device"|"room"|"group"|"scene","command"|"position","enabled"}]
+    String getSchedulesJson();
+    bool saveSchedules(const String& json); // Valida y reemplaza todas las reglas
+
+    // Hashes del discovery de Home Assistant ya publicado
+    uint16_t loadDiscoveryHashes(DiscoveryHash* entries, uint16_t maxEntries);
+    bool saveDiscoveryHashes(const DiscoveryHash* entries, uint16_t count);
+
+    // Posición estimada de las cortinas con recorrido medido
+    uint16_t loadCoverPositions(CoverPositionRecord* entries, uint16_t maxEntries);
+    bool saveCoverPositions(const CoverPositionRecord* entries, uint16_t count);
 
-    // Backup y Restore
-    String createBackup();
-    bool restoreBackup(const String& backupJson);
+    // Último estado conocido de cada dispositivo (replay al reconectar MQTT)
+    uint16_t loadDeviceStates(DeviceStateRecord* entries, uint16_t maxEntries);
+    bool saveDeviceStates(const DeviceStateRecord* entries, uint16_t count);
+
+    // Backup y Restore en streaming (memoria constante)
+    bool createBackup(Print& out);
+    bool restoreBackup(File& in);
     bool exportToFile(const char* filename);
     bool importFromFile(const char* filename);
 
+    // Subida de /api/restore por partes: se guarda en RESTORE_FILE y se aplica
+    bool beginRestoreUpload();
+    bool appendRestoreUpload(const uint8_t* data, size_t length);
+    void abortRestoreUpload();
+    bool restoreUploaded();
+
     // Utilidades
     String generateUUID();
     bool fileExists(const char* path);
@@ -56,6 +97,32 @@ public:
 private:
     bool initialized;
 
+    // Cabecera del catálogo (copia en RAM de CATALOG_FILE)
+    uint16_t catalogCount;
+    uint32_t catalogGeneration;
+    uint32_t catalogCrc;
+    size_t catalogSize;
+
+    File restoreUpload;         // Subida de /api/restore en curso
+
+    void (*onDeviceChange)(const char* id, const SavedDevice* device);
+    void notifyDeviceChange(const char* id, const SavedDevice* device);
+
+    bool loadCatalog();
+    bool rebuildCatalog();
+    bool saveCatalogHeader();
+    uint16_t countDevicesInFile();
+
+    // Lectura en streaming de devices.json (un elemento del array a la vez)
+    bool seekDevice(File& file, const char* id, int16_t index);
+    bool readDeviceAt(File& file, SavedDevice* device);
+    bool rewriteDevices(const char* targetId, const SavedDevice* replacement);
+    bool writeDeviceJson(Print& out, const SavedDevice* device);
+    bool commitDevicesFile(uint16_t count, uint32_t crc, size_t size);
+    bool copyRange(File& in, size_t start, size_t end, Print& out);
+    bool atArrayEnd(Stream& in);
+    bool findRootKey(Stream& in, const char* key);
+
     // Helpers JSON
     void signalToJson(JsonObject& obj, const RFSignal* signal);
     void jsonToSignal(JsonObject& obj, RFSignal* signal);
@@ -41,7 +41,13 @@ public:
     // Configuración
     void setTimezone(const char* timezone);
     void setNTPServer(const char* server);
-    bool syncTime();
+    bool syncTime();    // Inicia SNTP y retorna sin esperar la respuesta
+
+    // Procesamiento periódico (reintentos sin bloquear)
+    void loop();
+
+    // Callback al completar cada sincronización SNTP
+    void setSyncCallback(void (*callback)());
 
     // Obtener tiempo
     String getTimeString();
@@ -61,12 +67,18 @@ public:
 
 private:
     SystemConfig* sysConfig;
-    bool synced;
-    unsigned long lastSyncTime;
+    volatile bool synced;
+    volatile unsigned long lastSyncTime;
+    volatile bool syncLogPending;
+    unsigned long lastSyncRequest;
+    bool sntpStarted;
+    void (*onSync)();
     char currentTimezone[64];
     char ntpServer[64];
+    char tzString[64];          // Cadena POSIX aplicada en TZ
 
-    void configureTimezone(const char* tzString);
+    void configureTimezone(const char* posixTz);
+    static void sntpSyncNotification(struct timeval* tv);
 };
 
 // Instancia global
@@ -0,0 +1,92 @@
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// PLANIFICADOR DE TRANSMISIÓN
+// Los comandos se encolan y, TX_SCHED_WINDOW_MS después del primero, se
+// transmiten en una ráfaga: primero el perfil de radio en curso, luego el
+// trabajo elegible más antiguo. Los trabajos de un mismo dispositivo salen
+// en orden de llegada y ninguno se demora más de TX_SCHED_MAX_DELAY_MS por
+// trabajos posteriores que salieron antes. Dentro de la ráfaga el CC1101 solo se reconfigura
+// cuando cambia el perfil (ver CC1101_RF::beginBurst).
+// ============================================
+
+// Acciones de los protocolos con encoder propio (Somfy, Dooya, A-OK)
+enum ProtocolAction {
+    ACTION_UP = 0,
+    ACTION_DOWN = 1,
+    ACTION_STOP = 2,
+    ACTION_PROG = 3
+};
+
+// Se llama tras la ráfaga por cada trabajo transmitido; no debe encolar otro
+typedef void (*TxDoneCallback)(const char* deviceId, const char* command);
+
+class TxScheduler {
+public:
+    TxScheduler();
+
+    // Encola un comando de texto ("open", "off", "2"...) para el dispositivo.
+    // Devuelve false si el dispositivo no acepta el comando.
+    bool submit(const SavedDevice* device, const char* command, TxDoneCallback onDone);
+
+    // Encola una señal concreta de un dispositivo con señales capturadas
+    bool submitSignal(const SavedDevice* device, uint8_t signalIndex,
+                      const char* command, TxDoneCallback onDone);
+
+    void loop();                // Lanza la ráfaga cuando vence la ventana
+    uint8_t flush();            // Transmite todo lo pendiente ya mismo
+
+    uint8_t getPending() const { return jobCount; }
+
+    // Dentro de un TxDoneCallback: millis() al empezar a transmitir ese
+    // trabajo (la ráfaga puede durar mucho más). 0 fuera de los callbacks.
+    unsigned long getDoneSentAt() const { return doneSentAt; }
+
+    // Comando de texto -> índice de señal para dispositivos con señales capturadas
+    static int8_t getSignalIndex(uint8_t type, const char* command);
+
+    // Inverso: comando que transmite la señal `signal` (nullptr si no hay uno
+    // propio, p.ej. botones). En cortinas con protocolo signal = ProtocolAction.
+    static const char* getSignalCommand(uint8_t type, uint8_t signal);
+
+    // Comando de texto -> ProtocolAction (-1 si no aplica)
+    static int8_t getProtocolAction(const char* command);
+
+private:
+    struct TxJob {
+        char deviceId[37];
+        char command[24];
+        uint8_t type;
+        int8_t action;          // Índice de señal, o acción de protocolo (subir/bajar/parar/prog)
+        uint32_t profile;       // CC1101_RF::makeTxProfile
+        unsigned long queuedAt;
+        unsigned long sentAt;
+        uint32_t bypassedMs;    // Demora causada por trabajos posteriores que salieron antes
+        TxDoneCallback onDone;
+
+        union {
+            SomfyRemote somfy;
+            DooyaBidirRemote dooyaBidir;
+            AOKRemote aok;
+        };
+        RFSignal* signal;       // Solo señales capturadas (malloc)
+    };
+
+    TxJob jobs[TX_SCHED_QUEUE_DEPTH];    // En orden de llegada
+    uint8_t jobCount;
+    unsigned long doneSentAt;
+
+    TxJob* reserve(const SavedDevice* device, const char* command, TxDoneCallback onDone);
+    int8_t pickNext(const bool* done, uint32_t currentProfile);
+    bool transmit(TxJob& job);
+    void release(TxJob& job);
+};
+
+// Instancia global
+extern TxScheduler txScheduler;
+
+#endif // TX_SCHEDULER_H
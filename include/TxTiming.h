@@ -0,0 +1,74 @@
+#ifndef TX_TIMING_H
+#define TX_TIMING_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "PulseTrain.h"
+
+// ============================================
+// MONITOR DE TIMING TX
+// Compara los anchos de pulso reales del pin de TX con los pedidos por el
+// encoder. En el ESP32 un canal RMT en RX lee el mismo pad (que queda en
+// modo entrada/salida); en el build nativo se usan los flancos de NativeHAL.
+//
+//   txTiming.arm(pin);
+//   train.play(pin);
+//   txTiming.measure(train);
+// ============================================
+#define TX_TIMING_BUCKETS       8
+
+struct TxTimingStats {
+    uint16_t pulses;        // Pulsos comparados
+    float meanUs;           // Error absoluto medio
+    uint16_t p99Us;
+    uint16_t maxUs;
+    bool countMismatch;     // Cantidad de pulsos medidos != pedidos
+};
+
+class TxTiming {
+public:
+    TxTiming();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Antes y después de reproducir un tren de pulsos (no-op si está deshabilitado)
+    void arm(uint8_t pin);
+    bool measure(const PulseTrain& requested) { return measure(requested.data(), requested.size()); }
+    bool measure(const uint32_t* pulses, uint16_t count);
+
+    const TxTimingStats& getLastStats() const { return last; }
+    uint32_t getTransmissions() const { return transmissions; }
+    uint32_t getMismatches() const { return mismatches; }
+    uint16_t getWorstUs() const { return worstUs; }
+
+    // Histograma acumulado de |error| por pulso
+    static uint16_t getBucketBound(uint8_t bucket);     // Límite superior en µs
+    uint32_t getBucketCount(uint8_t bucket) const;
+
+    void reset();
+    String getStatusString();
+
+private:
+    bool enabled;
+    bool armed;
+    uint8_t armedPin;
+    bool driverReady;
+
+    TxTimingStats last;
+    uint32_t transmissions;
+    uint32_t mismatches;
+    uint16_t worstUs;
+    uint32_t buckets[TX_TIMING_BUCKETS];
+
+    uint32_t measured[TX_TIMING_MAX_PULSES];
+    uint16_t errors[TX_TIMING_MAX_PULSES];
+
+    bool startCapture(uint8_t pin);
+    uint16_t finishCapture();   // Llena measured[], retorna la cantidad
+};
+
+// Instancia global
+extern TxTiming txTiming;
+
+#endif // TX_TIMING_H
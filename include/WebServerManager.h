@@ -51,6 +51,9 @@ private:
 
     // Configuración de rutas
     void setupRoutes();
+    void route(const char* uri, HTTPMethod method, void (WebServerManager::*handler)());
+    void route(const char* uri, HTTPMethod method, void (WebServerManager::*handler)(),
+               void (WebServerManager::*upload)());     // Cuerpo recibido por partes
 
     // Handlers de páginas
     void handleRoot();
@@ -64,11 +67,23 @@ private:
     void handleAddDevice();
     void handleUpdateDevice();
     void handleDeleteDevice();
+    void handleGetGroups();
+    void handleSaveGroups();
+    void handleSendGroup();
+    static void onGroupMemberSent(const char* deviceId, const char* command);
+    void handleGetScenes();
+    void handleSaveScenes();
+    void handleRunScene();
+    void handleGetSchedules();
+    void handleSaveSchedules();
+    void handleGetNextSchedules();
     void handleTransmitSignal();
     void handleStartCapture();
     void handleStopCapture();
     void handleGetCapture();
     void handleSaveSignal();
+    void handleSignalDuplicates();
+    void handleGetSomfyRemotes();
     void handleDeleteSignal();
     void handleTestSignal();
     void handleUpdateSignalRepeat();
@@ -77,8 +92,15 @@ private:
     void handleScanFrequency();
     void handleIdentifySignal();
     void handleDecodeAOK();
+    void handleRecordTrace();
+    void handleDownloadTrace();
+    void handleGetMetrics();
+    void handlePrometheusMetrics();
+    void handleGetLogs();
+    void handleTxMonitor();
     void handleBackup();
     void handleRestore();
+    void handleRestoreUpload();
     void handleWiFiScan();
     void handleWiFiConnect();
     void handleMqttRediscover();
@@ -86,6 +108,8 @@ private:
     void handleFactoryReset();
 
     // Helpers
+    void addSignalMatches(JsonArray matches, const RFSignal* signal,
+                          const char* excludeId, int8_t excludeSignal);
     String getContentType(const String& filename);
     void sendJsonResponse(int code, const String& json);
     void sendJsonError(int code, const String& message);
@@ -43,6 +43,26 @@
 #define MQTT_RECONNECT_DELAY    5000
 #define MQTT_BASE_TOPIC         "rf_controller"
 #define MQTT_DISCOVERY_PREFIX   "homeassistant"
+#define METRICS_MQTT_INTERVAL_MS 60000      // Resumen de métricas en <base>/metrics (0 = no publicar)
+
+// Cola de salida: la E/S con el broker corre en su propia tarea y los
+// comandos recibidos vuelven a loop() por una cola de entrada
+#define MQTT_QUEUE_DEPTH        64          // Mensajes pendientes de publicar
+#define MQTT_QUEUE_MAX_BYTES    12288       // Topic + payload de todos los pendientes
+#define MQTT_DRAIN_PER_TICK     8           // Publicaciones por vuelta de la tarea
+#define MQTT_INBOX_DEPTH        8           // Comandos recibidos pendientes para loop()
+#define MQTT_INBOX_TOPIC_MAX    128
+#define MQTT_INBOX_PAYLOAD_MAX  128
+#define MQTT_TASK_INTERVAL_MS   10
+#define MQTT_TASK_STACK         6144
+#define MQTT_TASK_PRIORITY      1
+#define MQTT_TASK_CORE          0           // Fuera del núcleo de loop() y la TX
+
+// Discovery incremental: se publica desde loop() en tandas pequeñas y se
+// omiten las configs cuyo hash no cambió desde la última publicación
+#define DISCOVERY_TICK_MS       100
+#define DISCOVERY_MSGS_PER_TICK 2           // Configs publicadas por tick
+#define DISCOVERY_SCAN_PER_TICK 8           // Elementos revisados por tick (publicados o sin cambios)
 
 // ============================================
 // CONFIGURACIÓN RF
@@ -52,6 +72,17 @@
 #define RF_MAX_SIGNAL_LENGTH    512     // bytes
 #define RF_REPEAT_TRANSMIT      6      // repeticiones (aumentado para mejor confiabilidad)
 
+// Modo del perfil de TX cargado en el CC1101 (ver CC1101_RF::makeTxProfile)
+#define RF_TX_MODE_ASYNC        1       // OOK async serial por GDO2 (señales raw, A-OK)
+#define RF_TX_MODE_FSK          2       // Paquetes 2-FSK (Dooya bidireccional)
+
+// Planificador de TX: los comandos que llegan dentro de la ventana se
+// transmiten en una ráfaga agrupada por perfil de radio
+#define TX_SCHED_WINDOW_MS      50      // Espera desde el primer trabajo pendiente
+#define TX_SCHED_MAX_DELAY_MS   1500    // Demora máxima por reordenamiento (~3 comandos)
+#define TX_SCHED_QUEUE_DEPTH    24
+#define TX_SCHED_GAP_MS         10      // Silencio entre trabajos consecutivos
+
 // Frecuencias predefinidas comunes
 const float RF_FREQUENCIES[] = {
     300.00,   // 300 MHz
@@ -156,6 +187,14 @@ enum RFProtocol {
 #define SOMFY_CMD_MY_UP         0x5     // My + Up
 #define SOMFY_CMD_MY_DOWN       0x6     // My + Down
 
+// Recepción de controles Somfy físicos (RxMonitor): cada duración del frame
+// es medio símbolo o uno entero según estos rangos
+#define SOMFY_RX_HALF_MIN       400     // us - medio símbolo más corto aceptado
+#define SOMFY_RX_HALF_MAX       960     // us - hasta aquí medio símbolo, después uno entero
+#define SOMFY_RX_FULL_MAX       1600    // us - símbolo entero más largo aceptado
+#define SOMFY_REMOTES_MAX       16      // Controles físicos seguidos (se reemplaza el más viejo)
+#define SOMFY_RC_SAVE_MS        10000   // Rolling code adelantado por un control: guardado diferido
+
 // ============================================
 // CONFIGURACIÓN DOOYA BIDIRECCIONAL (DDxxxx)
 // Protocolo: 433.92 MHz, FSK con encriptación
@@ -257,6 +296,118 @@ struct SavedDevice {
 
     // A-OK AC114 (solo usado si type == DEVICE_CURTAIN_AOK)
     AOKRemote aok;          // Remote ID y canal
+
+    // Recorrido medido de la cortina (0 = sin modelo de posición)
+    uint32_t travelOpenMs;  // Cerrada -> abierta
+    uint32_t travelCloseMs; // Abierta -> cerrada
+};
+
+// ============================================
+// GRUPOS Y HABITACIONES
+// <base>/room/<room>/set y <base>/group/<id>/set: los miembros se resuelven
+// en una sola pasada por devices.json y pasan juntos al planificador de TX
+// ============================================
+#define MAX_GROUP_MEMBERS       16
+#define GROUP_ID_LENGTH         32
+
+// ============================================
+// ESCENAS
+// <base>/scene/<id>/set: secuencia (dispositivo, comando, pausa) que se
+// precompila al guardar en formas de onda listas para reproducir
+// ============================================
+#define MAX_SCENE_STEPS         12
+#define SCENE_ID_LENGTH         32
+#define SCENE_NAME_LENGTH       32
+#define SCENE_MAX_DELAY_MS      60000       // Pausa máxima tras un paso
+#define SCENE_COMPILED_MAX_BYTES 32768      // Formas de onda de todas las escenas juntas
+#define SCENE_MAX_SOMFY         16          // Controles Somfy distintos entre todas las escenas
+#define SCENE_RECOMPILE_DELAY_MS 2000       // Espera tras un cambio en devices.json
+
+// ============================================
+// HUELLA DE SEÑALES CAPTURADAS
+// Un frame completo de la captura como secuencia de símbolos: las
+// duraciones se agrupan en clusters, así dos capturas del mismo botón dan
+// la misma huella aunque el receptor agregue jitter
+// ============================================
+#define SIGNAL_FP_GAP_US        4000        // Separa frames repetidos dentro de una captura
+#define SIGNAL_FP_CLUSTER_RATIO 13          // Salto x1.3 entre duraciones ordenadas: cluster nuevo (décimas)
+#define SIGNAL_FP_MAX_CLUSTERS  8           // Más duraciones distintas: ruido, sin huella
+#define SIGNAL_FP_MIN_SYMBOLS   16          // Frame mínimo para calcular huella
+#define SIGNAL_FP_BASE_TOLERANCE 30         // % de diferencia admitida en el pulso base
+#define SIGNAL_INDEX_MAX        (MAX_DEVICES * 4)
+#define SIGNAL_INDEX_SLOTS      512         // Tabla hash de huellas (potencia de 2, > 2 x SIGNAL_INDEX_MAX)
+#define SIGNAL_MATCH_MAX        8           // Coincidencias informadas por captura
+
+// ============================================
+// RECONOCIMIENTO DE CONTROLES FÍSICOS
+// Con la radio libre el CC1101 queda escuchando en la frecuencia por
+// defecto: cada frame recibido se busca en el índice de huellas y una
+// coincidencia se publica como estado del dispositivo y trigger de HA.
+// Los frames Somfy RTS (rolling code) se decodifican en lugar de compararse
+// ============================================
+#define RX_MONITOR_ENABLED      1
+#define RX_RING_SIZE            1024        // Duraciones pendientes de la ISR (potencia de 2)
+#define RX_DRAIN_PER_LOOP       256         // Duraciones procesadas por vuelta de loop()
+#define RX_RESUME_MS            300         // Radio libre este tiempo (TX, captura) antes de escuchar
+#define RX_REPEAT_HOLD_MS       400         // Repeticiones del mismo botón: una sola pulsación
+#define RX_LISTEN_BANDWIDTH_KHZ 812         // Ancho de banda RX: con cortinas Somfy se escucha
+                                            // entre 433.42 y la frecuencia por defecto
+
+// Squelch por carrier sense: el CC1101 saca CS en GDO2 y la ISR descarta los
+// pulsos que terminan sin portadora (ruido). El umbral es relativo a
+// MAGN_TARGET, de -7 a +7 dB (AGCCTRL1.CARRIER_SENSE_ABS_THR). GDO2 es
+// strapping del ESP32: al suspender la escucha vuelve a tri-state
+#define RX_SQUELCH_ENABLED      1
+#define RX_CARRIER_SENSE_DB     6
+
+// ============================================
+// POSICIÓN DE CORTINAS POR TIEMPO
+// Cortinas con recorrido medido: la posición se estima desde la hora de
+// cada comando y <base>/<id>/position/set abre o cierra y programa el stop
+// ============================================
+#define COVER_TRAVEL_MIN_MS     1000        // Recorrido mínimo aceptado
+#define COVER_TRAVEL_MAX_MS     300000      // Recorrido máximo aceptado
+#define COVER_POSITION_PUBLISH_MS 1000      // Publicación de posición en movimiento
+#define COVER_POSITION_SAVE_MS  5000        // Guardar posiciones tras detenerse todas
+
+struct CoverPositionRecord {
+    char id[37];
+    uint8_t position;       // 0 = cerrada, 100 = abierta
+};
+
+// ============================================
+// ÚLTIMO ESTADO DE CADA DISPOSITIVO
+// Sobrevive a cortes de WiFi/broker y reinicios: al reconectar se
+// republica el último estado de cada dispositivo, por tandas
+// ============================================
+#define STATE_LENGTH            24          // Igual que un comando (open, signal_2, ...)
+#define STATE_SAVE_MS           10000       // Guardado diferido tras el primer cambio
+#define STATE_REPLAY_BATCH      8           // Estados encolados por vuelta al reconectar
+
+struct DeviceStateRecord {
+    char id[37];
+    char state[STATE_LENGTH];
+};
+
+// ============================================
+// PROGRAMACIONES
+// Reglas cron (minuto hora día mes díaSemana) o salida/puesta del sol con
+// desplazamiento, evaluadas en el equipo con la hora de TimeManager
+// ============================================
+#define SCHEDULE_ID_LENGTH      32
+#define SCHEDULE_MAX_OFFSET_MIN 720         // Desplazamiento máximo sobre el sol (±)
+#define SCHEDULE_MAX_LATE_S     120         // Disparo atrasado máximo (p.ej. tras un salto del reloj)
+#define SCHEDULE_SEARCH_DAYS    1462        // Búsqueda del próximo disparo (4 años: 29/02)
+
+// ============================================
+// HASH DE CONFIG DE DISCOVERY PUBLICADA
+// FNV-1a del topic y del payload retenido en el broker
+// ============================================
+#define DISCOVERY_HASH_MAX      (16 + MAX_DEVICES * 8 + MAX_SCENES)     // Botones + triggers por dispositivo
+
+struct DiscoveryHash {
+    uint32_t topic;
+    uint32_t payload;
 };
 
 // ============================================
@@ -283,6 +434,10 @@ struct SystemConfig {
     int utc_offset;
     bool dst_enabled;
 
+    // Ubicación para salida/puesta del sol (0, 0 = sin configurar)
+    float latitude;
+    float longitude;
+
     // RF por defecto
     float default_frequency;
     int default_modulation;
@@ -292,11 +447,42 @@ struct SystemConfig {
     bool auto_detect_enabled;
 };
 
+// ============================================
+// MEDICIÓN DE TIMING TX (opcional, se activa en /api/metrics/tx-monitor)
+// El canal RMT lee el mismo pad que transmite (loopback por la matriz GPIO)
+// ============================================
+#define TX_TIMING_RMT_CHANNEL   0           // Usa los 8 bloques de memoria RMT (512 items)
+#define TX_TIMING_IDLE_US       65000       // Fin de captura (> gap inter-frame de Somfy)
+#define TX_TIMING_MAX_PULSES    1024
+
+// ============================================
+// LOGGER (buffer circular vaciado por una tarea de baja prioridad)
+// ============================================
+#ifndef LOG_LEVEL
+#define LOG_LEVEL               3           // 0=nada 1=error 2=warn 3=info 4=debug 5=verbose
+#endif
+#define LOG_RING_SIZE           64          // Líneas retenidas (también para /api/logs)
+#define LOG_LINE_MAX            112
+#define LOG_DRAIN_INTERVAL_MS   20
+#define LOG_TASK_STACK          3072
+#define LOG_TASK_PRIORITY       1
+#define LOG_TASK_CORE           0           // Fuera del núcleo de loop() y la TX
+
+// ============================================
+// SEGUIMIENTO DE HEAP
+// ============================================
+#define HEAP_CHECK_INTERVAL_MS  5000
+#define HEAP_FRAG_ALERT_PCT     60          // Alerta: 1 - mayor bloque / libre
+#define HEAP_FRAG_CLEAR_PCT     45          // Histéresis para despejar la alerta
+#define HEAP_LARGEST_ALERT      20480       // Alerta si el mayor bloque baja de esto (docs JSON de 16-32 KB)
+
 // ============================================
 // CONFIGURACIÓN POR DEFECTO
 // ============================================
 #define DEFAULT_TIMEZONE        "America/Bogota"
 #define DEFAULT_NTP_SERVER      "pool.ntp.org"
+#define NTP_SYNC_INTERVAL_MS    3600000     // Resincronización periódica SNTP (1 h)
+#define NTP_RETRY_MS            30000       // Reintento si aún no hubo sincronización
 #define DEFAULT_DEVICE_NAME     "RF_Controller"
 
 // ============================================
@@ -304,13 +490,34 @@ struct SystemConfig {
 // ============================================
 #define CONFIG_FILE             "/config.json"
 #define DEVICES_FILE            "/devices.json"
+#define DEVICES_TMP_FILE        "/devices.tmp"     // Reescritura atómica de devices.json
+#define CATALOG_FILE            "/catalog.json"    // Cabecera: count, generation, size, crc
 #define BACKUP_FILE             "/backup.json"
+#define RESTORE_FILE            "/restore.json"    // Backup subido por /api/restore (se borra al aplicarlo)
+#define TRACE_FILE              "/trace.ptr"       // Última grabación de pulsos (formato PulseTrace)
+#define DISCOVERY_FILE          "/discovery.json"  // Hashes de las configs de discovery publicadas
+#define GROUPS_FILE             "/groups.json"     // Grupos de dispositivos definidos por el usuario
+#define SCENES_FILE             "/scenes.json"     // Escenas: pasos (dispositivo, comando, pausa)
+#define POSITIONS_FILE          "/positions.json"  // Última posición estimada de cada cortina
+#define SCHEDULES_FILE          "/schedules.json"  // Programaciones: cron o sol -> comando
+#define STATES_FILE             "/states.json"     // Último estado de cada dispositivo (replay MQTT)
+#define TRACE_MAX_BYTES         65536              // Límite de la grabación en LittleFS
+#define TRACE_MAX_SECONDS       60
+// devices.json se lee y escribe de a un registro, pero las tablas en RAM
+// (SignalIndex, MQTTTopics, DeviceStates, CoverPositions, SomfyRemotes,
+// hashes de discovery) se dimensionan con MAX_DEVICES
 #define MAX_DEVICES             50
+#define MAX_GROUPS              16
+#define MAX_SCENES              8
+#define MAX_SCHEDULES           32
 
 // ============================================
 // TAMAÑOS DE BUFFER
 // ============================================
-#define JSON_BUFFER_SIZE        16384  // Increased for multiple signals with large data
+#define DEVICE_JSON_SIZE        8192   // UN dispositivo: 4 señales de 512 bytes en hex + metadatos
+#define GROUPS_JSON_SIZE        8192   // groups.json completo (MAX_GROUPS x MAX_GROUP_MEMBERS)
+#define SCENES_JSON_SIZE        12288  // scenes.json completo (MAX_SCENES x MAX_SCENE_STEPS)
+#define SCHEDULES_JSON_SIZE     8192   // schedules.json completo (MAX_SCHEDULES reglas)
 #define WEB_BUFFER_SIZE         4096
 
 #endif // CONFIG_H
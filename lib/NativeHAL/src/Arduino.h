@@ -0,0 +1,131 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// ============================================
+// Arduino/ESP32 mínimo para el build nativo (env:native)
+// Reloj virtual y GPIO simulados: ver NativeHAL.h
+// ============================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+#define INPUT_PULLDOWN  0x09
+
+#define RISING          0x01
+#define FALLING         0x02
+#define CHANGE          0x03
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s)            (s)
+
+#define digitalPinToInterrupt(p)    (p)
+#define portDISABLE_INTERRUPTS()    noInterrupts()
+#define portENABLE_INTERRUPTS()     interrupts()
+
+#ifndef constrain
+#define constrain(amt, low, high)   ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+using std::min;
+using std::max;
+
+// newlib (ESP32) la trae; glibc solo desde 2.38
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size) {
+        size_t n = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return length;
+}
+#endif
+
+// Tiempo (reloj virtual)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+// Interrupciones
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+// Hora del sistema (sin SNTP: el reloj es el del host). Como en el core
+// ESP32, configTime() reemplaza TZ por un offset fijo y configTzTime() la
+// fija a la cadena POSIX indicada.
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+void configTzTime(const char* tz, const char* server1,
+                  const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// Aleatorios (deterministas en el host)
+uint32_t esp_random();
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Serial sobre stdout
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// Heap simulado (el host no tiene un heap de tamaño fijo)
+#define NATIVE_HEAP_SIZE    327680
+
+class EspClass {
+public:
+    uint32_t getHeapSize() { return NATIVE_HEAP_SIZE; }
+    uint32_t getFreeHeap() { return NATIVE_HEAP_SIZE / 2; }
+    uint32_t getMinFreeHeap() { return NATIVE_HEAP_SIZE / 2; }
+    uint32_t getMaxAllocHeap() { return NATIVE_HEAP_SIZE / 4; }
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+#endif // NATIVE_ARDUINO_H
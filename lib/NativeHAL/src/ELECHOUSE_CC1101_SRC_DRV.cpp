@@ -0,0 +1,176 @@
+#include "ELECHOUSE_CC1101_SRC_DRV.h"
+
+ELECHOUSE_CC1101 ELECHOUSE_cc1101;
+
+// Strobes del CC1101
+#define SIM_SRES    0x30
+#define SIM_SRX     0x34
+#define SIM_STX     0x35
+#define SIM_SIDLE   0x36
+#define SIM_SPWD    0x39
+
+ELECHOUSE_CC1101::ELECHOUSE_CC1101() {
+    gdo0Pin = 0;
+    gdo2Pin = 0;
+    simReset();
+}
+
+void ELECHOUSE_CC1101::simReset() {
+    chipPresent = true;
+    mode = CC1101_SIM_MODE_IDLE;
+    memset(registers, 0, sizeof(registers));
+    frequency = 433.92;
+    modulation = 0;
+    rssiIdle = -100;
+    rssiActive = -40;
+    lqi = 0;
+    initCount = 0;
+    opLog.clear();
+    packets.clear();
+}
+
+void ELECHOUSE_CC1101::logCall(const char* name, float value) {
+    opLog.push_back({nativeHAL.nowMicros(), CC1101_OP_CALL, name, 0, value});
+}
+
+void ELECHOUSE_CC1101::Init() {
+    initCount++;
+    mode = CC1101_SIM_MODE_IDLE;
+    logCall("Init", 0);
+}
+
+void ELECHOUSE_CC1101::setSpiPin(byte sck, byte miso, byte mosi, byte ss) {
+    (void)sck; (void)miso; (void)mosi; (void)ss;
+}
+
+void ELECHOUSE_CC1101::setGDO(byte gdo0, byte gdo2) {
+    gdo0Pin = gdo0;
+    gdo2Pin = gdo2;
+}
+
+void ELECHOUSE_CC1101::setGDO0(byte gdo0) {
+    gdo0Pin = gdo0;
+}
+
+bool ELECHOUSE_CC1101::getCC1101() {
+    return chipPresent;
+}
+
+byte ELECHOUSE_CC1101::getMode() {
+    return mode;
+}
+
+void ELECHOUSE_CC1101::setCCMode(bool s) { logCall("setCCMode", s); }
+void ELECHOUSE_CC1101::setModulation(byte m) { modulation = m; logCall("setModulation", m); }
+void ELECHOUSE_CC1101::setPA(int p) { logCall("setPA", p); }
+void ELECHOUSE_CC1101::setMHZ(float mhz) { frequency = mhz; logCall("setMHZ", mhz); }
+void ELECHOUSE_CC1101::setChannel(byte chnl) { logCall("setChannel", chnl); }
+void ELECHOUSE_CC1101::setRxBW(float f) { logCall("setRxBW", f); }
+void ELECHOUSE_CC1101::setDRate(float d) { logCall("setDRate", d); }
+void ELECHOUSE_CC1101::setDeviation(float d) { logCall("setDeviation", d); }
+void ELECHOUSE_CC1101::setSyncMode(byte s) { logCall("setSyncMode", s); }
+void ELECHOUSE_CC1101::setPktFormat(byte v) { logCall("setPktFormat", v); }
+void ELECHOUSE_CC1101::setCrc(bool v) { logCall("setCrc", v); }
+void ELECHOUSE_CC1101::setLengthConfig(byte v) { logCall("setLengthConfig", v); }
+void ELECHOUSE_CC1101::setPacketLength(byte v) { logCall("setPacketLength", v); }
+void ELECHOUSE_CC1101::setDcFilterOff(bool v) { logCall("setDcFilterOff", v); }
+void ELECHOUSE_CC1101::setManchester(bool v) { logCall("setManchester", v); }
+void ELECHOUSE_CC1101::setPRE(byte v) { logCall("setPRE", v); }
+
+void ELECHOUSE_CC1101::setSyncWord(byte sh, byte sl) {
+    SpiWriteReg(0x04, sh);
+    SpiWriteReg(0x05, sl);
+}
+
+void ELECHOUSE_CC1101::SetTx() { SpiStrobe(SIM_STX); }
+void ELECHOUSE_CC1101::SetRx() { SpiStrobe(SIM_SRX); }
+void ELECHOUSE_CC1101::SetTx(float mhz) { setSidle(); setMHZ(mhz); SetTx(); }
+void ELECHOUSE_CC1101::SetRx(float mhz) { setSidle(); setMHZ(mhz); SetRx(); }
+void ELECHOUSE_CC1101::setSidle() { SpiStrobe(SIM_SIDLE); }
+void ELECHOUSE_CC1101::goSleep() { SpiStrobe(SIM_SPWD); }
+void ELECHOUSE_CC1101::setSres() { SpiStrobe(SIM_SRES); }
+
+// RSSI alto mientras haya pulsos inyectados pendientes en GDO0
+int ELECHOUSE_CC1101::getRssi() {
+    return nativeHAL.injectionActive() ? rssiActive : rssiIdle;
+}
+
+byte ELECHOUSE_CC1101::getLqi() {
+    return lqi;
+}
+
+void ELECHOUSE_CC1101::SendData(byte* txBuffer, byte size) {
+    packets.push_back(std::vector<byte>(txBuffer, txBuffer + size));
+    logCall("SendData", size);
+}
+
+void ELECHOUSE_CC1101::SendData(byte* txBuffer, byte size, int t) {
+    (void)t;
+    SendData(txBuffer, size);
+}
+
+byte ELECHOUSE_CC1101::CheckReceiveFlag() {
+    return 0;
+}
+
+byte ELECHOUSE_CC1101::ReceiveData(byte* rxBuffer) {
+    (void)rxBuffer;
+    return 0;
+}
+
+bool ELECHOUSE_CC1101::CheckCRC() {
+    return true;
+}
+
+void ELECHOUSE_CC1101::SpiStrobe(byte strobe) {
+    opLog.push_back({nativeHAL.nowMicros(), CC1101_OP_STROBE, "strobe", strobe, 0});
+
+    switch (strobe) {
+        case SIM_SRX:   mode = CC1101_SIM_MODE_RX; break;
+        case SIM_STX:   mode = CC1101_SIM_MODE_TX; break;
+        case SIM_SRES:
+            memset(registers, 0, sizeof(registers));
+            mode = CC1101_SIM_MODE_IDLE;
+            break;
+        case SIM_SIDLE:
+        case SIM_SPWD:  mode = CC1101_SIM_MODE_IDLE; break;
+        default: break;
+    }
+}
+
+void ELECHOUSE_CC1101::SpiWriteReg(byte addr, byte value) {
+    if (addr < CC1101_SIM_NUM_REGS) registers[addr] = value;
+    opLog.push_back({nativeHAL.nowMicros(), CC1101_OP_WRITE_REG, "reg", addr, (float)value});
+}
+
+void ELECHOUSE_CC1101::SpiWriteBurstReg(byte addr, byte* buffer, byte num) {
+    for (byte i = 0; i < num; i++) {
+        SpiWriteReg(addr + i, buffer[i]);
+    }
+}
+
+byte ELECHOUSE_CC1101::SpiReadReg(byte addr) {
+    return simGetRegister(addr);
+}
+
+byte ELECHOUSE_CC1101::SpiReadStatus(byte addr) {
+    return simGetRegister(addr);
+}
+
+void ELECHOUSE_CC1101::simInjectRx(const uint32_t* durations, size_t count, bool startHigh, uint64_t delayUs) {
+    nativeHAL.injectPulses(gdo0Pin, durations, count, startHigh, delayUs);
+
+    // Carrier sense en GDO2 (IOCFG2 = 0x0E): alto mientras dura el tren,
+    // con margen a los dos lados, si la señal supera el umbral
+    if (rssiActive < CC1101_SIM_CS_DBM || gdo2Pin == gdo0Pin) return;
+
+    uint32_t total = 0;
+    for (size_t i = 0; i < count; i++) total += durations[i];
+    uint64_t margin = delayUs < CC1101_SIM_CS_MARGIN_US ? delayUs : CC1101_SIM_CS_MARGIN_US;
+    uint32_t envelope = total + margin + CC1101_SIM_CS_MARGIN_US;
+    nativeHAL.injectPulses(gdo2Pin, &envelope, 1, true, delayUs - margin);
+}
+
+std::vector<SimPulse> ELECHOUSE_CC1101::simGetTxWaveform(uint8_t pin) const {
+    return nativeHAL.getWaveform(pin == 0xFF ? gdo2Pin : pin);
+}
@@ -0,0 +1,132 @@
+#ifndef NATIVE_ELECHOUSE_CC1101_H
+#define NATIVE_ELECHOUSE_CC1101_H
+
+#include <Arduino.h>
+#include <vector>
+#include "NativeHAL.h"
+
+// ============================================
+// CC1101 SIMULADO (misma interfaz que SmartRC-CC1101-Driver-Lib)
+// Registra escrituras de registros, strobes y llamadas de configuración;
+// la forma de onda TX se toma de los flancos escritos en GDO2/GDO0 y la
+// recepción se simula inyectando pulsos en GDO0 (ver NativeHAL).
+// ============================================
+
+#define CC1101_SIM_NUM_REGS     0x3E
+#define CC1101_SIM_CS_DBM       -90     // RSSI desde el que se afirma carrier sense
+#define CC1101_SIM_CS_MARGIN_US 50      // CS antes del primer flanco y después del último
+
+#define CC1101_SIM_MODE_IDLE    0
+#define CC1101_SIM_MODE_RX      1
+#define CC1101_SIM_MODE_TX      2
+
+enum CC1101SimOpType : uint8_t {
+    CC1101_OP_WRITE_REG,    // SpiWriteReg(addr, value)
+    CC1101_OP_STROBE,       // SpiStrobe(addr)
+    CC1101_OP_CALL          // Setter de alto nivel (name, value)
+};
+
+struct CC1101SimOp {
+    uint64_t timeUs;
+    CC1101SimOpType type;
+    const char* name;
+    uint8_t addr;
+    float value;
+};
+
+class ELECHOUSE_CC1101 {
+public:
+    ELECHOUSE_CC1101();
+
+    // Interfaz del driver real (solo lo que usa el firmware)
+    void Init();
+    void setSpiPin(byte sck, byte miso, byte mosi, byte ss);
+    void setGDO(byte gdo0, byte gdo2);
+    void setGDO0(byte gdo0);
+    bool getCC1101();
+    byte getMode();
+
+    void setCCMode(bool s);
+    void setModulation(byte m);
+    void setPA(int p);
+    void setMHZ(float mhz);
+    void setChannel(byte chnl);
+    void setRxBW(float f);
+    void setDRate(float d);
+    void setDeviation(float d);
+    void setSyncMode(byte s);
+    void setSyncWord(byte sh, byte sl);
+    void setPktFormat(byte v);
+    void setCrc(bool v);
+    void setLengthConfig(byte v);
+    void setPacketLength(byte v);
+    void setDcFilterOff(bool v);
+    void setManchester(bool v);
+    void setPRE(byte v);
+
+    void SetTx();
+    void SetRx();
+    void SetTx(float mhz);
+    void SetRx(float mhz);
+    void setSidle();
+    void goSleep();
+    void setSres();
+
+    int getRssi();
+    byte getLqi();
+
+    void SendData(byte* txBuffer, byte size);
+    void SendData(byte* txBuffer, byte size, int t);
+    byte CheckReceiveFlag();
+    byte ReceiveData(byte* rxBuffer);
+    bool CheckCRC();
+
+    void SpiStrobe(byte strobe);
+    void SpiWriteReg(byte addr, byte value);
+    void SpiWriteBurstReg(byte addr, byte* buffer, byte num);
+    byte SpiReadReg(byte addr);
+    byte SpiReadStatus(byte addr);
+
+    // ---- Control del simulador ----
+    void simReset();
+    void simSetPresent(bool present) { chipPresent = present; }
+    void simSetRssi(int idleDbm, int activeDbm) { rssiIdle = idleDbm; rssiActive = activeDbm; }
+    void simSetLqi(byte value) { lqi = value; }
+
+    // Recepción: inyecta un tren de pulsos (µs) en GDO0 y, si el RSSI
+    // activo llega a CC1101_SIM_CS_DBM, el carrier sense en GDO2
+    void simInjectRx(const uint32_t* durations, size_t count, bool startHigh = true, uint64_t delayUs = 0);
+
+    // Transmisión: forma de onda en el pin de datos TX (GDO2 por defecto)
+    std::vector<SimPulse> simGetTxWaveform(uint8_t pin = 0xFF) const;
+
+    const std::vector<CC1101SimOp>& simGetLog() const { return opLog; }
+    void simClearLog() { opLog.clear(); }
+    const std::vector<std::vector<byte>>& simGetPackets() const { return packets; }
+    byte simGetRegister(byte addr) const { return addr < CC1101_SIM_NUM_REGS ? registers[addr] : 0; }
+    float simGetFrequency() const { return frequency; }
+    byte simGetModulation() const { return modulation; }
+    uint32_t simGetInitCount() const { return initCount; }
+
+private:
+    bool chipPresent;
+    byte mode;
+    byte gdo0Pin;
+    byte gdo2Pin;
+    byte registers[CC1101_SIM_NUM_REGS];
+    float frequency;
+    byte modulation;
+    int rssiIdle;
+    int rssiActive;
+    byte lqi;
+    uint32_t initCount;
+
+    std::vector<CC1101SimOp> opLog;
+    std::vector<std::vector<byte>> packets;
+
+    void logCall(const char* name, float value);
+};
+
+extern ELECHOUSE_CC1101 ELECHOUSE_cc1101;
+
+#endif // NATIVE_ELECHOUSE_CC1101_H
@@ -0,0 +1,50 @@
+#ifndef NATIVE_HOST_FILE_H
+#define NATIVE_HOST_FILE_H
+
+#include <cstdio>
+#include "Stream.h"
+
+// ============================================
+// Stream sobre un archivo del host (rutas arbitrarias, fuera de LittleFS),
+// para que los módulos que escriben/leen Print/Stream trabajen con archivos
+// locales en el build nativo
+// ============================================
+class HostFile : public Stream {
+public:
+    HostFile(const char* path, const char* mode) { fp = fopen(path, mode); }
+    ~HostFile() { close(); }
+
+    explicit operator bool() const { return fp != nullptr; }
+    void close() {
+        if (fp) fclose(fp);
+        fp = nullptr;
+    }
+
+    size_t write(uint8_t c) override { return fp && fputc(c, fp) != EOF ? 1 : 0; }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return fp ? fwrite(buffer, 1, size, fp) : 0;
+    }
+
+    int available() override {
+        if (!fp) return 0;
+        int c = fgetc(fp);
+        if (c == EOF) return 0;
+        ungetc(c, fp);
+        return 1;
+    }
+    int read() override {
+        if (!fp) return -1;
+        int c = fgetc(fp);
+        return c == EOF ? -1 : c;
+    }
+    int peek() override {
+        int c = read();
+        if (c >= 0) ungetc(c, fp);
+        return c;
+    }
+
+private:
+    FILE* fp;
+};
+
+#endif // NATIVE_HOST_FILE_H
@@ -0,0 +1,226 @@
+#include "LittleFS.h"
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+class FileImpl {
+public:
+    FILE* fp = nullptr;
+    DIR* dir = nullptr;
+    std::string path;       // Ruta LittleFS ("/devices.json")
+    std::string hostPath;   // Ruta real en el host
+    std::string baseName;
+
+    ~FileImpl() {
+        if (fp) fclose(fp);
+        if (dir) closedir(dir);
+    }
+};
+
+static std::string baseNameOf(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!impl || !impl->fp) return 0;
+    return fwrite(buffer, 1, size, impl->fp);
+}
+
+int File::available() {
+    if (!impl || !impl->fp) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    if (!impl || !impl->fp) return -1;
+    int c = fgetc(impl->fp);
+    return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+    if (!impl || !impl->fp) return -1;
+    int c = fgetc(impl->fp);
+    if (c == EOF) return -1;
+    ungetc(c, impl->fp);
+    return c;
+}
+
+void File::flush() {
+    if (impl && impl->fp) fflush(impl->fp);
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!impl || !impl->fp) return 0;
+    return fread(buffer, 1, size, impl->fp);
+}
+
+bool File::seek(uint32_t pos) {
+    if (!impl || !impl->fp) return false;
+    return fseek(impl->fp, pos, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    if (!impl || !impl->fp) return 0;
+    long pos = ftell(impl->fp);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!impl || !impl->fp) return 0;
+    fflush(impl->fp);
+    struct stat st;
+    if (fstat(fileno(impl->fp), &st) != 0) return 0;
+    return (size_t)st.st_size;
+}
+
+void File::close() {
+    if (!impl) return;
+    if (impl->fp) {
+        fclose(impl->fp);
+        impl->fp = nullptr;
+    }
+    if (impl->dir) {
+        closedir(impl->dir);
+        impl->dir = nullptr;
+    }
+}
+
+const char* File::name() const {
+    return impl ? impl->baseName.c_str() : "";
+}
+
+const char* File::path() const {
+    return impl ? impl->path.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return impl && impl->dir;
+}
+
+File File::openNextFile() {
+    if (!impl || !impl->dir) return File();
+
+    struct dirent* entry;
+    while ((entry = readdir(impl->dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        std::string childPath = impl->path;
+        if (childPath.empty() || childPath.back() != '/') childPath += '/';
+        childPath += name;
+        return LittleFS.open(childPath.c_str(), "r");
+    }
+    return File();
+}
+
+File::operator bool() const {
+    return impl && (impl->fp || impl->dir);
+}
+
+LittleFSFS::LittleFSFS() {
+    const char* env = getenv("NATIVE_FS_ROOT");
+    root = env ? env : ".native_fs";
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles,
+                       const char* partitionLabel) {
+    (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+
+    struct stat st;
+    if (stat(root.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+    return ::mkdir(root.c_str(), 0755) == 0;
+}
+
+bool LittleFSFS::format() {
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return begin();
+
+    // Solo archivos en la raíz, como usa el firmware
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        ::remove((root + "/" + name).c_str());
+    }
+    closedir(dir);
+    return true;
+}
+
+std::string LittleFSFS::hostPath(const char* path) const {
+    std::string p = path ? path : "/";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return root + p;
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    auto impl = std::make_shared<FileImpl>();
+    impl->path = path ? path : "/";
+    impl->hostPath = hostPath(path);
+    impl->baseName = baseNameOf(impl->path);
+
+    struct stat st;
+    if (stat(impl->hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        impl->dir = opendir(impl->hostPath.c_str());
+        return impl->dir ? File(impl) : File();
+    }
+
+    const char* hostMode = "rb";
+    if (mode && mode[0] == 'w') hostMode = mode[1] == '+' ? "w+b" : "wb";
+    else if (mode && mode[0] == 'a') hostMode = mode[1] == '+' ? "a+b" : "ab";
+    else if (mode && mode[1] == '+') hostMode = "r+b";
+
+    impl->fp = fopen(impl->hostPath.c_str(), hostMode);
+    return impl->fp ? File(impl) : File();
+}
+
+bool LittleFSFS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    // rename() de POSIX reemplaza el destino de forma atómica, como LittleFS
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool LittleFSFS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return NATIVE_FS_TOTAL_BYTES;
+}
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return 0;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        struct stat st;
+        std::string full = root + "/" + entry->d_name;
+        if (stat(full.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            used += st.st_size;
+        }
+    }
+    closedir(dir);
+    return used;
+}
+
+} // namespace fs
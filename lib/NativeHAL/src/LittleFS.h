@@ -0,0 +1,84 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+// ============================================
+// LittleFS sobre un directorio del host (solo build nativo)
+// Raíz: variable de entorno NATIVE_FS_ROOT, o ./.native_fs por defecto
+// ============================================
+
+namespace fs {
+
+class FileImpl;
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+
+    size_t read(uint8_t* buffer, size_t size);
+    size_t readBytes(char* buffer, size_t length) override { return read((uint8_t*)buffer, length); }
+    bool seek(uint32_t pos);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    const char* name() const;
+    const char* path() const;
+    bool isDirectory() const;
+    File openNextFile();
+
+    operator bool() const;
+
+private:
+    std::shared_ptr<FileImpl> impl;
+};
+
+class LittleFSFS {
+public:
+    LittleFSFS();
+
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+    void end() {}
+    bool format();
+
+    File open(const char* path, const char* mode = "r");
+    File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+
+    size_t totalBytes();
+    size_t usedBytes();
+
+    // Ruta del host correspondiente a una ruta de LittleFS
+    std::string hostPath(const char* path) const;
+
+private:
+    std::string root;
+};
+
+} // namespace fs
+
+using fs::File;
+
+extern fs::LittleFSFS LittleFS;
+
+#define NATIVE_FS_TOTAL_BYTES   0x160000    // Partición spiffs de default.csv
+
+#endif // NATIVE_LITTLEFS_H
@@ -0,0 +1,310 @@
+#include "NativeHAL.h"
+#include "Arduino.h"
+#include "SPI.h"
+#include "WiFi.h"
+#include "esp_sntp.h"
+#include <cstdio>
+
+NativeHAL nativeHAL;
+HardwareSerial Serial;
+EspClass ESP;
+SPIClass SPI;
+WiFiClass WiFi;
+
+NativeHAL::NativeHAL() {
+    serialEcho = true;
+    randomState = 0x12345678;
+    reset();
+}
+
+void NativeHAL::reset() {
+    clockUs = 0;
+    inIsr = false;
+    interruptsEnabled = true;
+    recording = false;
+    recorded.clear();
+    pending.clear();
+
+    for (uint8_t i = 0; i < NATIVE_MAX_PINS; i++) {
+        pinLevels[i] = LOW;
+        pinModes[i] = INPUT;
+        isrs[i] = nullptr;
+        isrModes[i] = 0;
+        interruptPending[i] = false;
+    }
+}
+
+void NativeHAL::advance(uint64_t us) {
+    uint64_t target = clockUs + us;
+
+    while (!pending.empty() && pending.back().timeUs <= target) {
+        PinEdge edge = pending.back();
+        pending.pop_back();
+        if (edge.timeUs > clockUs) clockUs = edge.timeUs;
+        fireEdge(edge);
+    }
+
+    clockUs = target;
+}
+
+void NativeHAL::tick() {
+    // Dentro de una ISR el reloj queda fijo en el instante del flanco
+    if (!inIsr) advance(1);
+}
+
+void NativeHAL::setPinMode(uint8_t pin, uint8_t mode) {
+    if (pin < NATIVE_MAX_PINS) pinModes[pin] = mode;
+}
+
+void NativeHAL::writePin(uint8_t pin, uint8_t level) {
+    if (pin >= NATIVE_MAX_PINS) return;
+
+    pinLevels[pin] = level ? HIGH : LOW;
+    if (recording) {
+        recorded.push_back({clockUs, pin, pinLevels[pin]});
+    }
+}
+
+int NativeHAL::readPin(uint8_t pin) const {
+    return pin < NATIVE_MAX_PINS ? pinLevels[pin] : LOW;
+}
+
+void NativeHAL::startRecording() {
+    recording = true;
+}
+
+void NativeHAL::stopRecording() {
+    recording = false;
+}
+
+void NativeHAL::clearRecording() {
+    recorded.clear();
+}
+
+// Convierte los flancos registrados de un pin en pulsos (nivel, duración),
+// uniendo escrituras consecutivas del mismo nivel
+std::vector<SimPulse> NativeHAL::getWaveform(uint8_t pin) const {
+    std::vector<SimPulse> pulses;
+    const PinEdge* previous = nullptr;
+
+    for (const PinEdge& edge : recorded) {
+        if (edge.pin != pin) continue;
+
+        if (previous) {
+            uint32_t duration = (uint32_t)(edge.timeUs - previous->timeUs);
+            if (duration > 0) {
+                if (!pulses.empty() && pulses.back().level == previous->level) {
+                    pulses.back().durationUs += duration;
+                } else {
+                    pulses.push_back({previous->level, duration});
+                }
+            }
+        }
+        previous = &edge;
+    }
+
+    return pulses;
+}
+
+void NativeHAL::attach(uint8_t pin, void (*isr)(), int mode) {
+    if (pin >= NATIVE_MAX_PINS) return;
+    isrs[pin] = isr;
+    isrModes[pin] = mode;
+    interruptPending[pin] = false;
+}
+
+void NativeHAL::detach(uint8_t pin) {
+    if (pin >= NATIVE_MAX_PINS) return;
+    isrs[pin] = nullptr;
+    interruptPending[pin] = false;
+}
+
+void NativeHAL::setInterruptsEnabled(bool enabled) {
+    interruptsEnabled = enabled;
+    if (!enabled) return;
+
+    // Como en el hardware: una interrupción enmascarada se atiende al rehabilitar
+    for (uint8_t pin = 0; pin < NATIVE_MAX_PINS; pin++) {
+        if (interruptPending[pin]) {
+            interruptPending[pin] = false;
+            runIsr(pin);
+        }
+    }
+}
+
+void NativeHAL::injectPulses(uint8_t pin, const uint32_t* durations, size_t count,
+                             bool startHigh, uint64_t startDelayUs) {
+    if (pin >= NATIVE_MAX_PINS) return;
+
+    uint64_t t = clockUs + startDelayUs;
+    uint8_t level = startHigh ? HIGH : LOW;
+
+    for (size_t i = 0; i < count; i++) {
+        pending.push_back({t, pin, level});
+        t += durations[i];
+        level = level ? LOW : HIGH;
+    }
+    pending.push_back({t, pin, LOW});
+
+    // El próximo flanco queda al final del vector
+    std::stable_sort(pending.begin(), pending.end(),
+        [](const PinEdge& a, const PinEdge& b) { return a.timeUs > b.timeUs; });
+}
+
+void NativeHAL::clearInjections() {
+    pending.clear();
+}
+
+uint32_t NativeHAL::nextRandom() {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+void NativeHAL::fireEdge(const PinEdge& edge) {
+    uint8_t previous = pinLevels[edge.pin];
+    pinLevels[edge.pin] = edge.level;
+
+    if (previous == edge.level || !isrs[edge.pin]) return;
+
+    int mode = isrModes[edge.pin];
+    bool trigger = mode == CHANGE ||
+                   (mode == RISING && edge.level == HIGH) ||
+                   (mode == FALLING && edge.level == LOW);
+    if (!trigger) return;
+
+    if (interruptsEnabled) {
+        runIsr(edge.pin);
+    } else {
+        interruptPending[edge.pin] = true;
+    }
+}
+
+void NativeHAL::runIsr(uint8_t pin) {
+    void (*isr)() = isrs[pin];
+    if (!isr) return;
+
+    inIsr = true;
+    isr();
+    inIsr = false;
+}
+
+// ============================================
+// API Arduino sobre la HAL simulada
+// ============================================
+
+unsigned long millis() {
+    nativeHAL.tick();
+    return (unsigned long)(nativeHAL.nowMicros() / 1000);
+}
+
+unsigned long micros() {
+    nativeHAL.tick();
+    return (unsigned long)nativeHAL.nowMicros();
+}
+
+void delay(unsigned long ms) {
+    nativeHAL.advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    nativeHAL.advance(us);
+}
+
+void yield() {
+    nativeHAL.tick();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    nativeHAL.setPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    nativeHAL.writePin(pin, level);
+}
+
+int digitalRead(uint8_t pin) {
+    return nativeHAL.readPin(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    nativeHAL.attach(pin, isr, mode);
+}
+
+void detachInterrupt(uint8_t pin) {
+    nativeHAL.detach(pin);
+}
+
+void noInterrupts() {
+    nativeHAL.setInterruptsEnabled(false);
+}
+
+void interrupts() {
+    nativeHAL.setInterruptsEnabled(true);
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2, const char* server3) {
+    char tz[32];
+    long offset = -gmtOffsetSec;
+    if (daylightOffsetSec) snprintf(tz, sizeof(tz), "UTC%ldDST", offset / 3600);
+    else snprintf(tz, sizeof(tz), "UTC%ld", offset / 3600);
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+void configTzTime(const char* tz, const char* server1, const char* server2, const char* server3) {
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+static sntp_sync_time_cb_t sntpCallback = nullptr;
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    sntpCallback = callback;
+}
+
+void sntp_set_sync_interval(uint32_t intervalMs) {}
+
+void sntp_sim_sync() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (sntpCallback) sntpCallback(&tv);
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return info->tm_year > (2016 - 1900);
+}
+
+uint32_t esp_random() {
+    return nativeHAL.nextRandom();
+}
+
+long random(long max) {
+    if (max <= 0) return 0;
+    return nativeHAL.nextRandom() % max;
+}
+
+long random(long min, long max) {
+    if (min >= max) return min;
+    return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+    nativeHAL.seedRandom((uint32_t)seed);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (nativeHAL.getSerialEcho()) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
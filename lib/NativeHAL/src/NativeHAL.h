@@ -0,0 +1,97 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ============================================
+// HAL SIMULADA PARA EL BUILD NATIVO
+// Reloj virtual en microsegundos: solo avanza con delay()/delayMicroseconds()
+// y 1 µs por cada llamada a micros()/millis() (para que las esperas activas
+// terminen). Los flancos inyectados se disparan al avanzar el reloj, llamando
+// a la ISR adjunta con el reloj detenido en el instante exacto del flanco.
+// ============================================
+
+#define NATIVE_MAX_PINS     40
+
+struct PinEdge {
+    uint64_t timeUs;
+    uint8_t pin;
+    uint8_t level;
+};
+
+struct SimPulse {
+    uint8_t level;
+    uint32_t durationUs;
+};
+
+class NativeHAL {
+public:
+    NativeHAL();
+
+    // Vuelve a t=0 sin flancos, interrupciones ni inyecciones pendientes
+    void reset();
+
+    // Reloj virtual
+    uint64_t nowMicros() const { return clockUs; }
+    void advance(uint64_t us);
+    void tick();    // Costo simulado de una llamada a micros()/millis()
+
+    // GPIO
+    void setPinMode(uint8_t pin, uint8_t mode);
+    void writePin(uint8_t pin, uint8_t level);
+    int readPin(uint8_t pin) const;
+
+    // Registro de flancos escritos por el firmware (TX)
+    void startRecording();
+    void stopRecording();
+    void clearRecording();
+    const std::vector<PinEdge>& getRecordedEdges() const { return recorded; }
+    std::vector<SimPulse> getWaveform(uint8_t pin) const;
+
+    // Interrupciones
+    void attach(uint8_t pin, void (*isr)(), int mode);
+    void detach(uint8_t pin);
+    void setInterruptsEnabled(bool enabled);
+
+    // Inyección de un tren de pulsos en un pin de entrada (p.ej. GDO0 en RX).
+    // durations alterna niveles empezando por startHigh; al final el pin queda en LOW.
+    void injectPulses(uint8_t pin, const uint32_t* durations, size_t count,
+                      bool startHigh = true, uint64_t startDelayUs = 0);
+    bool injectionActive() const { return !pending.empty(); }
+    void clearInjections();
+
+    // Salida de Serial (desactivar en benchmarks)
+    void setSerialEcho(bool enabled) { serialEcho = enabled; }
+    bool getSerialEcho() const { return serialEcho; }
+
+    // Aleatorios deterministas
+    void seedRandom(uint32_t seed) { randomState = seed ? seed : 1; }
+    uint32_t nextRandom();
+
+private:
+    uint64_t clockUs;
+    bool inIsr;
+    bool interruptsEnabled;
+    bool interruptPending[NATIVE_MAX_PINS];
+
+    uint8_t pinLevels[NATIVE_MAX_PINS];
+    uint8_t pinModes[NATIVE_MAX_PINS];
+    void (*isrs[NATIVE_MAX_PINS])();
+    int isrModes[NATIVE_MAX_PINS];
+
+    bool recording;
+    std::vector<PinEdge> recorded;
+    std::vector<PinEdge> pending;   // Ordenado por tiempo (el próximo al final)
+
+    bool serialEcho;
+    uint32_t randomState;
+
+    void fireEdge(const PinEdge& edge);
+    void runIsr(uint8_t pin);
+};
+
+extern NativeHAL nativeHAL;
+
+#endif // NATIVE_HAL_H
@@ -0,0 +1,54 @@
+#include "Print.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (!write(*buffer++)) break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::write(const char* str) {
+    if (!str) return 0;
+    return write((const uint8_t*)str, strlen(str));
+}
+
+size_t Print::printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+
+    if (len < 0) {
+        va_end(args);
+        return 0;
+    }
+
+    std::vector<char> buffer(len + 1);
+    vsnprintf(buffer.data(), buffer.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)buffer.data(), len);
+}
+
+size_t Print::print(const String& s) { return write(s.c_str()); }
+size_t Print::print(const char* s) { return write(s); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base) { return print(String(value, base)); }
+size_t Print::print(int value, int base) { return print(String(value, base)); }
+size_t Print::print(unsigned int value, int base) { return print(String(value, base)); }
+size_t Print::print(long value, int base) { return print(String(value, base)); }
+size_t Print::print(unsigned long value, int base) { return print(String(value, base)); }
+size_t Print::print(long long value, int base) { return print(String(value, base)); }
+size_t Print::print(unsigned long long value, int base) { return print(String(value, base)); }
+size_t Print::print(double value, int digits) { return print(String(value, digits)); }
+
+size_t Print::println() {
+    return write("\r\n");
+}
@@ -0,0 +1,20 @@
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+#include <Arduino.h>
+
+// ============================================
+// SPI nulo para el build nativo: el CC1101 simulado no usa el bus
+// ============================================
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+        (void)sck; (void)miso; (void)mosi; (void)ss;
+    }
+    void end() {}
+    uint8_t transfer(uint8_t data) { (void)data; return 0; }
+};
+
+extern SPIClass SPI;
+
+#endif // NATIVE_SPI_H
@@ -0,0 +1,80 @@
+#include "Stream.h"
+#include <cstring>
+
+bool Stream::find(const char* target) {
+    return findUntil(target, strlen(target), nullptr, 0);
+}
+
+bool Stream::find(const char* target, size_t length) {
+    return findUntil(target, length, nullptr, 0);
+}
+
+bool Stream::findUntil(const char* target, const char* terminator) {
+    return findUntil(target, strlen(target), terminator, terminator ? strlen(terminator) : 0);
+}
+
+// Avanza hasta encontrar target (true) o terminator/EOF (false)
+bool Stream::findUntil(const char* target, size_t targetLen, const char* terminator, size_t termLen) {
+    if (targetLen == 0) return true;
+
+    size_t targetIndex = 0;
+    size_t termIndex = 0;
+    int c;
+
+    while ((c = timedRead()) >= 0) {
+        if (c == target[targetIndex]) {
+            if (++targetIndex >= targetLen) return true;
+        } else {
+            targetIndex = (c == target[0]) ? 1 : 0;
+        }
+
+        if (termLen > 0) {
+            if (c == terminator[termIndex]) {
+                if (++termIndex >= termLen) return false;
+            } else {
+                termIndex = (c == terminator[0]) ? 1 : 0;
+            }
+        }
+    }
+    return false;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0 || c == terminator) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String out;
+    int c;
+    while ((c = timedRead()) >= 0) {
+        out += (char)c;
+    }
+    return out;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String out;
+    int c;
+    while ((c = timedRead()) >= 0 && c != terminator) {
+        out += (char)c;
+    }
+    return out;
+}
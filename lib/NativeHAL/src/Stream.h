@@ -0,0 +1,40 @@
+#ifndef NATIVE_STREAM_H
+#define NATIVE_STREAM_H
+
+#include "Print.h"
+
+// ============================================
+// Stream de Arduino (solo build nativo)
+// ============================================
+class Stream : public Print {
+public:
+    Stream() : timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeout = ms; }
+    unsigned long getTimeout() const { return timeout; }
+
+    bool find(const char* target);
+    bool find(const char* target, size_t length);
+    bool find(char target) { return find(&target, 1); }
+    bool findUntil(const char* target, const char* terminator);
+    bool findUntil(const char* target, size_t targetLen, const char* terminator, size_t termLen);
+
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length);
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long timeout;
+
+    // Sin espera real: en el host los datos ya están disponibles o no llegarán
+    int timedRead() { return read(); }
+    int timedPeek() { return peek(); }
+};
+
+#endif // NATIVE_STREAM_H
@@ -0,0 +1,224 @@
+#include "WString.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static std::string formatUnsigned(unsigned long long value, unsigned char base) {
+    if (base < 2 || base > 16) base = 10;
+    if (value == 0) return "0";
+
+    std::string out;
+    while (value > 0) {
+        out += "0123456789abcdef"[value % base];
+        value /= base;
+    }
+    std::reverse(out.begin(), out.end());
+    return out;
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        return "-" + formatUnsigned((unsigned long long)(-value), 10);
+    }
+    // Como en Arduino: en bases != 10 se muestra el complemento a dos de 32 bits
+    if (value < 0) return formatUnsigned((uint32_t)value, base);
+    return formatUnsigned((unsigned long long)value, base);
+}
+
+static std::string formatDouble(double value, unsigned int decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    return buf;
+}
+
+String::String(const char* cstr) : buffer(cstr ? cstr : "") {}
+String::String(char c) : buffer(1, c) {}
+String::String(unsigned char value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : buffer(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : buffer(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base) : buffer(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : buffer(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : buffer(formatDouble(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : buffer(formatDouble(value, decimalPlaces)) {}
+
+String& String::operator=(const char* cstr) {
+    buffer = cstr ? cstr : "";
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    buffer.reserve(size);
+    return true;
+}
+
+char String::charAt(unsigned int index) const {
+    return index < buffer.length() ? buffer[index] : 0;
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < buffer.length()) buffer[index] = c;
+}
+
+char String::operator[](unsigned int index) const {
+    return charAt(index);
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= buffer.length()) {
+        dummy = 0;
+        return dummy;
+    }
+    return buffer[index];
+}
+
+bool String::concat(const String& str) { buffer += str.buffer; return true; }
+bool String::concat(const char* cstr) { if (!cstr) return false; buffer += cstr; return true; }
+bool String::concat(const char* cstr, unsigned int length) {
+    if (!cstr) return false;
+    buffer.append(cstr, length);
+    return true;
+}
+bool String::concat(char c) { buffer += c; return true; }
+bool String::concat(int value) { return concat(String(value)); }
+bool String::concat(unsigned int value) { return concat(String(value)); }
+bool String::concat(long value) { return concat(String(value)); }
+bool String::concat(unsigned long value) { return concat(String(value)); }
+bool String::concat(float value) { return concat(String(value)); }
+bool String::concat(double value) { return concat(String(value)); }
+
+int String::compareTo(const String& str) const {
+    return buffer.compare(str.buffer);
+}
+
+bool String::equals(const char* cstr) const {
+    return buffer == (cstr ? cstr : "");
+}
+
+bool String::equalsIgnoreCase(const String& str) const {
+    if (buffer.length() != str.buffer.length()) return false;
+    for (size_t i = 0; i < buffer.length(); i++) {
+        if (tolower((unsigned char)buffer[i]) != tolower((unsigned char)str.buffer[i])) return false;
+    }
+    return true;
+}
+
+bool String::startsWith(const String& prefix) const {
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    if (offset > buffer.length()) return false;
+    return buffer.compare(offset, prefix.buffer.length(), prefix.buffer) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix.buffer.length() > buffer.length()) return false;
+    return buffer.compare(buffer.length() - suffix.buffer.length(), suffix.buffer.length(), suffix.buffer) == 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    size_t pos = buffer.find(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    size_t pos = buffer.find(str.buffer, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const {
+    size_t pos = buffer.rfind(ch);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String& str) const {
+    size_t pos = buffer.rfind(str.buffer);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, buffer.length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+    if (beginIndex >= buffer.length()) return String();
+    if (endIndex > buffer.length()) endIndex = buffer.length();
+    return String(buffer.substr(beginIndex, endIndex - beginIndex).c_str());
+}
+
+void String::replace(char find, char replace) {
+    std::replace(buffer.begin(), buffer.end(), find, replace);
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (find.buffer.empty()) return;
+    size_t pos = 0;
+    while ((pos = buffer.find(find.buffer, pos)) != std::string::npos) {
+        buffer.replace(pos, find.buffer.length(), replace.buffer);
+        pos += replace.buffer.length();
+    }
+}
+
+void String::remove(unsigned int index) {
+    if (index < buffer.length()) buffer.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index < buffer.length()) buffer.erase(index, count);
+}
+
+void String::toLowerCase() {
+    for (auto& c : buffer) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (auto& c : buffer) c = toupper((unsigned char)c);
+}
+
+void String::trim() {
+    size_t start = buffer.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        buffer.clear();
+        return;
+    }
+    size_t end = buffer.find_last_not_of(" \t\r\n");
+    buffer = buffer.substr(start, end - start + 1);
+}
+
+long String::toInt() const { return atol(buffer.c_str()); }
+float String::toFloat() const { return (float)atof(buffer.c_str()); }
+double String::toDouble() const { return atof(buffer.c_str()); }
+
+StringSumHelper operator+(const String& lhs, const String& rhs) {
+    StringSumHelper out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+StringSumHelper operator+(const String& lhs, const char* rhs) {
+    StringSumHelper out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+StringSumHelper operator+(const char* lhs, const String& rhs) {
+    StringSumHelper out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+StringSumHelper operator+(const String& lhs, char rhs) {
+    StringSumHelper out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+bool operator==(const char* lhs, const String& rhs) {
+    return rhs.equals(lhs);
+}
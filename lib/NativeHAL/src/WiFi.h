@@ -0,0 +1,48 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <Arduino.h>
+
+// ============================================
+// WiFi mínimo para el build nativo (sin red)
+// ============================================
+#define WL_CONNECTED        3
+#define WL_DISCONNECTED     6
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) {
+        octets[0] = a; octets[1] = b; octets[2] = c; octets[3] = d;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t octets[4];
+};
+
+class WiFiClass {
+public:
+    int status() { return simStatus; }
+    void simSetStatus(int status) { simStatus = status; }
+    uint8_t* macAddress(uint8_t* mac) {
+        // MAC fija para que los IDs generados sean reproducibles
+        static const uint8_t simMac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+        memcpy(mac, simMac, 6);
+        return mac;
+    }
+    String macAddress() { return String("24:0A:C4:00:00:01"); }
+    IPAddress localIP() { return IPAddress(); }
+    String SSID() { return String(); }
+    int RSSI() { return 0; }
+
+private:
+    int simStatus = WL_DISCONNECTED;
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
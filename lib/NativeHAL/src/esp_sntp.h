@@ -0,0 +1,19 @@
+#ifndef NATIVE_ESP_SNTP_H
+#define NATIVE_ESP_SNTP_H
+
+#include <stdint.h>
+#include <sys/time.h>
+
+// ============================================
+// SNTP mínimo para el build nativo: sin red, la notificación de
+// sincronización solo llega con sntp_sim_sync()
+// ============================================
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+void sntp_set_sync_interval(uint32_t intervalMs);
+
+// Simula la respuesta del servidor (hora del host)
+void sntp_sim_sync();
+
+#endif // NATIVE_ESP_SNTP_H
@@ -1,4 +1,8 @@
 #include "AOK_Protocol.h"
+#include "CC1101_RF.h"
+#include "TxTiming.h"
+#include "Metrics.h"
+#include "Logger.h"
 
 // Global instance
 AOK_Protocol aokProtocol;
@@ -88,9 +92,9 @@ void AOK_Protocol::buildFrame(uint8_t command, uint8_t* frame) {
     frame[6] = command;
     frame[7] = checksum;
 
-    Serial.printf("[A-OK] Frame: %02X %02X %02X %02X %02X %02X %02X %02X\n",
-                  frame[0], frame[1], frame[2], frame[3],
-                  frame[4], frame[5], frame[6], frame[7]);
+    LOG_D("A-OK", "Frame: %02X %02X %02X %02X %02X %02X %02X %02X",
+          frame[0], frame[1], frame[2], frame[3],
+          frame[4], frame[5], frame[6], frame[7]);
 }
 
 void AOK_Protocol::configureTransmitter() {
@@ -112,7 +116,7 @@ void AOK_Protocol::configureTransmitter() {
     pinMode(CC1101_GDO2, OUTPUT);
     digitalWrite(CC1101_GDO2, LOW);
 
-    Serial.println("[A-OK] TX configurado: 433.92 MHz, ASK/OOK");
+    LOG_D("A-OK", "TX configurado: 433.92 MHz, ASK/OOK");
 }
 
 void AOK_Protocol::restoreConfig() {
@@ -131,71 +135,72 @@ void AOK_Protocol::restoreConfig() {
     ELECHOUSE_cc1101.setCrc(0);
     ELECHOUSE_cc1101.setPA(10);
 
-    Serial.println("[A-OK] Configuración restaurada");
+    LOG_D("A-OK", "Configuración restaurada");
 }
 
-void AOK_Protocol::sendAGC() {
-    // Send AGC preamble: 5300µs HIGH + 530µs LOW
-    digitalWrite(CC1101_GDO2, HIGH);
-    delayMicroseconds(AOK_AGC1_PULSE);
-    digitalWrite(CC1101_GDO2, LOW);
-    delayMicroseconds(AOK_AGC2_PULSE);
-}
+void AOK_Protocol::encodeFrame(const uint8_t* frame, PulseTrain& train) {
+    train.clear();
+
+    // AGC preamble: 5300µs HIGH + 530µs LOW
+    train.high(AOK_AGC1_PULSE);
+    train.low(AOK_AGC2_PULSE);
 
-void AOK_Protocol::sendBit(bool bit) {
-    // A-OK bit encoding:
+    // 64 bits de 8 bytes (MSB primero) + bit final (siempre 1)
     // Bit 0: 270µs HIGH + 565µs LOW
     // Bit 1: 565µs HIGH + 270µs LOW
-    if (bit) {
-        // Bit 1: long HIGH, short LOW
-        digitalWrite(CC1101_GDO2, HIGH);
-        delayMicroseconds(AOK_LONG_PULSE);
-        digitalWrite(CC1101_GDO2, LOW);
-        delayMicroseconds(AOK_SHORT_PULSE);
-    } else {
-        // Bit 0: short HIGH, long LOW
-        digitalWrite(CC1101_GDO2, HIGH);
-        delayMicroseconds(AOK_SHORT_PULSE);
-        digitalWrite(CC1101_GDO2, LOW);
-        delayMicroseconds(AOK_LONG_PULSE);
+    for (int i = 0; i < AOK_TOTAL_BITS; i++) {
+        bool bit = (i < 64) ? ((frame[i / 8] >> (7 - (i % 8))) & 0x01) : true;
+        train.high(bit ? AOK_LONG_PULSE : AOK_SHORT_PULSE);
+        train.low(bit ? AOK_SHORT_PULSE : AOK_LONG_PULSE);
     }
 }
 
+bool AOK_Protocol::encodeCommand(uint8_t command, PulseTrain& train) {
+    uint8_t frame[8];
+    buildFrame(command, frame);
+    encodeFrame(frame, train);
+    return !train.isOverflowed();
+}
+
 bool AOK_Protocol::transmitFrame(uint8_t* frame, int repeats) {
+    // Una repetición se codifica una sola vez y se reproduce N veces
+    PulseTrain train;
+    encodeFrame(frame, train);
+    return transmitPulses(train.data(), train.size(), repeats);
+}
+
+bool AOK_Protocol::transmitPulses(const uint32_t* pulses, uint16_t count, int repeats) {
     if (!initialized) {
-        Serial.println("[A-OK] ERROR: No inicializado");
+        LOG_E("A-OK", "ERROR: No inicializado");
         return false;
     }
 
-    configureTransmitter();
+    rfModule.suspendListening();
+
+    // En una ráfaga del planificador el perfil puede estar ya cargado
+    uint32_t profile = CC1101_RF::makeTxProfile(AOK_FREQUENCY, 2, RF_TX_MODE_ASYNC);
+    if (rfModule.isTxProfileLoaded(profile)) {
+        pinMode(CC1101_GDO2, OUTPUT);
+        digitalWrite(CC1101_GDO2, LOW);
+    } else {
+        configureTransmitter();
+        rfModule.setTxProfileLoaded(profile);
+    }
 
     // Enter TX mode
     ELECHOUSE_cc1101.SetTx();
     delay(5);
 
-    Serial.printf("[A-OK] Transmitiendo %d veces...\n", repeats);
+    LOG_I("A-OK", "Transmitiendo %d veces...", repeats);
 
+    metrics.txStarted();
     for (int rep = 0; rep < repeats; rep++) {
+        // Se mide solo la última repetición para no alterar los gaps
+        if (rep == repeats - 1) txTiming.arm(CC1101_GDO2);
+
         // Disable interrupts for precise timing
         portDISABLE_INTERRUPTS();
-
-        // Send AGC preamble
-        sendAGC();
-
-        // Send 64 bits from 8 bytes (MSB first)
-        for (int byte = 0; byte < 8; byte++) {
-            for (int bit = 7; bit >= 0; bit--) {
-                bool b = (frame[byte] >> bit) & 0x01;
-                sendBit(b);
-            }
-        }
-
-        // Send trailing bit (always 1)
-        sendBit(true);
-
-        // Ensure LOW at end
-        digitalWrite(CC1101_GDO2, LOW);
-
+        PulseTrain::play(CC1101_GDO2, pulses, count);
         portENABLE_INTERRUPTS();
 
         // Radio silence between repetitions
@@ -204,29 +209,39 @@ bool AOK_Protocol::transmitFrame(uint8_t* frame, int repeats) {
         }
     }
 
-    Serial.printf("[A-OK] TX completado: %d repeticiones\n", repeats);
+    metrics.txFinished(true);
+    txTiming.measure(pulses, count);
+    LOG_D("A-OK", "TX completado: %d repeticiones", repeats);
 
-    restoreConfig();
+    if (rfModule.isBurst()) {
+        // Solo volver a IDLE: la restauración completa la hace endBurst()
+        digitalWrite(CC1101_GDO2, LOW);
+        ELECHOUSE_cc1101.setSidle();
+        pinMode(CC1101_GDO2, INPUT);
+        rfModule.deferRestore();
+    } else {
+        restoreConfig();
+    }
     return true;
 }
 
 bool AOK_Protocol::sendUp(int repeats) {
-    Serial.println("[A-OK] Enviando UP");
+    LOG_I("A-OK", "Enviando UP");
     return sendCommand(AOK_CMD_UP, repeats);
 }
 
 bool AOK_Protocol::sendDown(int repeats) {
-    Serial.println("[A-OK] Enviando DOWN");
+    LOG_I("A-OK", "Enviando DOWN");
     return sendCommand(AOK_CMD_DOWN, repeats);
 }
 
 bool AOK_Protocol::sendStop(int repeats) {
-    Serial.println("[A-OK] Enviando STOP");
+    LOG_I("A-OK", "Enviando STOP");
     return sendCommand(AOK_CMD_STOP, repeats);
 }
 
 bool AOK_Protocol::sendProgram(int repeats) {
-    Serial.println("[A-OK] Enviando PROGRAM");
+    LOG_I("A-OK", "Enviando PROGRAM");
     return sendCommand(AOK_CMD_PROGRAM, repeats);
 }
 
@@ -241,24 +256,26 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
     // Format: AGC (5300µs + 530µs) + 65 bits of data
     // Bit encoding: 0 = short-long (270µs-565µs), 1 = long-short (565µs-270µs)
 
-    Serial.println(">>> [A-OK] ENTRANDO A learnFromCapture <<<");
-    Serial.flush();
-    Serial.printf(">>> [A-OK] Datos: ptr=%p, len=%d <<<\n", capturedData, length);
-    Serial.flush();
+    LOG_D("A-OK", "learnFromCapture: ptr=%p, len=%d", capturedData, length);
 
     if (length < 20) {
-        Serial.println("[A-OK] Señal muy corta");
+        LOG_I("A-OK", "Señal muy corta");
         return false;
     }
 
     // Print first 40 pulses for debugging
-    Serial.println("[A-OK] Primeros pulsos capturados (µs):");
-    for (int i = 0; i < min((int)length, 80); i += 2) {
-        uint16_t pulse = (capturedData[i] << 8) | capturedData[i + 1];
-        Serial.printf("%d ", pulse);
-        if ((i/2 + 1) % 10 == 0) Serial.println();
+    // Primeros 40 pulsos para depuración (solo con LOG_LEVEL >= debug)
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        for (int i = 0; i < min((int)length, 80); i += 20) {
+            char line[64];
+            int pos = 0;
+            for (int k = i; k < min((int)length - 1, i + 20); k += 2) {
+                uint16_t pulse = (capturedData[k] << 8) | capturedData[k + 1];
+                pos += snprintf(line + pos, sizeof(line) - pos, "%d ", pulse);
+            }
+            LOG_D("A-OK", "Pulsos (µs): %s", line);
+        }
     }
-    Serial.println();
 
     // Tolerance for pulse timing - NO OVERLAP between short and long
     // Short pulse: 270µs nominal, range 135-400µs
@@ -285,26 +302,26 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
 
         if (pulse >= PULSE_AGC_MIN && pulse <= PULSE_AGC_MAX) {
             foundAGC = true;
-            Serial.printf("[A-OK] AGC encontrado: %d µs en posición %d\n", pulse, idx - 2);
+            LOG_D("A-OK", "AGC encontrado: %d µs en posición %d", pulse, idx - 2);
             // Skip AGC2 pulse (~530µs)
             if (idx + 1 < length) {
                 uint16_t agc2 = (capturedData[idx] << 8) | capturedData[idx + 1];
                 idx += 2;
-                Serial.printf("[A-OK] AGC2: %d µs\n", agc2);
+                LOG_D("A-OK", "AGC2: %d µs", agc2);
             }
             break;
         }
     }
 
     if (!foundAGC) {
-        Serial.println("[A-OK] No se encontró preámbulo AGC - intentando detectar de otra forma...");
+        LOG_D("A-OK", "No se encontró preámbulo AGC - intentando detectar de otra forma...");
         // Try to find any long pulse > 2000µs as potential AGC
         idx = 0;
         while (idx + 1 < length) {
             uint16_t pulse = (capturedData[idx] << 8) | capturedData[idx + 1];
             if (pulse > 2000 && pulse < 10000) {
                 foundAGC = true;
-                Serial.printf("[A-OK] Pulso largo encontrado: %d µs - usando como AGC\n", pulse);
+                LOG_D("A-OK", "Pulso largo encontrado: %d µs - usando como AGC", pulse);
                 idx += 2;
                 // Skip next pulse (AGC2)
                 if (idx + 1 < length) {
@@ -315,13 +332,13 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
             idx += 2;
         }
         if (!foundAGC) {
-            Serial.println("[A-OK] Intentando decodificar desde el inicio...");
+            LOG_D("A-OK", "Intentando decodificar desde el inicio...");
             idx = 0;
         }
     }
 
     // Step 2: Decode bits (each bit = 2 pulses)
-    Serial.println("[A-OK] Decodificando bits...");
+    LOG_D("A-OK", "Decodificando bits...");
     while (idx + 3 < length && byteIdx < 8) {
         uint16_t pulse1 = (capturedData[idx] << 8) | capturedData[idx + 1];
         uint16_t pulse2 = (capturedData[idx + 2] << 8) | capturedData[idx + 3];
@@ -329,13 +346,13 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
 
         // Skip if pulse is too long (gap between repetitions)
         if (pulse1 > 2000 || pulse2 > 2000) {
-            Serial.printf("[A-OK] Gap detectado: %d, %d - fin de frame\n", pulse1, pulse2);
+            LOG_D("A-OK", "Gap detectado: %d, %d - fin de frame", pulse1, pulse2);
             break;
         }
 
         // Skip very short pulses (noise)
         if (pulse1 < 100 || pulse2 < 100) {
-            Serial.printf("[A-OK] Ruido ignorado: %d, %d\n", pulse1, pulse2);
+            LOG_D("A-OK", "Ruido ignorado: %d, %d", pulse1, pulse2);
             continue;
         }
 
@@ -356,7 +373,7 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
             // Ambiguous - use midpoint classification
             bit = !p1Short;  // If pulse1 >= midpoint, it's "long" = bit 1
             if (bitCount < 8) {  // Only print first 8 ambiguous for debug
-                Serial.printf("[A-OK] Bit %d: %d/%d -> %d (midpoint)\n", bitCount, pulse1, pulse2, bit);
+                LOG_D("A-OK", "Bit %d: %d/%d -> %d (midpoint)", bitCount, pulse1, pulse2, bit);
             }
         }
 
@@ -365,41 +382,41 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
         bitCount++;
 
         if (bitCount % 8 == 0) {
-            Serial.printf("[A-OK] Byte %d: 0x%02X\n", byteIdx, decodedBytes[byteIdx]);
+            LOG_D("A-OK", "Byte %d: 0x%02X", byteIdx, decodedBytes[byteIdx]);
             byteIdx++;
         }
     }
 
-    Serial.printf("[A-OK] Decodificados %d bits (%d bytes)\n", bitCount, byteIdx);
+    LOG_D("A-OK", "Decodificados %d bits (%d bytes)", bitCount, byteIdx);
 
     // Handle partial last byte
     if (bitCount % 8 != 0 && byteIdx < 8) {
         int remainingBits = bitCount % 8;
         decodedBytes[byteIdx] <<= (8 - remainingBits);  // Shift to align
-        Serial.printf("[A-OK] Byte %d parcial: 0x%02X (%d bits)\n", byteIdx, decodedBytes[byteIdx], remainingBits);
+        LOG_D("A-OK", "Byte %d parcial: 0x%02X (%d bits)", byteIdx, decodedBytes[byteIdx], remainingBits);
         byteIdx++;
     }
 
     // Step 3: Verify and extract data
     if (byteIdx < 3) {
-        Serial.println("[A-OK] Muy pocos bytes decodificados - puede no ser señal A-OK");
-        Serial.println("[A-OK] Intente acercar más el control al receptor");
+        LOG_I("A-OK", "Muy pocos bytes decodificados - puede no ser señal A-OK");
+        LOG_I("A-OK", "Intente acercar más el control al receptor");
         return false;
     }
 
     // Print all decoded bytes for analysis
-    Serial.print("[A-OK] Bytes decodificados: ");
-    for (int i = 0; i < byteIdx; i++) {
-        Serial.printf("%02X ", decodedBytes[i]);
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        char hex[8 * 3 + 1];
+        Logger::formatHex(hex, sizeof(hex), decodedBytes, byteIdx);
+        LOG_D("A-OK", "Bytes decodificados: %s", hex);
     }
-    Serial.println();
 
     // Check start byte (should be 0xA3)
     bool validStartByte = (decodedBytes[0] == AOK_START_BYTE);
     if (validStartByte) {
-        Serial.println("[A-OK] Start byte 0xA3 verificado - Señal A-OK válida!");
+        LOG_D("A-OK", "Start byte 0xA3 verificado - Señal A-OK válida!");
     } else {
-        Serial.printf("[A-OK] Start byte: 0x%02X (esperado 0xA3)\n", decodedBytes[0]);
+        LOG_D("A-OK", "Start byte: 0x%02X (esperado 0xA3)", decodedBytes[0]);
     }
 
     // Extract Remote ID (bytes 1-3)
@@ -417,9 +434,9 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
 
         validChecksum = (receivedChecksum == calculatedChecksum);
         if (validChecksum) {
-            Serial.printf("[A-OK] Checksum VÁLIDO: 0x%02X\n", receivedChecksum);
+            LOG_D("A-OK", "Checksum VÁLIDO: 0x%02X", receivedChecksum);
         } else {
-            Serial.printf("[A-OK] Checksum: recibido 0x%02X, calculado 0x%02X\n",
+            LOG_D("A-OK", "Checksum: recibido 0x%02X, calculado 0x%02X",
                          receivedChecksum, calculatedChecksum);
         }
     }
@@ -441,7 +458,7 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
     // Determine channel: if multiple bits set = group (channel 0), else single channel
     if (bitsSet > 1) {
         extractedChannel = 0;  // Group/All
-        Serial.printf("[A-OK] Grupo detectado: %d canales (address=0x%04X)\n", bitsSet, address);
+        LOG_D("A-OK", "Grupo detectado: %d canales (address=0x%04X)", bitsSet, address);
     } else if (bitsSet == 1) {
         extractedChannel = firstBit + 1;
     } else {
@@ -456,26 +473,22 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
     else if (cmd == AOK_CMD_STOP) cmdName = "STOP";
     else if (cmd == AOK_CMD_PROGRAM) cmdName = "PROGRAM";
 
-    Serial.println("[A-OK] ====== RESULTADO ======");
-    Serial.printf("[A-OK] Remote ID: 0x%06X\n", extractedId);
-    Serial.printf("[A-OK] Canal: %d\n", extractedChannel);
-    Serial.printf("[A-OK] Comando: %s (0x%02X)\n", cmdName, cmd);
-    Serial.printf("[A-OK] Start byte válido: %s\n", validStartByte ? "Sí" : "No");
-    Serial.printf("[A-OK] Checksum válido: %s\n", validChecksum ? "Sí" : "No");
+    LOG_I("A-OK", "Resultado: Remote ID 0x%06X, canal %d, comando %s (0x%02X)",
+          extractedId, extractedChannel, cmdName, cmd);
 
     // Calculate confidence level
     int confidence = 0;
     if (validStartByte) confidence += 40;
     if (validChecksum) confidence += 40;
     if (extractedId != 0 && extractedId != 0xFFFFFF) confidence += 20;
-    Serial.printf("[A-OK] Confianza: %d%%\n", confidence);
-    Serial.println("[A-OK] =======================");
+    LOG_I("A-OK", "Start byte válido: %s, checksum válido: %s, confianza: %d%%",
+          validStartByte ? "Sí" : "No", validChecksum ? "Sí" : "No", confidence);
 
     // Accept if checksum is valid (highest confidence) or start byte + reasonable ID
     if (validChecksum || (validStartByte && extractedId != 0 && extractedId != 0xFFFFFF)) {
         remoteId = extractedId;
         currentChannel = extractedChannel;
-        Serial.println("[A-OK] Remote ID guardado automáticamente!");
+        LOG_I("A-OK", "Remote ID guardado automáticamente!");
         return true;
     }
 
@@ -484,7 +497,7 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
     if (extractedId != 0 && extractedId != 0xFFFFFF) {
         remoteId = extractedId;
         currentChannel = extractedChannel;
-        Serial.println("[A-OK] Remote ID guardado (sin verificación completa)");
+        LOG_I("A-OK", "Remote ID guardado (sin verificación completa)");
         return true;
     }
 
@@ -495,67 +508,32 @@ bool AOK_Protocol::learnFromCapture(const uint8_t* capturedData, uint16_t length
                          ((uint32_t)decodedBytes[1] << 8) |
                          decodedBytes[2];
         if (altId != 0 && altId != 0xFFFFFF) {
-            Serial.printf("[A-OK] Usando ID alternativo: 0x%06X\n", altId);
+            LOG_I("A-OK", "Usando ID alternativo: 0x%06X", altId);
             remoteId = altId;
             currentChannel = extractedChannel;
             return true;
         }
     }
 
-    Serial.println("[A-OK] No se pudo extraer un ID válido");
+    LOG_W("A-OK", "No se pudo extraer un ID válido");
     return false;
 }
 
 bool AOK_Protocol::generateSignal(uint8_t command, uint8_t* buffer, uint16_t* length) {
     // Generate raw pulse data that can be stored and played back
     // This allows A-OK signals to be stored in the existing device/signal system
+    // Misma forma de onda que transmitFrame: pulsos alternados empezando en HIGH
 
-    uint8_t frame[8];
-    buildFrame(command, frame);
+    PulseTrain train;
+    encodeCommand(command, train);
 
     uint16_t idx = 0;
-
-    // AGC pulse (5300µs HIGH)
-    buffer[idx++] = (AOK_AGC1_PULSE >> 8) & 0xFF;
-    buffer[idx++] = AOK_AGC1_PULSE & 0xFF;
-
-    // AGC gap (530µs LOW) - represented as next pulse timing
-    buffer[idx++] = (AOK_AGC2_PULSE >> 8) & 0xFF;
-    buffer[idx++] = AOK_AGC2_PULSE & 0xFF;
-
-    // 64 bits from frame + 1 trailing bit = 65 bits
-    // Each bit is 2 pulses (HIGH + LOW timing)
-    for (int byte = 0; byte < 8; byte++) {
-        for (int bit = 7; bit >= 0; bit--) {
-            bool b = (frame[byte] >> bit) & 0x01;
-            if (b) {
-                // Bit 1: long HIGH, short LOW
-                buffer[idx++] = (AOK_LONG_PULSE >> 8) & 0xFF;
-                buffer[idx++] = AOK_LONG_PULSE & 0xFF;
-                buffer[idx++] = (AOK_SHORT_PULSE >> 8) & 0xFF;
-                buffer[idx++] = AOK_SHORT_PULSE & 0xFF;
-            } else {
-                // Bit 0: short HIGH, long LOW
-                buffer[idx++] = (AOK_SHORT_PULSE >> 8) & 0xFF;
-                buffer[idx++] = AOK_SHORT_PULSE & 0xFF;
-                buffer[idx++] = (AOK_LONG_PULSE >> 8) & 0xFF;
-                buffer[idx++] = AOK_LONG_PULSE & 0xFF;
-            }
-
-            // Safety check
-            if (idx >= RF_MAX_SIGNAL_LENGTH - 4) {
-                *length = idx;
-                return true;
-            }
-        }
+    for (uint16_t i = 0; i < train.size() && idx + 2 <= RF_MAX_SIGNAL_LENGTH; i++) {
+        uint16_t duration = train.getDuration(i);
+        buffer[idx++] = (duration >> 8) & 0xFF;
+        buffer[idx++] = duration & 0xFF;
     }
 
-    // Trailing bit (1)
-    buffer[idx++] = (AOK_LONG_PULSE >> 8) & 0xFF;
-    buffer[idx++] = AOK_LONG_PULSE & 0xFF;
-    buffer[idx++] = (AOK_SHORT_PULSE >> 8) & 0xFF;
-    buffer[idx++] = AOK_SHORT_PULSE & 0xFF;
-
     *length = idx;
     Serial.printf("[A-OK] Señal generada: %d bytes\n", idx);
     return true;
@@ -0,0 +1,103 @@
+#include "BootManager.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "DooyaBidir.h"
+#include "AOK_Protocol.h"
+#include "TimeManager.h"
+#include "Metrics.h"
+
+BootManager bootManager;
+
+BootManager::BootManager() {
+    readyBits = nullptr;
+    sysConfig = nullptr;
+    radioReadyMs = 0;
+    wifiReadyMs = 0;
+    timeReadyMs = 0;
+}
+
+void BootManager::begin() {
+    if (!readyBits) {
+        readyBits = xEventGroupCreate();
+    }
+}
+
+void BootManager::startRadio(SystemConfig* config) {
+    sysConfig = config;
+    xTaskCreate(radioTask, "boot_radio", BOOT_TASK_STACK, this, 2, nullptr);
+}
+
+// Sin tarea propia: begin() solo configura zona horaria y servidor (y lanza
+// SNTP si ya hay WiFi); timeManager.loop() lo lanza al conectar y reintenta.
+// BOOT_TIME_READY lo marca onTimeSynced
+void BootManager::startTimeSync(SystemConfig* config) {
+    sysConfig = config;
+    timeManager.setSyncCallback(onTimeSynced);
+    timeManager.begin(config);
+}
+
+void BootManager::radioTask(void* param) {
+    BootManager* self = static_cast<BootManager*>(param);
+
+    // La radio no depende de la red: se inicializa apenas hay configuración
+    if (rfModule.begin()) {
+        rfModule.setFrequency(self->sysConfig->default_frequency);
+        rfModule.setModulation(self->sysConfig->default_modulation);
+        somfyRTS.begin(CC1101_GDO0);
+        dooyaBidir.begin();
+        aokProtocol.begin();
+
+        self->radioReadyMs = millis();
+        metrics.setGauge(METRIC_BOOT_RADIO_READY_MS, self->radioReadyMs);
+        self->setReady(BOOT_RADIO_READY);
+        Serial.printf("[Boot] Radio lista en %lu ms\n", self->radioReadyMs);
+    } else {
+        Serial.println("[Boot] CC1101 no detectado");
+    }
+
+    self->setReady(BOOT_RADIO_DONE);
+    vTaskDelete(nullptr);
+}
+
+void BootManager::onTimeSynced() {
+    if (bootManager.timeReadyMs == 0) {
+        bootManager.timeReadyMs = millis();
+    }
+    bootManager.setReady(BOOT_TIME_READY);
+}
+
+void BootManager::setReady(EventBits_t bits) {
+    if (!readyBits) return;
+
+    if ((bits & BOOT_WIFI_READY) && wifiReadyMs == 0) {
+        wifiReadyMs = millis();
+    }
+    xEventGroupSetBits(readyBits, bits);
+}
+
+void BootManager::clearReady(EventBits_t bits) {
+    if (!readyBits) return;
+    xEventGroupClearBits(readyBits, bits);
+}
+
+bool BootManager::isReady(EventBits_t bits) {
+    if (!readyBits) return false;
+    return (xEventGroupGetBits(readyBits) & bits) == bits;
+}
+
+bool BootManager::waitFor(EventBits_t bits, uint32_t timeoutMs) {
+    if (!readyBits) return false;
+
+    TickType_t ticks = (timeoutMs == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    EventBits_t result = xEventGroupWaitBits(readyBits, bits, pdFALSE, pdTRUE, ticks);
+    return (result & bits) == bits;
+}
+
+String BootManager::getStatusString() {
+    String status = "Boot: ";
+    status += "storage=" + String(isReady(BOOT_STORAGE_READY) ? "OK" : "-");
+    status += ", radio=" + String(isReady(BOOT_RADIO_READY) ? String(radioReadyMs) + "ms" : "-");
+    status += ", wifi=" + String(isReady(BOOT_WIFI_READY) ? String(wifiReadyMs) + "ms" : "-");
+    status += ", ntp=" + String(isReady(BOOT_TIME_READY) ? String(timeReadyMs) + "ms" : "-");
+    return status;
+}
@@ -1,4 +1,8 @@
 #include "CC1101_RF.h"
+#include "TxTiming.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "HeapMonitor.h"
 
 // Instancia estática para ISR
 CC1101_RF* CC1101_RF::instance = nullptr;
@@ -7,6 +11,9 @@ CC1101_RF rfModule;
 CC1101_RF::CC1101_RF() {
     currentFrequency = RF_DEFAULT_FREQUENCY;
     currentModulation = 2; // ASK/OOK
+    loadedTxProfile = 0;
+    burst = false;
+    restorePending = false;
     capturing = false;
     connected = false;
     captureIndex = 0;
@@ -15,11 +22,20 @@ CC1101_RF::CC1101_RF() {
     preBufferIndex = 0;
     preBufferFull = false;
     preCapturing = false;
+    lastCaptureRssi = 0;
+    listenHead = 0;
+    listenTail = 0;
+    listenOverruns = 0;
+    listenNoise = 0;
+    squelched = false;
+    listening = false;
+    lastRadioUse = 0;
     instance = this;
 }
 
 bool CC1101_RF::begin() {
     Serial.println("[RF] Inicializando CC1101...");
+    loadedTxProfile = 0;
 
     // Configurar pines SPI
     ELECHOUSE_cc1101.setSpiPin(CC1101_SCK, CC1101_MISO, CC1101_MOSI, CC1101_CSN);
@@ -68,10 +84,14 @@ bool CC1101_RF::isConnected() {
 }
 
 void CC1101_RF::setFrequency(float freq) {
+    suspendListening();
     currentFrequency = freq;
+    if (loadedTxProfile && (loadedTxProfile >> 8) != (uint32_t)(freq * 1000 + 0.5f)) {
+        loadedTxProfile = 0;
+    }
     if (connected) {
         ELECHOUSE_cc1101.setMHZ(freq);
-        Serial.printf("[RF] Frecuencia cambiada a: %.2f MHz\n", freq);
+        LOG_D("RF", "Frecuencia cambiada a: %.2f MHz", freq);
     }
 }
 
@@ -80,10 +100,14 @@ float CC1101_RF::getFrequency() {
 }
 
 void CC1101_RF::setModulation(int mod) {
+    suspendListening();
     currentModulation = mod;
+    if (loadedTxProfile && ((loadedTxProfile >> 4) & 0x0F) != (uint32_t)(mod & 0x0F)) {
+        loadedTxProfile = 0;
+    }
     if (connected) {
         ELECHOUSE_cc1101.setModulation(mod);
-        Serial.printf("[RF] Modulación cambiada a: %d\n", mod);
+        LOG_D("RF", "Modulación cambiada a: %d", mod);
     }
 }
 
@@ -93,6 +117,8 @@ int CC1101_RF::getModulation() {
 
 bool CC1101_RF::startCapture() {
     if (!connected) return false;
+    suspendListening();
+    loadedTxProfile = 0;
 
     // Reset buffer
     captureIndex = 0;
@@ -134,6 +160,12 @@ void IRAM_ATTR CC1101_RF::handlePreCaptureInterrupt() {
     }
 }
 
+void IRAM_ATTR CC1101_RF::handleListenInterrupt() {
+    if (instance) {
+        instance->onListenInterrupt();
+    }
+}
+
 // Pre-captura: almacena pulsos en buffer circular ANTES de detectar señal fuerte
 void CC1101_RF::onPreCaptureInterrupt() {
     if (!preCapturing) return;
@@ -188,8 +220,107 @@ void CC1101_RF::onInterrupt() {
     }
 }
 
+// Escucha continua: solo se guarda la duración, el armado de frames y la
+// búsqueda quedan para RxMonitor::loop()
+void CC1101_RF::onListenInterrupt() {
+    if (!listening) return;
+
+    unsigned long now = micros();
+    unsigned long duration = now - lastPulse;
+    lastPulse = now;
+
+    // Mismo filtro que la captura: las huellas se comparan con señales capturadas
+    if (duration < RF_MIN_PULSE_WIDTH) return;
+    if (duration > 0xFFFF) duration = 0xFFFF;
+
+#if RX_SQUELCH_ENABLED
+    // En OOK el carrier sense cae durante los bajos: se juzga al terminar
+    // cada alto. Un bajo después de ruido descartado no se mide
+    if (digitalRead(CC1101_GDO0)) {
+        if (!squelched) pushListened(duration);
+        return;
+    }
+    if (!digitalRead(CC1101_GDO2)) {
+        // Una ráfaga de ruido cuenta una sola vez
+        if (!squelched) listenNoise++;
+        squelched = true;
+        return;
+    }
+    if (squelched) {
+        squelched = false;
+        pushListened(0xFFFF);   // Separador largo
+    }
+#endif
+    pushListened(duration);
+}
+
+void CC1101_RF::pushListened(uint16_t duration) {
+    uint16_t head = listenHead;
+    uint16_t next = (head + 1) & (RX_RING_SIZE - 1);
+    if (next == listenTail) {
+        listenOverruns++;
+        return;
+    }
+    listenRing[head] = duration;
+    listenHead = next;
+}
+
+bool CC1101_RF::startListening(float freq, int modulation) {
+    if (!connected || capturing || burst) return false;
+    if (listening) return true;
+
+    loadedTxProfile = 0;
+    configureReceiver(freq, modulation);
+    ELECHOUSE_cc1101.setRxBW(RX_LISTEN_BANDWIDTH_KHZ);
+#if RX_SQUELCH_ENABLED
+    pinMode(CC1101_GDO2, INPUT);
+    ELECHOUSE_cc1101.SpiWriteReg(0x1C, 0x40 | (RX_CARRIER_SENSE_DB & 0x0F));  // AGCCTRL1 = umbral absoluto de CS
+    ELECHOUSE_cc1101.SpiWriteReg(0x00, 0x0E);  // IOCFG2 = Carrier Sense
+#endif
+    ELECHOUSE_cc1101.SetRx();
+
+    listenHead = 0;
+    listenTail = 0;
+    squelched = false;
+    pinMode(CC1101_GDO0, INPUT);
+    lastPulse = micros();
+    listening = true;
+    attachInterrupt(digitalPinToInterrupt(CC1101_GDO0), handleListenInterrupt, CHANGE);
+
+    LOG_D("RF", "Escuchando en %.2f MHz", freq);
+    return true;
+}
+
+void CC1101_RF::suspendListening() {
+    lastRadioUse = millis();
+    if (!listening) return;
+
+    listening = false;
+    detachInterrupt(digitalPinToInterrupt(CC1101_GDO0));
+    ELECHOUSE_cc1101.setSidle();
+#if RX_SQUELCH_ENABLED
+    // GDO2 vuelve a ser la salida de datos TX del ESP32
+    ELECHOUSE_cc1101.SpiWriteReg(0x00, 0x2E);  // IOCFG2 = tri-state
+#endif
+    LOG_D("RF", "Escucha suspendida");
+}
+
+uint16_t CC1101_RF::readListened(uint16_t* out, uint16_t maxCount) {
+    uint16_t head = listenHead;
+    uint16_t tail = listenTail;
+    uint16_t count = 0;
+
+    while (tail != head && count < maxCount) {
+        out[count++] = listenRing[tail];
+        tail = (tail + 1) & (RX_RING_SIZE - 1);
+    }
+    listenTail = tail;
+    return count;
+}
+
 bool CC1101_RF::captureSignal(RFSignal* signal, unsigned long timeout) {
     if (!connected) return false;
+    suspendListening();
 
     unsigned long startTime = millis();
     unsigned long lastPrint = 0;
@@ -201,6 +332,10 @@ bool CC1101_RF::captureSignal(RFSignal* signal, unsigned long timeout) {
     configureReceiver();
     ELECHOUSE_cc1101.SetRx();
 
+    // Sin esto, una llamada sin señal devolvería la captura anterior
+    captureIndex = 0;
+    captureComplete = false;
+
     // === FASE 1: Iniciar PRE-CAPTURA inmediatamente ===
     // Esto captura todo incluyendo el preámbulo/wake-up
     preBufferIndex = 0;
@@ -228,6 +363,7 @@ bool CC1101_RF::captureSignal(RFSignal* signal, unsigned long timeout) {
         // Detectar señal (umbral más sensible)
         if (rssi > RSSI_THRESHOLD && !signalDetected) {
             signalDetected = true;
+            lastCaptureRssi = rssi;
             Serial.printf("[RF] Señal detectada! RSSI: %d - Continuando captura...\n", rssi);
 
             // Detener pre-captura y cambiar a captura principal
@@ -272,6 +408,7 @@ bool CC1101_RF::captureSignal(RFSignal* signal, unsigned long timeout) {
         detachInterrupt(digitalPinToInterrupt(CC1101_GDO0));
     }
     ELECHOUSE_cc1101.setSidle();
+    lastRadioUse = millis();
 
     // Verificar resultado
     if (captureIndex > 20) {
@@ -295,6 +432,47 @@ bool CC1101_RF::captureSignal(RFSignal* signal, unsigned long timeout) {
     return false;
 }
 
+int CC1101_RF::recordTrace(Print& out, unsigned long durationMs, uint32_t startUnix, uint32_t maxBytes) {
+    if (!connected) return -1;
+
+    PulseTraceHeader header;
+    header.version = PULSE_TRACE_VERSION;
+    header.modulation = currentModulation;
+    header.flags = PULSE_TRACE_FLAG_START_HIGH;
+    header.rssi = getRSSI();    // Piso de ruido al iniciar
+    header.frequencyKHz = (uint32_t)(currentFrequency * 1000 + 0.5f);
+    header.startUnix = startUnix;
+    header.startMillis = millis();
+
+    PulseTraceWriter writer(out);
+    if (!writer.begin(header)) return -1;
+
+    Serial.printf("[RF] Grabando pulsos %lu ms a %.2f MHz...\n", durationMs, currentFrequency);
+
+    // Cada ráfaga capturada se agrega como un segmento
+    RFSignal* signal = new RFSignal();
+    while (millis() - header.startMillis < durationMs) {
+        unsigned long remaining = durationMs - (millis() - header.startMillis);
+        if (!captureSignal(signal, remaining)) continue;
+
+        uint32_t offset = millis() - header.startMillis;
+        if (!writer.addSignal(signal, offset, lastCaptureRssi)) {
+            Serial.println("[RF] Error escribiendo la grabación");
+            break;
+        }
+        if (writer.getBytesWritten() >= maxBytes) {
+            Serial.println("[RF] Grabación: límite de tamaño alcanzado");
+            break;
+        }
+    }
+    delete signal;
+
+    Serial.printf("[RF] Grabación: %u segmentos, %lu pulsos, %lu bytes\n",
+                  writer.getSegmentCount(), (unsigned long)writer.getPulseCount(),
+                  (unsigned long)writer.getBytesWritten());
+    return writer.getSegmentCount();
+}
+
 bool CC1101_RF::transmitSignal(const RFSignal* signal, int repeats) {
     if (!connected || !signal->valid) return false;
 
@@ -303,51 +481,78 @@ bool CC1101_RF::transmitSignal(const RFSignal* signal, int repeats) {
 
 bool CC1101_RF::transmitRaw(const uint8_t* data, uint16_t length, int repeats, bool inverted) {
     if (!connected || length == 0) {
-        Serial.printf("[RF] TX FAILED: connected=%d, length=%d\n", connected, length);
+        LOG_E("RF", "TX FAILED: connected=%d, length=%d", connected, length);
+        metrics.increment(METRIC_RF_TX_ERRORS);
         return false;
     }
 
+    int pulseCount = length / 2;
+    LOG_I("RF", "TX: %d pulses, %d repeats, freq=%.2f MHz, inverted=%s",
+          pulseCount, repeats, currentFrequency, inverted ? "YES" : "NO");
+
+    // Debug: primeras duraciones (solo se compila con LOG_LEVEL >= debug)
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        char pulses[80];
+        int pos = 0;
+        for (int i = 0; i < min((int)length - 1, 20) && pos < (int)sizeof(pulses) - 8; i += 2) {
+            uint16_t dur = (data[i] << 8) | data[i + 1];
+            pos += snprintf(pulses + pos, sizeof(pulses) - pos, "%d ", dur);
+        }
+        LOG_D("RF", "Pulses (us): %s%s", pulses, length > 20 ? "..." : "");
+    }
+
+    // Polaridad inicial: normalmente empieza HIGH, si está invertido empieza LOW
+    LOG_D("RF", "Starting with: %s", inverted ? "LOW (inverted)" : "HIGH (normal)");
+
+    // Una repetición se codifica una sola vez y se reproduce N veces
+    PulseTrain train;
+    encodeRaw(data, length, inverted, train);
+
+    return transmitPulses(train.data(), train.size(), repeats);
+}
+
+bool CC1101_RF::transmitPulses(const uint32_t* pulses, uint16_t count, int repeats) {
+    if (!connected || count == 0) {
+        LOG_E("RF", "TX FAILED: connected=%d, pulses=%d", connected, count);
+        metrics.increment(METRIC_RF_TX_ERRORS);
+        return false;
+    }
+    suspendListening();
+
     // Verificar que el módulo responda antes de transmitir
     if (!ELECHOUSE_cc1101.getCC1101()) {
-        Serial.println("[RF] TX FAILED: CC1101 no responde, intentando reiniciar...");
+        LOG_W("RF", "TX FAILED: CC1101 no responde, intentando reiniciar...");
         connected = false;
         // Intentar reiniciar el módulo
         if (!begin()) {
-            Serial.println("[RF] No se pudo reiniciar CC1101");
+            LOG_E("RF", "No se pudo reiniciar CC1101");
+            metrics.increment(METRIC_RF_TX_ERRORS);
             return false;
         }
-        Serial.println("[RF] CC1101 reiniciado, continuando transmisión...");
+        LOG_I("RF", "CC1101 reiniciado, continuando transmisión...");
     }
 
-    int pulseCount = length / 2;
-    Serial.printf("[RF] ========== TRANSMIT START ==========\n");
-    Serial.printf("[RF] TX: %d pulses, %d repeats, freq=%.2f MHz, inverted=%s\n",
-                  pulseCount, repeats, currentFrequency, inverted ? "YES" : "NO");
+    // En una ráfaga con el mismo perfil los registros ya están listos
+    uint32_t profile = makeTxProfile(currentFrequency, 2, RF_TX_MODE_ASYNC);
+    if (!isTxProfileLoaded(profile)) {
+        // Step 1: Go to IDLE and reset
+        ELECHOUSE_cc1101.setSidle();
+        ELECHOUSE_cc1101.SpiStrobe(0x3A);  // SFRX - flush RX FIFO
+        ELECHOUSE_cc1101.SpiStrobe(0x3B);  // SFTX - flush TX FIFO
+        delay(5);
 
-    // Debug: show first pulse durations
-    Serial.print("[RF] Pulses (us): ");
-    for (int i = 0; i < min((int)length - 1, 20); i += 2) {
-        uint16_t dur = (data[i] << 8) | data[i + 1];
-        Serial.printf("%d ", dur);
+        // Step 2: Full re-initialization for TX
+        ELECHOUSE_cc1101.Init();
+        ELECHOUSE_cc1101.setMHZ(currentFrequency);
+        ELECHOUSE_cc1101.setModulation(2);      // ASK/OOK
+        ELECHOUSE_cc1101.setPA(12);             // Max power (PA table index)
+        ELECHOUSE_cc1101.setCCMode(0);          // Transparent mode
+        ELECHOUSE_cc1101.setSyncMode(0);        // No sync
+        ELECHOUSE_cc1101.setCrc(0);             // No CRC
+        ELECHOUSE_cc1101.setDcFilterOff(1);     // DC filter off
+        ELECHOUSE_cc1101.setPktFormat(3);       // Async serial mode - GDO2 is TX data input!
+        loadedTxProfile = profile;
     }
-    Serial.println(length > 20 ? "..." : "");
-
-    // Step 1: Go to IDLE and reset
-    ELECHOUSE_cc1101.setSidle();
-    ELECHOUSE_cc1101.SpiStrobe(0x3A);  // SFRX - flush RX FIFO
-    ELECHOUSE_cc1101.SpiStrobe(0x3B);  // SFTX - flush TX FIFO
-    delay(5);
-
-    // Step 2: Full re-initialization for TX
-    ELECHOUSE_cc1101.Init();
-    ELECHOUSE_cc1101.setMHZ(currentFrequency);
-    ELECHOUSE_cc1101.setModulation(2);      // ASK/OOK
-    ELECHOUSE_cc1101.setPA(12);             // Max power (PA table index)
-    ELECHOUSE_cc1101.setCCMode(0);          // Transparent mode
-    ELECHOUSE_cc1101.setSyncMode(0);        // No sync
-    ELECHOUSE_cc1101.setCrc(0);             // No CRC
-    ELECHOUSE_cc1101.setDcFilterOff(1);     // DC filter off
-    ELECHOUSE_cc1101.setPktFormat(3);       // Async serial mode - GDO2 is TX data input!
 
     // Step 3: Configure GDO2 (pin 12) as output for TX data
     // In CC1101 async serial mode: GDO0=RX output, GDO2=TX input
@@ -359,38 +564,15 @@ bool CC1101_RF::transmitRaw(const uint8_t* data, uint16_t length, int repeats, b
     ELECHOUSE_cc1101.SetTx();  // Use library function
     delay(5);  // Give time to enter TX mode
 
-    // Polaridad inicial: normalmente empieza HIGH, si está invertido empieza LOW
-    bool startHigh = !inverted;
-    Serial.printf("[RF] Starting with: %s\n", startHigh ? "HIGH (normal)" : "LOW (inverted)");
-
     // Step 5: Transmit the signal
+    metrics.txStarted();
     for (int rep = 0; rep < repeats; rep++) {
+        // Se mide solo la última repetición para no alterar los gaps
+        if (rep == repeats - 1) txTiming.arm(CC1101_GDO2);
 
         // Disable interrupts for precise timing
         portDISABLE_INTERRUPTS();
-
-        bool currentLevel = startHigh;
-
-        // Transmit each pulse by toggling state
-        for (uint16_t i = 0; i + 1 < length; i += 2) {
-            uint16_t duration = (data[i] << 8) | data[i + 1];
-
-            // Skip invalid durations
-            if (duration == 0 || duration > 50000) continue;
-
-            // Set output level on GDO2
-            digitalWrite(CC1101_GDO2, currentLevel ? HIGH : LOW);
-
-            // Wait for duration
-            delayMicroseconds(duration);
-
-            // Toggle for next pulse
-            currentLevel = !currentLevel;
-        }
-
-        // Ensure carrier OFF at end
-        digitalWrite(CC1101_GDO2, LOW);
-
+        PulseTrain::play(CC1101_GDO2, pulses, count);
         portENABLE_INTERRUPTS();
 
         // Gap mínimo entre repeticiones (solo para estabilidad del transmisor)
@@ -399,7 +581,9 @@ bool CC1101_RF::transmitRaw(const uint8_t* data, uint16_t length, int repeats, b
         }
     }
 
-    Serial.printf("[RF] TX: %d repeticiones completadas\n", repeats);
+    metrics.txFinished(true);
+    txTiming.measure(pulses, count);
+    LOG_D("RF", "TX: %d repeticiones completadas", repeats);
 
     // Step 6: Return to idle
     digitalWrite(CC1101_GDO2, LOW);
@@ -407,10 +591,63 @@ bool CC1101_RF::transmitRaw(const uint8_t* data, uint16_t length, int repeats, b
     ELECHOUSE_cc1101.setSidle();
     pinMode(CC1101_GDO2, INPUT);
 
-    Serial.printf("[RF] ========== TRANSMIT COMPLETE ==========\n");
+    LOG_I("RF", "TX completa");
+    lastRadioUse = millis();
     return true;
 }
 
+// kHz en los bits 31..8, modulación en 7..4 y modo en 3..0
+uint32_t CC1101_RF::makeTxProfile(float freq, int modulation, uint8_t mode) {
+    return ((uint32_t)(freq * 1000 + 0.5f) << 8) | ((modulation & 0x0F) << 4) | (mode & 0x0F);
+}
+
+void CC1101_RF::beginBurst() {
+    suspendListening();
+    burst = true;
+    loadedTxProfile = 0;        // Fuera de la ráfaga el estado de los registros no se sigue
+    restorePending = false;
+}
+
+void CC1101_RF::endBurst() {
+    burst = false;
+    loadedTxProfile = 0;
+    if (restorePending) {
+        restorePending = false;
+        restoreDefaults();
+    }
+    lastRadioUse = millis();
+}
+
+void CC1101_RF::restoreDefaults() {
+    suspendListening();
+    ELECHOUSE_cc1101.setSidle();
+    ELECHOUSE_cc1101.Init();
+    ELECHOUSE_cc1101.setMHZ(433.92);
+    ELECHOUSE_cc1101.setModulation(2);
+    ELECHOUSE_cc1101.setCCMode(1);
+    ELECHOUSE_cc1101.setSyncMode(0);
+    ELECHOUSE_cc1101.setCrc(0);
+    ELECHOUSE_cc1101.setPA(10);
+    LOG_D("RF", "Configuración por defecto restaurada");
+}
+
+// Convierte pares de bytes (duración big endian) en un tren de pulsos
+// alternados. Las duraciones inválidas se saltan sin alternar el nivel.
+bool CC1101_RF::encodeRaw(const uint8_t* data, uint16_t length, bool inverted, PulseTrain& train) {
+    train.clear();
+
+    bool currentLevel = !inverted;
+    for (uint16_t i = 0; i + 1 < length; i += 2) {
+        uint16_t duration = (data[i] << 8) | data[i + 1];
+        if (duration == 0 || duration > 50000) continue;
+
+        train.add(currentLevel, duration);
+        currentLevel = !currentLevel;
+    }
+
+    return !train.isOverflowed();
+}
+
 float CC1101_RF::scanForSignal(float* frequencies, int count, unsigned long timeout) {
     if (!connected) return 0;
 
@@ -558,6 +795,7 @@ String CC1101_RF::getProtocolName(RFProtocol protocol) {
 
 String CC1101_RF::analyzeSignal(const RFSignal* signal) {
     if (!signal->valid) return "Señal inválida";
+    HeapScope heap(HEAP_RF);
 
     // Detectar protocolo
     RFProtocol protocol = detectProtocol(signal);
@@ -661,12 +899,15 @@ int CC1101_RF::getLQI() {
 }
 
 void CC1101_RF::setTxPower(int power) {
+    suspendListening();
+    loadedTxProfile = 0;
     if (connected) {
         ELECHOUSE_cc1101.setPA(power);
     }
 }
 
 void CC1101_RF::reset() {
+    suspendListening();
     if (connected) {
         ELECHOUSE_cc1101.setSidle();
         ELECHOUSE_cc1101.SpiStrobe(0x30); // SRES
@@ -689,9 +930,14 @@ String CC1101_RF::getStatusString() {
 }
 
 void CC1101_RF::configureReceiver() {
+    configureReceiver(currentFrequency, currentModulation);
+    Serial.println("[RF] Receiver configurado para async serial");
+}
+
+void CC1101_RF::configureReceiver(float freq, int modulation) {
     ELECHOUSE_cc1101.setCCMode(0);          // Raw mode (no packet handling)
-    ELECHOUSE_cc1101.setModulation(currentModulation);
-    ELECHOUSE_cc1101.setMHZ(currentFrequency);
+    ELECHOUSE_cc1101.setModulation(modulation);
+    ELECHOUSE_cc1101.setMHZ(freq);
     ELECHOUSE_cc1101.setSyncMode(0);        // Sin sync word
     ELECHOUSE_cc1101.setCrc(0);             // Sin CRC
     ELECHOUSE_cc1101.setDcFilterOff(0);     // DC filter ON para mejor recepción
@@ -699,8 +945,6 @@ void CC1101_RF::configureReceiver() {
 
     // Configurar GDO0 para salida de datos serial (0x0D = serial data output)
     ELECHOUSE_cc1101.SpiWriteReg(0x02, 0x0D);  // IOCFG0 = Serial Data Output
-
-    Serial.println("[RF] Receiver configurado para async serial");
 }
 
 void CC1101_RF::configureTransmitter() {
@@ -0,0 +1,404 @@
+#include "CoverPositions.h"
+#include "Storage.h"
+#include "TxScheduler.h"
+#include "Logger.h"
+
+CoverPositions coverPositions;
+
+CoverPositions::CoverPositions() {
+    coverCount = 0;
+    generation = 0;
+    stale = true;
+    pending = false;
+    nextDeadline = 0;
+    saveDirty = false;
+    saveAt = 0;
+    onPublish = nullptr;
+}
+
+bool CoverPositions::isValidTravel(uint32_t ms) {
+    return ms == 0 || (ms >= COVER_TRAVEL_MIN_MS && ms <= COVER_TRAVEL_MAX_MS);
+}
+
+bool CoverPositions::hasTravel(const SavedDevice* device) {
+    switch (device->type) {
+        case DEVICE_CURTAIN:
+        case DEVICE_CURTAIN_SOMFY:
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+        case DEVICE_CURTAIN_AOK:
+            return device->travelOpenMs > 0 && device->travelCloseMs > 0;
+        default:
+            return false;
+    }
+}
+
+void CoverPositions::begin() {
+    ensure();
+    if (coverCount == 0) return;
+
+    CoverPositionRecord* records = (CoverPositionRecord*)malloc(coverCount * sizeof(CoverPositionRecord));
+    if (!records) return;
+
+    uint16_t count = storage.loadCoverPositions(records, coverCount);
+    for (uint16_t i = 0; i < count; i++) {
+        Cover* cover = find(records[i].id);
+        if (cover) cover->position = cover->startPosition = records[i].position * 10;
+    }
+    free(records);
+
+    LOG_I("Cover", "%d cortinas con recorrido medido, %d posiciones guardadas", coverCount, count);
+}
+
+// ============================================
+// Tabla de cortinas
+// ============================================
+
+void CoverPositions::onDeviceChanged(const char* id, const SavedDevice* device) {
+    // Se aplica en el lugar solo si es el único cambio desde la última
+    // pasada (p.ej. el rolling code); si no, ensure() recorre el catálogo
+    if (stale || !id || storage.getCatalogGeneration() != generation + 1 ||
+        (device && strcmp(id, device->id) != 0)) {
+        stale = true;
+        return;
+    }
+
+    Cover* cover = find(id);
+    if (device && hasTravel(device)) {
+        visit(device, this);
+    } else if (cover) {
+        remove(cover);
+    }
+
+    generation++;
+    schedule();
+}
+
+void CoverPositions::ensure() {
+    uint32_t catalog = storage.getCatalogGeneration();
+    if (!stale && generation == catalog) return;
+
+    for (uint8_t i = 0; i < coverCount; i++) covers[i].seen = false;
+    storage.forEachDevice(visit, this);
+
+    for (uint8_t i = 0; i < coverCount; ) {
+        if (covers[i].seen) i++;
+        else remove(&covers[i]);
+    }
+
+    generation = catalog;
+    stale = false;
+    schedule();
+}
+
+// Visitante de Storage::forEachDevice: alta o actualización de una cortina
+bool CoverPositions::visit(const SavedDevice* device, void* context) {
+    CoverPositions* self = (CoverPositions*)context;
+    if (!hasTravel(device)) return true;
+
+    Cover* cover = self->find(device->id);
+    if (!cover) {
+        if (self->coverCount >= MAX_DEVICES) return false;
+
+        cover = &self->covers[self->coverCount++];
+        memset(cover, 0, sizeof(Cover));
+        strlcpy(cover->id, device->id, sizeof(cover->id));
+        cover->position = cover->startPosition = 1000;     // Sin historial: se asume abierta
+        cover->target = -1;
+    }
+
+    cover->openMs = device->travelOpenMs;
+    cover->closeMs = device->travelCloseMs;
+    cover->seen = true;
+    return true;
+}
+
+CoverPositions::Cover* CoverPositions::find(const char* deviceId) {
+    for (uint8_t i = 0; i < coverCount; i++) {
+        if (strcmp(covers[i].id, deviceId) == 0) return &covers[i];
+    }
+    return nullptr;
+}
+
+// El orden de la tabla no importa: el último ocupa el hueco
+void CoverPositions::remove(Cover* cover) {
+    *cover = covers[--coverCount];
+}
+
+// ============================================
+// Modelo de recorrido
+// ============================================
+
+uint16_t CoverPositions::current(const Cover& cover, unsigned long now) const {
+    if (cover.direction == 0) return cover.position;
+
+    uint32_t travel = cover.direction > 0 ? cover.openMs : cover.closeMs;
+    uint32_t delta = (uint64_t)(now - cover.startedAt) * 1000 / travel;
+
+    if (cover.direction > 0) {
+        return cover.startPosition + delta >= 1000 ? 1000 : cover.startPosition + delta;
+    }
+    return delta >= cover.startPosition ? 0 : cover.startPosition - delta;
+}
+
+// Fin del movimiento en curso: stop programado o tope del recorrido
+unsigned long CoverPositions::deadline(const Cover& cover) const {
+    unsigned long end = cover.stopAt;
+    if (end == 0) {
+        uint32_t travel = cover.direction > 0 ? cover.openMs : cover.closeMs;
+        uint16_t remaining = cover.direction > 0 ? 1000 - cover.startPosition : cover.startPosition;
+        end = cover.startedAt + (unsigned long)((uint64_t)remaining * travel / 1000);
+    }
+    return end;
+}
+
+// at = hora de transmisión del comando
+void CoverPositions::start(Cover& cover, int8_t direction, unsigned long at) {
+    uint16_t from = current(cover, at);
+    cover.position = from;
+    cover.startPosition = from;
+    cover.startedAt = at;
+    cover.direction = direction;
+    cover.stopAt = 0;
+
+    // set_position: el stop se programa desde que el comando salió al aire
+    if (cover.target >= 0) {
+        uint16_t goal = cover.target * 10;
+        if ((direction > 0 && goal > from) || (direction < 0 && goal < from)) {
+            uint32_t travel = direction > 0 ? cover.openMs : cover.closeMs;
+            uint16_t distance = direction > 0 ? goal - from : from - goal;
+            cover.stopAt = at + (unsigned long)((uint64_t)distance * travel / 1000);
+            if (cover.stopAt == 0) cover.stopAt = 1;
+        }
+        cover.target = -1;
+    }
+
+    publish(cover, millis());
+}
+
+void CoverPositions::halt(Cover& cover, uint16_t position, unsigned long now) {
+    cover.position = position;
+    cover.startPosition = position;
+    cover.direction = 0;
+    cover.stopAt = 0;
+    publish(cover, now);
+
+    saveDirty = true;
+    saveAt = now + COVER_POSITION_SAVE_MS;
+}
+
+// Un solo plazo para todas: fin de movimiento, próxima publicación o guardado
+void CoverPositions::schedule() {
+    pending = false;
+    bool moving = false;
+
+    for (uint8_t i = 0; i < coverCount; i++) {
+        const Cover& cover = covers[i];
+        if (cover.direction == 0) continue;
+        moving = true;
+
+        unsigned long end = deadline(cover);
+        unsigned long tick = cover.publishedAt + COVER_POSITION_PUBLISH_MS;
+        unsigned long next = (long)(tick - end) < 0 ? tick : end;
+
+        if (!pending || (long)(next - nextDeadline) < 0) {
+            nextDeadline = next;
+            pending = true;
+        }
+    }
+
+    if (!moving && saveDirty) {
+        nextDeadline = saveAt;
+        pending = true;
+    }
+}
+
+void CoverPositions::loop() {
+    if (!pending) return;
+
+    unsigned long now = millis();
+    if ((long)(now - nextDeadline) < 0) return;
+
+    // Los stops vencidos salen juntos en una ráfaga inmediata: la ventana
+    // del planificador sumaría su retardo al error de posición
+    uint8_t stops = 0;
+    bool moving = false;
+
+    for (uint8_t i = 0; i < coverCount; i++) {
+        Cover& cover = covers[i];
+        if (cover.direction == 0) continue;
+
+        if ((long)(now - deadline(cover)) >= 0) {
+            if (cover.stopAt == 0) {
+                halt(cover, cover.direction > 0 ? 1000 : 0, now);
+                continue;
+            }
+
+            cover.stopAt = 0;
+            if (send(cover.id, "stop")) {
+                cover.stopping = true;
+                stops++;
+            } else {
+                LOG_W("Cover", "No se pudo programar el stop de %s", cover.id);
+                halt(cover, current(cover, now), now);
+                continue;
+            }
+        } else if (now - cover.publishedAt >= COVER_POSITION_PUBLISH_MS) {
+            publish(cover, now);
+        }
+        moving = true;
+    }
+
+    if (stops > 0) {
+        txScheduler.flush();
+
+        // Sigue en stopping: la ráfaga no transmitió su stop
+        moving = false;
+        for (uint8_t i = 0; i < coverCount; i++) {
+            Cover& cover = covers[i];
+            if (cover.stopping) {
+                cover.stopping = false;
+                halt(cover, current(cover, millis()), millis());
+            }
+            if (cover.direction != 0) moving = true;
+        }
+    }
+
+    if (saveDirty && !moving && (long)(now - saveAt) >= 0) {
+        save();
+    }
+
+    schedule();
+}
+
+// ============================================
+// Comandos
+// ============================================
+
+bool CoverPositions::onCommandSent(const char* deviceId, const char* command) {
+    ensure();
+
+    Cover* cover = find(deviceId);
+    if (!cover) return false;
+
+    // El motor reacciona a la primera trama, no al final de la ráfaga
+    unsigned long now = millis();
+    unsigned long at = txScheduler.getDoneSentAt();
+    if (at == 0 || (long)(at - cover->startedAt) < 0) at = now;
+
+    cover->stopping = false;
+    switch (TxScheduler::getProtocolAction(command)) {
+        case ACTION_UP:
+            start(*cover, 1, at);
+            break;
+        case ACTION_DOWN:
+            start(*cover, -1, at);
+            break;
+        case ACTION_STOP:
+            cover->target = -1;
+            halt(*cover, current(*cover, at), now);
+            break;
+        default:
+            break;      // prog no mueve la cortina
+    }
+
+    schedule();
+    return true;
+}
+
+bool CoverPositions::setPosition(const char* deviceId, uint8_t position) {
+    ensure();
+
+    Cover* cover = find(deviceId);
+    if (!cover) return false;
+    if (position > 100) position = 100;
+
+    // Copia local: transmitir puede reconstruir la tabla
+    char id[sizeof(cover->id)];
+    strlcpy(id, cover->id, sizeof(id));
+
+    // El nuevo destino reemplaza al stop que estuviera programado
+    cover->stopAt = 0;
+
+    // Extremos: recorrido completo, el motor se detiene en su tope
+    if (position == 0 || position == 100) {
+        cover->target = -1;
+        return send(id, position == 100 ? "open" : "close");
+    }
+
+    unsigned long now = millis();
+    uint16_t at = current(*cover, now);
+    uint16_t goal = position * 10;
+
+    if (abs((int)goal - (int)at) < 10) {
+        if (cover->direction != 0) return send(id, "stop");
+        publish(*cover, now);
+        return true;
+    }
+
+    cover->target = position;
+    if (!send(id, goal > at ? "open" : "close")) {
+        cover = find(id);
+        if (cover) cover->target = -1;
+        return false;
+    }
+
+    LOG_I("Cover", "%s: %d%% -> %d%%", id, (at + 5) / 10, position);
+    return true;
+}
+
+int8_t CoverPositions::getPosition(const char* deviceId) {
+    ensure();
+
+    Cover* cover = find(deviceId);
+    if (!cover) return -1;
+    return (current(*cover, millis()) + 5) / 10;
+}
+
+void CoverPositions::publishAll() {
+    ensure();
+
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < coverCount; i++) {
+        publish(covers[i], now);
+    }
+    schedule();
+}
+
+void CoverPositions::publish(Cover& cover, unsigned long now) {
+    cover.publishedAt = now;
+    if (!onPublish) return;
+
+    uint16_t position = current(cover, now);
+    const char* state;
+    if (cover.direction > 0) state = "opening";
+    else if (cover.direction < 0) state = "closing";
+    else if (position >= 1000) state = "open";
+    else if (position == 0) state = "closed";
+    else state = "stopped";
+
+    onPublish(cover.id, (position + 5) / 10, state);
+}
+
+bool CoverPositions::send(const char* deviceId, const char* command) {
+    SavedDevice device;
+    if (!storage.getDevice(deviceId, &device)) return false;
+    return txScheduler.submit(&device, command, onSent);
+}
+
+void CoverPositions::onSent(const char* deviceId, const char* command) {
+    coverPositions.onCommandSent(deviceId, command);
+}
+
+void CoverPositions::save() {
+    saveDirty = false;
+
+    CoverPositionRecord* records = (CoverPositionRecord*)malloc((coverCount ? coverCount : 1) * sizeof(CoverPositionRecord));
+    if (!records) return;
+
+    for (uint8_t i = 0; i < coverCount; i++) {
+        strlcpy(records[i].id, covers[i].id, sizeof(records[i].id));
+        records[i].position = (covers[i].position + 5) / 10;
+    }
+    storage.saveCoverPositions(records, coverCount);
+    free(records);
+}
@@ -0,0 +1,128 @@
+#include "CronSpec.h"
+
+// "minuto hora día mes díaSemana"
+bool CronSpec::parse(const char* text) {
+    memset(this, 0, sizeof(*this));
+
+    char buffer[64];
+    strlcpy(buffer, text, sizeof(buffer));
+
+    char* fields[5];
+    uint8_t count = 0;
+    char* save = nullptr;
+    for (char* field = strtok_r(buffer, " \t", &save); field; field = strtok_r(nullptr, " \t", &save)) {
+        if (count == 5) return false;
+        fields[count++] = field;
+    }
+    if (count != 5) return false;
+
+    uint64_t mask;
+    bool any;
+
+    if (!parseField(fields[0], 0, 59, &mask, &any)) return false;
+    minutes = mask;
+    if (!parseField(fields[1], 0, 23, &mask, &any)) return false;
+    hours = (uint32_t)mask;
+    if (!parseField(fields[2], 1, 31, &mask, &anyMonthDay)) return false;
+    monthDays = (uint32_t)mask;
+    if (!parseField(fields[3], 1, 12, &mask, &any)) return false;
+    months = (uint16_t)mask;
+    if (!parseField(fields[4], 0, 7, &mask, &anyWeekday)) return false;
+    weekdays = (mask | (mask >> 7)) & 0x7F;
+
+    return true;
+}
+
+// Lista de "*", "n", "a-b", con paso opcional "/n" ("*/15", "8-18/2", "5/10")
+bool CronSpec::parseField(const char* text, uint8_t low, uint8_t high, uint64_t* mask, bool* any) {
+    char buffer[32];
+    if (strlcpy(buffer, text, sizeof(buffer)) >= sizeof(buffer)) return false;
+
+    *mask = 0;
+    *any = text[0] == '*';
+
+    char* save = nullptr;
+    for (char* item = strtok_r(buffer, ",", &save); item; item = strtok_r(nullptr, ",", &save)) {
+        long step = 1;
+        char* slash = strchr(item, '/');
+        if (slash) {
+            *slash = '\0';
+            char* end;
+            step = strtol(slash + 1, &end, 10);
+            if (end == slash + 1 || *end != '\0' || step < 1) return false;
+        }
+
+        long from = low;
+        long to = high;
+        if (strcmp(item, "*") != 0) {
+            char* end;
+            from = strtol(item, &end, 10);
+            if (end == item) return false;
+
+            if (*end == '-') {
+                char* start = end + 1;
+                to = strtol(start, &end, 10);
+                if (end == start) return false;
+            } else if (!slash) {
+                to = from;
+            }
+            if (*end != '\0') return false;
+        }
+
+        if (from < low || to > high || from > to) return false;
+        for (long value = from; value <= to; value += step) {
+            *mask |= 1ULL << value;
+        }
+    }
+
+    return *mask != 0;
+}
+
+// Con día del mes y día de la semana restringidos basta uno
+bool CronSpec::dayMatches(const struct tm& date) const {
+    if (!(months & (1 << (date.tm_mon + 1)))) return false;
+
+    bool monthDay = monthDays & (1UL << date.tm_mday);
+    bool weekday = weekdays & (1 << date.tm_wday);
+
+    if (anyMonthDay && anyWeekday) return true;
+    if (anyMonthDay) return weekday;
+    if (anyWeekday) return monthDay;
+    return monthDay || weekday;
+}
+
+// Día por día (no minuto por minuto): la hora y el minuto salen de las máscaras
+time_t CronSpec::next(time_t after) const {
+    time_t start = after - (after % 60) + 60;
+    struct tm date;
+    localtime_r(&start, &date);
+
+    for (uint16_t day = 0; day < SCHEDULE_SEARCH_DAYS; day++) {
+        if (dayMatches(date)) {
+            for (int hour = date.tm_hour; hour < 24; hour++) {
+                if (!(hours & (1UL << hour))) continue;
+
+                for (int minute = hour == date.tm_hour ? date.tm_min : 0; minute < 60; minute++) {
+                    if (minutes & (1ULL << minute)) {
+                        date.tm_hour = hour;
+                        date.tm_min = minute;
+                        date.tm_sec = 0;
+                        date.tm_isdst = -1;
+                        return mktime(&date);
+                    }
+                }
+            }
+        }
+
+        // Día siguiente a las 00:00 (mktime normaliza mes, año y DST)
+        date.tm_mday++;
+        date.tm_hour = 0;
+        date.tm_min = 0;
+        date.tm_sec = 0;
+        date.tm_isdst = -1;
+        time_t next = mktime(&date);
+        localtime_r(&next, &date);
+    }
+
+    return 0;
+}
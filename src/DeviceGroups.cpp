@@ -0,0 +1,82 @@
+#include "DeviceGroups.h"
+#include "Storage.h"
+#include "Logger.h"
+
+DeviceGroups deviceGroups;
+
+DeviceGroups::DeviceGroups() {
+    command = nullptr;
+    room = nullptr;
+    groupIds = nullptr;
+    groupIdCount = 0;
+    onSent = nullptr;
+    queued = 0;
+}
+
+uint8_t DeviceGroups::sendToRoom(const char* roomName, const char* cmd, TxDoneCallback callback) {
+    command = cmd;
+    room = roomName;
+    onSent = callback;
+
+    uint8_t count = resolve(roomName);
+    room = nullptr;
+    return count;
+}
+
+uint8_t DeviceGroups::sendToGroup(const char* groupId, const char* cmd, TxDoneCallback callback) {
+    char ids[MAX_GROUP_MEMBERS][37];
+    uint8_t count = 0;
+    if (!storage.loadGroupMembers(groupId, ids, MAX_GROUP_MEMBERS, &count)) {
+        LOG_W("Group", "Grupo no encontrado: %s", groupId);
+        return 0;
+    }
+
+    command = cmd;
+    groupIds = ids;
+    groupIdCount = count;
+    onSent = callback;
+
+    uint8_t queuedCount = count > 0 ? resolve(groupId) : 0;
+    groupIds = nullptr;
+    groupIdCount = 0;
+    return queuedCount;
+}
+
+uint8_t DeviceGroups::resolve(const char* target) {
+    queued = 0;
+    storage.forEachDevice(visit, this);
+
+    if (queued == 0) {
+        LOG_W("Group", "'%s' sin miembros para '%s'", target, command);
+    } else {
+        LOG_I("Group", "'%s': %d miembros en cola para '%s'", target, queued, command);
+    }
+    return queued;
+}
+
+// Visitante de Storage::forEachDevice: el planificador copia solo lo necesario para transmitir
+bool DeviceGroups::visit(const SavedDevice* device, void* context) {
+    DeviceGroups* self = (DeviceGroups*)context;
+
+    if (self->room) {
+        if (strcasecmp(device->room, self->room) != 0) return true;
+    } else {
+        bool listed = false;
+        for (uint8_t i = 0; i < self->groupIdCount && !listed; i++) {
+            listed = strcmp(device->id, self->groupIds[i]) == 0;
+        }
+        if (!listed) return true;
+    }
+
+    if (!device->enabled) return true;
+
+    if (self->queued >= MAX_GROUP_MEMBERS) {
+        LOG_W("Group", "Más de %d miembros: se ignoran los restantes", MAX_GROUP_MEMBERS);
+        return false;
+    }
+
+    if (txScheduler.submit(device, self->command, self->onSent)) {
+        self->queued++;
+    }
+    return true;
+}
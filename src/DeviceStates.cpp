@@ -0,0 +1,112 @@
+#include "DeviceStates.h"
+#include "Storage.h"
+#include "Logger.h"
+
+DeviceStates deviceStates;
+
+DeviceStates::DeviceStates() {
+    count = 0;
+    dirty = false;
+    saveAt = 0;
+}
+
+void DeviceStates::begin() {
+    count = storage.loadDeviceStates(entries, MAX_DEVICES);
+    LOG_I("States", "%d estados de dispositivos guardados", count);
+}
+
+void DeviceStates::loop() {
+    if (dirty && (long)(millis() - saveAt) >= 0) {
+        flush();
+    }
+}
+
+void DeviceStates::flush() {
+    if (!dirty) return;
+    dirty = false;
+    storage.saveDeviceStates(entries, count);
+}
+
+bool DeviceStates::record(const char* deviceId, const char* state) {
+    if (!deviceId || !state || !isStorable(state)) return false;
+
+    int16_t index = indexOf(deviceId);
+    if (index >= 0) {
+        // Repetido (p.ej. varios "close" seguidos): nada que guardar
+        if (strcmp(entries[index].state, state) == 0) return false;
+    } else {
+        if (count >= MAX_DEVICES) prune();
+        if (count >= MAX_DEVICES) return false;
+
+        index = count++;
+        strlcpy(entries[index].id, deviceId, sizeof(entries[index].id));
+    }
+
+    strlcpy(entries[index].state, state, sizeof(entries[index].state));
+
+    // El plazo no se corre con cada cambio: una escritura cada STATE_SAVE_MS
+    if (!dirty) {
+        dirty = true;
+        saveAt = millis() + STATE_SAVE_MS;
+    }
+    return true;
+}
+
+const char* DeviceStates::get(const char* deviceId) const {
+    int16_t index = indexOf(deviceId);
+    return index >= 0 ? entries[index].state : nullptr;
+}
+
+void DeviceStates::onDeviceChanged(const char* id, const SavedDevice* device) {
+    if (!id) {
+        // clearUserData(): states.json ya no existe
+        count = 0;
+        dirty = false;
+        return;
+    }
+    if (device) return;
+
+    int16_t index = indexOf(id);
+    if (index >= 0) {
+        remove(index);
+        if (!dirty) {
+            dirty = true;
+            saveAt = millis() + STATE_SAVE_MS;
+        }
+    }
+}
+
+int16_t DeviceStates::indexOf(const char* deviceId) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp(entries[i].id, deviceId) == 0) return i;
+    }
+    return -1;
+}
+
+// El orden no importa: el último ocupa el hueco
+void DeviceStates::remove(uint8_t index) {
+    entries[index] = entries[--count];
+}
+
+// Tabla llena: quedan entradas de dispositivos borrados sin MQTT activo
+// (sin aviso de Storage). Raro: se consulta el catálogo una vez por entrada.
+void DeviceStates::prune() {
+    SavedDevice device;
+    for (uint8_t i = 0; i < count; ) {
+        if (storage.getDevice(entries[i].id, &device)) i++;
+        else remove(i);
+    }
+    LOG_I("States", "Tabla depurada: %d estados", count);
+}
+
+// Solo estados de comando: states.json se escribe sin escapar
+bool DeviceStates::isStorable(const char* state) {
+    size_t length = strlen(state);
+    if (length == 0 || length >= STATE_LENGTH) return false;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = state[i];
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+    }
+    return true;
+}
@@ -1,5 +1,7 @@
 #include "DooyaBidir.h"
 #include "CC1101_RF.h"
+#include "Metrics.h"
+#include "Logger.h"
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 
 // Instancia global
@@ -49,39 +51,44 @@ bool DooyaBidirectional::sendProg() {
 
 bool DooyaBidirectional::sendCommand(uint8_t command) {
     if (!initialized) {
-        Serial.println("[DooyaBidir] Error: No inicializado");
+        LOG_E("DooyaBidir", "Error: No inicializado");
         return false;
     }
 
     if (currentDeviceId == 0) {
-        Serial.println("[DooyaBidir] Error: No hay ID configurado");
+        LOG_E("DooyaBidir", "Error: No hay ID configurado");
         return false;
     }
 
-    Serial.printf("[DooyaBidir] Enviando comando 0x%02X\n", command);
+    LOG_I("DooyaBidir", "Enviando comando 0x%02X", command);
 
     // Construir el frame
     buildFrame(command);
 
     // Mostrar frame
-    Serial.print("[DooyaBidir] Frame: ");
-    for (int i = 0; i < DOOYA_BIDIR_FRAME_LEN; i++) {
-        Serial.printf("%02X", frameBuffer[i]);
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        char hex[DOOYA_BIDIR_FRAME_LEN * 3 + 1];
+        Logger::formatHex(hex, sizeof(hex), frameBuffer, DOOYA_BIDIR_FRAME_LEN);
+        LOG_D("DooyaBidir", "Frame: %s", hex);
     }
-    Serial.println();
 
     // Transmitir
-    bool success = transmitFrame();
+    bool success = transmitFrame(frameBuffer);
 
     if (success) {
-        Serial.println("[DooyaBidir] Comando enviado OK");
+        LOG_D("DooyaBidir", "Comando enviado OK");
     } else {
-        Serial.println("[DooyaBidir] Error al transmitir");
+        LOG_E("DooyaBidir", "Error al transmitir");
     }
 
     return success;
 }
 
+void DooyaBidirectional::encodeFrame(uint8_t command, uint8_t* out) {
+    buildFrame(command);
+    memcpy(out, frameBuffer, DOOYA_BIDIR_FRAME_LEN);
+}
+
 void DooyaBidirectional::buildFrame(uint8_t command) {
     // Estructura del frame Dooya bidireccional (10 bytes):
     // Byte 0: 0x09 (fijo)
@@ -117,28 +124,45 @@ void DooyaBidirectional::buildFrame(uint8_t command) {
     frameBuffer[9] = 0x00;
 }
 
-bool DooyaBidirectional::transmitFrame() {
-    // Configurar CC1101 para FSK
-    configureFSK();
+bool DooyaBidirectional::transmitFrame(const uint8_t* frame) {
+    if (!initialized) {
+        LOG_E("DooyaBidir", "Error: No inicializado");
+        return false;
+    }
+
+    rfModule.suspendListening();
+
+    // Configurar CC1101 para FSK (en una ráfaga solo si cambió el perfil)
+    uint32_t profile = CC1101_RF::makeTxProfile(DOOYA_BIDIR_FREQUENCY, DOOYA_BIDIR_MODULATION, RF_TX_MODE_FSK);
+    if (!rfModule.isTxProfileLoaded(profile)) {
+        configureFSK();
+        rfModule.setTxProfileLoaded(profile);
+    }
 
     // Transmitir usando la librería CC1101
     // Nota: La transmisión FSK requiere configuración especial del CC1101
     // que puede no estar completamente soportada por todas las librerías
 
     ELECHOUSE_cc1101.SetTx();
+    metrics.txStarted();
 
     // Transmitir el frame
     // La librería ELECHOUSE puede no soportar FSK directamente
     // Por ahora simulamos la transmisión
     for (int repeat = 0; repeat < 5; repeat++) {
-        ELECHOUSE_cc1101.SendData(frameBuffer, DOOYA_BIDIR_FRAME_LEN);
+        ELECHOUSE_cc1101.SendData((uint8_t*)frame, DOOYA_BIDIR_FRAME_LEN);
         delay(20);
     }
+    metrics.txFinished(true);
 
     ELECHOUSE_cc1101.SetRx();
 
-    // Restaurar configuración ASK para otros dispositivos
-    restoreASK();
+    // Restaurar configuración ASK para otros dispositivos (al final de la ráfaga)
+    if (rfModule.isBurst()) {
+        rfModule.deferRestore();
+    } else {
+        restoreASK();
+    }
 
     return true;
 }
@@ -147,7 +171,7 @@ void DooyaBidirectional::configureFSK() {
     // Configurar CC1101 para modulación 2-FSK (Dooya Bidireccional)
     // Referencia: CC1101 Datasheet (SWRS061I)
 
-    Serial.println("[DooyaBidir] Configurando 2-FSK para Dooya...");
+    LOG_D("DooyaBidir", "Configurando 2-FSK para Dooya...");
 
     // 1. Ir a estado IDLE antes de configurar
     ELECHOUSE_cc1101.setSidle();
@@ -205,7 +229,7 @@ void DooyaBidirectional::configureFSK() {
     // 12. Configurar potencia de transmisión
     ELECHOUSE_cc1101.setPA(12);  // Potencia máxima
 
-    Serial.printf("[DooyaBidir] FSK configurado: 433.92 MHz, 2-FSK, ~4800 baud, dev ~25kHz\n");
+    LOG_D("DooyaBidir", "FSK configurado: 433.92 MHz, 2-FSK, ~4800 baud, dev ~25kHz");
 }
 
 void DooyaBidirectional::restoreASK() {
@@ -230,7 +254,7 @@ void DooyaBidirectional::restoreASK() {
     ELECHOUSE_cc1101.setCrc(0);         // Sin CRC
     ELECHOUSE_cc1101.setPA(10);         // Potencia normal
 
-    Serial.println("[DooyaBidir] Restaurado a ASK/OOK");
+    LOG_D("DooyaBidir", "Restaurado a ASK/OOK");
 }
 
 String DooyaBidirectional::getStatusString() {
@@ -0,0 +1,146 @@
+#include "HeapMonitor.h"
+#include "Logger.h"
+
+#ifndef NATIVE_BUILD
+#include <esp_heap_caps.h>
+#endif
+
+HeapMonitor heapMonitor;
+
+static const char* SUBSYSTEM_NAMES[HEAP_SUBSYSTEM_COUNT] = {
+    "other", "mqtt", "web", "storage", "rf"
+};
+
+HeapMonitor::HeapMonitor() {
+    memset(stats, 0, sizeof(stats));
+    current = HEAP_OTHER;
+    minLargestBlock = 0;
+    allocFailures = 0;
+    alertActive = false;
+    lastCheck = 0;
+    onAlert = nullptr;
+}
+
+void HeapMonitor::begin() {
+#ifndef NATIVE_BUILD
+    heap_caps_register_failed_alloc_callback(onAllocFailed);
+#endif
+    sample();
+}
+
+// Puede ejecutarse en cualquier tarea y con el heap agotado: solo contadores
+void HeapMonitor::onAllocFailed(size_t size, uint32_t caps, const char* functionName) {
+    (void)size;
+    (void)caps;
+    (void)functionName;
+    heapMonitor.allocFailures++;
+    heapMonitor.stats[heapMonitor.current].allocFailures++;
+}
+
+void HeapMonitor::sample() {
+    uint32_t largest = getLargestBlock();
+    if (minLargestBlock == 0 || largest < minLargestBlock) {
+        minLargestBlock = largest;
+    }
+}
+
+void HeapMonitor::loop() {
+    if (millis() - lastCheck < HEAP_CHECK_INTERVAL_MS) return;
+    lastCheck = millis();
+
+    sample();
+
+    uint8_t fragmentation = getFragmentation();
+    uint32_t largest = getLargestBlock();
+
+    bool trigger = fragmentation >= HEAP_FRAG_ALERT_PCT || largest < HEAP_LARGEST_ALERT;
+    bool clear = fragmentation <= HEAP_FRAG_CLEAR_PCT && largest >= HEAP_LARGEST_ALERT;
+
+    if (!alertActive && trigger) {
+        alertActive = true;
+        LOG_W("Heap", "Fragmentación %u%% (libre %u, mayor bloque %u)",
+              fragmentation, getFree(), largest);
+        if (onAlert) onAlert(true, fragmentation);
+    } else if (alertActive && clear) {
+        alertActive = false;
+        LOG_I("Heap", "Fragmentación normal: %u%%", fragmentation);
+        if (onAlert) onAlert(false, fragmentation);
+    }
+}
+
+HeapSubsystem HeapMonitor::enter(HeapSubsystem subsystem, uint32_t* freeBefore) {
+    HeapSubsystem previous = current;
+    current = subsystem;
+    *freeBefore = getFree();
+    return previous;
+}
+
+void HeapMonitor::leave(HeapSubsystem subsystem, HeapSubsystem previous, uint32_t freeBefore) {
+    int32_t retained = (int32_t)freeBefore - (int32_t)getFree();
+
+    HeapSubsystemStats& s = stats[subsystem];
+    s.calls++;
+    s.retainedBytes += retained;
+    if (retained > 0 && (uint32_t)retained > s.peakRetained) {
+        s.peakRetained = retained;
+    }
+
+    current = previous;
+    sample();
+}
+
+const HeapSubsystemStats& HeapMonitor::getStats(HeapSubsystem subsystem) const {
+    return stats[subsystem < HEAP_SUBSYSTEM_COUNT ? subsystem : HEAP_OTHER];
+}
+
+const char* HeapMonitor::getSubsystemName(HeapSubsystem subsystem) {
+    return subsystem < HEAP_SUBSYSTEM_COUNT ? SUBSYSTEM_NAMES[subsystem] : "?";
+}
+
+uint32_t HeapMonitor::getFree() const {
+    return ESP.getFreeHeap();
+}
+
+uint32_t HeapMonitor::getLargestBlock() const {
+    return ESP.getMaxAllocHeap();
+}
+
+uint32_t HeapMonitor::getMinFree() const {
+    return ESP.getMinFreeHeap();
+}
+
+uint8_t HeapMonitor::getFragmentation() const {
+    uint32_t freeBytes = getFree();
+    if (freeBytes == 0) return 100;
+
+    uint32_t largest = getLargestBlock();
+    if (largest >= freeBytes) return 0;
+    return (uint8_t)(100 - (uint64_t)largest * 100 / freeBytes);
+}
+
+void HeapMonitor::setAlertCallback(void (*callback)(bool active, uint8_t fragmentation)) {
+    onAlert = callback;
+}
+
+String HeapMonitor::getStatusString() {
+    String status = "Heap: libre " + String(getFree()) +
+                    ", mín " + String(getMinFree()) +
+                    ", bloque " + String(getLargestBlock()) +
+                    " (mín " + String(minLargestBlock) + ")" +
+                    ", frag " + String(getFragmentation()) + "%";
+    if (allocFailures > 0) {
+        status += ", " + String(allocFailures) + " fallos";
+    }
+    if (alertActive) {
+        status += " [ALERTA]";
+    }
+    return status;
+}
+
+HeapScope::HeapScope(HeapSubsystem subsystem) : subsystem(subsystem) {
+    previous = heapMonitor.enter(subsystem, &freeBefore);
+}
+
+HeapScope::~HeapScope() {
+    heapMonitor.leave(subsystem, previous, freeBefore);
+}
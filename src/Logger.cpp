@@ -0,0 +1,160 @@
+#include "Logger.h"
+#include <stdarg.h>
+
+#ifndef NATIVE_BUILD
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+Logger logger;
+
+Logger::Logger() : head(0) {
+    for (uint16_t i = 0; i < LOG_RING_SIZE; i++) {
+        entries[i].seq.store(0, std::memory_order_relaxed);
+        entries[i].ms = 0;
+        entries[i].level = 0;
+        entries[i].text[0] = '\0';
+    }
+    serialCursor = 0;
+    dropped = 0;
+    taskStarted = false;
+}
+
+void Logger::begin() {
+#ifndef NATIVE_BUILD
+    if (taskStarted) return;
+    taskStarted = true;
+    xTaskCreatePinnedToCore(drainTask, "log_drain", LOG_TASK_STACK, this,
+                            LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE);
+#endif
+}
+
+void Logger::write(uint8_t level, const char* fmt, ...) {
+    uint32_t ticket = head.fetch_add(1, std::memory_order_acq_rel);
+    Entry& entry = entries[ticket % LOG_RING_SIZE];
+
+    // Marcar la entrada como incompleta antes de tocar el texto
+    entry.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.ms = millis();
+    entry.level = level;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(entry.text, LOG_LINE_MAX, fmt, args);
+    va_end(args);
+
+    entry.seq.store(ticket + 1, std::memory_order_release);
+
+#ifdef NATIVE_BUILD
+    // En el simulador no hay tarea: la salida se mantiene en orden con printf
+    flush();
+#endif
+}
+
+uint32_t Logger::getOldest() const {
+    uint32_t h = getHead();
+    return h > LOG_RING_SIZE ? h - LOG_RING_SIZE : 0;
+}
+
+// Copia la entrada solo si sigue siendo `ticket` antes y después de leerla
+bool Logger::readEntry(uint32_t ticket, LogLine& line) {
+    Entry& entry = entries[ticket % LOG_RING_SIZE];
+
+    uint32_t before = entry.seq.load(std::memory_order_acquire);
+    if (before != ticket + 1) return false;
+
+    line.seq = ticket;
+    line.ms = entry.ms;
+    line.level = entry.level;
+    memcpy(line.text, entry.text, LOG_LINE_MAX);
+    line.text[LOG_LINE_MAX - 1] = '\0';
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return entry.seq.load(std::memory_order_relaxed) == before;
+}
+
+bool Logger::read(uint32_t& cursor, LogLine& line, uint32_t* skipped) {
+    uint32_t h = getHead();
+
+    // El cursor quedó más atrás que el buffer: saltar a la línea más antigua
+    if ((int32_t)(h - cursor) > LOG_RING_SIZE) {
+        if (skipped) *skipped += h - LOG_RING_SIZE - cursor;
+        cursor = h - LOG_RING_SIZE;
+    }
+
+    while ((int32_t)(h - cursor) > 0) {
+        if (readEntry(cursor, line)) {
+            cursor++;
+            return true;
+        }
+
+        uint32_t seq = entries[cursor % LOG_RING_SIZE].seq.load(std::memory_order_acquire);
+        if (seq != 0 && (int32_t)(seq - (cursor + 1)) > 0) {
+            // Sobrescrita por un productor más nuevo
+            if (skipped) (*skipped)++;
+            cursor++;
+            continue;
+        }
+
+        // Todavía se está escribiendo: reintentar en la próxima pasada
+        return false;
+    }
+
+    return false;
+}
+
+void Logger::flush() {
+    LogLine line;
+    uint32_t skipped = 0;
+
+    while (read(serialCursor, line, &skipped)) {
+        if (skipped > 0) {
+            dropped += skipped;
+            Serial.printf("[Log] %u líneas perdidas (buffer lleno)\n", skipped);
+            skipped = 0;
+        }
+        Serial.println(line.text);
+    }
+
+    if (skipped > 0) {
+        dropped += skipped;
+        Serial.printf("[Log] %u líneas perdidas (buffer lleno)\n", skipped);
+    }
+}
+
+char Logger::levelChar(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:   return 'E';
+        case LOG_LEVEL_WARN:    return 'W';
+        case LOG_LEVEL_INFO:    return 'I';
+        case LOG_LEVEL_DEBUG:   return 'D';
+        default:                return 'V';
+    }
+}
+
+// "A7 12 34 ..." truncado al tamaño del buffer
+size_t Logger::formatHex(char* out, size_t outSize, const uint8_t* data, size_t length) {
+    size_t pos = 0;
+    if (outSize == 0) return 0;
+    out[0] = '\0';
+
+    for (size_t i = 0; i < length && pos + 4 <= outSize; i++) {
+        pos += snprintf(out + pos, outSize - pos, i ? " %02X" : "%02X", data[i]);
+    }
+    return pos;
+}
+
+void Logger::drainTask(void* param) {
+#ifndef NATIVE_BUILD
+    Logger* self = static_cast<Logger*>(param);
+
+    for (;;) {
+        self->flush();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+#else
+    (void)param;
+#endif
+}
@@ -1,18 +1,52 @@
 #include "MQTTClient.h"
 #include "config.h"
 #include "CC1101_RF.h"
-#include "SomfyRTS.h"
-#include "DooyaBidir.h"
-#include "AOK_Protocol.h"
+#include "BootManager.h"
+#include "Metrics.h"
+#include "HeapMonitor.h"
+#include "MQTTTopics.h"
+#include "DeviceGroups.h"
+#include "TxScheduler.h"
+#include "Scenes.h"
+#include "CoverPositions.h"
+#include "Schedules.h"
+#include "DeviceStates.h"
+#include "RxMonitor.h"
+#include "SomfyRemotes.h"
 
 MQTTClientManager* MQTTClientManager::instance = nullptr;
 MQTTClientManager mqttClient;
 
 MQTTClientManager::MQTTClientManager() : mqtt(wifiClient) {
     enabled = false;
+    reconfigure = false;
+    linkUp = false;
+    connectedEvent = false;
+    taskStarted = false;
     lastReconnectAttempt = 0;
     lastStatusPublish = 0;
-    onCommand = nullptr;
+    lastMetricsPublish = 0;
+    discoveryRunning = false;
+    discoveryForce = false;
+    discoveryDirty = false;
+    discoveryItem = 0;
+    discoveryPublished = 0;
+    discoverySkipped = 0;
+    lastDiscoveryTick = 0;
+    discoveryHashCount = 0;
+    replayRunning = false;
+    replayItem = 0;
+    replayPublished = 0;
+    queueHead = 0;
+    queueCount = 0;
+    queueBytes = 0;
+    queuePeak = 0;
+    queueLock = nullptr;
+    pendingSeq = 0;
+    memset(&pendingConnection, 0, sizeof(pendingConnection));
+    memset(&connection, 0, sizeof(connection));
+    queueFreed = nullptr;
+    inbox = nullptr;
     sysConfig = nullptr;
     instance = this;
 }
@@ -39,22 +73,49 @@ bool MQTTClientManager::begin(SystemConfig* config) {
     Serial.printf("[MQTT] Configurando conexión a %s:%d\n",
                   config->mqtt_server, config->mqtt_port);
 
-    mqtt.setServer(config->mqtt_server, config->mqtt_port);
-    mqtt.setCallback(mqttCallback);
-    mqtt.setBufferSize(1024);
+    if (!queueLock) {
+        queueLock = xSemaphoreCreateMutex();
+        queueFreed = xSemaphoreCreateBinary();
+        inbox = xQueueCreate(MQTT_INBOX_DEPTH, sizeof(Inbound));
+    }
 
+    // Sin esperar a la tarea: copia los datos de conexión y la tarea los
+    // aplica en su próxima vuelta (aunque esté en medio de un connect())
     setupTopics();
+
+    uint32_t seq = pendingSeq.load(std::memory_order_relaxed);
+    pendingSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Connection& pending = pendingConnection;
+    strlcpy(pending.server, config->mqtt_server, sizeof(pending.server));
+    pending.port = config->mqtt_port;
+    strlcpy(pending.clientId, config->mqtt_client_id, sizeof(pending.clientId));
+    strlcpy(pending.user, config->mqtt_user, sizeof(pending.user));
+    strlcpy(pending.password, config->mqtt_password, sizeof(pending.password));
+    strlcpy(pending.baseTopic, baseTopic.c_str(), sizeof(pending.baseTopic));
+    strlcpy(pending.availabilityTopic, availabilityTopic.c_str(), sizeof(pending.availabilityTopic));
+
+    pendingSeq.store(seq + 2, std::memory_order_release);
+    reconfigure = true;
     enabled = true;
 
-    return connect();
+    // Configs ya retenidas en el broker (no se republican si no cambian)
+    discoveryRunning = false;
+    discoveryHashCount = storage.loadDiscoveryHashes(discoveryHashes, DISCOVERY_HASH_MAX);
+    Serial.printf("[MQTT] %u configs de discovery conocidas\n", discoveryHashCount);
+
+    if (!taskStarted) {
+        taskStarted = true;
+        xTaskCreatePinnedToCore(mqttTask, "mqtt", MQTT_TASK_STACK, this,
+                                MQTT_TASK_PRIORITY, nullptr, MQTT_TASK_CORE);
+    }
+
+    return true;
 }
 
 void MQTTClientManager::stop() {
-    if (mqtt.connected()) {
-        // Publicar offline antes de desconectar
-        mqtt.publish(availabilityTopic.c_str(), "offline", true);
-        mqtt.disconnect();
-    }
+    // La tarea publica "offline" y cierra la conexión
     enabled = false;
 }
 
@@ -63,10 +124,95 @@ void MQTTClientManager::setupTopics() {
     commandTopic = baseTopic + "/+/set";
     stateTopic = baseTopic + "/state";
     availabilityTopic = baseTopic + "/status";
+    systemTopicPrefix = baseTopic + "/system/";
+    roomTopicPrefix = baseTopic + "/room/";
+    groupTopicPrefix = baseTopic + "/group/";
+    sceneTopicPrefix = baseTopic + "/scene/";
+
+    // Topics por dispositivo: se arman al primer uso y tras cambios en
+    // Storage (aviso repartido desde main.cpp)
+    mqttTopics.begin(baseTopic.c_str(), sysConfig->mqtt_client_id);
+
+    // Estado de cada dispositivo al terminar su tramo de la escena
+    scenes.setStepCallback(onCommandSent);
+
+    // Posición estimada de las cortinas con recorrido medido
+    coverPositions.setPublishCallback(onCoverPosition);
+
+    // Estado de los dispositivos movidos por una programación
+    schedules.setCommandCallback(onCommandSent);
+
+    // Controles físicos reconocidos: estado como si el comando saliera de
+    // aquí y trigger de HA por cada pulsación
+    rxMonitor.setCommandCallback(onCommandSent);
+    rxMonitor.setTriggerCallback(onRemoteTrigger);
+}
+
+// ============================================
+// Tarea MQTT: única dueña de PubSubClient
+// ============================================
+
+void MQTTClientManager::mqttTask(void* param) {
+    MQTTClientManager* self = static_cast<MQTTClientManager*>(param);
+
+    for (;;) {
+        self->service();
+        vTaskDelay(pdMS_TO_TICKS(MQTT_TASK_INTERVAL_MS));
+    }
+}
+
+void MQTTClientManager::service() {
+    if (reconfigure.exchange(false)) {
+        // Se cierra con los datos viejos: "offline" va al broker y topic anteriores
+        closeConnection();
+        if (loadConnection()) {
+            mqtt.setServer(connection.server, connection.port);
+            mqtt.setCallback(mqttCallback);
+            mqtt.setBufferSize(1024);
+            lastReconnectAttempt = millis() - MQTT_RECONNECT_DELAY - 1;
+        } else {
+            reconfigure = true;     // begin() estaba escribiendo: próxima vuelta
+        }
+    }
+
+    if (!enabled || reconfigure) {
+        closeConnection();
+        return;
+    }
+
+    if (!mqtt.connected()) {
+        linkUp = false;
+        xSemaphoreGive(queueFreed);     // waitForQueue() deja de esperar
+        if (millis() - lastReconnectAttempt > MQTT_RECONNECT_DELAY) {
+            lastReconnectAttempt = millis();
+            connect();
+        }
+    } else {
+        mqtt.loop();
+        drainQueue(MQTT_DRAIN_PER_TICK);
+    }
+}
+
+// Copia de pendingConnection; false si begin() la estaba escribiendo
+bool MQTTClientManager::loadConnection() {
+    uint32_t seq = pendingSeq.load(std::memory_order_acquire);
+    if (seq & 1) return false;
+
+    memcpy(&connection, &pendingConnection, sizeof(connection));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return pendingSeq.load(std::memory_order_relaxed) == seq;
+}
+
+void MQTTClientManager::closeConnection() {
+    if (mqtt.connected()) {
+        mqtt.publish(connection.availabilityTopic, "offline", true);
+        mqtt.disconnect();
+    }
+    linkUp = false;
 }
 
 bool MQTTClientManager::connect() {
-    if (!enabled || !sysConfig) return false;
+    if (!enabled) return false;
 
     if (WiFi.status() != WL_CONNECTED) {
         Serial.println("[MQTT] WiFi no conectado");
@@ -76,20 +222,19 @@ bool MQTTClientManager::connect() {
     Serial.println("[MQTT] Conectando...");
 
     bool connected = false;
-    String willTopic = availabilityTopic;
 
-    if (strlen(sysConfig->mqtt_user) > 0) {
+    if (strlen(connection.user) > 0) {
         connected = mqtt.connect(
-            sysConfig->mqtt_client_id,
-            sysConfig->mqtt_user,
-            sysConfig->mqtt_password,
-            willTopic.c_str(),
+            connection.clientId,
+            connection.user,
+            connection.password,
+            connection.availabilityTopic,
             0, true, "offline"
         );
     } else {
         connected = mqtt.connect(
-            sysConfig->mqtt_client_id,
-            willTopic.c_str(),
+            connection.clientId,
+            connection.availabilityTopic,
             0, true, "offline"
         );
     }
@@ -97,23 +242,15 @@ bool MQTTClientManager::connect() {
     if (connected) {
         Serial.println("[MQTT] Conectado!");
 
-        // Publicar disponibilidad
-        mqtt.publish(availabilityTopic.c_str(), "online", true);
+        // Disponibilidad antes que lo acumulado en la cola
+        mqtt.publish(connection.availabilityTopic, "online", true);
 
         // Suscribirse a comandos
         subscribe();
 
-        // Publicar discovery si está habilitado
-        if (sysConfig->mqtt_discovery) {
-            publishDiscovery();
-            delay(100);  // Pausa después de discovery
-            yield();
-        }
-
-        // Publicar estado inicial
-        publishAllStates();
-        delay(50);
-        publishSystemStatus();
+        // loop() publica discovery y estados iniciales
+        linkUp = true;
+        connectedEvent = true;
 
         return true;
     } else {
@@ -134,273 +271,470 @@ bool MQTTClientManager::connect() {
     }
 }
 
-void MQTTClientManager::disconnect() {
-    if (mqtt.connected()) {
-        mqtt.publish(availabilityTopic.c_str(), "offline", true);
-        mqtt.disconnect();
-    }
-}
-
 bool MQTTClientManager::isConnected() {
-    return mqtt.connected();
+    return linkUp;
 }
 
+// Lado de loop(): comandos recibidos, publicaciones periódicas y discovery.
+// Nunca toca el socket; todo sale por la cola.
 void MQTTClientManager::loop() {
     if (!enabled) return;
 
-    if (!mqtt.connected()) {
-        unsigned long now = millis();
-        if (now - lastReconnectAttempt > MQTT_RECONNECT_DELAY) {
-            lastReconnectAttempt = now;
-            connect();
+    Inbound message;
+    while (inbox && xQueueReceive(inbox, &message, 0) == pdTRUE) {
+        handleMessage(message.topic, message.payload);
+    }
+
+    if (connectedEvent) {
+        connectedEvent = false;
+
+        // Discovery en segundo plano desde loop(): solo sale lo que cambió
+        publishDiscovery();
+
+        // Publicar estado inicial
+        publishAllStates();
+        coverPositions.publishAll();
+        publishSystemStatus();
+    }
+
+    if (!linkUp) return;
+
+    // Publicar estado periódicamente
+    if (millis() - lastStatusPublish > 60000) {
+        lastStatusPublish = millis();
+        publishSystemStatus();
+    }
+
+    if (METRICS_MQTT_INTERVAL_MS > 0 &&
+        millis() - lastMetricsPublish > METRICS_MQTT_INTERVAL_MS) {
+        lastMetricsPublish = millis();
+        publishMetrics();
+    }
+
+    if (discoveryRunning && millis() - lastDiscoveryTick >= DISCOVERY_TICK_MS) {
+        lastDiscoveryTick = millis();
+        discoveryStep();
+    }
+
+    if (replayRunning) {
+        replayStep();
+    }
+}
+
+// ============================================
+// Cola de salida
+// ============================================
+
+// Todas las publicaciones pasan por aquí: se copian a la cola y la tarea
+// MQTT las envía. Devuelve false si se descartaron.
+bool MQTTClientManager::publish(const char* topic, const char* payload, bool retained) {
+    if (!topic || !queueLock) return false;
+
+    size_t topicLength = strlen(topic);
+    size_t payloadLength = strlen(payload);
+    size_t size = topicLength + payloadLength + 2;
+
+    // Topic y payload en un solo bloque, ambos terminados en '\0'
+    char* data = (char*)malloc(size);
+    if (!data) {
+        metrics.increment(METRIC_MQTT_QUEUE_DROPS);
+        return false;
+    }
+    memcpy(data, topic, topicLength + 1);
+    memcpy(data + topicLength + 1, payload, payloadLength + 1);
+
+    Outbound entry;
+    entry.data = data;
+    entry.topicLength = topicLength;
+    entry.size = size;
+    entry.hash = MQTTTopicCache::hash(topic);
+    entry.retained = retained;
+
+    xSemaphoreTake(queueLock, portMAX_DELAY);
+    bool queued = enqueue(entry);
+    updateQueueGauges();
+    xSemaphoreGive(queueLock);
+
+    if (!queued) {
+        free(data);
+        metrics.increment(METRIC_MQTT_QUEUE_DROPS);
+    }
+    return queued;
+}
+
+// Con queueLock tomado
+bool MQTTClientManager::enqueue(const Outbound& entry) {
+    // Retenidos: el valor nuevo reemplaza al pendiente del mismo topic
+    if (entry.retained) {
+        Outbound* pending = findRetained(entry);
+        if (pending) {
+            queueBytes = queueBytes - pending->size + entry.size;
+            free(pending->data);
+            *pending = entry;
+            metrics.increment(METRIC_MQTT_QUEUE_COALESCED);
+            return true;
+        }
+    }
+
+    // Sin espacio: se descartan primero los no retenidos más antiguos
+    while (queueCount >= MQTT_QUEUE_DEPTH || queueBytes + entry.size > MQTT_QUEUE_MAX_BYTES) {
+        if (!evictTransient()) return false;
+    }
+
+    queue[(queueHead + queueCount) % MQTT_QUEUE_DEPTH] = entry;
+    queueCount++;
+    queueBytes += entry.size;
+    if (queueCount > queuePeak) queuePeak = queueCount;
+    return true;
+}
+
+MQTTClientManager::Outbound* MQTTClientManager::findRetained(const Outbound& entry) {
+    for (uint8_t i = 0; i < queueCount; i++) {
+        Outbound& pending = queue[(queueHead + i) % MQTT_QUEUE_DEPTH];
+        if (pending.retained && pending.hash == entry.hash && strcmp(pending.data, entry.data) == 0) {
+            return &pending;
+        }
+    }
+    return nullptr;
+}
+
+bool MQTTClientManager::evictTransient() {
+    for (uint8_t i = 0; i < queueCount; i++) {
+        Outbound& victim = queue[(queueHead + i) % MQTT_QUEUE_DEPTH];
+        if (victim.retained) continue;
+
+        queueBytes -= victim.size;
+        free(victim.data);
+        for (uint8_t j = i; j + 1 < queueCount; j++) {
+            queue[(queueHead + j) % MQTT_QUEUE_DEPTH] = queue[(queueHead + j + 1) % MQTT_QUEUE_DEPTH];
+        }
+        queueCount--;
+        metrics.increment(METRIC_MQTT_QUEUE_DROPS);
+        return true;
+    }
+    return false;
+}
+
+// Con queueLock tomado
+void MQTTClientManager::updateQueueGauges() {
+    metrics.setGauge(METRIC_MQTT_QUEUE_DEPTH, queueCount);
+    metrics.setGauge(METRIC_MQTT_QUEUE_BYTES, queueBytes);
+    metrics.setGauge(METRIC_MQTT_QUEUE_PEAK, queuePeak);
+}
+
+// Tarea MQTT: envía hasta maxMessages; si el envío falla el mensaje vuelve
+// al frente y se reintenta tras reconectar
+void MQTTClientManager::drainQueue(uint8_t maxMessages) {
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < maxMessages; i++) {
+        Outbound entry;
+
+        xSemaphoreTake(queueLock, portMAX_DELAY);
+        bool available = queueCount > 0;
+        if (available) {
+            entry = queue[queueHead];
+            queueHead = (queueHead + 1) % MQTT_QUEUE_DEPTH;
+            queueCount--;
+            queueBytes -= entry.size;
+        }
+        xSemaphoreGive(queueLock);
+
+        if (!available) break;
+
+        bool ok;
+        {
+            MetricScope scope(METRIC_MQTT_PUBLISH_US);
+            ok = mqtt.publish(entry.data, entry.data + entry.topicLength + 1, entry.retained);
         }
-    } else {
-        mqtt.loop();
 
-        // Publicar estado periódicamente
-        if (millis() - lastStatusPublish > 60000) {
-            lastStatusPublish = millis();
-            publishSystemStatus();
+        if (ok) {
+            free(entry.data);
+            sent++;
+            continue;
         }
+
+        metrics.increment(METRIC_MQTT_PUBLISH_ERRORS);
+
+        xSemaphoreTake(queueLock, portMAX_DELAY);
+        bool superseded = entry.retained && findRetained(entry) != nullptr;
+        if (!superseded && queueCount < MQTT_QUEUE_DEPTH) {
+            queueHead = (queueHead + MQTT_QUEUE_DEPTH - 1) % MQTT_QUEUE_DEPTH;
+            queue[queueHead] = entry;
+            queueCount++;
+            queueBytes += entry.size;
+        } else {
+            free(entry.data);
+            if (!superseded) metrics.increment(METRIC_MQTT_QUEUE_DROPS);
+        }
+        xSemaphoreGive(queueLock);
+        break;
+    }
+
+    xSemaphoreTake(queueLock, portMAX_DELAY);
+    updateQueueGauges();
+    xSemaphoreGive(queueLock);
+
+    if (sent) xSemaphoreGive(queueFreed);
+}
+
+uint8_t MQTTClientManager::getQueueDepth() const {
+    return queueCount;
+}
+
+// Espera (desde loop()) a que queden al menos `slots` lugares libres:
+// bloqueada en queueFreed, que drainQueue() da al liberar entradas
+bool MQTTClientManager::waitForQueue(uint8_t slots, unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (MQTT_QUEUE_DEPTH - queueCount < slots) {
+        unsigned long elapsed = millis() - start;
+        if (!linkUp || elapsed > timeoutMs) return false;
+        xSemaphoreTake(queueFreed, pdMS_TO_TICKS(timeoutMs - elapsed) + 1);
     }
+    return true;
 }
 
+void MQTTClientManager::publishMetrics() {
+    String topic = baseTopic + "/metrics";
+    String payload = metrics.toCompactJson();
+    publish(topic.c_str(), payload.c_str(), false);
+}
+
+// Tarea MQTT, justo después de conectar
 void MQTTClientManager::subscribe() {
+    String base = connection.baseTopic;
+
     // Suscribirse a comandos de todos los dispositivos
-    String topic = baseTopic + "/+/set";
+    String topic = base + "/+/set";
     mqtt.subscribe(topic.c_str());
     Serial.printf("[MQTT] Suscrito a: %s\n", topic.c_str());
 
-    // Suscribirse a comandos específicos de señales
-    topic = baseTopic + "/+/+/set";
+    // Suscribirse a comandos específicos de señales (cubre room/, group/ y scene/<id>/set)
+    topic = base + "/+/+/set";
     mqtt.subscribe(topic.c_str());
     Serial.printf("[MQTT] Suscrito a: %s\n", topic.c_str());
 
     // Suscribirse a comandos del sistema (rediscover, reboot)
-    topic = baseTopic + "/system/+";
+    topic = base + "/system/+";
     mqtt.subscribe(topic.c_str());
     Serial.printf("[MQTT] Suscrito a: %s\n", topic.c_str());
 }
 
+// Corre en la tarea MQTT (dentro de mqtt.loop()): solo copia el mensaje a
+// la cola de entrada; loop() lo procesa en el núcleo de la radio
 void MQTTClientManager::mqttCallback(char* topic, uint8_t* payload, unsigned int length) {
-    if (instance) {
-        instance->handleMessage(topic, payload, length);
+    if (!instance || !instance->inbox) return;
+
+    Inbound message;
+    if (strlen(topic) >= sizeof(message.topic) || length >= sizeof(message.payload)) {
+        metrics.increment(METRIC_MQTT_INBOX_DROPS);
+        return;
     }
-}
 
-void MQTTClientManager::handleMessage(char* topic, uint8_t* payload, unsigned int length) {
-    // Convertir payload a string
-    char message[length + 1];
-    memcpy(message, payload, length);
-    message[length] = '\0';
+    strlcpy(message.topic, topic, sizeof(message.topic));
+    memcpy(message.payload, payload, length);
+    message.payload[length] = '\0';
 
-    Serial.printf("[MQTT] Mensaje recibido: %s -> %s\n", topic, message);
+    if (xQueueSend(instance->inbox, &message, 0) != pdTRUE) {
+        metrics.increment(METRIC_MQTT_INBOX_DROPS);
+    }
+}
 
-    // Parsear topic: baseTopic/deviceId/set o baseTopic/deviceId/signalIndex/set
-    String topicStr = String(topic);
-    String baseStr = baseTopic + "/";
+void MQTTClientManager::handleMessage(const char* topic, const char* message) {
+    HeapScope heap(HEAP_MQTT);
 
-    if (!topicStr.startsWith(baseStr)) return;
+    Serial.printf("[MQTT] Mensaje recibido: %s -> %s\n", topic, message);
 
-    String remainder = topicStr.substring(baseStr.length());
+    // Comandos del sistema: <base>/system/<cmd>
+    if (strncmp(topic, systemTopicPrefix.c_str(), systemTopicPrefix.length()) == 0) {
+        processSystemCommand(topic + systemTopicPrefix.length(), message);
+        return;
+    }
 
-    // Check for system commands first
-    if (remainder.startsWith("system/")) {
-        String sysCmd = remainder.substring(7);  // Remove "system/"
-        processSystemCommand(sysCmd.c_str(), message);
+    // Grupos: <base>/room/<room>/set y <base>/group/<id>/set
+    if (strncmp(topic, roomTopicPrefix.c_str(), roomTopicPrefix.length()) == 0) {
+        processGroupCommand(topic + roomTopicPrefix.length(), true, message);
+        return;
+    }
+    if (strncmp(topic, groupTopicPrefix.c_str(), groupTopicPrefix.length()) == 0) {
+        processGroupCommand(topic + groupTopicPrefix.length(), false, message);
         return;
     }
 
-    int slashPos = remainder.indexOf('/');
+    // Escenas: <base>/scene/<id>/set (cualquier payload la ejecuta)
+    if (strncmp(topic, sceneTopicPrefix.c_str(), sceneTopicPrefix.length()) == 0) {
+        processSceneCommand(topic + sceneTopicPrefix.length());
+        return;
+    }
 
-    if (slashPos < 0) return;
+    // <base>/<id>/set o <base>/<id>/<n>/set, resuelto por hash
+    int8_t signalIndex = -1;
+    const DeviceTopics* device = mqttTopics.match(topic, &signalIndex);
+    if (!device) {
+        Serial.printf("[MQTT] Topic sin dispositivo: %s\n", topic);
+        return;
+    }
 
-    String deviceId = remainder.substring(0, slashPos);
-    String rest = remainder.substring(slashPos + 1);
+    // Copia local: el comando puede modificar el catálogo y reconstruir la caché
+    char deviceId[sizeof(device->id)];
+    strlcpy(deviceId, device->id, sizeof(deviceId));
 
-    // Verificar si es comando directo o de señal específica
-    if (rest == "set") {
-        // Comando directo al dispositivo
-        processDeviceCommand(deviceId.c_str(), message);
-    } else if (rest.endsWith("/set")) {
-        // Comando a señal específica
-        String signalStr = rest.substring(0, rest.length() - 4);
-        int signalIndex = signalStr.toInt();
-        processSignalCommand(deviceId.c_str(), signalIndex, message);
+    metrics.commandReceived();
+    if (signalIndex == MQTT_ROUTE_POSITION) {
+        processPositionCommand(deviceId, message);
+    } else if (signalIndex < 0) {
+        processDeviceCommand(deviceId, message);
+    } else {
+        processSignalCommand(deviceId, signalIndex, message);
     }
 }
 
 void MQTTClientManager::processDeviceCommand(const char* deviceId, const char* command) {
     Serial.printf("[MQTT] Comando para dispositivo %s: %s\n", deviceId, command);
 
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        Serial.println("[MQTT] Radio no disponible");
+        return;
+    }
+
     SavedDevice device;
     if (!storage.getDevice(deviceId, &device)) {
         Serial.println("[MQTT] Dispositivo no encontrado");
         return;
     }
 
-    String cmd = String(command);
-    cmd.toLowerCase();
-
-    // Manejar dispositivos Somfy RTS de forma especial (rolling code)
-    if (device.type == DEVICE_CURTAIN_SOMFY) {
-        Serial.printf("[MQTT] Comando Somfy RTS para %s\n", device.name);
-
-        // Configurar el módulo RF para Somfy (433.42 MHz)
-        rfModule.setFrequency(SOMFY_FREQUENCY);
-        somfyRTS.setRemote(&device.somfy);
-
-        bool success = false;
-        if (cmd == "open" || cmd == "up") {
-            success = somfyRTS.sendUp();
-        } else if (cmd == "close" || cmd == "down") {
-            success = somfyRTS.sendDown();
-        } else if (cmd == "stop" || cmd == "my") {
-            success = somfyRTS.sendStop();
-        } else if (cmd == "prog") {
-            success = somfyRTS.sendProg();
-        }
-
-        if (success) {
-            // Actualizar rolling code en storage
-            storage.updateSomfyRollingCode(deviceId, somfyRTS.getRollingCode());
-            publishDeviceState(deviceId, command);
-        }
-        return;
+    // El planificador lo transmite junto con los comandos que lleguen en la
+    // misma ventana y publica el estado al terminar
+    if (!txScheduler.submit(&device, command, onCommandSent)) {
+        Serial.printf("[MQTT] Comando no válido para %s: %s\n", device.name, command);
     }
+}
 
-    // Manejar dispositivos Dooya Bidireccional (DDxxxx con FSK)
-    if (device.type == DEVICE_CURTAIN_DOOYA_BIDIR) {
-        Serial.printf("[MQTT] Comando Dooya Bidir para %s\n", device.name);
-
-        dooyaBidir.setRemote(&device.dooyaBidir);
-
-        bool success = false;
-        if (cmd == "open" || cmd == "up") {
-            success = dooyaBidir.sendUp();
-        } else if (cmd == "close" || cmd == "down") {
-            success = dooyaBidir.sendDown();
-        } else if (cmd == "stop") {
-            success = dooyaBidir.sendStop();
-        } else if (cmd == "prog") {
-            success = dooyaBidir.sendProg();
-        }
+void MQTTClientManager::processSignalCommand(const char* deviceId, int signalIndex, const char* command) {
+    Serial.printf("[MQTT] Comando para señal %s/%d: %s\n", deviceId, signalIndex, command);
 
-        if (success) {
-            publishDeviceState(deviceId, command);
-        }
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        Serial.println("[MQTT] Radio no disponible");
         return;
     }
 
-    // Manejar dispositivos A-OK AC114
-    if (device.type == DEVICE_CURTAIN_AOK) {
-        Serial.printf("[MQTT] Comando A-OK para %s\n", device.name);
+    SavedDevice device;
+    if (!storage.getDevice(deviceId, &device)) {
+        Serial.println("[MQTT] Dispositivo no encontrado");
+        return;
+    }
 
-        aokProtocol.setRemoteId(device.aok.remoteId);
-        aokProtocol.setChannel(device.aok.channel);
+    if (signalIndex < 0 || !txScheduler.submitSignal(&device, signalIndex, command, nullptr)) {
+        Serial.println("[MQTT] Señal no válida");
+    }
+}
 
-        bool success = false;
-        if (cmd == "open" || cmd == "up") {
-            success = aokProtocol.sendUp();
-        } else if (cmd == "close" || cmd == "down") {
-            success = aokProtocol.sendDown();
-        } else if (cmd == "stop") {
-            success = aokProtocol.sendStop();
-        } else if (cmd == "prog") {
-            success = aokProtocol.sendProgram();
-        }
+// name = "<room>/set" o "<id>/set"; los miembros se resuelven y transmiten de una vez
+void MQTTClientManager::processGroupCommand(const char* name, bool isRoom, const char* command) {
+    const char* suffix = strrchr(name, '/');
+    if (!suffix || strcmp(suffix, "/set") != 0 || suffix == name) {
+        Serial.printf("[MQTT] Topic de grupo no válido: %s\n", name);
+        return;
+    }
 
-        if (success) {
-            publishDeviceState(deviceId, command);
-        }
+    char target[GROUP_ID_LENGTH];
+    size_t length = suffix - name;
+    if (length >= sizeof(target)) {
+        Serial.println("[MQTT] Nombre de grupo demasiado largo");
         return;
     }
+    memcpy(target, name, length);
+    target[length] = '\0';
 
-    // Interpretar comando según tipo de dispositivo funcional
-    int signalIndex = -1;
+    Serial.printf("[MQTT] Comando para %s %s: %s\n", isRoom ? "habitación" : "grupo", target, command);
 
-    switch (device.type) {
-        case DEVICE_CURTAIN:
-            // Cortinas: OPEN, CLOSE, STOP (índices 0, 1, 2)
-            if (cmd == "open") signalIndex = 0;
-            else if (cmd == "close") signalIndex = 1;
-            else if (cmd == "stop") signalIndex = 2;
-            break;
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        Serial.println("[MQTT] Radio no disponible");
+        return;
+    }
 
-        case DEVICE_SWITCH:
-        case DEVICE_LIGHT:
-            // Interruptores/Luces: ON, OFF (índices 0, 1)
-            if (cmd == "on") signalIndex = 0;
-            else if (cmd == "off") signalIndex = 1;
-            break;
+    metrics.commandReceived();
+    if (isRoom) {
+        deviceGroups.sendToRoom(target, command, onCommandSent);
+    } else {
+        deviceGroups.sendToGroup(target, command, onCommandSent);
+    }
+}
 
-        case DEVICE_BUTTON:
-            // Botones: cualquier comando activa señal 0
-            signalIndex = 0;
-            break;
+// name = "<id>/set"; la escena ya está compilada, solo se arranca
+void MQTTClientManager::processSceneCommand(const char* name) {
+    const char* suffix = strrchr(name, '/');
+    if (!suffix || strcmp(suffix, "/set") != 0 || suffix == name) {
+        Serial.printf("[MQTT] Topic de escena no válido: %s\n", name);
+        return;
+    }
 
-        case DEVICE_GATE:
-            // Portones: TOGGLE o OPEN/CLOSE
-            if (cmd == "toggle" || cmd == "open") signalIndex = 0;
-            else if (cmd == "close") signalIndex = 1;
-            break;
+    char sceneId[SCENE_ID_LENGTH];
+    size_t length = suffix - name;
+    if (length >= sizeof(sceneId)) {
+        Serial.println("[MQTT] Id de escena demasiado largo");
+        return;
+    }
+    memcpy(sceneId, name, length);
+    sceneId[length] = '\0';
 
-        case DEVICE_FAN:
-            // Ventiladores: ON, OFF, SPEED (índices 0, 1, 2)
-            if (cmd == "on") signalIndex = 0;
-            else if (cmd == "off") signalIndex = 1;
-            else if (cmd == "speed") signalIndex = 2;
-            break;
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        Serial.println("[MQTT] Radio no disponible");
+        return;
+    }
 
-        case DEVICE_DIMMER:
-            // Dimmers: ON, OFF, UP, DOWN (índices 0, 1, 2, 3)
-            if (cmd == "on") signalIndex = 0;
-            else if (cmd == "off") signalIndex = 1;
-            else if (cmd == "up" || cmd == "brightness_up") signalIndex = 2;
-            else if (cmd == "down" || cmd == "brightness_down") signalIndex = 3;
-            break;
+    metrics.commandReceived();
+    scenes.run(sceneId);
+}
 
-        default:
-            // Para otros tipos, interpretar como índice numérico
-            signalIndex = cmd.toInt();
-            break;
+// payload = 0-100 (posición de Home Assistant: 0 cerrada, 100 abierta)
+void MQTTClientManager::processPositionCommand(const char* deviceId, const char* payload) {
+    char* end = nullptr;
+    long position = strtol(payload, &end, 10);
+    if (end == payload || *end != '\0' || position < 0 || position > 100) {
+        Serial.printf("[MQTT] Posición no válida para %s: %s\n", deviceId, payload);
+        return;
     }
 
-    if (signalIndex >= 0 && signalIndex < device.signalCount && device.signals[signalIndex].valid) {
-        // Transmitir señal
-        rfModule.setFrequency(device.signals[signalIndex].frequency);
-        rfModule.setModulation(device.signals[signalIndex].modulation);
-        rfModule.transmitSignal(&device.signals[signalIndex]);
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        Serial.println("[MQTT] Radio no disponible");
+        return;
+    }
 
-        // Publicar estado actualizado
-        publishDeviceState(deviceId, command);
+    if (!coverPositions.setPosition(deviceId, (uint8_t)position)) {
+        Serial.printf("[MQTT] No se pudo mover %s a %ld%%\n", deviceId, position);
+    }
+}
 
-        Serial.printf("[MQTT] Señal %d transmitida\n", signalIndex);
-    } else {
-        Serial.printf("[MQTT] Señal no válida: %d\n", signalIndex);
+// Las cortinas con recorrido medido publican estado y posición desde CoverPositions
+void MQTTClientManager::onCommandSent(const char* deviceId, const char* command) {
+    if (!coverPositions.onCommandSent(deviceId, command)) {
+        mqttClient.publishDeviceState(deviceId, command);
     }
 }
 
-void MQTTClientManager::processSignalCommand(const char* deviceId, int signalIndex, const char* command) {
-    Serial.printf("[MQTT] Comando para señal %s/%d: %s\n", deviceId, signalIndex, command);
+void MQTTClientManager::onCoverPosition(const char* deviceId, uint8_t position, const char* state) {
+    mqttClient.publishCoverPosition(deviceId, position, state);
+}
 
-    SavedDevice device;
-    if (!storage.getDevice(deviceId, &device)) {
-        Serial.println("[MQTT] Dispositivo no encontrado");
-        return;
-    }
+// Payload de <base>/<id>/remote: el comando de la señal o su índice
+static const char* triggerPayload(uint8_t type, uint8_t signal, char* buffer, size_t size) {
+    const char* command = TxScheduler::getSignalCommand(type, signal);
+    if (command) return command;
 
-    if (signalIndex < 0 || signalIndex >= device.signalCount || !device.signals[signalIndex].valid) {
-        Serial.println("[MQTT] Señal no válida");
-        return;
-    }
+    snprintf(buffer, size, "%u", signal);
+    return buffer;
+}
+
+// Evento sin retener: una pulsación vieja no se repite al reconectar
+void MQTTClientManager::onRemoteTrigger(const char* deviceId, uint8_t signal) {
+    if (!mqttClient.enabled || !mqttClient.linkUp) return;
 
-    // Transmitir señal
-    rfModule.setFrequency(device.signals[signalIndex].frequency);
-    rfModule.setModulation(device.signals[signalIndex].modulation);
-    rfModule.transmitSignal(&device.signals[signalIndex]);
+    const DeviceTopics* topics = mqttTopics.ensure() ? mqttTopics.find(deviceId) : nullptr;
+    const char* topic = topics ? mqttTopics.topic(topics->remote) : nullptr;
+    if (!topic) return;
 
-    Serial.printf("[MQTT] Señal %d transmitida\n", signalIndex);
+    char buffer[4];
+    mqttClient.publish(topic, triggerPayload(topics->type, signal, buffer, sizeof(buffer)), false);
 }
 
 void MQTTClientManager::processSystemCommand(const char* command, const char* payload) {
@@ -410,46 +744,118 @@ void MQTTClientManager::processSystemCommand(const char* command, const char* pa
 
     if (cmd == "rediscover") {
         Serial.println("[MQTT] Ejecutando rediscovery...");
-        publishDiscovery();
+        publishDiscovery(true);
     } else if (cmd == "reboot") {
         Serial.println("[MQTT] Reiniciando...");
-        mqtt.publish(availabilityTopic.c_str(), "offline", true);
-        delay(500);
+        deviceStates.flush();
+        somfyRemotes.flush();
+        publish(availabilityTopic.c_str(), "offline", true);
+        waitForQueue(MQTT_QUEUE_DEPTH, 500);    // Dar tiempo a vaciar la cola
         ESP.restart();
     }
 }
 
-void MQTTClientManager::setCommandCallback(void (*callback)(const char* deviceId, const char* command)) {
-    onCommand = callback;
+// Sin conexión solo se actualiza DeviceStates: al reconectar sale el último
+void MQTTClientManager::publishDeviceState(const char* deviceId, const char* state) {
+    deviceStates.record(deviceId, state);
+    if (!enabled || !linkUp) return;
+
+    publishState(deviceId, state);
 }
 
-void MQTTClientManager::publishDeviceState(const char* deviceId, const char* state) {
-    if (!mqtt.connected()) return;
+void MQTTClientManager::publishState(const char* deviceId, const char* state) {
+    const char* topic = mqttTopics.getStateTopic(deviceId);
+    if (topic) {
+        publish(topic, state, true);
+    } else {
+        // Dispositivo fuera del catálogo (p.ej. recién borrado)
+        String fallback = baseTopic + "/" + String(deviceId) + "/state";
+        publish(fallback.c_str(), state, true);
+    }
+}
+
+// La posición ya la guarda CoverPositions y la republica publishAll()
+void MQTTClientManager::publishCoverPosition(const char* deviceId, uint8_t position, const char* state) {
+    if (!enabled || !linkUp) return;
 
-    String topic = baseTopic + "/" + String(deviceId) + "/state";
-    mqtt.publish(topic.c_str(), state, true);
+    publishState(deviceId, state);
+
+    const DeviceTopics* topics = mqttTopics.ensure() ? mqttTopics.find(deviceId) : nullptr;
+    const char* topic = topics ? mqttTopics.topic(topics->position) : nullptr;
+    if (!topic) return;
+
+    char payload[4];
+    snprintf(payload, sizeof(payload), "%u", position);
+    publish(topic, payload, true);
 }
 
+// Arranca (o reinicia) el replay del último estado de cada dispositivo
 void MQTTClientManager::publishAllStates() {
-    if (!mqtt.connected()) return;
+    if (!enabled) return;
 
-    uint8_t count = storage.getDeviceCount();
-    SavedDevice device;
+    replayRunning = true;
+    replayItem = 0;
+    replayPublished = 0;
+}
 
-    for (uint8_t i = 0; i < count; i++) {
-        if (storage.getDeviceByIndex(i, &device)) {
-            publishDeviceState(device.id, "unknown");
+// Una tanda por vuelta y solo con lugar en la cola: tras un corte largo
+// el replay no desplaza al discovery ni a los comandos en curso. Las
+// cortinas con recorrido medido publican su posición (ver
+// CoverPositions::publishAll); sin estado conocido se publica "unknown".
+void MQTTClientManager::replayStep() {
+    if (!linkUp) return;        // Sigue al reconectar (publishAllStates reinicia)
+    if (MQTT_QUEUE_DEPTH - getQueueDepth() < STATE_REPLAY_BATCH) return;
+
+    if (!mqttTopics.ensure()) {
+        Serial.println("[MQTT] Replay de estados omitido: caché de topics no disponible");
+        replayRunning = false;
+        return;
+    }
+
+    uint8_t batch = 0;
+    while (batch < STATE_REPLAY_BATCH) {
+        const DeviceTopics* topics = mqttTopics.at(replayItem);
+        if (!topics) {
+            replayRunning = false;
+            Serial.printf("[MQTT] Replay de estados: %u publicados, %u conocidos\n",
+                          replayPublished, deviceStates.getCount());
+            return;
         }
+        replayItem++;
+        if (topics->travel) continue;
+
+        const char* state = deviceStates.get(topics->id);
+        publish(mqttTopics.topic(topics->state), state ? state : "unknown", true);
+        replayPublished++;
+        batch++;
     }
 }
 
 void MQTTClientManager::publishSystemStatus() {
-    if (!mqtt.connected()) return;
+    if (!enabled) return;
+    HeapScope heap(HEAP_MQTT);
 
     // Publicar al topic de diagnosticos para los sensores HA
-    StaticJsonDocument<384> doc;
+    StaticJsonDocument<1024> doc;
     doc["uptime"] = millis() / 1000;
     doc["heap"] = ESP.getFreeHeap();
+    doc["heap_min"] = heapMonitor.getMinFree();
+    doc["heap_largest"] = heapMonitor.getLargestBlock();
+    doc["heap_largest_min"] = heapMonitor.getMinLargestBlock();
+    doc["heap_frag"] = heapMonitor.getFragmentation();
+    doc["heap_alert"] = heapMonitor.isAlertActive() ? "ON" : "OFF";
+    doc["alloc_fail"] = heapMonitor.getAllocFailures();
+
+    // Por subsistema: [llamadas, bytes retenidos, pico retenido, fallos]
+    JsonObject heapSub = doc.createNestedObject("heap_sub");
+    for (uint8_t i = 0; i < HEAP_SUBSYSTEM_COUNT; i++) {
+        const HeapSubsystemStats& stats = heapMonitor.getStats((HeapSubsystem)i);
+        JsonArray entry = heapSub.createNestedArray(HeapMonitor::getSubsystemName((HeapSubsystem)i));
+        entry.add(stats.calls);
+        entry.add(stats.retainedBytes);
+        entry.add(stats.peakRetained);
+        entry.add(stats.allocFailures);
+    }
     doc["rssi"] = WiFi.RSSI();
     doc["ip"] = WiFi.localIP().toString();
     doc["mac"] = WiFi.macAddress();
@@ -462,319 +868,349 @@ void MQTTClientManager::publishSystemStatus() {
 
     // Publicar a diagnostics (para sensores HA)
     String diagTopic = baseTopic + "/diagnostics";
-    mqtt.publish(diagTopic.c_str(), payload.c_str(), true);
+    publish(diagTopic.c_str(), payload.c_str(), true);
 
     // También publicar a system (legacy)
     String sysTopic = baseTopic + "/system";
-    mqtt.publish(sysTopic.c_str(), payload.c_str(), true);
+    publish(sysTopic.c_str(), payload.c_str(), true);
 }
 
 // ============================================
 // Home Assistant Discovery
 // ============================================
 
-void MQTTClientManager::publishDiscovery() {
-    if (!mqtt.connected() || !sysConfig->mqtt_discovery) return;
+// Configs de sensores de diagnóstico (todas leen <base>/diagnostics)
+struct DiagnosticSensor {
+    const char* name;
+    const char* idSuffix;
+    const char* valueTemplate;
+    const char* unit;
+    const char* deviceClass;
+    const char* icon;
+};
+
+static const DiagnosticSensor DIAGNOSTIC_SENSORS[] = {
+    { "WiFi Signal", "_wifi_signal", "{{ value_json.rssi }}", "dBm", "signal_strength", "mdi:wifi" },
+    { "IP Address", "_ip_address", "{{ value_json.ip }}", nullptr, nullptr, "mdi:ip-network" },
+    { "MAC Address", "_mac_address", "{{ value_json.mac }}", nullptr, nullptr, "mdi:network-outline" },
+    { "WiFi SSID", "_ssid", "{{ value_json.ssid }}", nullptr, nullptr, "mdi:wifi-settings" },
+    { "Uptime", "_uptime", "{{ value_json.uptime }}", "s", "duration", "mdi:timer-outline" },
+    { "Free Memory", "_free_heap", "{{ value_json.heap }}", "B", "data_size", "mdi:memory" },
+    { "Min Free Memory", "_heap_min", "{{ value_json.heap_min }}", "B", "data_size", "mdi:memory" },
+    { "Largest Free Block", "_heap_largest", "{{ value_json.heap_largest }}", "B", "data_size", "mdi:memory" },
+    { "Heap Fragmentation", "_heap_frag", "{{ value_json.heap_frag }}", "%", nullptr, "mdi:chart-donut" },
+};
+
+#define DIAGNOSTIC_SENSOR_COUNT (sizeof(DIAGNOSTIC_SENSORS) / sizeof(DIAGNOSTIC_SENSORS[0]))
+
+// Elementos del sistema: 2 botones, sensores de diagnóstico y alerta de heap
+#define SYSTEM_DISCOVERY_ITEMS  (2 + DIAGNOSTIC_SENSOR_COUNT + 1)
+
+// Arranca (o continúa) el trabajo de discovery; lo avanza loop()
+void MQTTClientManager::publishDiscovery(bool force) {
+    if (!sysConfig || !sysConfig->mqtt_discovery) return;
+
+    if (discoveryRunning && !force) return;     // Sigue donde quedó
+
+    discoveryRunning = true;
+    discoveryForce = force;
+    discoveryItem = 0;
+    discoveryPublished = 0;
+    discoverySkipped = 0;
+    lastDiscoveryTick = 0;
+
+    Serial.printf("[MQTT] Discovery en segundo plano%s\n", force ? " (forzado)" : "");
+}
 
-    Serial.println("[MQTT] Publicando Home Assistant Discovery...");
+void MQTTClientManager::discoveryStep() {
+    HeapScope heap(HEAP_MQTT);
+    uint16_t publishedBefore = discoveryPublished;
 
-    // Publish system buttons (Rediscover, Reboot)
-    publishSystemButtons();
+    for (uint8_t scanned = 0; scanned < DISCOVERY_SCAN_PER_TICK; scanned++) {
+        if (discoveryPublished - publishedBefore >= DISCOVERY_MSGS_PER_TICK) return;
 
-    // Publish diagnostic sensors
-    publishDiagnosticSensors();
+        // Contrapresión: un dispositivo de botones encola hasta 4 configs
+        // más un trigger por señal
+        if (MQTT_QUEUE_DEPTH - getQueueDepth() < 2 * MQTT_TOPIC_SIGNALS) return;
 
-    // Cargar dispositivos uno a uno para evitar stack overflow
-    uint8_t count = storage.getDeviceCount();
-    SavedDevice device;  // Solo UN dispositivo en stack
+        if (!publishDiscoveryItem(discoveryItem)) {
+            // Los hashes se guardan cuando la cola ya entregó todo
+            if (getQueueDepth() == 0) finishDiscovery();
+            return;
+        }
+        discoveryItem++;
+    }
+}
 
-    for (uint8_t i = 0; i < count; i++) {
-        if (!storage.getDeviceByIndex(i, &device)) continue;
+void MQTTClientManager::finishDiscovery() {
+    discoveryRunning = false;
+    discoveryForce = false;
 
-        switch (device.type) {
-            case DEVICE_CURTAIN:
-            case DEVICE_CURTAIN_SOMFY:
-            case DEVICE_CURTAIN_DOOYA_BIDIR:
-            case DEVICE_CURTAIN_AOK:
-                publishCoverDiscovery(&device);
-                break;
-
-            case DEVICE_SWITCH:
-            case DEVICE_LIGHT:
-                publishSwitchDiscovery(&device);
-                break;
-
-            case DEVICE_GATE:
-                publishGateDiscovery(&device);
-                break;
-
-            case DEVICE_FAN:
-                publishSwitchDiscovery(&device);
-                break;
-
-            default:
-                for (uint8_t j = 0; j < device.signalCount; j++) {
-                    if (device.signals[j].valid) {
-                        publishButtonDiscovery(&device, j);
-                    }
-                }
-                break;
-        }
-        delay(20);
-        yield();
+    if (discoveryDirty) {
+        storage.saveDiscoveryHashes(discoveryHashes, discoveryHashCount);
+        discoveryDirty = false;
     }
 
-    Serial.printf("[MQTT] Discovery publicado para %d dispositivos\n", count);
+    Serial.printf("[MQTT] Discovery completo: %u publicadas, %u sin cambios\n",
+                  discoveryPublished, discoverySkipped);
 }
 
-void MQTTClientManager::publishSystemButtons() {
-    // Rediscover button - usar StaticJsonDocument para menos overhead
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_rediscover";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/button/" + uniqueId + "/config";
-
-        doc["name"] = "Redescubrir";
-        doc["unique_id"] = uniqueId;
-        doc["cmd_t"] = baseTopic + "/system/rediscover";
-        doc["avty_t"] = availabilityTopic;
-        doc["pl_prs"] = "PRESS";
-        doc["ic"] = "mdi:refresh";
-        doc["ent_cat"] = "config";
+// Publica el elemento `item`; false si ya no quedan elementos
+bool MQTTClientManager::publishDiscoveryItem(uint16_t item) {
+    if (item < SYSTEM_DISCOVERY_ITEMS) {
+        publishSystemDiscovery(item);
+        return true;
+    }
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    // Después de los dispositivos, una config por escena
+    uint16_t index = item - SYSTEM_DISCOVERY_ITEMS;
+    uint16_t deviceCount = storage.getDeviceCount();
+    if (index >= deviceCount) {
+        if (index - deviceCount >= scenes.getCount()) return false;
+        publishSceneDiscovery(index - deviceCount);
+        return true;
+    }
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
+    // Los topics por dispositivo salen de la caché (se arma aquí si hace falta)
+    if (!mqttTopics.ensure()) {
+        Serial.println("[MQTT] Discovery de dispositivos omitido: caché de topics no disponible");
+        return false;
     }
 
-    delay(50);  // Pequeña pausa entre publicaciones
+    SavedDevice device;  // Solo UN dispositivo en stack
+    if (!storage.getDeviceByIndex(index, &device)) return true;
 
-    // Reboot button
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_reboot";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/button/" + uniqueId + "/config";
+    switch (device.type) {
+        case DEVICE_CURTAIN:
+        case DEVICE_CURTAIN_SOMFY:
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+        case DEVICE_CURTAIN_AOK:
+            publishCoverDiscovery(&device);
+            break;
 
-        doc["name"] = "Reiniciar";
-        doc["unique_id"] = uniqueId;
-        doc["cmd_t"] = baseTopic + "/system/reboot";
-        doc["avty_t"] = availabilityTopic;
-        doc["pl_prs"] = "PRESS";
-        doc["ic"] = "mdi:restart";
-        doc["dev_cla"] = "restart";
-        doc["ent_cat"] = "config";
+        case DEVICE_SWITCH:
+        case DEVICE_LIGHT:
+            publishSwitchDiscovery(&device);
+            break;
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+        case DEVICE_GATE:
+            publishGateDiscovery(&device);
+            break;
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
+        case DEVICE_FAN:
+            publishSwitchDiscovery(&device);
+            break;
+
+        default:
+            for (uint8_t j = 0; j < device.signalCount; j++) {
+                if (device.signals[j].valid) {
+                    publishButtonDiscovery(&device, j);
+                }
+            }
+            break;
     }
 
-    Serial.println("[MQTT] System buttons published");
+    publishTriggerDiscovery(&device);
+    return true;
 }
 
-void MQTTClientManager::publishDiagnosticSensors() {
-    String sysStateTopic = baseTopic + "/diagnostics";
+// Publica una config retenida solo si cambió desde la última publicación exitosa
+bool MQTTClientManager::publishConfig(const char* topic, const String& payload) {
+    if (!topic) return false;
+
+    uint32_t topicHash = MQTTTopicCache::hash(topic);
+    uint32_t payloadHash = MQTTTopicCache::hash(payload.c_str());
 
-    // WiFi Signal Strength (RSSI)
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_wifi_signal";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
+    int16_t slot = -1;
+    for (uint16_t i = 0; i < discoveryHashCount; i++) {
+        if (discoveryHashes[i].topic == topicHash) {
+            slot = i;
+            break;
+        }
+    }
 
-        doc["name"] = "WiFi Signal";
-        doc["uniq_id"] = uniqueId;
-        doc["stat_t"] = sysStateTopic;
-        doc["val_tpl"] = "{{ value_json.rssi }}";
-        doc["unit_of_meas"] = "dBm";
-        doc["dev_cla"] = "signal_strength";
-        doc["ent_cat"] = "diagnostic";
-        doc["ic"] = "mdi:wifi";
-        doc["avty_t"] = availabilityTopic;
+    if (!discoveryForce && slot >= 0 && discoveryHashes[slot].payload == payloadHash) {
+        discoverySkipped++;
+        return true;
+    }
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    if (!publish(topic, payload.c_str(), true)) return false;
+    discoveryPublished++;
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
+    if (slot < 0 && discoveryHashCount < DISCOVERY_HASH_MAX) {
+        slot = discoveryHashCount++;
+        discoveryHashes[slot].topic = topicHash;
+    }
+    if (slot >= 0 && discoveryHashes[slot].payload != payloadHash) {
+        discoveryHashes[slot].payload = payloadHash;
+        discoveryDirty = true;
     }
-    delay(30);
+    return true;
+}
 
-    // IP Address
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_ip_address";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
+void MQTTClientManager::publishSystemDiscovery(uint8_t index) {
+    if (index == 0) {
+        publishSystemButton("Redescubrir", "_rediscover", "rediscover", "mdi:refresh", nullptr);
+    } else if (index == 1) {
+        publishSystemButton("Reiniciar", "_reboot", "reboot", "mdi:restart", "restart");
+    } else if (index < 2 + DIAGNOSTIC_SENSOR_COUNT) {
+        const DiagnosticSensor& sensor = DIAGNOSTIC_SENSORS[index - 2];
+        publishDiagnosticSensor(sensor.name, sensor.idSuffix, sensor.valueTemplate,
+                                sensor.unit, sensor.deviceClass, sensor.icon);
+    } else {
+        publishHeapAlertDiscovery();
+    }
+}
 
-        doc["name"] = "IP Address";
-        doc["uniq_id"] = uniqueId;
-        doc["stat_t"] = sysStateTopic;
-        doc["val_tpl"] = "{{ value_json.ip }}";
-        doc["ent_cat"] = "diagnostic";
-        doc["ic"] = "mdi:ip-network";
-        doc["avty_t"] = availabilityTopic;
+void MQTTClientManager::publishSystemButton(const char* name, const char* idSuffix, const char* command,
+                                            const char* icon, const char* deviceClass) {
+    StaticJsonDocument<384> doc;
+    String uniqueId = String(sysConfig->mqtt_client_id) + idSuffix;
+    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/button/" + uniqueId + "/config";
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    doc["name"] = name;
+    doc["unique_id"] = uniqueId;
+    doc["cmd_t"] = systemTopicPrefix + command;
+    doc["avty_t"] = availabilityTopic;
+    doc["pl_prs"] = "PRESS";
+    doc["ic"] = icon;
+    if (deviceClass) doc["dev_cla"] = deviceClass;
+    doc["ent_cat"] = "config";
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    }
-    delay(30);
+    JsonObject dev = doc.createNestedObject("dev");
+    JsonArray ids = dev.createNestedArray("ids");
+    ids.add(sysConfig->mqtt_client_id);
+    dev["name"] = sysConfig->device_name;
+    dev["mf"] = "Dirasmart";
+    dev["sw"] = FIRMWARE_VERSION;
 
-    // MAC Address
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_mac_address";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
+    String payload;
+    serializeJson(doc, payload);
+    publishConfig(discoveryTopic.c_str(), payload);
+}
 
-        doc["name"] = "MAC Address";
-        doc["uniq_id"] = uniqueId;
-        doc["stat_t"] = sysStateTopic;
-        doc["val_tpl"] = "{{ value_json.mac }}";
-        doc["ent_cat"] = "diagnostic";
-        doc["ic"] = "mdi:network-outline";
-        doc["avty_t"] = availabilityTopic;
+void MQTTClientManager::publishHeapAlertDiscovery() {
+    StaticJsonDocument<384> doc;
+    String uniqueId = String(sysConfig->mqtt_client_id) + "_heap_alert";
+    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/binary_sensor/" + uniqueId + "/config";
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    doc["name"] = "Heap Alert";
+    doc["uniq_id"] = uniqueId;
+    doc["stat_t"] = baseTopic + "/diagnostics";
+    doc["val_tpl"] = "{{ value_json.heap_alert }}";
+    doc["dev_cla"] = "problem";
+    doc["ent_cat"] = "diagnostic";
+    doc["avty_t"] = availabilityTopic;
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    }
-    delay(30);
+    JsonObject dev = doc.createNestedObject("dev");
+    JsonArray ids = dev.createNestedArray("ids");
+    ids.add(sysConfig->mqtt_client_id);
+    dev["name"] = sysConfig->device_name;
+    dev["mf"] = "Dirasmart";
+    dev["sw"] = FIRMWARE_VERSION;
 
-    // SSID
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_ssid";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
+    String payload;
+    serializeJson(doc, payload);
+    publishConfig(discoveryTopic.c_str(), payload);
+}
 
-        doc["name"] = "WiFi SSID";
-        doc["uniq_id"] = uniqueId;
-        doc["stat_t"] = sysStateTopic;
-        doc["val_tpl"] = "{{ value_json.ssid }}";
-        doc["ent_cat"] = "diagnostic";
-        doc["ic"] = "mdi:wifi-settings";
-        doc["avty_t"] = availabilityTopic;
+void MQTTClientManager::publishDiagnosticSensor(const char* name, const char* idSuffix,
+                                                const char* valueTemplate, const char* unit,
+                                                const char* deviceClass, const char* icon) {
+    StaticJsonDocument<384> doc;
+    String uniqueId = String(sysConfig->mqtt_client_id) + idSuffix;
+    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    doc["name"] = name;
+    doc["uniq_id"] = uniqueId;
+    doc["stat_t"] = baseTopic + "/diagnostics";
+    doc["val_tpl"] = valueTemplate;
+    if (unit) doc["unit_of_meas"] = unit;
+    if (deviceClass) doc["dev_cla"] = deviceClass;
+    doc["ent_cat"] = "diagnostic";
+    doc["ic"] = icon;
+    doc["avty_t"] = availabilityTopic;
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    }
-    delay(30);
-
-    // Uptime
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_uptime";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
-
-        doc["name"] = "Uptime";
-        doc["uniq_id"] = uniqueId;
-        doc["stat_t"] = sysStateTopic;
-        doc["val_tpl"] = "{{ value_json.uptime }}";
-        doc["unit_of_meas"] = "s";
-        doc["dev_cla"] = "duration";
-        doc["ent_cat"] = "diagnostic";
-        doc["ic"] = "mdi:timer-outline";
-        doc["avty_t"] = availabilityTopic;
+    JsonObject dev = doc.createNestedObject("dev");
+    JsonArray ids = dev.createNestedArray("ids");
+    ids.add(sysConfig->mqtt_client_id);
+    dev["name"] = sysConfig->device_name;
+    dev["mf"] = "Dirasmart";
+    dev["sw"] = FIRMWARE_VERSION;
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    String payload;
+    serializeJson(doc, payload);
+    publishConfig(discoveryTopic.c_str(), payload);
+}
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    }
-    delay(30);
-
-    // Free Heap
-    {
-        StaticJsonDocument<384> doc;
-        String uniqueId = String(sysConfig->mqtt_client_id) + "_free_heap";
-        String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/sensor/" + uniqueId + "/config";
-
-        doc["name"] = "Free Memory";
-        doc["uniq_id"] = uniqueId;
-        doc["stat_t"] = sysStateTopic;
-        doc["val_tpl"] = "{{ value_json.heap }}";
-        doc["unit_of_meas"] = "B";
-        doc["dev_cla"] = "data_size";
-        doc["ent_cat"] = "diagnostic";
-        doc["ic"] = "mdi:memory";
-        doc["avty_t"] = availabilityTopic;
+void MQTTClientManager::publishSceneDiscovery(uint8_t index) {
+    StaticJsonDocument<384> doc;
+    String uniqueId = String(sysConfig->mqtt_client_id) + "_scene_" + scenes.getId(index);
+    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/scene/" + uniqueId + "/config";
 
-        JsonObject dev = doc.createNestedObject("dev");
-        JsonArray ids = dev.createNestedArray("ids");
-        ids.add(sysConfig->mqtt_client_id);
-        dev["name"] = sysConfig->device_name;
-        dev["mf"] = "Dirasmart";
-        dev["sw"] = FIRMWARE_VERSION;
+    doc["name"] = scenes.getName(index);
+    doc["uniq_id"] = uniqueId;
+    doc["cmd_t"] = sceneTopicPrefix + scenes.getId(index) + "/set";
+    doc["pl_on"] = "ON";
+    doc["avty_t"] = availabilityTopic;
+    doc["ic"] = "mdi:palette";
 
-        String payload;
-        serializeJson(doc, payload);
-        mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
+    JsonObject dev = doc.createNestedObject("dev");
+    JsonArray ids = dev.createNestedArray("ids");
+    ids.add(sysConfig->mqtt_client_id);
+    dev["name"] = sysConfig->device_name;
+    dev["mf"] = "Dirasmart";
+    dev["sw"] = FIRMWARE_VERSION;
+
+    String payload;
+    serializeJson(doc, payload);
+    publishConfig(discoveryTopic.c_str(), payload);
+}
+
+// Escena eliminada: se borra la config retenida y su hash, así una escena
+// nueva con el mismo id vuelve a publicarse
+void MQTTClientManager::removeSceneDiscovery(const char* sceneId) {
+    if (!enabled || !sysConfig) return;
+
+    String uniqueId = String(sysConfig->mqtt_client_id) + "_scene_" + sceneId;
+    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/scene/" + uniqueId + "/config";
+
+    uint32_t topicHash = MQTTTopicCache::hash(discoveryTopic.c_str());
+    for (uint16_t i = 0; i < discoveryHashCount; i++) {
+        if (discoveryHashes[i].topic == topicHash) {
+            discoveryHashes[i].payload = 0;
+            discoveryDirty = true;
+            break;
+        }
     }
 
-    Serial.println("[MQTT] Diagnostic sensors published");
+    publish(discoveryTopic.c_str(), "", true);
 }
 
 void MQTTClientManager::publishCoverDiscovery(const SavedDevice* device) {
     StaticJsonDocument<512> doc;
 
+    const DeviceTopics* topics = mqttTopics.find(device->id);
+    if (!topics) return;
+
     String uniqueId = String(sysConfig->mqtt_client_id) + "_" + String(device->id);
-    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/cover/" + uniqueId + "/config";
 
     doc["name"] = device->name;
     doc["uniq_id"] = uniqueId;
     doc["dev_cla"] = "curtain";
-    doc["cmd_t"] = baseTopic + "/" + String(device->id) + "/set";
-    doc["stat_t"] = baseTopic + "/" + String(device->id) + "/state";
+    doc["cmd_t"] = mqttTopics.topic(topics->set);
+    doc["stat_t"] = mqttTopics.topic(topics->state);
     doc["avty_t"] = availabilityTopic;
     doc["pl_open"] = "OPEN";
     doc["pl_cls"] = "CLOSE";
     doc["pl_stop"] = "STOP";
 
+    // Recorrido medido: posición estimada y set_position (0 cerrada, 100 abierta)
+    if (topics->position != MQTT_TOPIC_NONE) {
+        doc["pos_t"] = mqttTopics.topic(topics->position);
+        doc["set_pos_t"] = mqttTopics.topic(topics->positionSet);
+    }
+
     JsonObject dev = doc.createNestedObject("dev");
     JsonArray ids = dev.createNestedArray("ids");
     ids.add(sysConfig->mqtt_client_id);
@@ -784,21 +1220,22 @@ void MQTTClientManager::publishCoverDiscovery(const SavedDevice* device) {
 
     String payload;
     serializeJson(doc, payload);
-    mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    delay(30);
+    publishConfig(mqttTopics.topic(topics->discovery), payload);
 }
 
 void MQTTClientManager::publishGateDiscovery(const SavedDevice* device) {
     StaticJsonDocument<512> doc;
 
+    const DeviceTopics* topics = mqttTopics.find(device->id);
+    if (!topics) return;
+
     String uniqueId = String(sysConfig->mqtt_client_id) + "_" + String(device->id);
-    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/cover/" + uniqueId + "/config";
 
     doc["name"] = device->name;
     doc["uniq_id"] = uniqueId;
     doc["dev_cla"] = "garage";
-    doc["cmd_t"] = baseTopic + "/" + String(device->id) + "/set";
-    doc["stat_t"] = baseTopic + "/" + String(device->id) + "/state";
+    doc["cmd_t"] = mqttTopics.topic(topics->set);
+    doc["stat_t"] = mqttTopics.topic(topics->state);
     doc["avty_t"] = availabilityTopic;
     doc["pl_open"] = "TOGGLE";
     doc["pl_cls"] = "CLOSE";
@@ -813,20 +1250,21 @@ void MQTTClientManager::publishGateDiscovery(const SavedDevice* device) {
 
     String payload;
     serializeJson(doc, payload);
-    mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    delay(30);
+    publishConfig(mqttTopics.topic(topics->discovery), payload);
 }
 
 void MQTTClientManager::publishSwitchDiscovery(const SavedDevice* device) {
     StaticJsonDocument<512> doc;
 
+    const DeviceTopics* topics = mqttTopics.find(device->id);
+    if (!topics) return;
+
     String uniqueId = String(sysConfig->mqtt_client_id) + "_" + String(device->id);
-    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/switch/" + uniqueId + "/config";
 
     doc["name"] = device->name;
     doc["uniq_id"] = uniqueId;
-    doc["cmd_t"] = baseTopic + "/" + String(device->id) + "/set";
-    doc["stat_t"] = baseTopic + "/" + String(device->id) + "/state";
+    doc["cmd_t"] = mqttTopics.topic(topics->set);
+    doc["stat_t"] = mqttTopics.topic(topics->state);
     doc["avty_t"] = availabilityTopic;
     doc["pl_on"] = "ON";
     doc["pl_off"] = "OFF";
@@ -840,15 +1278,16 @@ void MQTTClientManager::publishSwitchDiscovery(const SavedDevice* device) {
 
     String payload;
     serializeJson(doc, payload);
-    mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    delay(30);
+    publishConfig(mqttTopics.topic(topics->discovery), payload);
 }
 
 void MQTTClientManager::publishButtonDiscovery(const SavedDevice* device, uint8_t signalIndex) {
     StaticJsonDocument<448> doc;
 
+    const DeviceTopics* topics = mqttTopics.find(device->id);
+    if (!topics || signalIndex >= MQTT_TOPIC_SIGNALS) return;
+
     String uniqueId = String(sysConfig->mqtt_client_id) + "_" + String(device->id) + "_" + String(signalIndex);
-    String discoveryTopic = String(MQTT_DISCOVERY_PREFIX) + "/button/" + uniqueId + "/config";
 
     String signalName = String(device->signalNames[signalIndex]);
     if (signalName.length() == 0) {
@@ -857,7 +1296,7 @@ void MQTTClientManager::publishButtonDiscovery(const SavedDevice* device, uint8_
 
     doc["name"] = String(device->name) + " - " + signalName;
     doc["uniq_id"] = uniqueId;
-    doc["cmd_t"] = baseTopic + "/" + String(device->id) + "/" + String(signalIndex) + "/set";
+    doc["cmd_t"] = mqttTopics.topic(topics->signalSet[signalIndex]);
     doc["avty_t"] = availabilityTopic;
     doc["pl_prs"] = "PRESS";
 
@@ -870,20 +1309,65 @@ void MQTTClientManager::publishButtonDiscovery(const SavedDevice* device, uint8_
 
     String payload;
     serializeJson(doc, payload);
-    mqtt.publish(discoveryTopic.c_str(), payload.c_str(), true);
-    delay(30);
+    publishConfig(mqttTopics.topic(topics->signalDiscovery[signalIndex]), payload);
+}
+
+// Un trigger de dispositivo por señal reconocible (ver RxMonitor): las
+// automatizaciones de HA reaccionan al control físico
+void MQTTClientManager::publishTriggerDiscovery(const SavedDevice* device) {
+    const DeviceTopics* topics = mqttTopics.find(device->id);
+    const char* remoteTopic = topics ? mqttTopics.topic(topics->remote) : nullptr;
+    if (!remoteTopic) return;
+
+    for (uint8_t j = 0; j < MQTT_TOPIC_SIGNALS; j++) {
+        const char* configTopic = mqttTopics.topic(topics->triggerDiscovery[j]);
+        if (!configTopic) continue;
+
+        char buffer[4];
+        const char* payloadValue = triggerPayload(device->type, j, buffer, sizeof(buffer));
+
+        // A-OK y Somfy no tienen nombres de señal: se usa el comando
+        bool protocol = device->type == DEVICE_CURTAIN_AOK || device->type == DEVICE_CURTAIN_SOMFY;
+        String signalName = protocol ? String() : String(device->signalNames[j]);
+        if (signalName.length() == 0 && TxScheduler::getSignalCommand(device->type, j)) {
+            signalName = payloadValue;
+        } else if (signalName.length() == 0) {
+            signalName = "Senal " + String(j + 1);
+        }
+
+        StaticJsonDocument<448> doc;
+        doc["atype"] = "trigger";
+        doc["t"] = remoteTopic;
+        doc["type"] = "button_short_press";
+        doc["stype"] = String(device->name) + " - " + signalName;
+        doc["pl"] = payloadValue;
+
+        JsonObject dev = doc.createNestedObject("dev");
+        JsonArray ids = dev.createNestedArray("ids");
+        ids.add(sysConfig->mqtt_client_id);
+        dev["name"] = sysConfig->device_name;
+        dev["mf"] = "Dirasmart";
+        dev["sw"] = FIRMWARE_VERSION;
+
+        String payload;
+        serializeJson(doc, payload);
+        publishConfig(configTopic, payload);
+    }
 }
 
 void MQTTClientManager::removeDiscovery() {
-    if (!mqtt.connected()) return;
+    if (!linkUp) return;
 
-    uint8_t count = storage.getDeviceCount();
+    uint16_t count = storage.getDeviceCount();
     SavedDevice device;
 
-    for (uint8_t i = 0; i < count; i++) {
+    for (uint16_t i = 0; i < count; i++) {
         if (!storage.getDeviceByIndex(i, &device)) continue;
         String uniqueId = String(sysConfig->mqtt_client_id) + "_" + String(device.id);
 
+        // 11 borrados por dispositivo: esperar lugar en la cola
+        if (!waitForQueue(11, 2000)) break;
+
         // Eliminar discovery según tipo
         String topics[] = {
             String(MQTT_DISCOVERY_PREFIX) + "/cover/" + uniqueId + "/config",
@@ -892,14 +1376,34 @@ void MQTTClientManager::removeDiscovery() {
         };
 
         for (const String& topic : topics) {
-            mqtt.publish(topic.c_str(), "", true);
+            publish(topic.c_str(), "", true);
         }
 
         // Eliminar botones de señales
         for (uint8_t j = 0; j < 4; j++) {
             String btnId = uniqueId + "_" + String(j);
             String btnTopic = String(MQTT_DISCOVERY_PREFIX) + "/button/" + btnId + "/config";
-            mqtt.publish(btnTopic.c_str(), "", true);
+            publish(btnTopic.c_str(), "", true);
+        }
+
+        // Eliminar triggers de controles físicos
+        for (uint8_t j = 0; j < MQTT_TOPIC_SIGNALS; j++) {
+            String triggerTopic = String(MQTT_DISCOVERY_PREFIX) + "/device_automation/" +
+                                  uniqueId + "_" + String(j) + "/config";
+            publish(triggerTopic.c_str(), "", true);
         }
     }
+
+    for (uint8_t i = 0; i < scenes.getCount(); i++) {
+        if (!waitForQueue(1, 2000)) break;
+        String sceneTopic = String(MQTT_DISCOVERY_PREFIX) + "/scene/" + sysConfig->mqtt_client_id +
+                            "_scene_" + scenes.getId(i) + "/config";
+        publish(sceneTopic.c_str(), "", true);
+    }
+
+    // El broker ya no retiene esas configs: el próximo discovery publica todo
+    discoveryRunning = false;
+    discoveryHashCount = 0;
+    discoveryDirty = false;
+    storage.saveDiscoveryHashes(discoveryHashes, 0);
 }
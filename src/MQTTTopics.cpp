@@ -0,0 +1,308 @@
+#include "MQTTTopics.h"
+#include "Storage.h"
+#include "CoverPositions.h"
+#include <stdarg.h>
+
+MQTTTopicCache mqttTopics;
+
+MQTTTopicCache::MQTTTopicCache() {
+    base[0] = '\0';
+    clientId[0] = '\0';
+    deviceCount = 0;
+    block = nullptr;
+    routes = nullptr;
+    routeCount = 0;
+    arena = nullptr;
+    arenaSize = 0;
+    memset(slots, 0, sizeof(slots));
+    dirty = true;
+}
+
+void MQTTTopicCache::begin(const char* baseTopic, const char* client) {
+    strlcpy(base, baseTopic, sizeof(base));
+    strlcpy(clientId, client, sizeof(clientId));
+    dirty = true;
+}
+
+// FNV-1a de 32 bits
+uint32_t MQTTTopicCache::hash(const char* text) {
+    uint32_t h = 2166136261u;
+    while (*text) {
+        h ^= (uint8_t)*text++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void MQTTTopicCache::onDeviceChanged(const char* id, const SavedDevice* device) {
+    if (dirty) return;
+
+    if (!id || !device || strcmp(id, device->id) != 0) {
+        dirty = true;
+        return;
+    }
+
+    const DeviceTopics* cached = find(id);
+    if (!cached) {
+        dirty = true;      // Dispositivo nuevo
+        return;
+    }
+
+    // Solo el tipo, las señales válidas y el recorrido cambian los topics (no el rolling code)
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < device->signalCount && i < MQTT_TOPIC_SIGNALS; i++) {
+        if (device->signals[i].valid) mask |= (1 << i);
+    }
+    if (cached->type != device->type || cached->signalMask != mask ||
+        cached->travel != CoverPositions::hasTravel(device)) {
+        dirty = true;
+    }
+}
+
+void MQTTTopicCache::release() {
+    free(block);
+    block = nullptr;
+    routes = nullptr;
+    arena = nullptr;
+    arenaSize = 0;
+    routeCount = 0;
+    memset(slots, 0, sizeof(slots));
+}
+
+bool MQTTTopicCache::ensure() {
+    if (!dirty) return true;
+    if (base[0] == '\0') return false;
+
+    release();
+    deviceCount = 0;
+
+    // Una pasada por el catálogo: solo id, tipo, señales válidas y recorrido
+    uint16_t count = storage.getDeviceCount();
+    SavedDevice device;
+    for (uint16_t i = 0; i < count && deviceCount < MAX_DEVICES; i++) {
+        if (!storage.getDeviceByIndex(i, &device)) continue;
+
+        DeviceTopics& entry = devices[deviceCount++];
+        strlcpy(entry.id, device.id, sizeof(entry.id));
+        entry.type = device.type;
+        entry.signalMask = 0;
+        for (uint8_t j = 0; j < device.signalCount && j < MQTT_TOPIC_SIGNALS; j++) {
+            if (device.signals[j].valid) entry.signalMask |= (1 << j);
+        }
+        entry.travel = CoverPositions::hasTravel(&device);
+        entry.idHash = hash(entry.id);
+    }
+
+    // Medir, reservar un único bloque y luego escribir
+    uint16_t routesNeeded = 0;
+    size_t textSize = layout(false, &routesNeeded);
+
+    if (textSize > MQTT_TOPIC_NONE) {
+        Serial.printf("[MQTT] Topics exceden la arena (%u bytes)\n", (unsigned)textSize);
+        deviceCount = 0;
+        dirty = false;
+        return false;
+    }
+
+    if (textSize == 0) {
+        dirty = false;
+        return true;
+    }
+
+    size_t routesSize = routesNeeded * sizeof(Route);
+    block = (uint8_t*)malloc(routesSize + textSize);
+    if (!block) {
+        Serial.println("[MQTT] Sin memoria para la caché de topics");
+        deviceCount = 0;
+        return false;
+    }
+
+    routes = (Route*)block;
+    arena = (char*)block + routesSize;
+    arenaSize = textSize;
+    layout(true, &routesNeeded);
+
+    dirty = false;
+    Serial.printf("[MQTT] Caché de topics: %d dispositivos, %u rutas, %u bytes\n",
+                  deviceCount, routeCount, (unsigned)(routesSize + textSize));
+    return true;
+}
+
+size_t MQTTTopicCache::layout(bool fill, uint16_t* routesNeeded) {
+    size_t used = 0;
+    uint16_t routeTotal = 0;
+    routeCount = 0;
+
+    for (uint16_t i = 0; i < deviceCount; i++) {
+        DeviceTopics& d = devices[i];
+        const char* component = getComponent(d.type);
+
+        uint16_t state = append(fill, &used, "%s/%s/state", base, d.id);
+        uint16_t set = append(fill, &used, "%s/%s/set", base, d.id);
+        uint16_t discovery = MQTT_TOPIC_NONE;
+        if (component) {
+            discovery = append(fill, &used, "%s/%s/%s_%s/config",
+                               MQTT_DISCOVERY_PREFIX, component, clientId, d.id);
+        }
+
+        uint8_t triggers = getTriggerMask(d.type, d.signalMask);
+        uint16_t remote = MQTT_TOPIC_NONE;
+        if (triggers) {
+            remote = append(fill, &used, "%s/%s/remote", base, d.id);
+        }
+
+        if (fill) {
+            d.state = state;
+            d.set = set;
+            d.discovery = discovery;
+            d.remote = remote;
+            addRoute(set, i, -1);
+        }
+        routeTotal++;
+
+        for (uint8_t j = 0; j < MQTT_TOPIC_SIGNALS; j++) {
+            uint16_t signalSet = MQTT_TOPIC_NONE;
+            uint16_t signalDiscovery = MQTT_TOPIC_NONE;
+
+            if (d.signalMask & (1 << j)) {
+                signalSet = append(fill, &used, "%s/%s/%d/set", base, d.id, j);
+                if (!component) {
+                    signalDiscovery = append(fill, &used, "%s/button/%s_%s_%d/config",
+                                             MQTT_DISCOVERY_PREFIX, clientId, d.id, j);
+                }
+                if (fill) addRoute(signalSet, i, j);
+                routeTotal++;
+            }
+
+            uint16_t triggerDiscovery = MQTT_TOPIC_NONE;
+            if (triggers & (1 << j)) {
+                triggerDiscovery = append(fill, &used, "%s/device_automation/%s_%s_%d/config",
+                                          MQTT_DISCOVERY_PREFIX, clientId, d.id, j);
+            }
+
+            if (fill) {
+                d.signalSet[j] = signalSet;
+                d.signalDiscovery[j] = signalDiscovery;
+                d.triggerDiscovery[j] = triggerDiscovery;
+            }
+        }
+
+        uint16_t position = MQTT_TOPIC_NONE;
+        uint16_t positionSet = MQTT_TOPIC_NONE;
+        if (d.travel) {
+            position = append(fill, &used, "%s/%s/position", base, d.id);
+            positionSet = append(fill, &used, "%s/%s/position/set", base, d.id);
+            if (fill) addRoute(positionSet, i, MQTT_ROUTE_POSITION);
+            routeTotal++;
+        }
+        if (fill) {
+            d.position = position;
+            d.positionSet = positionSet;
+        }
+    }
+
+    *routesNeeded = routeTotal;
+    return used;
+}
+
+// Escribe un topic terminado en '\0' en la arena (o solo mide si !fill)
+uint16_t MQTTTopicCache::append(bool fill, size_t* used, const char* format, ...) {
+    char buffer[192];
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length < 0 || length >= (int)sizeof(buffer)) return MQTT_TOPIC_NONE;
+
+    size_t offset = *used;
+    if (fill) {
+        if (offset + length + 1 > arenaSize) return MQTT_TOPIC_NONE;
+        memcpy(arena + offset, buffer, length + 1);
+    }
+    *used += length + 1;
+    return (uint16_t)offset;
+}
+
+void MQTTTopicCache::addRoute(uint16_t topicOffset, uint8_t device, int8_t signal) {
+    if (topicOffset == MQTT_TOPIC_NONE) return;
+
+    Route& route = routes[routeCount];
+    route.hash = hash(arena + topicOffset);
+    route.topic = topicOffset;
+    route.device = device;
+    route.signal = signal;
+
+    // Sondeo lineal
+    uint16_t slot = route.hash & (MQTT_TOPIC_HASH_SLOTS - 1);
+    while (slots[slot] != 0) {
+        slot = (slot + 1) & (MQTT_TOPIC_HASH_SLOTS - 1);
+    }
+    slots[slot] = ++routeCount;
+}
+
+const DeviceTopics* MQTTTopicCache::match(const char* topicName, int8_t* signalIndex) {
+    if (!ensure() || routeCount == 0) return nullptr;
+
+    uint32_t h = hash(topicName);
+    uint16_t slot = h & (MQTT_TOPIC_HASH_SLOTS - 1);
+
+    while (slots[slot] != 0) {
+        const Route& route = routes[slots[slot] - 1];
+        if (route.hash == h && strcmp(arena + route.topic, topicName) == 0) {
+            *signalIndex = route.signal;
+            return &devices[route.device];
+        }
+        slot = (slot + 1) & (MQTT_TOPIC_HASH_SLOTS - 1);
+    }
+
+    return nullptr;
+}
+
+const DeviceTopics* MQTTTopicCache::find(const char* deviceId) {
+    uint32_t h = hash(deviceId);
+    for (uint16_t i = 0; i < deviceCount; i++) {
+        if (devices[i].idHash == h && strcmp(devices[i].id, deviceId) == 0) {
+            return &devices[i];
+        }
+    }
+    return nullptr;
+}
+
+const char* MQTTTopicCache::topic(uint16_t offset) const {
+    if (!arena || offset == MQTT_TOPIC_NONE || offset >= arenaSize) return nullptr;
+    return arena + offset;
+}
+
+const char* MQTTTopicCache::getStateTopic(const char* deviceId) {
+    if (!ensure()) return nullptr;
+
+    const DeviceTopics* d = find(deviceId);
+    return d ? topic(d->state) : nullptr;
+}
+
+// Componente de Home Assistant según el tipo (igual que publishDiscovery)
+const char* MQTTTopicCache::getComponent(uint8_t type) {
+    switch (type) {
+        case DEVICE_CURTAIN:
+        case DEVICE_CURTAIN_SOMFY:
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+        case DEVICE_CURTAIN_AOK:
+        case DEVICE_GATE:
+            return "cover";
+        case DEVICE_SWITCH:
+        case DEVICE_LIGHT:
+        case DEVICE_FAN:
+            return "switch";
+        default:
+            return nullptr;
+    }
+}
+
+// Mismas señales que reconoce RxMonitor: las capturadas y los comandos de
+// las cortinas A-OK y Somfy (subir/bajar/parar)
+uint8_t MQTTTopicCache::getTriggerMask(uint8_t type, uint8_t signalMask) {
+    if (type == DEVICE_CURTAIN_AOK || type == DEVICE_CURTAIN_SOMFY) return 0x07;
+    return signalMask;
+}
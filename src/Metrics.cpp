@@ -0,0 +1,215 @@
+#include "Metrics.h"
+#include "TxTiming.h"
+
+Metrics metrics;
+
+// Límites superiores de los buckets en µs (el último es +Inf)
+static const uint32_t BUCKET_BOUNDS[METRIC_BUCKETS - 1] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+
+struct MetricInfo {
+    const char* name;       // Prometheus
+    const char* shortName;  // MQTT
+    const char* help;
+};
+
+static const MetricInfo COUNTER_INFO[METRIC_COUNTER_COUNT] = {
+    {"rf_commands_total", "cmd", "Comandos recibidos por MQTT o HTTP"},
+    {"rf_tx_errors_total", "tx_err", "Transmisiones fallidas"},
+    {"rf_storage_errors_total", "st_err", "Errores de lectura/escritura en LittleFS"},
+    {"rf_json_errors_total", "json_err", "Documentos JSON inválidos"},
+    {"rf_mqtt_publish_errors_total", "pub_err", "Publicaciones MQTT fallidas"},
+    {"rf_mqtt_queue_dropped_total", "mq_drop", "Mensajes MQTT descartados por cola llena"},
+    {"rf_mqtt_queue_coalesced_total", "mq_coal", "Mensajes retenidos reemplazados en la cola por un valor más nuevo"},
+    {"rf_mqtt_inbox_dropped_total", "in_drop", "Comandos MQTT descartados (cola de entrada llena o demasiado largos)"},
+};
+
+static const MetricInfo HISTOGRAM_INFO[METRIC_HISTOGRAM_COUNT] = {
+    {"rf_command_to_tx_seconds", "cmd_rf", "Desde la recepción del comando hasta el inicio de la transmisión"},
+    {"rf_tx_air_seconds", "air", "Duración de la transmisión RF"},
+    {"rf_storage_read_seconds", "st_rd", "Lecturas de LittleFS (config, dispositivos)"},
+    {"rf_storage_write_seconds", "st_wr", "Escrituras de LittleFS (config, dispositivos)"},
+    {"rf_json_parse_seconds", "json", "deserializeJson de almacenamiento y API"},
+    {"rf_mqtt_publish_seconds", "pub", "Publicaciones MQTT"},
+    {"rf_http_handler_seconds", "http", "Handlers HTTP de la API"},
+};
+
+static const MetricInfo GAUGE_INFO[METRIC_GAUGE_COUNT] = {
+    {"rf_mqtt_queue_depth", "mq", "Mensajes MQTT pendientes de publicar"},
+    {"rf_mqtt_queue_bytes", "mq_b", "Bytes pendientes en la cola MQTT"},
+    {"rf_mqtt_queue_peak", "mq_max", "Máxima profundidad de la cola MQTT"},
+    {"rf_boot_radio_ready_ms", "boot_rf", "Milisegundos desde el reset hasta poder transmitir"},
+};
+
+Metrics::Metrics() {
+    memset(counters, 0, sizeof(counters));
+    memset(histograms, 0, sizeof(histograms));
+    memset(gauges, 0, sizeof(gauges));
+    commandStartUs = 0;
+    commandPending = false;
+    txStartUs = 0;
+}
+
+void Metrics::increment(MetricCounter counter, uint32_t amount) {
+    if (counter < METRIC_COUNTER_COUNT) counters[counter] += amount;
+}
+
+void Metrics::observe(MetricHistogram histogram, uint32_t valueUs) {
+    if (histogram >= METRIC_HISTOGRAM_COUNT) return;
+
+    MetricHistogramData& h = histograms[histogram];
+    uint8_t bucket = 0;
+    while (bucket < METRIC_BUCKETS - 1 && valueUs > BUCKET_BOUNDS[bucket]) bucket++;
+
+    h.buckets[bucket]++;
+    h.count++;
+    h.sumUs += valueUs;
+    if (valueUs > h.maxUs) h.maxUs = valueUs;
+}
+
+void Metrics::setGauge(MetricGauge gauge, uint32_t value) {
+    if (gauge < METRIC_GAUGE_COUNT) gauges[gauge] = value;
+}
+
+void Metrics::commandReceived() {
+    counters[METRIC_COMMANDS]++;
+    commandStartUs = micros();
+    commandPending = true;
+}
+
+void Metrics::txStarted() {
+    txStartUs = micros();
+
+    // Solo la primera transmisión de cada comando cuenta para la latencia
+    if (commandPending) {
+        observe(METRIC_CMD_TO_RF_US, txStartUs - commandStartUs);
+        commandPending = false;
+    }
+}
+
+void Metrics::txFinished(bool success) {
+    observe(METRIC_RF_AIR_US, micros() - txStartUs);
+    if (!success) counters[METRIC_RF_TX_ERRORS]++;
+}
+
+uint32_t Metrics::getCounter(MetricCounter counter) const {
+    return counter < METRIC_COUNTER_COUNT ? counters[counter] : 0;
+}
+
+const MetricHistogramData& Metrics::getHistogram(MetricHistogram histogram) const {
+    return histograms[histogram < METRIC_HISTOGRAM_COUNT ? histogram : 0];
+}
+
+uint32_t Metrics::getGauge(MetricGauge gauge) const {
+    return gauge < METRIC_GAUGE_COUNT ? gauges[gauge] : 0;
+}
+
+uint32_t Metrics::getBucketBound(uint8_t bucket) {
+    return bucket < METRIC_BUCKETS - 1 ? BUCKET_BOUNDS[bucket] : 0xFFFFFFFF;
+}
+
+static void writeGauge(Print& out, const char* name, const char* help, double value) {
+    out.printf("# HELP %s %s\n# TYPE %s gauge\n%s %.0f\n", name, help, name, name, value);
+}
+
+void Metrics::writePrometheus(Print& out) {
+    for (uint8_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        const MetricInfo& info = COUNTER_INFO[i];
+        out.printf("# HELP %s %s\n# TYPE %s counter\n%s %lu\n",
+                   info.name, info.help, info.name, info.name, (unsigned long)counters[i]);
+    }
+
+    for (uint8_t i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        const MetricInfo& info = HISTOGRAM_INFO[i];
+        const MetricHistogramData& h = histograms[i];
+        out.printf("# HELP %s %s\n# TYPE %s histogram\n", info.name, info.help, info.name);
+
+        // Buckets acumulados, límites en segundos
+        uint32_t cumulative = 0;
+        for (uint8_t b = 0; b < METRIC_BUCKETS; b++) {
+            cumulative += h.buckets[b];
+            if (b < METRIC_BUCKETS - 1) {
+                out.printf("%s_bucket{le=\"%g\"} %lu\n", info.name, BUCKET_BOUNDS[b] / 1e6,
+                           (unsigned long)cumulative);
+            } else {
+                out.printf("%s_bucket{le=\"+Inf\"} %lu\n", info.name, (unsigned long)cumulative);
+            }
+        }
+        out.printf("%s_sum %.6f\n%s_count %lu\n", info.name, h.sumUs / 1e6, info.name,
+                   (unsigned long)h.count);
+    }
+
+    writeGauge(out, "rf_uptime_seconds", "Tiempo desde el arranque", millis() / 1000);
+    writeGauge(out, "rf_heap_free_bytes", "Heap libre", ESP.getFreeHeap());
+    writeGauge(out, "rf_heap_min_free_bytes", "Mínimo histórico de heap libre", ESP.getMinFreeHeap());
+    writeGauge(out, "rf_heap_largest_block_bytes", "Mayor bloque asignable", ESP.getMaxAllocHeap());
+
+    for (uint8_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        writeGauge(out, GAUGE_INFO[i].name, GAUGE_INFO[i].help, gauges[i]);
+    }
+
+    if (txTiming.getTransmissions() > 0) {
+        const TxTimingStats& last = txTiming.getLastStats();
+        writeGauge(out, "rf_tx_timing_p99_us", "p99 del error de ancho de pulso (última TX medida)", last.p99Us);
+        writeGauge(out, "rf_tx_timing_max_us", "Máximo error de ancho de pulso (última TX medida)", last.maxUs);
+    }
+}
+
+String Metrics::toCompactJson() {
+    String json;
+    json.reserve(448);
+
+    json += "{\"up\":";
+    json += millis() / 1000;
+    json += ",\"heap\":[";
+    json += ESP.getFreeHeap();
+    json += ",";
+    json += ESP.getMinFreeHeap();
+    json += ",";
+    json += ESP.getMaxAllocHeap();
+    json += "],\"c\":{";
+
+    for (uint8_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        if (i > 0) json += ",";
+        json += "\"";
+        json += COUNTER_INFO[i].shortName;
+        json += "\":";
+        json += counters[i];
+    }
+
+    // Histogramas: [cantidad, media µs, máximo µs]
+    json += "},\"h\":{";
+    for (uint8_t i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        const MetricHistogramData& h = histograms[i];
+        if (i > 0) json += ",";
+        json += "\"";
+        json += HISTOGRAM_INFO[i].shortName;
+        json += "\":[";
+        json += h.count;
+        json += ",";
+        json += h.count ? (uint32_t)(h.sumUs / h.count) : 0;
+        json += ",";
+        json += h.maxUs;
+        json += "]";
+    }
+
+    json += "},\"g\":{";
+    for (uint8_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        if (i > 0) json += ",";
+        json += "\"";
+        json += GAUGE_INFO[i].shortName;
+        json += "\":";
+        json += gauges[i];
+    }
+    json += "}}";
+
+    return json;
+}
+
+MetricScope::MetricScope(MetricHistogram histogram) : histogram(histogram), startUs(micros()) {
+}
+
+MetricScope::~MetricScope() {
+    metrics.observe(histogram, micros() - startUs);
+}
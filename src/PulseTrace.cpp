@@ -0,0 +1,155 @@
+#include "PulseTrace.h"
+
+// ============================================
+// ESCRITURA
+// ============================================
+
+PulseTraceWriter::PulseTraceWriter(Print& out)
+    : out(out), bytesWritten(0), pulseCount(0), segmentCount(0), ok(true) {
+}
+
+void PulseTraceWriter::writeByte(uint8_t value) {
+    if (out.write(value) == 1) {
+        bytesWritten++;
+    } else {
+        ok = false;
+    }
+}
+
+void PulseTraceWriter::writeU32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        writeByte((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void PulseTraceWriter::writeVarint(uint32_t value) {
+    // LEB128: 7 bits por byte, bit 7 = continúa
+    while (value >= 0x80) {
+        writeByte((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    writeByte(value);
+}
+
+bool PulseTraceWriter::begin(const PulseTraceHeader& header) {
+    const char* magic = PULSE_TRACE_MAGIC;
+    for (int i = 0; i < 4; i++) writeByte(magic[i]);
+
+    writeByte(PULSE_TRACE_VERSION);
+    writeByte(header.modulation);
+    writeByte(header.flags);
+    writeByte((uint8_t)header.rssi);
+    writeU32(header.frequencyKHz);
+    writeU32(header.startUnix);
+    writeU32(header.startMillis);
+    writeU32(0);
+
+    return ok;
+}
+
+bool PulseTraceWriter::beginSegment(uint32_t offsetMs, int8_t rssi) {
+    writeByte(0);
+    writeVarint(offsetMs);
+    writeByte((uint8_t)rssi);
+    segmentCount++;
+    return ok;
+}
+
+bool PulseTraceWriter::addPulse(uint32_t durationUs) {
+    // 0 está reservado para el marcador de segmento
+    if (durationUs == 0) return ok;
+
+    writeVarint(durationUs);
+    pulseCount++;
+    return ok;
+}
+
+bool PulseTraceWriter::addSignal(const RFSignal* signal, uint32_t offsetMs, int8_t rssi) {
+    beginSegment(offsetMs, rssi);
+    for (uint16_t i = 0; i + 1 < signal->length; i += 2) {
+        addPulse((signal->data[i] << 8) | signal->data[i + 1]);
+    }
+    return ok;
+}
+
+// ============================================
+// LECTURA
+// ============================================
+
+PulseTraceReader::PulseTraceReader(Stream& in) : in(in), segmentPending(false) {
+}
+
+bool PulseTraceReader::readByte(uint8_t& value) {
+    int b = in.read();
+    if (b < 0) return false;
+    value = (uint8_t)b;
+    return true;
+}
+
+bool PulseTraceReader::readU32(uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8_t b;
+        if (!readByte(b)) return false;
+        value |= (uint32_t)b << (8 * i);
+    }
+    return true;
+}
+
+bool PulseTraceReader::readVarint(uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t b;
+        if (!readByte(b)) return false;
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;   // Varint mal formado
+}
+
+bool PulseTraceReader::begin(PulseTraceHeader& header) {
+    char magic[4];
+    uint32_t reserved;
+    segmentPending = false;
+
+    if (in.readBytes((uint8_t*)magic, 4) != 4 || memcmp(magic, PULSE_TRACE_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    uint8_t rssi;
+    if (!readByte(header.version) || !readByte(header.modulation) ||
+        !readByte(header.flags) || !readByte(rssi) ||
+        !readU32(header.frequencyKHz) || !readU32(header.startUnix) ||
+        !readU32(header.startMillis) || !readU32(reserved)) {
+        return false;
+    }
+    header.rssi = (int8_t)rssi;
+
+    return header.version == PULSE_TRACE_VERSION;
+}
+
+bool PulseTraceReader::readSegment(PulseTraceSegment& segment, uint32_t* pulses,
+                                   uint16_t maxPulses, uint16_t& count) {
+    count = 0;
+
+    if (!segmentPending) {
+        uint32_t marker;
+        if (!readVarint(marker) || marker != 0) return false;
+    }
+    segmentPending = false;
+
+    uint8_t rssi;
+    if (!readVarint(segment.offsetMs) || !readByte(rssi)) return false;
+    segment.rssi = (int8_t)rssi;
+
+    uint32_t value;
+    while (readVarint(value)) {
+        if (value == 0) {
+            segmentPending = true;
+            break;
+        }
+        if (count < maxPulses) pulses[count++] = value;
+    }
+
+    return true;
+}
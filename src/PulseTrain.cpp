@@ -0,0 +1,69 @@
+#include "PulseTrain.h"
+
+PulseTrain::PulseTrain() {
+    clear();
+}
+
+void PulseTrain::clear() {
+    count = 0;
+    overflowed = false;
+}
+
+bool PulseTrain::add(bool level, uint32_t durationUs) {
+    if (durationUs == 0) return true;
+
+    // Mismo nivel que el pulso anterior: no hay flanco, se extiende
+    if (count > 0 && getLevel(count - 1) == level) {
+        pulses[count - 1] += durationUs;
+        return true;
+    }
+
+    if (count >= PULSE_TRAIN_MAX_PULSES) {
+        overflowed = true;
+        return false;
+    }
+
+    pulses[count++] = (level ? PULSE_LEVEL_BIT : 0) | (durationUs & PULSE_DURATION_MASK);
+    return true;
+}
+
+bool PulseTrain::getLevel(uint16_t index) const {
+    return index < count && (pulses[index] & PULSE_LEVEL_BIT);
+}
+
+uint32_t PulseTrain::getDuration(uint16_t index) const {
+    return index < count ? (pulses[index] & PULSE_DURATION_MASK) : 0;
+}
+
+uint32_t PulseTrain::getTotalDuration() const {
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        total += pulses[i] & PULSE_DURATION_MASK;
+    }
+    return total;
+}
+
+void PulseTrain::play(uint8_t pin, const uint32_t* pulses, uint16_t count) {
+    unsigned long deadline = micros();
+
+    for (uint16_t i = 0; i < count; i++) {
+        digitalWrite(pin, (pulses[i] & PULSE_LEVEL_BIT) ? HIGH : LOW);
+        deadline += pulses[i] & PULSE_DURATION_MASK;
+        while ((long)(micros() - deadline) < 0) {
+            // Espera activa hasta el plazo del siguiente flanco
+        }
+    }
+
+    digitalWrite(pin, LOW);
+}
+
+String PulseTrain::toString() const {
+    String out;
+    out.reserve(count * 6);
+    for (uint16_t i = 0; i < count; i++) {
+        if (i > 0) out += ' ';
+        out += getLevel(i) ? '+' : '-';
+        out += String(getDuration(i));
+    }
+    return out;
+}
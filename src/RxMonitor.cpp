@@ -0,0 +1,179 @@
+#include "RxMonitor.h"
+#include "CC1101_RF.h"
+#include "SomfyRemotes.h"
+#include "BootManager.h"
+#include "Logger.h"
+
+RxMonitor rxMonitor;
+
+RxMonitor::RxMonitor() {
+    sysConfig = nullptr;
+    listenFrequency = 0;
+    onCommand = nullptr;
+    onTrigger = nullptr;
+    frameLength = 0;
+    frameOverflow = false;
+    lastReadAt = 0;
+    memset(&lastPress, 0, sizeof(lastPress));
+    lastPressAt = 0;
+    pressing = false;
+    frameCount = 0;
+    matchCount = 0;
+}
+
+void RxMonitor::begin(SystemConfig* config) {
+    sysConfig = config;
+    if (RX_MONITOR_ENABLED) {
+        LOG_I("RX", "Escucha de controles físicos en %.2f MHz", sysConfig->default_frequency);
+    }
+}
+
+void RxMonitor::loop() {
+    if (!RX_MONITOR_ENABLED || !sysConfig || !bootManager.isReady(BOOT_RADIO_READY)) return;
+
+    if (!rfModule.isListening()) {
+        // Radio usada hace poco (TX, captura, escaneo): esperar a que quede libre
+        if (millis() - rfModule.getLastRadioUse() < RX_RESUME_MS) return;
+
+        float freq = getListenFrequency();
+        if (rfModule.startListening(freq, sysConfig->default_modulation)) {
+            listenFrequency = freq;
+            frameLength = 0;
+            frameOverflow = false;
+            lastReadAt = millis();
+        }
+        return;
+    }
+
+    // Cortina Somfy agregada o borrada (o frecuencia por defecto cambiada):
+    // se vuelve a escuchar en la frecuencia que corresponde
+    if (getListenFrequency() != listenFrequency) {
+        rfModule.suspendListening();
+        return;
+    }
+
+    // Tope por vuelta: una ráfaga de ruido no frena al resto de loop()
+    uint16_t durations[64];
+    uint16_t budget = RX_DRAIN_PER_LOOP;
+    while (budget > 0) {
+        uint16_t count = rfModule.readListened(durations, min(budget, (uint16_t)64));
+        if (count == 0) break;
+
+        budget -= count;
+        lastReadAt = millis();
+        for (uint16_t i = 0; i < count; i++) {
+            addDuration(durations[i]);
+        }
+    }
+
+    // La última repetición de una ráfaga no tiene flanco que la cierre: sin
+    // flancos durante más que un separador, el frame está completo
+    if (frameLength > 0 && millis() - lastReadAt > SIGNAL_FP_GAP_US / 1000) {
+        endFrame();
+    }
+}
+
+// Con cortinas Somfy guardadas se escucha en el medio entre 433.42 MHz y la
+// frecuencia por defecto, si las dos entran en RX_LISTEN_BANDWIDTH_KHZ
+float RxMonitor::getListenFrequency() {
+    float freq = sysConfig->default_frequency;
+    if (somfyRemotes.hasDevices() &&
+        fabs(freq - SOMFY_FREQUENCY) * 1000 < RX_LISTEN_BANDWIDTH_KHZ * 3 / 4) {
+        freq = (freq + SOMFY_FREQUENCY) / 2;
+    }
+    return freq;
+}
+
+void RxMonitor::addDuration(uint16_t duration) {
+    if (duration >= SIGNAL_FP_GAP_US) {
+        endFrame();
+        return;
+    }
+
+    if (frameOverflow) return;
+    if (frameLength >= sizeof(frame) / sizeof(frame[0])) {
+        frameOverflow = true;
+        return;
+    }
+    frame[frameLength++] = duration;
+}
+
+void RxMonitor::endFrame() {
+    if (!frameOverflow && frameLength >= SIGNAL_FP_MIN_SYMBOLS) {
+        processFrame();
+    }
+    frameLength = 0;
+    frameOverflow = false;
+}
+
+void RxMonitor::processFrame() {
+    frameCount++;
+
+    SomfyFrame somfy;
+    if (SomfyRTS::decodePulses(frame, frameLength, &somfy)) {
+        processSomfy(somfy);
+        return;
+    }
+
+    SignalFingerprint fp;
+    if (!SignalIndex::fingerprint(frame, frameLength, &fp)) return;
+
+    // Repetición de la pulsación en curso (el control repite el frame
+    // mientras se mantiene el botón)
+    unsigned long now = millis();
+    if (pressing && now - lastPressAt < RX_REPEAT_HOLD_MS && SignalIndex::matches(fp, lastPress)) {
+        lastPressAt = now;
+        return;
+    }
+
+    SignalMatch found[SIGNAL_MATCH_MAX];
+    uint8_t count = signalIndex.find(fp, found, SIGNAL_MATCH_MAX);
+    if (count == 0) return;
+
+    lastPress = fp;
+    lastPressAt = now;
+    pressing = true;
+    matchCount++;
+
+    // La misma señal guardada en varios dispositivos los actualiza a todos
+    for (uint8_t i = 0; i < count; i++) {
+        const char* command = TxScheduler::getSignalCommand(found[i].type, found[i].signal);
+        LOG_I("RX", "Control físico: %s, señal %u (%s)", found[i].deviceId, found[i].signal,
+              command ? command : "sin estado");
+
+        if (command && onCommand) onCommand(found[i].deviceId, command);
+        if (onTrigger) onTrigger(found[i].deviceId, found[i].signal);
+    }
+}
+
+// Subir/bajar/My como las señales 0/1/2 de una cortina (mismos comandos y
+// triggers que A-OK); el resto (PROG, combinaciones) no cambia el estado
+static int8_t somfyAction(uint8_t command) {
+    switch (command) {
+        case SOMFY_CMD_UP:   return ACTION_UP;
+        case SOMFY_CMD_DOWN: return ACTION_DOWN;
+        case SOMFY_CMD_MY:   return ACTION_STOP;
+        default:             return -1;
+    }
+}
+
+void RxMonitor::processSomfy(const SomfyFrame& somfy) {
+    // Las repeticiones llevan el mismo rolling code
+    if (!somfyRemotes.track(somfy)) return;
+
+    // Después de track(): actualizar el rolling code cambia la tabla de ids
+    const char* ids[SIGNAL_MATCH_MAX];
+    uint8_t count = somfyRemotes.findDevices(somfy.address, ids, SIGNAL_MATCH_MAX);
+    LOG_I("RX", "Control Somfy 0x%06lX: comando 0x%X, rolling code %u, %u cortinas",
+          (unsigned long)somfy.address, somfy.command, somfy.rollingCode, count);
+
+    int8_t action = somfyAction(somfy.command);
+    if (count == 0 || action < 0) return;
+    matchCount++;
+
+    for (uint8_t i = 0; i < count; i++) {
+        const char* command = TxScheduler::getSignalCommand(DEVICE_CURTAIN_SOMFY, action);
+        if (command && onCommand) onCommand(ids[i], command);
+        if (onTrigger) onTrigger(ids[i], action);
+    }
+}
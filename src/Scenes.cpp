@@ -0,0 +1,489 @@
+#include "Scenes.h"
+#include "Storage.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "DooyaBidir.h"
+#include "AOK_Protocol.h"
+#include "SomfyRemotes.h"
+#include "Logger.h"
+
+Scenes scenes;
+
+Scenes::Scenes() {
+    sceneCount = 0;
+    steps = nullptr;
+    stepTotal = 0;
+    somfyCount = 0;
+    compiledBytes = 0;
+    compiledGeneration = 0;
+    seenGeneration = 0;
+    seenAt = 0;
+    reencodePending = false;
+    scratch = nullptr;
+    active = -1;
+    nextStep = 0;
+    nextAt = 0;
+    onStep = nullptr;
+}
+
+bool Scenes::begin() {
+    return compile();
+}
+
+bool Scenes::reload() {
+    if (active >= 0) {
+        LOG_W("Scene", "Escena '%s' interrumpida por recarga", entries[active].id);
+        active = -1;
+    }
+    return compile();
+}
+
+void Scenes::release() {
+    for (uint16_t i = 0; i < stepTotal; i++) {
+        free(steps[i].pulses);
+    }
+    free(steps);
+    steps = nullptr;
+    stepTotal = 0;
+    sceneCount = 0;
+    somfyCount = 0;
+    compiledBytes = 0;
+    reencodePending = false;
+}
+
+bool Scenes::compile() {
+    release();
+    compiledGeneration = storage.getCatalogGeneration();
+    seenGeneration = compiledGeneration;
+
+    {
+        String json = storage.getScenesJson();
+        DynamicJsonDocument doc(SCENES_JSON_SIZE);
+        if (deserializeJson(doc, json)) {
+            LOG_E("Scene", "scenes.json inválido");
+            return false;
+        }
+
+        JsonArray list = doc.as<JsonArray>();
+        uint16_t total = 0;
+        for (size_t i = 0; i < list.size() && i < MAX_SCENES; i++) {
+            total += min((size_t)MAX_SCENE_STEPS, list[i]["steps"].as<JsonArray>().size());
+        }
+        if (total == 0) return true;
+
+        steps = (SceneStep*)calloc(total, sizeof(SceneStep));
+        if (!steps) {
+            LOG_E("Scene", "Sin memoria para %d pasos", total);
+            return false;
+        }
+
+        for (size_t i = 0; i < list.size() && sceneCount < MAX_SCENES; i++) {
+            Scene& scene = entries[sceneCount++];
+            strlcpy(scene.id, list[i]["id"] | "", sizeof(scene.id));
+            strlcpy(scene.name, list[i]["name"] | scene.id, sizeof(scene.name));
+            scene.first = stepTotal;
+            scene.stepCount = 0;
+
+            JsonArray sceneSteps = list[i]["steps"].as<JsonArray>();
+            for (size_t j = 0; j < sceneSteps.size() && scene.stepCount < MAX_SCENE_STEPS; j++) {
+                SceneStep& step = steps[stepTotal++];
+                strlcpy(step.deviceId, sceneSteps[j]["device"] | "", sizeof(step.deviceId));
+                strlcpy(step.command, sceneSteps[j]["command"] | "", sizeof(step.command));
+                step.pauseMs = min((uint32_t)(sceneSteps[j]["delay"] | 0), (uint32_t)SCENE_MAX_DELAY_MS);
+                step.somfySlot = -1;
+                scene.stepCount++;
+            }
+        }
+    }
+
+    // Una sola pasada por devices.json para todos los pasos
+    scratch = new PulseTrain();
+    storage.forEachDevice(visit, this);
+    delete scratch;
+    scratch = nullptr;
+
+    uint16_t ready = 0;
+    for (uint16_t i = 0; i < stepTotal; i++) {
+        if (steps[i].kind == STEP_NONE) {
+            LOG_W("Scene", "Paso sin compilar: %s -> %s", steps[i].deviceId, steps[i].command);
+        } else {
+            ready++;
+        }
+    }
+
+    for (uint8_t i = 0; i < sceneCount; i++) {
+        orderScene(entries[i]);
+    }
+    encodeSomfy();
+
+    LOG_I("Scene", "%d escenas, %d/%d pasos compilados, %u bytes",
+          sceneCount, ready, stepTotal, (unsigned)compiledBytes);
+    return true;
+}
+
+// Visitante de Storage::forEachDevice: compila los pasos que usan este dispositivo
+bool Scenes::visit(const SavedDevice* device, void* context) {
+    Scenes* self = (Scenes*)context;
+    for (uint16_t i = 0; i < self->stepTotal; i++) {
+        if (strcmp(self->steps[i].deviceId, device->id) == 0) {
+            self->compileStep(self->steps[i], device);
+        }
+    }
+    return true;
+}
+
+void Scenes::compileStep(SceneStep& step, const SavedDevice* device) {
+    if (!device->enabled) return;
+
+    int8_t action = -1;
+    switch (device->type) {
+        case DEVICE_CURTAIN_SOMFY:
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+        case DEVICE_CURTAIN_AOK:
+            action = TxScheduler::getProtocolAction(step.command);
+            if (action < 0) return;
+            break;
+        default:
+            break;
+    }
+
+    switch (device->type) {
+        case DEVICE_CURTAIN_SOMFY: {
+            if (device->somfy.address == 0) return;
+
+            // Un slot por control: varios pasos (y escenas) comparten el rolling code
+            int8_t slot = -1;
+            for (uint8_t i = 0; i < somfyCount && slot < 0; i++) {
+                if (strcmp(somfyRemotes[i].deviceId, device->id) == 0) slot = i;
+            }
+            if (slot < 0) {
+                if (somfyCount >= SCENE_MAX_SOMFY) {
+                    LOG_W("Scene", "Más de %d controles Somfy en escenas", SCENE_MAX_SOMFY);
+                    return;
+                }
+                slot = somfyCount++;
+                strlcpy(somfyRemotes[slot].deviceId, device->id, sizeof(somfyRemotes[slot].deviceId));
+                somfyRemotes[slot].remote = device->somfy;
+                somfyRemotes[slot].dirty = false;
+            }
+
+            static const uint8_t SOMFY_COMMANDS[] = { SOMFY_CMD_UP, SOMFY_CMD_DOWN, SOMFY_CMD_MY, SOMFY_CMD_PROG };
+            step.somfySlot = slot;
+            step.somfyCommand = SOMFY_COMMANDS[action];
+            step.profile = CC1101_RF::makeTxProfile(SOMFY_FREQUENCY, 2, RF_TX_MODE_ASYNC);
+            step.kind = STEP_SOMFY;     // La forma de onda sale de encodeSomfy()
+            break;
+        }
+
+        case DEVICE_CURTAIN_DOOYA_BIDIR: {
+            static const uint8_t DOOYA_COMMANDS[] = {
+                DOOYA_BIDIR_CMD_UP, DOOYA_BIDIR_CMD_DOWN, DOOYA_BIDIR_CMD_STOP, DOOYA_BIDIR_CMD_PROG
+            };
+            dooyaBidir.setRemote(&device->dooyaBidir);
+            dooyaBidir.encodeFrame(DOOYA_COMMANDS[action], step.frame);
+            step.profile = CC1101_RF::makeTxProfile(DOOYA_BIDIR_FREQUENCY, DOOYA_BIDIR_MODULATION, RF_TX_MODE_FSK);
+            step.kind = STEP_DOOYA;
+            break;
+        }
+
+        case DEVICE_CURTAIN_AOK: {
+            static const uint8_t AOK_COMMANDS[] = { AOK_CMD_UP, AOK_CMD_DOWN, AOK_CMD_STOP, AOK_CMD_PROGRAM };
+            aokProtocol.setRemoteId(device->aok.remoteId);
+            aokProtocol.setChannel(device->aok.channel);
+            if (!aokProtocol.encodeCommand(AOK_COMMANDS[action], *scratch)) return;
+            if (!storePulses(step, *scratch)) return;
+            step.profile = CC1101_RF::makeTxProfile(AOK_FREQUENCY, 2, RF_TX_MODE_ASYNC);
+            step.kind = STEP_AOK;
+            break;
+        }
+
+        default: {
+            int8_t index = TxScheduler::getSignalIndex(device->type, step.command);
+            if (index < 0 || index >= device->signalCount || !device->signals[index].valid) return;
+
+            const RFSignal& signal = device->signals[index];
+            if (!CC1101_RF::encodeRaw(signal.data, signal.length, signal.inverted, *scratch)) return;
+            if (!storePulses(step, *scratch)) return;
+            step.frequency = signal.frequency;
+            step.modulation = signal.modulation;
+            // transmitPulses siempre usa OOK async: solo la frecuencia distingue el perfil
+            step.profile = CC1101_RF::makeTxProfile(signal.frequency, 2, RF_TX_MODE_ASYNC);
+            step.kind = STEP_RAW;
+            break;
+        }
+    }
+}
+
+// Copia compacta de la forma de onda (el PulseTrain completo ocupa 2 KB)
+bool Scenes::storePulses(SceneStep& step, const PulseTrain& train) {
+    size_t size = train.size() * sizeof(uint32_t);
+    size_t previous = step.pulseCount * sizeof(uint32_t);
+
+    if (train.size() == 0 || compiledBytes - previous + size > SCENE_COMPILED_MAX_BYTES) {
+        LOG_W("Scene", "Formas de onda exceden %d bytes (%s)", SCENE_COMPILED_MAX_BYTES, step.deviceId);
+        return false;
+    }
+
+    uint32_t* pulses = (uint32_t*)realloc(step.pulses, size);
+    if (!pulses) {
+        LOG_E("Scene", "Sin memoria para la forma de onda de %s", step.deviceId);
+        return false;
+    }
+
+    memcpy(pulses, train.data(), size);
+    step.pulses = pulses;
+    step.pulseCount = train.size();
+    compiledBytes = compiledBytes - previous + size;
+    return true;
+}
+
+// Cada tramo (hasta un paso con pausa) se ordena por perfil de radio: primero
+// el perfil en curso, luego el paso elegible más antiguo. Los pasos de un
+// mismo dispositivo conservan su orden y la pausa pasa al último del tramo.
+void Scenes::orderScene(Scene& scene) {
+    SceneStep ordered[MAX_SCENE_STEPS];
+    SceneStep* source = steps + scene.first;
+    uint8_t start = 0;
+
+    while (start < scene.stepCount) {
+        uint8_t end = start;
+        while (end < scene.stepCount - 1 && source[end].pauseMs == 0) end++;
+        uint16_t pauseMs = source[end].pauseMs;
+
+        bool done[MAX_SCENE_STEPS] = {};
+        uint32_t currentProfile = 0;
+        for (uint8_t n = start; n <= end; n++) {
+            int8_t oldest = -1;
+            int8_t sameProfile = -1;
+            for (uint8_t i = start; i <= end; i++) {
+                if (done[i]) continue;
+
+                bool blocked = false;
+                for (uint8_t j = start; j < i && !blocked; j++) {
+                    blocked = !done[j] && strcmp(source[j].deviceId, source[i].deviceId) == 0;
+                }
+                if (blocked) continue;
+
+                if (oldest < 0) oldest = i;
+                if (sameProfile < 0 && source[i].profile == currentProfile) sameProfile = i;
+            }
+
+            int8_t pick = sameProfile >= 0 ? sameProfile : oldest;
+            done[pick] = true;
+            ordered[n] = source[pick];
+            ordered[n].pauseMs = 0;
+            if (source[pick].kind != STEP_NONE) currentProfile = source[pick].profile;
+        }
+        ordered[end].pauseMs = pauseMs;
+        start = end + 1;
+    }
+
+    memcpy(source, ordered, scene.stepCount * sizeof(SceneStep));
+
+    // Dentro de la escena cada paso Somfy usa el código siguiente al anterior
+    for (uint8_t i = 0; i < scene.stepCount; i++) {
+        source[i].codeOffset = 0;
+        if (source[i].kind != STEP_SOMFY) continue;
+        for (uint8_t j = 0; j < i; j++) {
+            if (source[j].kind == STEP_SOMFY && source[j].somfySlot == source[i].somfySlot) {
+                source[i].codeOffset++;
+            }
+        }
+    }
+}
+
+// Formas de onda Somfy para el rolling code vigente (desde loop(), nunca al ejecutar)
+void Scenes::encodeSomfy() {
+    PulseTrain* train = nullptr;
+    uint8_t encoded = 0;
+
+    for (uint8_t i = 0; i < somfyCount; i++) {
+        ::somfyRemotes.applyRollingCode(somfyRemotes[i].deviceId, &somfyRemotes[i].remote);
+    }
+
+    for (uint16_t i = 0; i < stepTotal; i++) {
+        SceneStep& step = steps[i];
+        if (step.kind != STEP_SOMFY) continue;
+
+        SomfyRemote remote = somfyRemotes[step.somfySlot].remote;
+        remote.rollingCode += step.codeOffset;
+        if (step.pulses && step.encodedCode == remote.rollingCode) continue;
+
+        if (!train) train = new PulseTrain();
+        somfyRTS.setRemote(&remote);
+        if (somfyRTS.encodeCommand(step.somfyCommand, *train) && storePulses(step, *train)) {
+            step.encodedCode = remote.rollingCode;
+            encoded++;
+        }
+    }
+
+    delete train;
+    if (encoded > 0) LOG_D("Scene", "%d pasos Somfy codificados", encoded);
+}
+
+void Scenes::loop() {
+    if (active >= 0) {
+        if ((long)(millis() - nextAt) >= 0) playSegment();
+        return;
+    }
+
+    // devices.json cambió: recompilar cuando deje de cambiar
+    uint32_t generation = storage.getCatalogGeneration();
+    if (generation != compiledGeneration) {
+        if (generation != seenGeneration) {
+            seenGeneration = generation;
+            seenAt = millis();
+        } else if (millis() - seenAt >= SCENE_RECOMPILE_DELAY_MS) {
+            compile();
+        }
+        return;
+    }
+
+    if (reencodePending) {
+        reencodePending = false;
+        encodeSomfy();
+    }
+}
+
+bool Scenes::run(const char* sceneId) {
+    int8_t index = find(sceneId);
+    if (index < 0) {
+        LOG_W("Scene", "Escena no encontrada: %s", sceneId);
+        return false;
+    }
+
+    if (active >= 0) {
+        LOG_W("Scene", "Escena '%s' en curso, se ignora '%s'", entries[active].id, sceneId);
+        return false;
+    }
+
+    // Catálogo modificado y aún sin recompilar: los rolling codes pueden estar viejos
+    if (storage.getCatalogGeneration() != compiledGeneration) {
+        LOG_I("Scene", "devices.json cambió, recompilando antes de ejecutar");
+        compile();
+        index = find(sceneId);
+        if (index < 0) return false;
+    }
+
+    active = index;
+    nextStep = 0;
+    nextAt = millis();
+    LOG_I("Scene", "Ejecutando '%s' (%d pasos)", entries[index].id, entries[index].stepCount);
+    return true;
+}
+
+// Un tramo: los pasos hasta la próxima pausa, en una ráfaga
+void Scenes::playSegment() {
+    Scene& scene = entries[active];
+    bool sent[MAX_SCENE_STEPS] = {};
+    uint8_t start = nextStep;
+    uint8_t sentCount = 0;
+    uint16_t pauseMs = 0;
+    unsigned long startedAt = millis();
+
+    rfModule.beginBurst();
+    while (nextStep < scene.stepCount) {
+        SceneStep& step = steps[scene.first + nextStep];
+        if (step.kind != STEP_NONE) {
+            if (sentCount > 0) delay(TX_SCHED_GAP_MS);
+            sent[nextStep] = playStep(step);
+            if (sent[nextStep]) sentCount++;
+        }
+        pauseMs = step.pauseMs;
+        nextStep++;
+        if (pauseMs > 0) break;
+    }
+    rfModule.endBurst();
+
+    LOG_I("Scene", "'%s': %d/%d pasos en %lu ms", scene.id, sentCount, nextStep - start, millis() - startedAt);
+
+    // Fuera del camino de TX: rolling codes y estado de cada paso
+    persistSomfy();
+    for (uint8_t i = start; i < nextStep; i++) {
+        if (sent[i] && onStep) onStep(steps[scene.first + i].deviceId, steps[scene.first + i].command);
+    }
+
+    if (nextStep >= scene.stepCount) {
+        active = -1;
+    } else {
+        nextAt = millis() + pauseMs;
+    }
+}
+
+bool Scenes::playStep(SceneStep& step) {
+    switch (step.kind) {
+        case STEP_RAW:
+            rfModule.setFrequency(step.frequency);
+            rfModule.setModulation(step.modulation);
+            return rfModule.transmitPulses(step.pulses, step.pulseCount);
+
+        case STEP_AOK:
+            return aokProtocol.transmitPulses(step.pulses, step.pulseCount);
+
+        case STEP_DOOYA:
+            return dooyaBidir.transmitFrame(step.frame);
+
+        case STEP_SOMFY: {
+            SomfySlot& slot = somfyRemotes[step.somfySlot];
+            bool success;
+
+            // Un control físico pudo adelantar el código después de encodeSomfy()
+            ::somfyRemotes.applyRollingCode(slot.deviceId, &slot.remote);
+
+            // Igual a Somfy directo: se toca solo la frecuencia, el pin es GDO0
+            rfModule.setFrequency(SOMFY_FREQUENCY);
+            if (step.pulses && step.encodedCode == slot.remote.rollingCode) {
+                success = somfyRTS.transmitPulses(step.pulses, step.pulseCount);
+            } else {
+                // Otra escena usó el control y encodeSomfy() aún no corrió
+                LOG_D("Scene", "Somfy %s codificado al ejecutar (RC=%d)", step.deviceId, slot.remote.rollingCode);
+                somfyRTS.setRemote(&slot.remote);
+                PulseTrain train;
+                success = somfyRTS.encodeCommand(step.somfyCommand, train) &&
+                          somfyRTS.transmitPulses(train.data(), train.size());
+            }
+
+            if (success) {
+                slot.remote.rollingCode++;
+                slot.dirty = true;
+                reencodePending = true;
+            }
+            return success;
+        }
+
+        default:
+            return false;
+    }
+}
+
+// Guarda los rolling codes usados. Si nadie más tocó devices.json desde la
+// compilación, la escritura propia no obliga a recompilar.
+void Scenes::persistSomfy() {
+    bool current = storage.getCatalogGeneration() == compiledGeneration;
+
+    for (uint8_t i = 0; i < somfyCount; i++) {
+        if (!somfyRemotes[i].dirty) continue;
+        storage.updateSomfyRollingCode(somfyRemotes[i].deviceId, somfyRemotes[i].remote.rollingCode);
+        somfyRemotes[i].dirty = false;
+    }
+
+    if (current) {
+        compiledGeneration = storage.getCatalogGeneration();
+        seenGeneration = compiledGeneration;
+    }
+}
+
+int8_t Scenes::find(const char* sceneId) const {
+    for (uint8_t i = 0; i < sceneCount; i++) {
+        if (strcmp(entries[i].id, sceneId) == 0) return i;
+    }
+    return -1;
+}
+
+const char* Scenes::getId(uint8_t index) const {
+    return index < sceneCount ? entries[index].id : nullptr;
+}
+
+const char* Scenes::getName(uint8_t index) const {
+    return index < sceneCount ? entries[index].name : nullptr;
+}
@@ -0,0 +1,307 @@
+#include "Schedules.h"
+#include "Storage.h"
+#include "BootManager.h"
+#include "DeviceGroups.h"
+#include "Scenes.h"
+#include "CoverPositions.h"
+#include "Logger.h"
+#include <math.h>
+
+Schedules schedules;
+
+Schedules::Schedules() {
+    sysConfig = nullptr;
+    ruleCount = 0;
+    heapCount = 0;
+    scheduled = false;
+    onCommand = nullptr;
+}
+
+bool Schedules::begin(SystemConfig* config) {
+    sysConfig = config;
+    return load();
+}
+
+bool Schedules::reload() {
+    return load();
+}
+
+// El próximo loop() con hora válida recalcula todos los disparos
+void Schedules::reschedule() {
+    scheduled = false;
+}
+
+const char* Schedules::getId(uint8_t index) const {
+    return index < ruleCount ? rules[index].id : "";
+}
+
+time_t Schedules::getNextFire(uint8_t index) const {
+    return index < ruleCount ? rules[index].nextFire : 0;
+}
+
+// ============================================
+// Carga de schedules.json
+// ============================================
+
+bool Schedules::load() {
+    ruleCount = 0;
+    heapCount = 0;
+    scheduled = false;
+
+    String json = storage.getSchedulesJson();
+    DynamicJsonDocument doc(SCHEDULES_JSON_SIZE);
+    if (deserializeJson(doc, json)) {
+        LOG_E("Sched", "schedules.json inválido");
+        return false;
+    }
+
+    JsonArray list = doc.as<JsonArray>();
+    for (size_t i = 0; i < list.size() && ruleCount < MAX_SCHEDULES; i++) {
+        JsonObject object = list[i];
+        if (!(object["enabled"] | true)) continue;
+
+        if (parseRule(object, rules[ruleCount])) {
+            ruleCount++;
+        } else {
+            LOG_W("Sched", "Regla '%s' inválida, se ignora", object["id"] | "");
+        }
+    }
+
+    LOG_I("Sched", "%d programaciones activas", ruleCount);
+    return true;
+}
+
+bool Schedules::parseRule(JsonObject object, Rule& rule) {
+    memset(&rule, 0, sizeof(rule));
+    strlcpy(rule.id, object["id"] | "", sizeof(rule.id));
+
+    const char* cron = object["cron"] | "";
+    if (strlen(cron) > 0) {
+        rule.kind = RULE_CRON;
+        if (!rule.cron.parse(cron)) return false;
+    } else {
+        const char* sun = object["sun"] | "";
+        if (strcmp(sun, "sunrise") == 0) rule.kind = RULE_SUNRISE;
+        else if (strcmp(sun, "sunset") == 0) rule.kind = RULE_SUNSET;
+        else return false;
+
+        rule.offsetMin = constrain((int)(object["offset"] | 0), -SCHEDULE_MAX_OFFSET_MIN, SCHEDULE_MAX_OFFSET_MIN);
+
+        uint64_t days = 0;
+        if (!CronSpec::parseField(object["days"] | "*", 0, 7, &days, &rule.cron.anyWeekday)) return false;
+        rule.cron.weekdays = (days | (days >> 7)) & 0x7F;   // 7 = domingo
+    }
+
+    static const char* const targets[] = {"device", "room", "group", "scene"};
+    bool found = false;
+    for (uint8_t i = 0; i < 4 && !found; i++) {
+        if (object.containsKey(targets[i])) {
+            rule.targetKind = i;
+            strlcpy(rule.target, object[targets[i]] | "", sizeof(rule.target));
+            found = true;
+        }
+    }
+    if (!found || rule.target[0] == '\0') return false;
+
+    strlcpy(rule.command, object["command"] | "", sizeof(rule.command));
+    rule.position = object.containsKey("position") ? constrain((int)object["position"], 0, 100) : -1;
+    if (rule.position >= 0 && rule.targetKind != TARGET_DEVICE) return false;
+    return rule.position >= 0 || rule.command[0] != '\0';
+}
+
+// ============================================
+// Próximo disparo
+// ============================================
+
+time_t Schedules::nextFire(const Rule& rule, time_t after) const {
+    return rule.kind == RULE_CRON ? rule.cron.next(after) : nextSun(rule, after);
+}
+
+time_t Schedules::nextSun(const Rule& rule, time_t after) const {
+    if (!sysConfig || (sysConfig->latitude == 0 && sysConfig->longitude == 0)) return 0;
+
+    // Desde el día anterior: un desplazamiento positivo puede caer hoy
+    time_t start = after - 86400;
+    struct tm date;
+    localtime_r(&start, &date);
+
+    for (uint16_t day = 0; day < 370; day++) {
+        // Mediodía: avanzar de día sin ambigüedades de DST
+        date.tm_hour = 12;
+        date.tm_min = 0;
+        date.tm_sec = 0;
+        date.tm_isdst = -1;
+        time_t noon = mktime(&date);
+        localtime_r(&noon, &date);
+
+        if (rule.cron.weekdays & (1 << date.tm_wday)) {
+            time_t event = sunEvent(date.tm_year + 1900, date.tm_mon + 1, date.tm_mday, date.tm_yday + 1,
+                                    sysConfig->latitude, sysConfig->longitude, rule.kind == RULE_SUNRISE);
+            if (event != 0) {
+                event += rule.offsetMin * 60;
+                if (event > after) return event;
+            }
+        }
+        date.tm_mday++;
+    }
+
+    return 0;
+}
+
+// Días desde 1970-01-01 para una fecha civil (calendario gregoriano)
+static long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yearOfEra = year - era * 400;
+    long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Algoritmo del Almanac for Computers (cenit oficial 90.833°), error ~1-2 min.
+// La hora UTC puede caer en el día UTC anterior o siguiente a la fecha local.
+time_t Schedules::sunEvent(int year, int month, int day, int dayOfYear,
+                           float latitude, float longitude, bool sunrise) {
+    const double rad = M_PI / 180.0;
+    double lngHour = longitude / 15.0;
+    double t = dayOfYear + ((sunrise ? 6.0 : 18.0) - lngHour) / 24.0;
+
+    // Anomalía media y longitud verdadera del sol
+    double M = 0.9856 * t - 3.289;
+    double L = fmod(M + 1.916 * sin(M * rad) + 0.020 * sin(2 * M * rad) + 282.634, 360.0);
+    if (L < 0) L += 360.0;
+
+    // Ascensión recta, en el mismo cuadrante que L
+    double RA = fmod(atan(0.91764 * tan(L * rad)) / rad + 360.0, 360.0);
+    RA += floor(L / 90.0) * 90.0 - floor(RA / 90.0) * 90.0;
+    RA /= 15.0;
+
+    double sinDec = 0.39782 * sin(L * rad);
+    double cosDec = cos(asin(sinDec));
+    double cosH = (cos(90.833 * rad) - sinDec * sin(latitude * rad)) / (cosDec * cos(latitude * rad));
+    if (cosH > 1.0 || cosH < -1.0) return 0;       // Noche o día polar
+
+    double H = (sunrise ? 360.0 - acos(cosH) / rad : acos(cosH) / rad) / 15.0;
+    double T = fmod(H + RA - 0.06571 * t - 6.622 + 48.0, 24.0);     // Hora solar media local
+    double ut = T - lngHour;
+
+    return (time_t)daysFromCivil(year, month, day) * 86400 + (time_t)lround(ut * 3600.0);
+}
+
+// ============================================
+// Min-heap por nextFire
+// ============================================
+
+bool Schedules::earlier(uint8_t a, uint8_t b) const {
+    return rules[heap[a]].nextFire < rules[heap[b]].nextFire;
+}
+
+void Schedules::siftUp(uint8_t position) {
+    while (position > 0) {
+        uint8_t parent = (position - 1) / 2;
+        if (!earlier(position, parent)) break;
+        uint8_t swap = heap[parent];
+        heap[parent] = heap[position];
+        heap[position] = swap;
+        position = parent;
+    }
+}
+
+void Schedules::siftDown(uint8_t position) {
+    while (true) {
+        uint8_t smallest = position;
+        uint8_t left = 2 * position + 1;
+        uint8_t right = left + 1;
+        if (left < heapCount && earlier(left, smallest)) smallest = left;
+        if (right < heapCount && earlier(right, smallest)) smallest = right;
+        if (smallest == position) return;
+
+        uint8_t swap = heap[smallest];
+        heap[smallest] = heap[position];
+        heap[position] = swap;
+        position = smallest;
+    }
+}
+
+void Schedules::schedule(time_t now) {
+    heapCount = 0;
+    for (uint8_t i = 0; i < ruleCount; i++) {
+        rules[i].nextFire = nextFire(rules[i], now);
+        if (rules[i].nextFire != 0) {
+            heap[heapCount] = i;
+            siftUp(heapCount++);
+        } else {
+            LOG_W("Sched", "'%s' sin próximo disparo", rules[i].id);
+        }
+    }
+    scheduled = true;
+
+    if (heapCount > 0) {
+        struct tm date;
+        char text[24];
+        localtime_r(&rules[heap[0]].nextFire, &date);
+        strftime(text, sizeof(text), "%d/%m/%Y %H:%M", &date);
+        LOG_I("Sched", "%d reglas en cola, próxima '%s' %s", heapCount, rules[heap[0]].id, text);
+    }
+}
+
+// Solo la raíz del heap: O(1) mientras no venza nada
+void Schedules::loop() {
+    if (ruleCount == 0) return;
+
+    if (!scheduled) {
+        if (!bootManager.isReady(BOOT_TIME_READY)) return;
+        schedule(time(nullptr));
+        return;
+    }
+
+    if (heapCount == 0) return;
+    time_t now = time(nullptr);
+    Rule& rule = rules[heap[0]];
+    if (now < rule.nextFire) return;
+
+    if (now - rule.nextFire <= SCHEDULE_MAX_LATE_S) {
+        fire(rule);
+    } else {
+        LOG_W("Sched", "'%s' omitida: %ld s de atraso", rule.id, (long)(now - rule.nextFire));
+    }
+
+    rule.nextFire = nextFire(rule, now);
+    if (rule.nextFire == 0) {
+        heap[0] = heap[--heapCount];
+    }
+    if (heapCount > 0) siftDown(0);
+}
+
+void Schedules::fire(const Rule& rule) {
+    if (!bootManager.isReady(BOOT_RADIO_READY)) {
+        LOG_W("Sched", "'%s': radio no disponible", rule.id);
+        return;
+    }
+
+    LOG_I("Sched", "Disparo '%s' -> %s", rule.id, rule.target);
+
+    bool done = false;
+    switch (rule.targetKind) {
+        case TARGET_DEVICE:
+            if (rule.position >= 0) {
+                done = coverPositions.setPosition(rule.target, rule.position);
+            } else {
+                SavedDevice device;
+                done = storage.getDevice(rule.target, &device) && device.enabled &&
+                       txScheduler.submit(&device, rule.command, onCommand);
+            }
+            break;
+        case TARGET_ROOM:
+            done = deviceGroups.sendToRoom(rule.target, rule.command, onCommand) > 0;
+            break;
+        case TARGET_GROUP:
+            done = deviceGroups.sendToGroup(rule.target, rule.command, onCommand) > 0;
+            break;
+        case TARGET_SCENE:
+            done = scenes.run(rule.target);
+            break;
+    }
+
+    if (!done) LOG_W("Sched", "'%s' sin efecto", rule.id);
+}
@@ -0,0 +1,294 @@
+#include "SignalIndex.h"
+#include "Storage.h"
+#include "AOK_Protocol.h"
+#include "PulseTrain.h"
+#include "Logger.h"
+
+SignalIndex signalIndex;
+
+SignalIndex::SignalIndex() {
+    memset(ids, 0, sizeof(ids));
+    memset(types, 0, sizeof(types));
+    memset(slots, 0, sizeof(slots));
+    idCount = 0;
+    entryCount = 0;
+    generation = 0;
+    stale = true;
+}
+
+void SignalIndex::begin() {
+    ensure();
+    LOG_I("Signals", "%d señales indexadas en %d dispositivos", entryCount, idCount);
+}
+
+// ============================================
+// Huella
+// ============================================
+
+static inline uint16_t durationAt(const RFSignal* signal, uint16_t index) {
+    return (signal->data[index * 2] << 8) | signal->data[index * 2 + 1];
+}
+
+// Misma huella para una captura guardada (bytes big endian) y para un
+// frame recibido por RxMonitor (duraciones): at(i) da la duración i
+template <typename Durations>
+static bool fingerprintOf(const Durations& at, uint16_t count, SignalFingerprint* out) {
+    if (count < SIGNAL_FP_MIN_SYMBOLS) return false;
+
+    // Primer frame completo: la captura puede empezar o cortarse a mitad de
+    // una repetición, así que se toma lo que hay entre los dos primeros
+    // separadores (o el tramo más largo si hay uno solo)
+    int16_t first = -1;
+    int16_t second = -1;
+    for (uint16_t i = 0; i < count; i++) {
+        if (at(i) < SIGNAL_FP_GAP_US) continue;
+        if (first < 0) {
+            first = i;
+        } else {
+            second = i;
+            break;
+        }
+    }
+
+    uint16_t start = 0;
+    uint16_t end = count;
+    if (second >= 0 && second - first - 1 >= SIGNAL_FP_MIN_SYMBOLS) {
+        start = first + 1;
+        end = second;
+    } else if (first >= 0) {
+        if (first >= count - first - 1) end = first;
+        else start = first + 1;
+    }
+
+    uint16_t symbols = end - start;
+    if (symbols < SIGNAL_FP_MIN_SYMBOLS || symbols > RF_MAX_SIGNAL_LENGTH / 2) return false;
+
+    // Duraciones ordenadas: un cluster nuevo empieza donde hay un salto de
+    // SIGNAL_FP_CLUSTER_RATIO entre dos consecutivas. El jitter llena el
+    // rango de cada cluster pero no el hueco entre T y 2T (o 3T).
+    uint16_t sorted[RF_MAX_SIGNAL_LENGTH / 2];
+    for (uint16_t i = 0; i < symbols; i++) {
+        uint16_t value = at(start + i);
+        uint16_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    uint16_t upper[SIGNAL_FP_MAX_CLUSTERS];
+    uint8_t clusters = 0;
+    uint32_t baseSum = 0;
+    uint16_t baseCount = 0;
+
+    for (uint16_t i = 0; i < symbols; i++) {
+        uint16_t value = sorted[i];
+        if (i == 0 || (uint32_t)value * 10 > (uint32_t)sorted[i - 1] * SIGNAL_FP_CLUSTER_RATIO) {
+            if (clusters >= SIGNAL_FP_MAX_CLUSTERS) return false;
+            clusters++;
+        }
+        upper[clusters - 1] = value;
+        if (clusters == 1) {
+            baseSum += value;
+            baseCount++;
+        }
+    }
+
+    // Secuencia de símbolos (índice de cluster) en el orden original
+    uint32_t hash = 2166136261UL;
+    for (uint16_t i = start; i < end; i++) {
+        uint16_t value = at(i);
+        uint8_t symbol = 0;
+        while (symbol + 1 < clusters && value > upper[symbol]) symbol++;
+        hash ^= symbol;
+        hash *= 16777619UL;
+    }
+
+    out->hash = hash;
+    out->base = baseSum / baseCount;
+    out->symbols = symbols;
+    out->clusters = clusters;
+    return true;
+}
+
+bool SignalIndex::fingerprint(const RFSignal* signal, SignalFingerprint* out) {
+    return fingerprintOf([signal](uint16_t i) { return durationAt(signal, i); },
+                         signal->length / 2, out);
+}
+
+bool SignalIndex::fingerprint(const uint16_t* durations, uint16_t count, SignalFingerprint* out) {
+    return fingerprintOf([durations](uint16_t i) { return durations[i]; }, count, out);
+}
+
+bool SignalIndex::matches(const SignalFingerprint& a, const SignalFingerprint& b) {
+    if (a.hash != b.hash || a.symbols != b.symbols || a.clusters != b.clusters) return false;
+
+    // Mismo patrón con otro timing (otro protocolo): el pulso base lo separa
+    uint16_t high = a.base > b.base ? a.base : b.base;
+    uint16_t low = a.base > b.base ? b.base : a.base;
+    return (uint32_t)(high - low) * 100 <= (uint32_t)high * SIGNAL_FP_BASE_TOLERANCE;
+}
+
+// ============================================
+// Índice
+// ============================================
+
+void SignalIndex::onDeviceChanged(const char* id, const SavedDevice* device) {
+    // Se aplica en el lugar solo si es el único cambio desde la última
+    // pasada (p.ej. guardar una señal); si no, ensure() recorre el catálogo
+    if (stale || !id || storage.getCatalogGeneration() != generation + 1 ||
+        (device && strcmp(id, device->id) != 0)) {
+        stale = true;
+        return;
+    }
+
+    remove(id);
+    if (device) add(device);
+    rehash();
+    generation++;
+}
+
+void SignalIndex::ensure() {
+    uint32_t catalog = storage.getCatalogGeneration();
+    if (!stale && generation == catalog) return;
+
+    memset(ids, 0, sizeof(ids));
+    idCount = 0;
+    entryCount = 0;
+    storage.forEachDevice(visit, this);
+    rehash();
+
+    generation = catalog;
+    stale = false;
+}
+
+bool SignalIndex::visit(const SavedDevice* device, void* context) {
+    ((SignalIndex*)context)->add(device);
+    return true;
+}
+
+void SignalIndex::add(const SavedDevice* device) {
+    SignalFingerprint fps[4];
+    uint8_t valid = 0;
+
+    if (device->type == DEVICE_CURTAIN_AOK) {
+        valid = aokFingerprints(device, fps);
+    } else {
+        for (uint8_t i = 0; i < 4; i++) {
+            const RFSignal& signal = device->signals[i];
+            if (signal.valid && fingerprint(&signal, &fps[i])) valid |= (1 << i);
+        }
+    }
+    if (valid == 0) return;
+
+    // Hueco libre (dispositivo borrado) o uno nuevo al final
+    uint8_t slot = 0;
+    while (slot < idCount && ids[slot][0] != '\0') slot++;
+    if (slot >= MAX_DEVICES) return;
+    if (slot == idCount) idCount++;
+    strlcpy(ids[slot], device->id, sizeof(ids[slot]));
+    types[slot] = device->type;
+
+    for (uint8_t i = 0; i < 4 && entryCount < SIGNAL_INDEX_MAX; i++) {
+        if (!(valid & (1 << i))) continue;
+
+        Entry& entry = entries[entryCount++];
+        entry.fp = fps[i];
+        entry.device = slot;
+        entry.signal = i;
+    }
+}
+
+// Subir/bajar/parar de una cortina A-OK como los emite su control: una
+// repetición sin el último LOW, que al recibir se funde con el silencio
+// entre repeticiones (igual que en una captura). Encoder local: el global
+// aokProtocol conserva el control del último envío
+uint8_t SignalIndex::aokFingerprints(const SavedDevice* device, SignalFingerprint* fps) {
+    static const uint8_t AOK_COMMANDS[] = { AOK_CMD_UP, AOK_CMD_DOWN, AOK_CMD_STOP };
+
+    AOK_Protocol encoder;
+    encoder.setRemoteId(device->aok.remoteId);
+    encoder.setChannel(device->aok.channel);
+
+    PulseTrain train;
+    uint16_t durations[PULSE_TRAIN_MAX_PULSES];
+    uint8_t valid = 0;
+
+    for (uint8_t i = 0; i < sizeof(AOK_COMMANDS); i++) {
+        if (!encoder.encodeCommand(AOK_COMMANDS[i], train)) continue;
+
+        uint16_t count = train.size();
+        if (count > 0 && !train.getLevel(count - 1)) count--;
+        for (uint16_t j = 0; j < count; j++) {
+            durations[j] = train.getDuration(j);
+        }
+        if (fingerprint(durations, count, &fps[i])) valid |= (1 << i);
+    }
+    return valid;
+}
+
+void SignalIndex::remove(const char* id) {
+    uint8_t slot = 0;
+    while (slot < idCount && strcmp(ids[slot], id) != 0) slot++;
+    if (slot >= idCount) return;
+
+    // El orden de las entradas no importa: la última ocupa el hueco
+    for (uint16_t i = 0; i < entryCount; ) {
+        if (entries[i].device == slot) entries[i] = entries[--entryCount];
+        else i++;
+    }
+
+    ids[slot][0] = '\0';
+    while (idCount > 0 && ids[idCount - 1][0] == '\0') idCount--;
+}
+
+// Tabla abierta por hash de la huella, reconstruida tras cada cambio
+void SignalIndex::rehash() {
+    memset(slots, 0, sizeof(slots));
+
+    for (uint16_t i = 0; i < entryCount; i++) {
+        // Sondeo lineal
+        uint16_t slot = entries[i].fp.hash & (SIGNAL_INDEX_SLOTS - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (SIGNAL_INDEX_SLOTS - 1);
+        }
+        slots[slot] = i + 1;
+    }
+}
+
+// O(1): solo se recorre la cadena de sondeo del hash (mismo hash con otro
+// pulso base o colisiones), nunca todo el índice
+uint8_t SignalIndex::find(const SignalFingerprint& fp, SignalMatch* out, uint8_t maxMatches) {
+    ensure();
+
+    uint8_t found = 0;
+    uint16_t slot = fp.hash & (SIGNAL_INDEX_SLOTS - 1);
+
+    while (slots[slot] != 0 && found < maxMatches) {
+        const Entry& entry = entries[slots[slot] - 1];
+        if (matches(entry.fp, fp)) {
+            out[found].deviceId = ids[entry.device];
+            out[found].type = types[entry.device];
+            out[found].signal = entry.signal;
+            found++;
+        }
+        slot = (slot + 1) & (SIGNAL_INDEX_SLOTS - 1);
+    }
+    return found;
+}
+
+uint16_t SignalIndex::getCount() {
+    ensure();
+    return entryCount;
+}
+
+bool SignalIndex::getEntry(uint16_t index, SignalMatch* match, SignalFingerprint* fp) {
+    if (index >= entryCount) return false;
+
+    match->deviceId = ids[entries[index].device];
+    match->type = types[entries[index].device];
+    match->signal = entries[index].signal;
+    if (fp) *fp = entries[index].fp;
+    return true;
+}
@@ -1,4 +1,8 @@
 #include "SomfyRTS.h"
+#include "CC1101_RF.h"
+#include "TxTiming.h"
+#include "Metrics.h"
+#include "Logger.h"
 
 // Instancia global
 SomfyRTS somfyRTS;
@@ -25,8 +29,8 @@ void SomfyRTS::setRemote(uint32_t address, uint16_t rollingCode, uint8_t key) {
     remoteAddress = address & 0xFFFFFF;  // Solo 24 bits
     currentRollingCode = rollingCode;
     encryptionKey = key & 0x0F;  // Solo 4 bits para el key
-    Serial.printf("[SomfyRTS] Configurado: Address=0x%06X, RC=%d, Key=0x%X\n",
-                  remoteAddress, currentRollingCode, encryptionKey);
+    LOG_D("SomfyRTS", "Configurado: Address=0x%06X, RC=%d, Key=0x%X",
+          remoteAddress, currentRollingCode, encryptionKey);
 }
 
 void SomfyRTS::setRemote(const SomfyRemote* remote) {
@@ -53,50 +57,76 @@ bool SomfyRTS::sendProg() {
 
 bool SomfyRTS::sendCommand(uint8_t command) {
     if (!initialized) {
-        Serial.println("[SomfyRTS] Error: No inicializado");
+        LOG_E("SomfyRTS", "Error: No inicializado");
         return false;
     }
 
     if (remoteAddress == 0) {
-        Serial.println("[SomfyRTS] Error: No hay dirección configurada");
+        LOG_E("SomfyRTS", "Error: No hay dirección configurada");
         return false;
     }
 
-    Serial.printf("[SomfyRTS] Enviando comando 0x%X (RC=%d)\n", command, currentRollingCode);
+    LOG_I("SomfyRTS", "Enviando comando 0x%X (RC=%d)", command, currentRollingCode);
 
-    // Construir el frame
-    buildFrame(command);
+    // Generar la forma de onda completa antes de transmitir
+    PulseTrain train;
+    if (!encodeCommand(command, train)) {
+        LOG_E("SomfyRTS", "Error: forma de onda excede el buffer");
+        return false;
+    }
 
-    // Ofuscar el frame
-    obfuscateFrame();
+    transmitPulses(train.data(), train.size());
+
+    // Incrementar rolling code para próximo uso
+    incrementRollingCode();
+
+    LOG_D("SomfyRTS", "Comando enviado OK");
+    return true;
+}
+
+bool SomfyRTS::transmitPulses(const uint32_t* pulses, uint16_t count) {
+    if (!initialized) {
+        LOG_E("SomfyRTS", "Error: No inicializado");
+        return false;
+    }
+
+    // Somfy sale por GDO0, la misma línea que usa la escucha continua
+    rfModule.suspendListening();
+    pinMode(txPin, OUTPUT);
+
+    metrics.txStarted();
+    txTiming.arm(txPin);
 
     // Deshabilitar interrupciones para timing preciso
     noInterrupts();
+    PulseTrain::play(txPin, pulses, count);
+    interrupts();
+
+    metrics.txFinished(true);
+    txTiming.measure(pulses, count);
+    return true;
+}
+
+bool SomfyRTS::encodeCommand(uint8_t command, PulseTrain& train) {
+    // Construir y ofuscar el frame con el rolling code actual
+    buildFrame(command);
+    obfuscateFrame();
 
-    // Transmitir primer frame (con 2 hardware syncs = wakeup)
-    transmitFrame(true);
+    train.clear();
 
-    // Esperar gap inter-frame
-    delayMicrosecondsPrecise(SOMFY_INTER_FRAME_GAP);
+    // Primer frame (con 2 hardware syncs = wakeup) + gap inter-frame
+    encodeFrame(true, train);
+    train.low(SOMFY_INTER_FRAME_GAP);
 
-    // Transmitir frames de repetición
+    // Frames de repetición
     for (int i = 0; i < SOMFY_TOTAL_FRAMES - 1; i++) {
-        transmitFrame(false);
+        encodeFrame(false, train);
         if (i < SOMFY_TOTAL_FRAMES - 2) {
-            delayMicrosecondsPrecise(SOMFY_INTER_FRAME_GAP);
+            train.low(SOMFY_INTER_FRAME_GAP);
         }
     }
 
-    // Restaurar interrupciones
-    interrupts();
-
-    digitalWrite(txPin, LOW);
-
-    // Incrementar rolling code para próximo uso
-    incrementRollingCode();
-
-    Serial.println("[SomfyRTS] Comando enviado OK");
-    return true;
+    return !train.isOverflowed();
 }
 
 void SomfyRTS::buildFrame(uint8_t command) {
@@ -137,11 +167,11 @@ void SomfyRTS::buildFrame(uint8_t command) {
     frameBuffer[1] |= checksum;
 
     // Debug: mostrar frame antes de ofuscar
-    Serial.print("[SomfyRTS] Frame (claro): ");
-    for (int i = 0; i < SOMFY_FRAME_LENGTH; i++) {
-        Serial.printf("%02X ", frameBuffer[i]);
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        char hex[SOMFY_FRAME_LENGTH * 3 + 1];
+        Logger::formatHex(hex, sizeof(hex), frameBuffer, SOMFY_FRAME_LENGTH);
+        LOG_D("SomfyRTS", "Frame (claro): %s", hex);
     }
-    Serial.println();
 }
 
 void SomfyRTS::obfuscateFrame() {
@@ -152,83 +182,113 @@ void SomfyRTS::obfuscateFrame() {
     }
 
     // Debug: mostrar frame ofuscado
-    Serial.print("[SomfyRTS] Frame (ofuscado): ");
-    for (int i = 0; i < SOMFY_FRAME_LENGTH; i++) {
-        Serial.printf("%02X ", frameBuffer[i]);
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+        char hex[SOMFY_FRAME_LENGTH * 3 + 1];
+        Logger::formatHex(hex, sizeof(hex), frameBuffer, SOMFY_FRAME_LENGTH);
+        LOG_D("SomfyRTS", "Frame (ofuscado): %s", hex);
     }
-    Serial.println();
 }
 
-void SomfyRTS::transmitFrame(bool isFirstFrame) {
-    // Enviar hardware sync
-    int hwSyncCount = isFirstFrame ? SOMFY_FIRST_FRAME_REPS * 2 : SOMFY_REPEAT_REPS;
-    sendHardwareSync(hwSyncCount);
+void SomfyRTS::deobfuscateFrame(uint8_t* frame) {
+    // Inversa de obfuscateFrame(): cada byte XOR con el anterior todavía
+    // ofuscado, así que se recorre desde el final
+    for (int i = SOMFY_FRAME_LENGTH - 1; i > 0; i--) {
+        frame[i] ^= frame[i - 1];
+    }
+}
 
-    // Enviar software sync
-    sendSoftwareSync();
+bool SomfyRTS::decodeFrame(const uint8_t* raw, SomfyFrame* out) {
+    uint8_t frame[SOMFY_FRAME_LENGTH];
+    memcpy(frame, raw, SOMFY_FRAME_LENGTH);
+    deobfuscateFrame(frame);
 
-    // Enviar datos (Manchester encoding)
-    // En Manchester: 0 = LOW->HIGH, 1 = HIGH->LOW (o viceversa según convención)
-    // Somfy usa: 0 = rising edge, 1 = falling edge
+    // El checksum de buildFrame() deja en 0 el XOR de todos los nibbles
+    uint8_t checksum = 0;
     for (int i = 0; i < SOMFY_FRAME_LENGTH; i++) {
-        uint8_t byte = frameBuffer[i];
-        for (int bit = 7; bit >= 0; bit--) {
-            sendBit((byte >> bit) & 1);
-        }
+        checksum ^= frame[i] ^ (frame[i] >> 4);
     }
+    if ((checksum & 0x0F) != 0) return false;
 
-    digitalWrite(txPin, LOW);
+    // Los controles Somfy mandan siempre 0xA en el nibble alto de la clave:
+    // descarta ruido que por azar pasa el checksum de 4 bits
+    if ((frame[0] >> 4) != 0x0A) return false;
+
+    out->key = frame[0];
+    out->command = frame[1] >> 4;
+    out->rollingCode = (frame[2] << 8) | frame[3];
+    out->address = frame[4] | (frame[5] << 8) | ((uint32_t)frame[6] << 16);
+    return true;
 }
 
-void SomfyRTS::sendBit(bool bit) {
-    // Manchester encoding para Somfy RTS
-    // Bit 0: LOW durante half-symbol, HIGH durante half-symbol (rising edge en medio)
-    // Bit 1: HIGH durante half-symbol, LOW durante half-symbol (falling edge en medio)
+bool SomfyRTS::decodePulses(const uint16_t* durations, uint16_t count, SomfyFrame* out) {
+    // Medios símbolos: niveles alternados empezando en LOW (el sync por
+    // software es el separador, su LOW de 604us abre el frame)
+    const uint16_t BITS = SOMFY_FRAME_LENGTH * 8;
+    uint8_t halves[1 + BITS * 2];
+    uint16_t n = 0;
+    bool level = false;
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t duration = durations[i];
+        uint8_t units;
+        if (duration >= SOMFY_RX_HALF_MIN && duration <= SOMFY_RX_HALF_MAX) units = 1;
+        else if (duration > SOMFY_RX_HALF_MAX && duration <= SOMFY_RX_FULL_MAX) units = 2;
+        else return false;
+
+        for (uint8_t u = 0; u < units; u++) {
+            if (n >= sizeof(halves)) return false;
+            halves[n++] = level;
+        }
+        level = !level;
+    }
 
-    if (bit) {
-        // Bit 1: HIGH -> LOW
-        digitalWrite(txPin, HIGH);
-        delayMicrosecondsPrecise(SOMFY_SYMBOL_WIDTH);
-        digitalWrite(txPin, LOW);
-        delayMicrosecondsPrecise(SOMFY_SYMBOL_WIDTH);
-    } else {
-        // Bit 0: LOW -> HIGH
-        digitalWrite(txPin, LOW);
-        delayMicrosecondsPrecise(SOMFY_SYMBOL_WIDTH);
-        digitalWrite(txPin, HIGH);
-        delayMicrosecondsPrecise(SOMFY_SYMBOL_WIDTH);
+    // Si el último bit es 1 su medio LOW se funde con el silencio siguiente
+    if (n == sizeof(halves) - 1) {
+        halves[n] = !halves[n - 1];
+        n++;
+    }
+    if (n != sizeof(halves)) return false;
+
+    // Manchester: 1 = HIGH-LOW, 0 = LOW-HIGH; dos medios iguales no son un bit
+    uint8_t raw[SOMFY_FRAME_LENGTH] = {0};
+    for (uint16_t bit = 0; bit < BITS; bit++) {
+        uint8_t first = halves[1 + bit * 2];
+        uint8_t second = halves[2 + bit * 2];
+        if (first == second) return false;
+        if (first) raw[bit / 8] |= 0x80 >> (bit % 8);
     }
+
+    return decodeFrame(raw, out);
 }
 
-void SomfyRTS::sendHardwareSync(int count) {
+void SomfyRTS::encodeFrame(bool isFirstFrame, PulseTrain& train) {
     // Hardware sync: pulsos high/low de 2416us cada uno
-    for (int i = 0; i < count; i++) {
-        digitalWrite(txPin, HIGH);
-        delayMicrosecondsPrecise(SOMFY_HWSYNC_HIGH);
-        digitalWrite(txPin, LOW);
-        delayMicrosecondsPrecise(SOMFY_HWSYNC_LOW);
+    int hwSyncCount = isFirstFrame ? SOMFY_FIRST_FRAME_REPS * 2 : SOMFY_REPEAT_REPS;
+    for (int i = 0; i < hwSyncCount; i++) {
+        train.high(SOMFY_HWSYNC_HIGH);
+        train.low(SOMFY_HWSYNC_LOW);
     }
-}
 
-void SomfyRTS::sendSoftwareSync() {
     // Software sync: 4550us HIGH + 604us LOW
-    digitalWrite(txPin, HIGH);
-    delayMicrosecondsPrecise(SOMFY_SWSYNC_HIGH);
-    digitalWrite(txPin, LOW);
-    delayMicrosecondsPrecise(SOMFY_SWSYNC_LOW);
+    train.high(SOMFY_SWSYNC_HIGH);
+    train.low(SOMFY_SWSYNC_LOW);
+
+    // Datos en Manchester (Somfy usa: 0 = rising edge, 1 = falling edge)
+    // Bit 0: LOW durante half-symbol, HIGH durante half-symbol
+    // Bit 1: HIGH durante half-symbol, LOW durante half-symbol
+    for (int i = 0; i < SOMFY_FRAME_LENGTH; i++) {
+        uint8_t byte = frameBuffer[i];
+        for (int bit = 7; bit >= 0; bit--) {
+            bool value = (byte >> bit) & 1;
+            train.add(value, SOMFY_SYMBOL_WIDTH);
+            train.add(!value, SOMFY_SYMBOL_WIDTH);
+        }
+    }
 }
 
 void SomfyRTS::incrementRollingCode() {
     currentRollingCode++;
-    Serial.printf("[SomfyRTS] Rolling code incrementado a %d\n", currentRollingCode);
-}
-
-void SomfyRTS::delayMicrosecondsPrecise(unsigned long us) {
-    // Para timings muy precisos en ESP32
-    unsigned long start = micros();
-    while (micros() - start < us) {
-        // Spin wait
-    }
+    LOG_D("SomfyRTS", "Rolling code incrementado a %d", currentRollingCode);
 }
 
 String SomfyRTS::getStatusString() {
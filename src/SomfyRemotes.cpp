@@ -0,0 +1,213 @@
+#include "SomfyRemotes.h"
+#include "Storage.h"
+#include "Logger.h"
+
+SomfyRemotes somfyRemotes;
+
+SomfyRemotes::SomfyRemotes() {
+    memset(remotes, 0, sizeof(remotes));
+    memset(devices, 0, sizeof(devices));
+    count = 0;
+    deviceCount = 0;
+    generation = 0;
+    stale = true;
+    dirty = false;
+    saveAt = 0;
+}
+
+void SomfyRemotes::begin() {
+    ensure();
+    LOG_I("SomfyRTS", "%d cortinas Somfy para controles físicos", deviceCount);
+}
+
+void SomfyRemotes::loop() {
+    if (dirty && (long)(millis() - saveAt) >= 0) {
+        flush();
+    }
+}
+
+void SomfyRemotes::flush() {
+    if (!dirty) return;
+    dirty = false;
+
+    for (uint8_t i = 0; i < deviceCount; ) {
+        Device& device = devices[i];
+        if (!device.pending) {
+            i++;
+            continue;
+        }
+        device.pending = false;
+
+        // Guardar reordena la tabla (onDeviceChanged): se vuelve a recorrer.
+        // Un envío pudo guardar antes un código más nuevo
+        char id[sizeof(device.id)];
+        strlcpy(id, device.id, sizeof(id));
+        storage.updateSomfyRollingCode(id, device.rollingCode, true);
+        i = 0;
+    }
+}
+
+// ============================================
+// Controles escuchados
+// ============================================
+
+bool SomfyRemotes::track(const SomfyFrame& frame) {
+    unsigned long now = millis();
+
+    uint8_t index = 0;
+    while (index < count && remotes[index].address != frame.address) index++;
+
+    if (index < count) {
+        // Diferencia con signo: el rolling code da la vuelta en 0xFFFF
+        int16_t ahead = (int16_t)(frame.rollingCode - remotes[index].rollingCode);
+        remotes[index].lastSeen = now;
+        if (ahead <= 0) return false;
+    } else if (count < SOMFY_REMOTES_MAX) {
+        count++;
+    } else {
+        // Tabla llena: se reemplaza el control escuchado hace más tiempo
+        index = 0;
+        for (uint8_t i = 1; i < count; i++) {
+            if (now - remotes[i].lastSeen > now - remotes[index].lastSeen) index = i;
+        }
+    }
+
+    SomfyRemoteSeen& remote = remotes[index];
+    remote.address = frame.address;
+    remote.rollingCode = frame.rollingCode;
+    remote.command = frame.command;
+    remote.lastSeen = now;
+
+    syncRollingCode(frame.address, frame.rollingCode);
+    return true;
+}
+
+const SomfyRemoteSeen* SomfyRemotes::get(uint8_t index) const {
+    return index < count ? &remotes[index] : nullptr;
+}
+
+// El motor ya vio rollingCode: el control virtual con la misma dirección
+// tiene que seguir desde el siguiente. Una pulsación no escribe
+// devices.json: las de SOMFY_RC_SAVE_MS se guardan juntas
+void SomfyRemotes::syncRollingCode(uint32_t address, uint16_t rollingCode) {
+    ensure();
+
+    uint16_t next = rollingCode + 1;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        Device& device = devices[i];
+        if (device.address != address || (int16_t)(next - device.rollingCode) <= 0) continue;
+
+        LOG_I("SomfyRTS", "%s: rolling code %u -> %u (control físico)", device.id, device.rollingCode, next);
+        device.rollingCode = next;
+        device.pending = true;
+
+        // El plazo no se corre con cada pulsación
+        if (!dirty) {
+            dirty = true;
+            saveAt = millis() + SOMFY_RC_SAVE_MS;
+        }
+    }
+}
+
+void SomfyRemotes::applyRollingCode(const char* id, SomfyRemote* remote) const {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        const Device& device = devices[i];
+        if (!device.pending || strcmp(device.id, id) != 0) continue;
+        if ((int16_t)(device.rollingCode - remote->rollingCode) > 0) remote->rollingCode = device.rollingCode;
+        return;
+    }
+}
+
+// ============================================
+// Cortinas Somfy del catálogo
+// ============================================
+
+void SomfyRemotes::onDeviceChanged(const char* id, const SavedDevice* device) {
+    // Se aplica en el lugar solo si es el único cambio desde la última
+    // pasada (p.ej. el rolling code tras un envío); si no, ensure()
+    if (stale || !id || storage.getCatalogGeneration() != generation + 1 ||
+        (device && strcmp(id, device->id) != 0)) {
+        stale = true;
+        return;
+    }
+
+    // Un código adelantado sin guardar sigue valiendo si es más nuevo que
+    // el guardado (p.ej. un envío encolado antes de la pulsación)
+    Device* entry = find(id);
+    bool pending = entry && entry->pending;
+    uint16_t pendingCode = pending ? entry->rollingCode : 0;
+
+    remove(id);
+    if (device) add(device);
+    generation++;
+
+    entry = pending ? find(id) : nullptr;
+    if (entry && (int16_t)(pendingCode - entry->rollingCode) > 0) {
+        entry->rollingCode = pendingCode;
+        entry->pending = true;
+    }
+}
+
+uint8_t SomfyRemotes::findDevices(uint32_t address, const char** ids, uint8_t maxIds) {
+    ensure();
+
+    uint8_t found = 0;
+    for (uint8_t i = 0; i < deviceCount && found < maxIds; i++) {
+        if (devices[i].address == address) ids[found++] = devices[i].id;
+    }
+    return found;
+}
+
+bool SomfyRemotes::hasDevices() {
+    ensure();
+    return deviceCount > 0;
+}
+
+void SomfyRemotes::ensure() {
+    uint32_t catalog = storage.getCatalogGeneration();
+    if (!stale && generation == catalog) return;
+
+    // La tabla se rearma desde devices.json: antes se guarda lo pendiente
+    if (dirty) {
+        flush();
+        catalog = storage.getCatalogGeneration();
+    }
+
+    deviceCount = 0;
+    storage.forEachDevice(visit, this);
+
+    generation = catalog;
+    stale = false;
+}
+
+bool SomfyRemotes::visit(const SavedDevice* device, void* context) {
+    ((SomfyRemotes*)context)->add(device);
+    return true;
+}
+
+void SomfyRemotes::add(const SavedDevice* device) {
+    if (device->type != DEVICE_CURTAIN_SOMFY || deviceCount >= MAX_DEVICES) return;
+
+    Device& entry = devices[deviceCount++];
+    strlcpy(entry.id, device->id, sizeof(entry.id));
+    entry.address = device->somfy.address;
+    entry.rollingCode = device->somfy.rollingCode;
+    entry.pending = false;
+}
+
+SomfyRemotes::Device* SomfyRemotes::find(const char* id) {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (strcmp(devices[i].id, id) == 0) return &devices[i];
+    }
+    return nullptr;
+}
+
+// El orden no importa: el último ocupa el hueco
+void SomfyRemotes::remove(const char* id) {
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        if (strcmp(devices[i].id, id) == 0) {
+            devices[i] = devices[--deviceCount];
+            return;
+        }
+    }
+}
@@ -1,10 +1,61 @@
 #include "Storage.h"
+#include "Metrics.h"
+#include "HeapMonitor.h"
 #include <WiFi.h>
 
 StorageManager storage;
 
+// CRC-32 (IEEE 802.3) incremental, sin tabla para no ocupar RAM
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+// Print que reenvía a un archivo y acumula CRC y tamaño de lo escrito,
+// para generar la cabecera del catálogo sin releer devices.json
+class CatalogWriter : public Print {
+public:
+    CatalogWriter(Print& out) : out(out), crc(0xFFFFFFFF), size(0) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t length) override {
+        size_t n = out.write(buffer, length);
+        crc = crc32Update(crc, buffer, n);
+        size += n;
+        return n;
+    }
+
+    uint32_t getCrc() const { return crc ^ 0xFFFFFFFF; }
+    size_t getSize() const { return size; }
+
+private:
+    Print& out;
+    uint32_t crc;
+    size_t size;
+};
+
+static uint32_t fileCrc(File& file) {
+    uint8_t buffer[128];
+    uint32_t crc = 0xFFFFFFFF;
+    size_t n;
+    while ((n = file.read(buffer, sizeof(buffer))) > 0) {
+        crc = crc32Update(crc, buffer, n);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
 StorageManager::StorageManager() {
     initialized = false;
+    catalogCount = 0;
+    catalogGeneration = 0;
+    catalogCrc = 0;
+    catalogSize = 0;
+    onDeviceChange = nullptr;
 }
 
 bool StorageManager::begin() {
@@ -26,12 +77,18 @@ bool StorageManager::begin() {
     Serial.printf("[Storage] LittleFS montado. Espacio: %d/%d bytes\n",
                   getTotalSpace() - getFreeSpace(), getTotalSpace());
 
+    loadCatalog();
+
     return true;
 }
 
 bool StorageManager::format() {
     Serial.println("[Storage] Formateando sistema de archivos...");
-    return LittleFS.format();
+    catalogCount = 0;
+    catalogSize = 0;
+    bool ok = LittleFS.format();
+    notifyDeviceChange(nullptr, nullptr);
+    return ok;
 }
 
 bool StorageManager::clearUserData() {
@@ -58,6 +115,30 @@ bool StorageManager::clearUserData() {
             success = false;
         }
     }
+    if (fileExists(CATALOG_FILE)) {
+        LittleFS.remove(CATALOG_FILE);
+    }
+    if (fileExists(DISCOVERY_FILE)) {
+        LittleFS.remove(DISCOVERY_FILE);
+    }
+    if (fileExists(GROUPS_FILE)) {
+        LittleFS.remove(GROUPS_FILE);
+    }
+    if (fileExists(SCENES_FILE)) {
+        LittleFS.remove(SCENES_FILE);
+    }
+    if (fileExists(POSITIONS_FILE)) {
+        LittleFS.remove(POSITIONS_FILE);
+    }
+    if (fileExists(SCHEDULES_FILE)) {
+        LittleFS.remove(SCHEDULES_FILE);
+    }
+    if (fileExists(STATES_FILE)) {
+        LittleFS.remove(STATES_FILE);
+    }
+    catalogCount = 0;
+    catalogSize = 0;
+    notifyDeviceChange(nullptr, nullptr);
 
     Serial.println("[Storage] Datos de usuario borrados (archivos web preservados)");
     return success;
@@ -90,6 +171,8 @@ void StorageManager::setDefaultConfig(SystemConfig* config) {
     strcpy(config->ntp_server, DEFAULT_NTP_SERVER);
     config->utc_offset = -5; // Colombia/Peru (GMT-5)
     config->dst_enabled = false;
+    config->latitude = 0;
+    config->longitude = 0;
 
     config->default_frequency = RF_DEFAULT_FREQUENCY;
     config->default_modulation = 2; // ASK/OOK
@@ -101,6 +184,8 @@ void StorageManager::setDefaultConfig(SystemConfig* config) {
 
 bool StorageManager::loadConfig(SystemConfig* config) {
     if (!initialized) return false;
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
 
     if (!fileExists(CONFIG_FILE)) {
         Serial.println("[Storage] Archivo de config no existe, creando default...");
@@ -111,16 +196,22 @@ bool StorageManager::loadConfig(SystemConfig* config) {
     File file = LittleFS.open(CONFIG_FILE, "r");
     if (!file) {
         Serial.println("[Storage] Error al abrir archivo de config");
+        metrics.increment(METRIC_STORAGE_ERRORS);
         setDefaultConfig(config);
         return false;
     }
 
     DynamicJsonDocument doc(2048);
-    DeserializationError error = deserializeJson(doc, file);
+    DeserializationError error;
+    {
+        MetricScope parseScope(METRIC_JSON_PARSE_US);
+        error = deserializeJson(doc, file);
+    }
     file.close();
 
     if (error) {
         Serial.printf("[Storage] Error JSON: %s\n", error.c_str());
+        metrics.increment(METRIC_JSON_ERRORS);
         setDefaultConfig(config);
         return false;
     }
@@ -146,6 +237,8 @@ bool StorageManager::loadConfig(SystemConfig* config) {
 
 bool StorageManager::saveConfig(const SystemConfig* config) {
     if (!initialized) return false;
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
 
     DynamicJsonDocument doc(2048);
     JsonObject obj = doc.to<JsonObject>();
@@ -154,6 +247,7 @@ bool StorageManager::saveConfig(const SystemConfig* config) {
     File file = LittleFS.open(CONFIG_FILE, "w");
     if (!file) {
         Serial.println("[Storage] Error al crear archivo de config");
+        metrics.increment(METRIC_STORAGE_ERRORS);
         return false;
     }
 
@@ -164,8 +258,10 @@ bool StorageManager::saveConfig(const SystemConfig* config) {
     return true;
 }
 
-bool StorageManager::loadDevices(SavedDevice* devices, uint8_t* count) {
+bool StorageManager::loadDevices(SavedDevice* devices, uint16_t* count) {
     if (!initialized) return false;
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
 
     *count = 0;
 
@@ -177,91 +273,109 @@ bool StorageManager::loadDevices(SavedDevice* devices, uint8_t* count) {
     File file = LittleFS.open(DEVICES_FILE, "r");
     if (!file) {
         Serial.println("[Storage] Error al abrir archivo de dispositivos");
+        metrics.increment(METRIC_STORAGE_ERRORS);
         return false;
     }
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
-
-    if (error) {
-        Serial.printf("[Storage] Error JSON dispositivos: %s\n", error.c_str());
-        return false;
-    }
-
-    JsonArray arr = doc.as<JsonArray>();
-    uint8_t idx = 0;
-
-    for (JsonObject obj : arr) {
-        if (idx >= MAX_DEVICES) break;
-        jsonToDevice(obj, &devices[idx]);
-        idx++;
+    // Leer elemento por elemento: memoria acotada por un solo registro
+    uint16_t idx = 0;
+    bool ok = true;
+    file.setTimeout(0);
+
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (idx >= MAX_DEVICES) break;
+            if (!readDeviceAt(file, &devices[idx])) {
+                ok = false;
+                break;
+            }
+            idx++;
+        } while (file.findUntil(",", "]"));
     }
+    file.close();
 
     *count = idx;
     Serial.printf("[Storage] %d dispositivos cargados\n", *count);
-    return true;
+    return ok;
 }
 
-bool StorageManager::saveDevices(const SavedDevice* devices, uint8_t count) {
+bool StorageManager::forEachDevice(bool (*visitor)(const SavedDevice* device, void* context), void* context) {
     if (!initialized) return false;
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    JsonArray arr = doc.to<JsonArray>();
-
-    for (uint8_t i = 0; i < count; i++) {
-        JsonObject obj = arr.createNestedObject();
-        deviceToJson(obj, &devices[i]);
-    }
+    if (!fileExists(DEVICES_FILE)) return true;
 
-    File file = LittleFS.open(DEVICES_FILE, "w");
+    File file = LittleFS.open(DEVICES_FILE, "r");
     if (!file) {
-        Serial.println("[Storage] Error al crear archivo de dispositivos");
+        metrics.increment(METRIC_STORAGE_ERRORS);
         return false;
     }
 
-    serializeJson(doc, file);
+    // Un único registro en memoria, reutilizado para cada elemento
+    SavedDevice device;
+    bool ok = true;
+    file.setTimeout(0);
+
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (!readDeviceAt(file, &device)) {
+                ok = false;
+                break;
+            }
+            if (!visitor(&device, context)) break;
+        } while (file.findUntil(",", "]"));
+    }
     file.close();
 
-    Serial.printf("[Storage] %d dispositivos guardados\n", count);
-    return true;
+    return ok;
 }
 
-bool StorageManager::addDevice(const SavedDevice* device) {
+bool StorageManager::saveDevices(const SavedDevice* devices, uint16_t count) {
     if (!initialized) return false;
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
 
-    // Leer archivo JSON existente
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
+    File file = LittleFS.open(DEVICES_TMP_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al crear archivo de dispositivos");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
 
-    if (fileExists(DEVICES_FILE)) {
-        File file = LittleFS.open(DEVICES_FILE, "r");
-        if (file) {
-            deserializeJson(doc, file);
+    CatalogWriter writer(file);
+    writer.print('[');
+    for (uint16_t i = 0; i < count; i++) {
+        if (i > 0) writer.print(',');
+        if (!writeDeviceJson(writer, &devices[i])) {
             file.close();
+            LittleFS.remove(DEVICES_TMP_FILE);
+            return false;
         }
     }
+    writer.print(']');
+    file.close();
+
+    if (!commitDevicesFile(count, writer.getCrc(), writer.getSize())) return false;
+    notifyDeviceChange(nullptr, nullptr);
 
-    JsonArray arr = doc.is<JsonArray>() ? doc.as<JsonArray>() : doc.to<JsonArray>();
+    Serial.printf("[Storage] %d dispositivos guardados\n", count);
+    return true;
+}
+
+bool StorageManager::addDevice(const SavedDevice* device) {
+    if (!initialized) return false;
 
-    if (arr.size() >= MAX_DEVICES) {
+    if (getDeviceCount() >= MAX_DEVICES) {
         Serial.println("[Storage] Máximo de dispositivos alcanzado");
         return false;
     }
 
-    // Agregar nuevo dispositivo al JSON
-    JsonObject obj = arr.createNestedObject();
-    deviceToJson(obj, device);
-
-    // Guardar
-    File file = LittleFS.open(DEVICES_FILE, "w");
-    if (!file) {
+    if (!rewriteDevices(nullptr, device)) {
         Serial.println("[Storage] Error al guardar dispositivo");
         return false;
     }
 
-    serializeJson(doc, file);
-    file.close();
-
     Serial.printf("[Storage] Dispositivo agregado: %s\n", device->name);
     return true;
 }
@@ -269,140 +383,454 @@ bool StorageManager::addDevice(const SavedDevice* device) {
 bool StorageManager::updateDevice(const char* id, const SavedDevice* device) {
     if (!initialized || !fileExists(DEVICES_FILE)) return false;
 
-    // Leer archivo JSON
-    File file = LittleFS.open(DEVICES_FILE, "r");
-    if (!file) return false;
+    if (!rewriteDevices(id, device)) return false;
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    Serial.printf("[Storage] Dispositivo actualizado: %s\n", id);
+    return true;
+}
 
-    if (error) return false;
+bool StorageManager::deleteDevice(const char* id) {
+    if (!initialized || !fileExists(DEVICES_FILE)) return false;
 
-    JsonArray arr = doc.as<JsonArray>();
-    bool found = false;
+    if (!rewriteDevices(id, nullptr)) return false;
 
-    for (size_t i = 0; i < arr.size(); i++) {
-        JsonObject obj = arr[i];
-        if (strcmp(obj["id"] | "", id) == 0) {
-            // Actualizar este dispositivo
-            deviceToJson(obj, device);
-            found = true;
-            break;
-        }
-    }
+    Serial.printf("[Storage] Dispositivo eliminado: %s\n", id);
+    return true;
+}
 
-    if (!found) return false;
+bool StorageManager::getDevice(const char* id, SavedDevice* device) {
+    if (!initialized || !fileExists(DEVICES_FILE)) return false;
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
 
-    // Guardar
-    file = LittleFS.open(DEVICES_FILE, "w");
+    File file = LittleFS.open(DEVICES_FILE, "r");
     if (!file) return false;
 
-    serializeJson(doc, file);
+    bool found = seekDevice(file, id, -1) && readDeviceAt(file, device);
     file.close();
 
-    Serial.printf("[Storage] Dispositivo actualizado: %s\n", id);
-    return true;
+    return found;
 }
 
-bool StorageManager::deleteDevice(const char* id) {
+uint16_t StorageManager::getDeviceCount() {
+    if (!initialized) return 0;
+    return catalogCount;
+}
+
+uint32_t StorageManager::getCatalogGeneration() {
+    return catalogGeneration;
+}
+
+bool StorageManager::getDeviceByIndex(uint16_t index, SavedDevice* device) {
     if (!initialized || !fileExists(DEVICES_FILE)) return false;
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
 
-    // Leer archivo JSON
     File file = LittleFS.open(DEVICES_FILE, "r");
     if (!file) return false;
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    DeserializationError error = deserializeJson(doc, file);
+    bool found = seekDevice(file, nullptr, (int16_t)index) && readDeviceAt(file, device);
     file.close();
 
-    if (error) return false;
+    return found;
+}
 
-    JsonArray arr = doc.as<JsonArray>();
-    bool found = false;
+// Recorre el array de devices.json elemento por elemento sin materializarlo.
+// Cada elemento se parsea con un filtro que solo conserva "id" (o nada, si se
+// busca por índice), así que la memoria usada es constante. Al encontrar el
+// elemento deja el archivo posicionado al inicio del mismo.
+bool StorageManager::seekDevice(File& file, const char* id, int16_t index) {
+    // Sin timeout: en EOF Stream::timedRead esperaría 1 s por cada lectura
+    file.setTimeout(0);
 
-    for (size_t i = 0; i < arr.size(); i++) {
-        JsonObject obj = arr[i];
-        if (strcmp(obj["id"] | "", id) == 0) {
-            arr.remove(i);
-            found = true;
-            break;
+    if (!file.find("[") || atArrayEnd(file)) return false;
+
+    // Filtro vacío (búsqueda por índice) = no conservar nada
+    StaticJsonDocument<32> filter;
+    if (id) filter["id"] = true;
+    StaticJsonDocument<128> idDoc;
+
+    int16_t current = 0;
+    do {
+        size_t start = file.position();
+
+        if (id == nullptr && current == index) {
+            return true;
+        }
+
+        DeserializationError error = deserializeJson(idDoc, file,
+            DeserializationOption::Filter(filter));
+        if (error) return false;
+
+        if (id && strcmp(idDoc["id"] | "", id) == 0) {
+            return file.seek(start);
         }
+        current++;
+    } while (file.findUntil(",", "]"));
+
+    return false;
+}
+
+// Deserializa un único dispositivo desde la posición actual del archivo.
+// El documento se dimensiona para un registro, no para todo el catálogo.
+bool StorageManager::readDeviceAt(File& file, SavedDevice* device) {
+    DynamicJsonDocument doc(DEVICE_JSON_SIZE);
+    DeserializationError error;
+    {
+        MetricScope scope(METRIC_JSON_PARSE_US);
+        error = deserializeJson(doc, file);
     }
 
-    if (!found) return false;
+    if (error) {
+        Serial.printf("[Storage] Error JSON dispositivo: %s\n", error.c_str());
+        metrics.increment(METRIC_JSON_ERRORS);
+        return false;
+    }
 
-    // Guardar
-    file = LittleFS.open(DEVICES_FILE, "w");
-    if (!file) return false;
+    JsonObject obj = doc.as<JsonObject>();
+    if (obj.isNull()) return false;
 
-    serializeJson(doc, file);
-    file.close();
+    jsonToDevice(obj, device);
+    return true;
+}
 
-    Serial.printf("[Storage] Dispositivo eliminado: %s\n", id);
+// Reescribe devices.json en streaming hacia un archivo temporal:
+//  - targetId != nullptr: reemplaza ese elemento por replacement (o lo elimina si es nullptr)
+//  - targetId == nullptr: agrega replacement al final
+// Los elementos no afectados se copian tal cual, sin deserializarlos completos.
+bool StorageManager::rewriteDevices(const char* targetId, const SavedDevice* replacement) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    File out = LittleFS.open(DEVICES_TMP_FILE, "w");
+    if (!out) {
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+
+    CatalogWriter writer(out);
+    writer.print('[');
+
+    bool ok = true;
+    bool found = false;
+    uint16_t written = 0;
+
+    File in = LittleFS.open(DEVICES_FILE, "r");
+    if (in) {
+        in.setTimeout(0);
+
+        StaticJsonDocument<32> idFilter;
+        idFilter["id"] = true;
+        StaticJsonDocument<128> idDoc;
+
+        if (in.find("[") && !atArrayEnd(in)) {
+            do {
+                size_t start = in.position();
+                DeserializationError error = deserializeJson(idDoc, in,
+                    DeserializationOption::Filter(idFilter));
+                if (error) {
+                    Serial.printf("[Storage] Error JSON dispositivos: %s\n", error.c_str());
+                    ok = false;
+                    break;
+                }
+                size_t end = in.position();
+
+                if (targetId && strcmp(idDoc["id"] | "", targetId) == 0) {
+                    found = true;
+                    if (replacement) {
+                        if (written++ > 0) writer.print(',');
+                        ok = writeDeviceJson(writer, replacement);
+                    }
+                } else {
+                    if (written++ > 0) writer.print(',');
+                    ok = copyRange(in, start, end, writer);
+                }
+            } while (ok && in.findUntil(",", "]"));
+        }
+        in.close();
+    }
+
+    if (ok && targetId == nullptr && replacement) {
+        if (written++ > 0) writer.print(',');
+        ok = writeDeviceJson(writer, replacement);
+    }
+
+    writer.print(']');
+    out.close();
+
+    if (!ok || (targetId && !found)) {
+        LittleFS.remove(DEVICES_TMP_FILE);
+        return false;
+    }
+
+    if (!commitDevicesFile(written, writer.getCrc(), writer.getSize())) return false;
+
+    notifyDeviceChange(targetId ? targetId : replacement->id, replacement);
     return true;
 }
 
-bool StorageManager::getDevice(const char* id, SavedDevice* device) {
-    if (!initialized || !fileExists(DEVICES_FILE)) return false;
+void StorageManager::setDeviceChangeCallback(void (*callback)(const char* id, const SavedDevice* device)) {
+    onDeviceChange = callback;
+}
 
-    File file = LittleFS.open(DEVICES_FILE, "r");
-    if (!file) return false;
+void StorageManager::notifyDeviceChange(const char* id, const SavedDevice* device) {
+    if (onDeviceChange) onDeviceChange(id, device);
+}
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+// Serializa un dispositivo con un documento del tamaño de un registro
+bool StorageManager::writeDeviceJson(Print& out, const SavedDevice* device) {
+    DynamicJsonDocument doc(DEVICE_JSON_SIZE);
+    JsonObject obj = doc.to<JsonObject>();
+    deviceToJson(obj, device);
 
-    if (error) return false;
+    if (doc.overflowed()) {
+        Serial.printf("[Storage] Dispositivo %s excede DEVICE_JSON_SIZE\n", device->id);
+        return false;
+    }
+
+    serializeJson(doc, out);
+    return true;
+}
 
-    JsonArray arr = doc.as<JsonArray>();
+// Reemplaza devices.json por el temporal recién escrito. La cabecera se
+// escribe antes del rename: si se corta la energía entre los dos, al
+// arrancar devices.tmp coincide con la cabecera y se completa el reemplazo,
+// así la cabecera nunca describe un devices.json más viejo.
+bool StorageManager::commitDevicesFile(uint16_t count, uint32_t crc, size_t size) {
+    uint16_t oldCount = catalogCount;
+    uint32_t oldCrc = catalogCrc;
+    size_t oldSize = catalogSize;
+
+    catalogCount = count;
+    catalogCrc = crc;
+    catalogSize = size;
+    catalogGeneration++;
+    saveCatalogHeader();
+
+    // rename() de LittleFS sobrescribe el destino de forma atómica
+    bool renamed = LittleFS.rename(DEVICES_TMP_FILE, DEVICES_FILE);
+    if (!renamed) {
+        LittleFS.remove(DEVICES_FILE);
+        renamed = LittleFS.rename(DEVICES_TMP_FILE, DEVICES_FILE);
+    }
 
-    for (JsonObject obj : arr) {
-        if (strcmp(obj["id"] | "", id) == 0) {
-            jsonToDevice(obj, device);
-            return true;
+    if (!renamed) {
+        Serial.println("[Storage] Error al reemplazar archivo de dispositivos");
+        // Sin devices.json begin() recupera el temporal con esta cabecera
+        if (fileExists(DEVICES_FILE)) {
+            catalogCount = oldCount;
+            catalogCrc = oldCrc;
+            catalogSize = oldSize;
+            saveCatalogHeader();
         }
+        return false;
     }
-
-    return false;
+    return true;
 }
 
-uint8_t StorageManager::getDeviceCount() {
-    if (!initialized || !fileExists(DEVICES_FILE)) return 0;
+// Carga la cabecera del catálogo sin leer devices.json: basta con que el
+// tamaño coincida. El CRC solo se recalcula si quedó una reescritura a
+// medias (devices.tmp); sin cabecera (firmware anterior) o si no coincide,
+// se reconstruye recorriendo el archivo una sola vez.
+bool StorageManager::loadCatalog() {
+    catalogCount = 0;
+    catalogCrc = 0;
+    catalogSize = 0;
+
+    bool valid = false;
+    File header = LittleFS.open(CATALOG_FILE, "r");
+    if (header) {
+        StaticJsonDocument<128> doc;
+        if (!deserializeJson(doc, header) && doc.containsKey("generation")) {
+            catalogCount = doc["count"] | 0;
+            catalogGeneration = doc["generation"] | 0;
+            catalogCrc = doc["crc"] | 0;
+            catalogSize = doc["size"] | 0;
+            valid = true;
+        }
+        header.close();
+    }
 
-    File file = LittleFS.open(DEVICES_FILE, "r");
-    if (!file) return 0;
+    // Reescritura interrumpida: completa (cabecera ya escrita) se termina el
+    // reemplazo; a medias se descarta y devices.json se verifica con el CRC
+    bool verifyCrc = false;
+    if (LittleFS.exists(DEVICES_TMP_FILE)) {
+        File tmp = LittleFS.open(DEVICES_TMP_FILE, "r");
+        bool complete = valid && tmp && tmp.size() == catalogSize && fileCrc(tmp) == catalogCrc;
+        if (tmp) tmp.close();
+
+        if (complete || !LittleFS.exists(DEVICES_FILE)) {
+            LittleFS.rename(DEVICES_TMP_FILE, DEVICES_FILE);
+            verifyCrc = !complete;
+        } else {
+            LittleFS.remove(DEVICES_TMP_FILE);
+            verifyCrc = true;
+        }
+        Serial.printf("[Storage] Reescritura interrumpida de devices.json %s\n",
+                      complete ? "completada" : "descartada");
+    }
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    if (!fileExists(DEVICES_FILE)) {
+        catalogCount = 0;
+        catalogCrc = 0;
+        catalogSize = 0;
+        return true;
+    }
 
-    if (error) return 0;
+    if (valid) {
+        File file = LittleFS.open(DEVICES_FILE, "r");
+        valid = file && file.size() == catalogSize;
+        if (valid && verifyCrc) valid = fileCrc(file) == catalogCrc;
+        if (file) file.close();
+    }
 
-    JsonArray arr = doc.as<JsonArray>();
-    return arr.size();
+    if (!valid) {
+        Serial.println("[Storage] Cabecera de catálogo inválida, reconstruyendo...");
+        return rebuildCatalog();
+    }
+
+    Serial.printf("[Storage] Catálogo: %d dispositivos (gen %lu)\n", catalogCount, (unsigned long)catalogGeneration);
+    return true;
 }
 
-bool StorageManager::getDeviceByIndex(uint8_t index, SavedDevice* device) {
-    if (!initialized || !fileExists(DEVICES_FILE)) return false;
+bool StorageManager::rebuildCatalog() {
+    catalogCount = countDevicesInFile();
 
     File file = LittleFS.open(DEVICES_FILE, "r");
     if (!file) return false;
+    catalogSize = file.size();
+    catalogCrc = fileCrc(file);
+    file.close();
+
+    catalogGeneration++;
+    Serial.printf("[Storage] Catálogo reconstruido: %d dispositivos\n", catalogCount);
+    return saveCatalogHeader();
+}
 
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    DeserializationError error = deserializeJson(doc, file);
+bool StorageManager::saveCatalogHeader() {
+    StaticJsonDocument<128> doc;
+    doc["count"] = catalogCount;
+    doc["generation"] = catalogGeneration;
+    doc["size"] = catalogSize;
+    doc["crc"] = catalogCrc;
+
+    File file = LittleFS.open(CATALOG_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al escribir cabecera del catálogo");
+        return false;
+    }
+    serializeJson(doc, file);
     file.close();
+    return true;
+}
 
-    if (error) return false;
+// Cuenta los elementos de devices.json sin materializarlos (solo para reconstruir la cabecera)
+uint16_t StorageManager::countDevicesInFile() {
+    File file = LittleFS.open(DEVICES_FILE, "r");
+    if (!file) return 0;
 
-    JsonArray arr = doc.as<JsonArray>();
-    if (index >= arr.size()) return false;
+    uint16_t count = 0;
+    StaticJsonDocument<8> skipFilter;
+    StaticJsonDocument<16> skipDoc;
+    file.setTimeout(0);
 
-    JsonObject obj = arr[index];
-    jsonToDevice(obj, device);
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (deserializeJson(skipDoc, file, DeserializationOption::Filter(skipFilter))) break;
+            count++;
+        } while (file.findUntil(",", "]"));
+    }
+    file.close();
+
+    return count;
+}
+
+// Copia los bytes [start, end) de un archivo a otro en bloques pequeños
+bool StorageManager::copyRange(File& in, size_t start, size_t end, Print& out) {
+    if (!in.seek(start)) return false;
+
+    uint8_t buffer[128];
+    size_t remaining = end - start;
+    while (remaining > 0) {
+        size_t chunk = in.read(buffer, min(remaining, sizeof(buffer)));
+        if (chunk == 0) return false;
+        if (out.write(buffer, chunk) != chunk) return false;
+        remaining -= chunk;
+    }
     return true;
 }
 
+// Salta espacios en blanco y verifica si sigue el cierre del array
+bool StorageManager::atArrayEnd(Stream& in) {
+    int c = in.peek();
+    while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+        in.read();
+        c = in.peek();
+    }
+    return c == ']' || c < 0;
+}
+
+// Deja in después del ':' de key en el objeto raíz. Las claves anidadas y
+// el texto dentro de valores string no cuentan
+bool StorageManager::findRootKey(Stream& in, const char* key) {
+    size_t keyLength = strlen(key);
+    size_t length = 0;
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    bool expectKey = false;     // Próximo string en el nivel raíz es una clave
+    bool inKey = false;
+    bool matched = false;
+    int c;
+
+    while ((c = in.read()) >= 0) {
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+                if (inKey) matched = length == keyLength;
+                inKey = false;
+            }
+            if (inKey) {
+                if (length >= keyLength || key[length] != c) inKey = false;
+                length++;
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '"':
+                inString = true;
+                inKey = depth == 1 && expectKey;
+                expectKey = false;
+                matched = false;
+                length = 0;
+                break;
+            case '{':
+                if (++depth == 1) expectKey = true;
+                break;
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                break;
+            case ',':
+                if (depth == 1) expectKey = true;
+                break;
+            case ':':
+                if (depth == 1 && matched) return true;
+                matched = false;
+                break;
+        }
+    }
+    return false;
+}
+
 bool StorageManager::saveSignalToDevice(const char* deviceId, uint8_t signalIndex,
                                         const RFSignal* signal, const char* signalName) {
     Serial.printf("[Storage] saveSignalToDevice: id=%s, index=%d, name=%s\n", deviceId, signalIndex, signalName);
@@ -487,7 +915,7 @@ bool StorageManager::updateSignalInverted(const char* deviceId, uint8_t signalIn
     return updateDevice(deviceId, &device);
 }
 
-bool StorageManager::updateSomfyRollingCode(const char* deviceId, uint16_t newRollingCode) {
+bool StorageManager::updateSomfyRollingCode(const char* deviceId, uint16_t newRollingCode, bool forwardOnly) {
     SavedDevice device;
     if (!getDevice(deviceId, &device)) return false;
 
@@ -496,12 +924,18 @@ bool StorageManager::updateSomfyRollingCode(const char* deviceId, uint16_t newRo
         return false;
     }
 
+    // Diferencia con signo: el rolling code da la vuelta en 0xFFFF
+    if (forwardOnly && (int16_t)(newRollingCode - device.somfy.rollingCode) <= 0) return true;
+
     device.somfy.rollingCode = newRollingCode;
     return updateDevice(deviceId, &device);
 }
 
-String StorageManager::createBackup() {
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE * 2);
+// El backup sale directo a out (archivo o respuesta HTTP): la cabecera es un
+// documento chico y el array de devices.json se copia tal cual, por partes
+bool StorageManager::createBackup(Print& out) {
+    HeapScope heap(HEAP_STORAGE);
+    DynamicJsonDocument doc(2048);
 
     // Configuración
     SystemConfig config;
@@ -510,68 +944,605 @@ String StorageManager::createBackup() {
         configToJson(configObj, &config);
     }
 
-    // Dispositivos - leer directamente del archivo
+    // Metadata
+    doc["backup_version"] = 1;
+    doc["timestamp"] = millis();
+    doc["device_name"] = config.device_name;
+
+    // Sin la '}' final: después van los dispositivos
+    String header;
+    serializeJson(doc, header);
+    header.remove(header.length() - 1);
+    out.print(header);
+
     if (fileExists(DEVICES_FILE)) {
         File file = LittleFS.open(DEVICES_FILE, "r");
-        if (file) {
-            DynamicJsonDocument devDoc(JSON_BUFFER_SIZE);
-            if (!deserializeJson(devDoc, file)) {
-                doc["devices"] = devDoc.as<JsonArray>();
+        if (file && file.size() > 0) {
+            out.print(",\"devices\":");
+
+            uint8_t buffer[128];
+            size_t n;
+            while ((n = file.read(buffer, sizeof(buffer))) > 0) {
+                out.write(buffer, n);
             }
-            file.close();
         }
+        if (file) file.close();
     }
 
-    // Metadata
-    doc["backup_version"] = 1;
-    doc["timestamp"] = millis();
-    doc["device_name"] = config.device_name;
+    out.print('}');
+    return true;
+}
+
+// Dos pasadas por el archivo: la configuración (el filtro descarta
+// "devices") y después los dispositivos elemento por elemento a
+// DEVICES_TMP_FILE. Nada se aplica hasta que el backup entero se leyó bien
+bool StorageManager::restoreBackup(File& in) {
+    HeapScope heap(HEAP_STORAGE);
+    in.setTimeout(0);
+
+    StaticJsonDocument<32> configFilter;
+    configFilter["config"] = true;
 
-    String output;
-    serializeJson(doc, output);
-    return output;
+    SystemConfig config;
+    bool hasConfig = false;
+    {
+        DynamicJsonDocument doc(2048);
+        DeserializationError error = deserializeJson(doc, in,
+            DeserializationOption::Filter(configFilter));
+
+        if (error) {
+            Serial.printf("[Storage] Error al parsear backup: %s\n", error.c_str());
+            return false;
+        }
+
+        if (doc.containsKey("config")) {
+            JsonObject configObj = doc["config"];
+            jsonToConfig(configObj, &config);
+            hasConfig = true;
+        }
+    }
+
+    // Dispositivos: la clave "devices" del objeto raíz, no un texto igual
+    // dentro de la configuración
+    bool hasDevices = in.seek(0) && findRootKey(in, "devices");
+    uint16_t count = 0;
+    File out;
+    CatalogWriter writer(out);
+
+    if (hasDevices) {
+        atArrayEnd(in);     // Salta espacios
+        if (in.read() != '[') {
+            Serial.println("[Storage] Error en backup: \"devices\" no es un array");
+            return false;
+        }
+
+        out = LittleFS.open(DEVICES_TMP_FILE, "w");
+        if (!out) return false;
+
+        writer.print('[');
+        bool ok = true;
+
+        if (!atArrayEnd(in)) {
+            DynamicJsonDocument devDoc(DEVICE_JSON_SIZE);
+            do {
+                if (count >= MAX_DEVICES) {
+                    Serial.printf("[Storage] Backup con más de %d dispositivos\n", MAX_DEVICES);
+                    ok = false;
+                    break;
+                }
+                DeserializationError error = deserializeJson(devDoc, in);
+                if (error) {
+                    Serial.printf("[Storage] Error en dispositivo %d del backup: %s\n", count, error.c_str());
+                    ok = false;
+                    break;
+                }
+                if (count++ > 0) writer.print(',');
+                serializeJson(devDoc, writer);
+            } while (in.findUntil(",", "]"));
+        }
+
+        writer.print(']');
+        out.close();
+
+        if (!ok) {
+            LittleFS.remove(DEVICES_TMP_FILE);
+            return false;
+        }
+    }
+
+    // Backup leído entero: configuración y después el catálogo
+    if (hasConfig && !saveConfig(&config)) {
+        if (hasDevices) LittleFS.remove(DEVICES_TMP_FILE);
+        return false;
+    }
+
+    if (hasDevices) {
+        if (!commitDevicesFile(count, writer.getCrc(), writer.getSize())) return false;
+        notifyDeviceChange(nullptr, nullptr);
+    }
+
+    Serial.printf("[Storage] Backup restaurado (%u dispositivos)\n", (unsigned)count);
+    return true;
 }
 
-bool StorageManager::restoreBackup(const String& backupJson) {
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE * 2);
-    DeserializationError error = deserializeJson(doc, backupJson);
+// La subida de /api/restore llega por partes: se escribe en RESTORE_FILE y
+// se aplica desde ahí, sin armar el backup en RAM
+bool StorageManager::beginRestoreUpload() {
+    if (restoreUpload) restoreUpload.close();
+    restoreUpload = LittleFS.open(RESTORE_FILE, "w");
+    if (!restoreUpload) {
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+    return true;
+}
 
-    if (error) {
-        Serial.printf("[Storage] Error al parsear backup: %s\n", error.c_str());
+bool StorageManager::appendRestoreUpload(const uint8_t* data, size_t length) {
+    if (!restoreUpload) return false;
+    if (restoreUpload.write(data, length) != length) {
+        Serial.println("[Storage] Sin espacio para el backup subido");
+        abortRestoreUpload();
         return false;
     }
+    return true;
+}
+
+void StorageManager::abortRestoreUpload() {
+    if (restoreUpload) restoreUpload.close();
+    LittleFS.remove(RESTORE_FILE);
+}
+
+bool StorageManager::restoreUploaded() {
+    if (restoreUpload) restoreUpload.close();
+    if (!fileExists(RESTORE_FILE)) return false;
+
+    bool ok = importFromFile(RESTORE_FILE);
+    LittleFS.remove(RESTORE_FILE);
+    return ok;
+}
+
+// discovery.json: [[topic, payload], ...] leído un par a la vez
+uint16_t StorageManager::loadDiscoveryHashes(DiscoveryHash* entries, uint16_t maxEntries) {
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
 
-    // Restaurar configuración
-    if (doc.containsKey("config")) {
-        SystemConfig config;
-        JsonObject configObj = doc["config"];
-        jsonToConfig(configObj, &config);
-        saveConfig(&config);
+    if (!fileExists(DISCOVERY_FILE)) return 0;
+
+    File file = LittleFS.open(DISCOVERY_FILE, "r");
+    if (!file) {
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return 0;
     }
 
-    // Restaurar dispositivos - guardar directamente el JSON
-    if (doc.containsKey("devices")) {
-        File file = LittleFS.open(DEVICES_FILE, "w");
-        if (file) {
-            serializeJson(doc["devices"], file);
-            file.close();
+    uint16_t count = 0;
+    StaticJsonDocument<64> doc;
+    file.setTimeout(0);
+
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (count >= maxEntries) break;
+            if (deserializeJson(doc, file)) {
+                // Archivo dañado: se republica todo, no hay nada que perder
+                metrics.increment(METRIC_STORAGE_ERRORS);
+                count = 0;
+                break;
+            }
+            entries[count].topic = doc[0] | 0UL;
+            entries[count].payload = doc[1] | 0UL;
+            count++;
+        } while (file.findUntil(",", "]"));
+    }
+    file.close();
+
+    return count;
+}
+
+bool StorageManager::saveDiscoveryHashes(const DiscoveryHash* entries, uint16_t count) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    File file = LittleFS.open(DISCOVERY_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al guardar discovery.json");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+
+    file.print('[');
+    for (uint16_t i = 0; i < count; i++) {
+        file.printf(i ? ",[%lu,%lu]" : "[%lu,%lu]",
+                    (unsigned long)entries[i].topic, (unsigned long)entries[i].payload);
+    }
+    file.print(']');
+    file.close();
+    return true;
+}
+
+// positions.json: [[id, posición], ...] leído un par a la vez
+uint16_t StorageManager::loadCoverPositions(CoverPositionRecord* entries, uint16_t maxEntries) {
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    if (!fileExists(POSITIONS_FILE)) return 0;
+
+    File file = LittleFS.open(POSITIONS_FILE, "r");
+    if (!file) {
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return 0;
+    }
+
+    uint16_t count = 0;
+    StaticJsonDocument<128> doc;
+    file.setTimeout(0);
+
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (count >= maxEntries) break;
+            if (deserializeJson(doc, file)) {
+                // Archivo dañado: las cortinas vuelven a posición desconocida
+                metrics.increment(METRIC_STORAGE_ERRORS);
+                count = 0;
+                break;
+            }
+            strlcpy(entries[count].id, doc[0] | "", sizeof(entries[count].id));
+            entries[count].position = constrain(doc[1] | 0, 0, 100);
+            if (entries[count].id[0] != '\0') count++;
+        } while (file.findUntil(",", "]"));
+    }
+    file.close();
+
+    return count;
+}
+
+bool StorageManager::saveCoverPositions(const CoverPositionRecord* entries, uint16_t count) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    File file = LittleFS.open(POSITIONS_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al guardar positions.json");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+
+    file.print('[');
+    for (uint16_t i = 0; i < count; i++) {
+        file.printf(i ? ",[\"%s\",%u]" : "[\"%s\",%u]", entries[i].id, entries[i].position);
+    }
+    file.print(']');
+    file.close();
+    return true;
+}
+
+// states.json: [[id, estado], ...] leído un par a la vez
+uint16_t StorageManager::loadDeviceStates(DeviceStateRecord* entries, uint16_t maxEntries) {
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    if (!fileExists(STATES_FILE)) return 0;
+
+    File file = LittleFS.open(STATES_FILE, "r");
+    if (!file) {
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return 0;
+    }
+
+    uint16_t count = 0;
+    StaticJsonDocument<192> doc;
+    file.setTimeout(0);
+
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (count >= maxEntries) break;
+            if (deserializeJson(doc, file)) {
+                // Archivo dañado: al reconectar se publica "unknown"
+                metrics.increment(METRIC_STORAGE_ERRORS);
+                count = 0;
+                break;
+            }
+            strlcpy(entries[count].id, doc[0] | "", sizeof(entries[count].id));
+            strlcpy(entries[count].state, doc[1] | "", sizeof(entries[count].state));
+            if (entries[count].id[0] != '\0' && entries[count].state[0] != '\0') count++;
+        } while (file.findUntil(",", "]"));
+    }
+    file.close();
+
+    return count;
+}
+
+bool StorageManager::saveDeviceStates(const DeviceStateRecord* entries, uint16_t count) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    File file = LittleFS.open(STATES_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al guardar states.json");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+
+    // DeviceStates solo guarda estados [A-Za-z0-9_-]: no hace falta escapar
+    file.print('[');
+    for (uint16_t i = 0; i < count; i++) {
+        file.printf(i ? ",[\"%s\",\"%s\"]" : "[\"%s\",\"%s\"]", entries[i].id, entries[i].state);
+    }
+    file.print(']');
+    file.close();
+    return true;
+}
+
+bool StorageManager::loadGroupMembers(const char* groupId, char members[][37],
+                                      uint8_t maxMembers, uint8_t* count) {
+    MetricScope scope(METRIC_STORAGE_READ_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    *count = 0;
+    if (!fileExists(GROUPS_FILE)) return false;
+
+    File file = LittleFS.open(GROUPS_FILE, "r");
+    if (!file) {
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+
+    // Un grupo a la vez: memoria acotada por MAX_GROUP_MEMBERS
+    StaticJsonDocument<1536> doc;
+    bool found = false;
+    file.setTimeout(0);
+
+    if (file.find("[") && !atArrayEnd(file)) {
+        do {
+            if (deserializeJson(doc, file)) {
+                metrics.increment(METRIC_JSON_ERRORS);
+                break;
+            }
+            if (strcmp(doc["id"] | "", groupId) != 0) continue;
+
+            found = true;
+            JsonArray list = doc["members"].as<JsonArray>();
+            for (size_t i = 0; i < list.size() && *count < maxMembers; i++) {
+                strlcpy(members[*count], list[i] | "", 37);
+                if (members[*count][0] != '\0') (*count)++;
+            }
+            break;
+        } while (file.findUntil(",", "]"));
+    }
+    file.close();
+
+    return found;
+}
+
+String StorageManager::getGroupsJson() {
+    if (!fileExists(GROUPS_FILE)) return "[]";
+
+    File file = LittleFS.open(GROUPS_FILE, "r");
+    if (!file) return "[]";
+
+    String json = file.readString();
+    file.close();
+    return json.length() > 0 ? json : String("[]");
+}
+
+bool StorageManager::saveGroups(const String& json) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    DynamicJsonDocument doc(GROUPS_JSON_SIZE);
+    if (deserializeJson(doc, json)) {
+        Serial.println("[Storage] groups: JSON inválido");
+        return false;
+    }
+
+    JsonArray groups = doc.as<JsonArray>();
+    if (groups.isNull() || groups.size() > MAX_GROUPS) {
+        Serial.printf("[Storage] groups: se esperaba un array de hasta %d grupos\n", MAX_GROUPS);
+        return false;
+    }
+
+    // El id forma parte del topic MQTT: sin comodines ni separadores
+    for (size_t i = 0; i < groups.size(); i++) {
+        const char* id = groups[i]["id"] | "";
+        size_t length = strlen(id);
+        if (length == 0 || length >= GROUP_ID_LENGTH || strpbrk(id, "/+#") != nullptr) {
+            Serial.printf("[Storage] groups: id inválido '%s'\n", id);
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(groups[j]["id"] | "", id) == 0) {
+                Serial.printf("[Storage] groups: id duplicado '%s'\n", id);
+                return false;
+            }
+        }
+
+        JsonArray members = groups[i]["members"].as<JsonArray>();
+        if (members.isNull() || members.size() > MAX_GROUP_MEMBERS) {
+            Serial.printf("[Storage] groups: miembros inválidos en '%s'\n", id);
+            return false;
         }
     }
 
-    Serial.println("[Storage] Backup restaurado");
+    File file = LittleFS.open(GROUPS_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al guardar groups.json");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+    serializeJson(doc, file);
+    file.close();
+
+    Serial.printf("[Storage] %u grupos guardados\n", (unsigned)groups.size());
     return true;
 }
 
-bool StorageManager::exportToFile(const char* filename) {
-    String backup = createBackup();
+String StorageManager::getScenesJson() {
+    if (!fileExists(SCENES_FILE)) return "[]";
+
+    File file = LittleFS.open(SCENES_FILE, "r");
+    if (!file) return "[]";
+
+    String json = file.readString();
+    file.close();
+    return json.length() > 0 ? json : String("[]");
+}
+
+bool StorageManager::saveScenes(const String& json) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    DynamicJsonDocument doc(SCENES_JSON_SIZE);
+    if (deserializeJson(doc, json)) {
+        Serial.println("[Storage] scenes: JSON inválido");
+        return false;
+    }
+
+    JsonArray scenes = doc.as<JsonArray>();
+    if (scenes.isNull() || scenes.size() > MAX_SCENES) {
+        Serial.printf("[Storage] scenes: se esperaba un array de hasta %d escenas\n", MAX_SCENES);
+        return false;
+    }
+
+    // El id forma parte del topic MQTT y del unique_id de Home Assistant
+    for (size_t i = 0; i < scenes.size(); i++) {
+        const char* id = scenes[i]["id"] | "";
+        size_t length = strlen(id);
+        if (length == 0 || length >= SCENE_ID_LENGTH || strpbrk(id, "/+# ") != nullptr) {
+            Serial.printf("[Storage] scenes: id inválido '%s'\n", id);
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(scenes[j]["id"] | "", id) == 0) {
+                Serial.printf("[Storage] scenes: id duplicado '%s'\n", id);
+                return false;
+            }
+        }
+
+        JsonArray steps = scenes[i]["steps"].as<JsonArray>();
+        if (steps.isNull() || steps.size() == 0 || steps.size() > MAX_SCENE_STEPS) {
+            Serial.printf("[Storage] scenes: pasos inválidos en '%s'\n", id);
+            return false;
+        }
+        for (size_t j = 0; j < steps.size(); j++) {
+            const char* device = steps[j]["device"] | "";
+            const char* command = steps[j]["command"] | "";
+            uint32_t delayMs = steps[j]["delay"] | 0;
+            if (strlen(device) == 0 || strlen(device) > 36 || strlen(command) == 0 ||
+                strlen(command) >= 24 || delayMs > SCENE_MAX_DELAY_MS) {
+                Serial.printf("[Storage] scenes: paso %u inválido en '%s'\n", (unsigned)j, id);
+                return false;
+            }
+        }
+    }
+
+    File file = LittleFS.open(SCENES_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al guardar scenes.json");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+    serializeJson(doc, file);
+    file.close();
+
+    Serial.printf("[Storage] %u escenas guardadas\n", (unsigned)scenes.size());
+    return true;
+}
+
+String StorageManager::getSchedulesJson() {
+    if (!fileExists(SCHEDULES_FILE)) return "[]";
+
+    File file = LittleFS.open(SCHEDULES_FILE, "r");
+    if (!file) return "[]";
 
+    String json = file.readString();
+    file.close();
+    return json.length() > 0 ? json : String("[]");
+}
+
+// Validación estructural; los campos cron se interpretan al cargar (Schedules)
+bool StorageManager::saveSchedules(const String& json) {
+    MetricScope scope(METRIC_STORAGE_WRITE_US);
+    HeapScope heap(HEAP_STORAGE);
+
+    DynamicJsonDocument doc(SCHEDULES_JSON_SIZE);
+    if (deserializeJson(doc, json)) {
+        Serial.println("[Storage] schedules: JSON inválido");
+        return false;
+    }
+
+    JsonArray rules = doc.as<JsonArray>();
+    if (rules.isNull() || rules.size() > MAX_SCHEDULES) {
+        Serial.printf("[Storage] schedules: se esperaba un array de hasta %d reglas\n", MAX_SCHEDULES);
+        return false;
+    }
+
+    static const char* const targets[] = {"device", "room", "group", "scene"};
+
+    for (size_t i = 0; i < rules.size(); i++) {
+        JsonObject rule = rules[i];
+        const char* id = rule["id"] | "";
+        size_t length = strlen(id);
+        if (length == 0 || length >= SCHEDULE_ID_LENGTH) {
+            Serial.printf("[Storage] schedules: id inválido '%s'\n", id);
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(rules[j]["id"] | "", id) == 0) {
+                Serial.printf("[Storage] schedules: id duplicado '%s'\n", id);
+                return false;
+            }
+        }
+
+        // Cuándo: "cron" o "sun" (sunrise/sunset), no ambos
+        const char* cron = rule["cron"] | "";
+        const char* sun = rule["sun"] | "";
+        int offset = rule["offset"] | 0;
+        bool validSun = strcmp(sun, "sunrise") == 0 || strcmp(sun, "sunset") == 0;
+        if ((strlen(cron) > 0) == (strlen(sun) > 0) || (strlen(sun) > 0 && !validSun) ||
+            strlen(cron) >= 64 || abs(offset) > SCHEDULE_MAX_OFFSET_MIN) {
+            Serial.printf("[Storage] schedules: horario inválido en '%s'\n", id);
+            return false;
+        }
+
+        // Qué: un solo destino, con command o position (solo dispositivos)
+        uint8_t targetCount = 0;
+        const char* target = "";
+        for (uint8_t j = 0; j < 4; j++) {
+            if (rule.containsKey(targets[j])) {
+                targetCount++;
+                target = rule[targets[j]] | "";
+            }
+        }
+        const char* command = rule["command"] | "";
+        int position = rule["position"] | -1;
+        bool hasPosition = rule.containsKey("position");
+        if (targetCount != 1 || strlen(target) == 0 || strlen(target) > 36 ||
+            hasPosition == (strlen(command) > 0) || strlen(command) >= 24 ||
+            (hasPosition && (!rule.containsKey("device") || position < 0 || position > 100))) {
+            Serial.printf("[Storage] schedules: destino o comando inválido en '%s'\n", id);
+            return false;
+        }
+    }
+
+    File file = LittleFS.open(SCHEDULES_FILE, "w");
+    if (!file) {
+        Serial.println("[Storage] Error al guardar schedules.json");
+        metrics.increment(METRIC_STORAGE_ERRORS);
+        return false;
+    }
+    serializeJson(doc, file);
+    file.close();
+
+    Serial.printf("[Storage] %u programaciones guardadas\n", (unsigned)rules.size());
+    return true;
+}
+
+bool StorageManager::exportToFile(const char* filename) {
     File file = LittleFS.open(filename, "w");
     if (!file) return false;
 
-    file.print(backup);
+    bool ok = createBackup(file);
     file.close();
 
-    return true;
+    return ok;
 }
 
 bool StorageManager::importFromFile(const char* filename) {
@@ -580,10 +1551,10 @@ bool StorageManager::importFromFile(const char* filename) {
     File file = LittleFS.open(filename, "r");
     if (!file) return false;
 
-    String content = file.readString();
+    bool ok = restoreBackup(file);
     file.close();
 
-    return restoreBackup(content);
+    return ok;
 }
 
 String StorageManager::generateUUID() {
@@ -720,6 +1691,12 @@ void StorageManager::deviceToJson(JsonObject& obj, const SavedDevice* device) {
         aokObj["remoteId"] = device->aok.remoteId;
         aokObj["channel"] = device->aok.channel;
     }
+
+    // Recorrido medido (solo cortinas con modelo de posición)
+    if (device->travelOpenMs > 0 || device->travelCloseMs > 0) {
+        obj["travelOpenMs"] = device->travelOpenMs;
+        obj["travelCloseMs"] = device->travelCloseMs;
+    }
 }
 
 void StorageManager::jsonToDevice(JsonObject& obj, SavedDevice* device) {
@@ -771,6 +1748,9 @@ void StorageManager::jsonToDevice(JsonObject& obj, SavedDevice* device) {
         device->aok.remoteId = aokObj["remoteId"] | 0;
         device->aok.channel = aokObj["channel"] | 1;
     }
+
+    device->travelOpenMs = obj["travelOpenMs"] | 0UL;
+    device->travelCloseMs = obj["travelCloseMs"] | 0UL;
 }
 
 void StorageManager::configToJson(JsonObject& obj, const SystemConfig* config) {
@@ -793,6 +1773,8 @@ void StorageManager::configToJson(JsonObject& obj, const SystemConfig* config) {
     obj["ntp_server"] = config->ntp_server;
     obj["utc_offset"] = config->utc_offset;
     obj["dst_enabled"] = config->dst_enabled;
+    obj["latitude"] = config->latitude;
+    obj["longitude"] = config->longitude;
 
     // RF
     obj["default_frequency"] = config->default_frequency;
@@ -831,6 +1813,8 @@ void StorageManager::jsonToConfig(JsonObject& obj, SystemConfig* config) {
     config->ntp_server[63] = '\0';
     config->utc_offset = obj["utc_offset"] | -3;
     config->dst_enabled = obj["dst_enabled"] | false;
+    config->latitude = obj["latitude"] | 0.0f;
+    config->longitude = obj["longitude"] | 0.0f;
 
     // RF
     config->default_frequency = obj["default_frequency"] | RF_DEFAULT_FREQUENCY;
@@ -1,12 +1,18 @@
 #include "TimeManager.h"
+#include <esp_sntp.h>
 
 TimeManager timeManager;
 
 TimeManager::TimeManager() {
     synced = false;
     lastSyncTime = 0;
+    syncLogPending = false;
+    lastSyncRequest = 0;
+    sntpStarted = false;
+    onSync = nullptr;
     strcpy(currentTimezone, DEFAULT_TIMEZONE);
     strcpy(ntpServer, DEFAULT_NTP_SERVER);
+    strcpy(tzString, "UTC0");
     sysConfig = nullptr;
 }
 
@@ -36,6 +42,8 @@ bool TimeManager::begin(SystemConfig* config) {
         configureTimezone(tzStr);
     }
 
+    // Sin WiFi todavía: loop() lanza SNTP al conectar
+    if (WiFi.status() != WL_CONNECTED) return false;
     return syncTime();
 }
 
@@ -54,9 +62,15 @@ void TimeManager::setNTPServer(const char* server) {
     strncpy(ntpServer, server, 63);
     ntpServer[63] = '\0';
     Serial.printf("[Time] Servidor NTP cambiado a: %s\n", server);
+
+    // Aplicar el nuevo servidor sin esperar a la próxima resincronización
+    if (sntpStarted) {
+        syncTime();
+    }
 }
 
-void TimeManager::configureTimezone(const char* tzString) {
+void TimeManager::configureTimezone(const char* posixTz) {
+    strlcpy(tzString, posixTz, sizeof(tzString));
     setenv("TZ", tzString, 1);
     tzset();
 }
@@ -69,27 +83,48 @@ bool TimeManager::syncTime() {
 
     Serial.println("[Time] Sincronizando con NTP...");
 
-    configTime(0, 0, ntpServer, "time.nist.gov", "time.google.com");
+    // SNTP corre en la tarea de lwIP: el resultado llega por
+    // sntpSyncNotification, sin bloquear el loop ni los comandos RF
+    sntp_set_time_sync_notification_cb(sntpSyncNotification);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL_MS);
+    // configTime(0, 0, ...) deja TZ en UTC0 y las reglas horarias
+    // dispararían en UTC: configTzTime vuelve a aplicar la zona configurada
+    configTzTime(tzString, ntpServer, "time.nist.gov", "time.google.com");
+
+    lastSyncRequest = millis();
+    sntpStarted = true;
+    return true;
+}
+
+void TimeManager::sntpSyncNotification(struct timeval* tv) {
+    // Se ejecuta en el contexto de SNTP: solo actualizar estado
+    timeManager.synced = true;
+    timeManager.lastSyncTime = millis();
+    timeManager.syncLogPending = true;
 
-    // Esperar sincronización
-    int retry = 0;
-    while (time(nullptr) < 100000 && retry < 20) {
-        delay(500);
-        Serial.print(".");
-        retry++;
+    if (timeManager.onSync) {
+        timeManager.onSync();
     }
-    Serial.println();
+}
 
-    if (time(nullptr) > 100000) {
-        synced = true;
-        lastSyncTime = millis();
+void TimeManager::loop() {
+    if (syncLogPending) {
+        syncLogPending = false;
         Serial.printf("[Time] Sincronizado: %s\n", getDateTimeString().c_str());
-        return true;
     }
 
-    Serial.println("[Time] Error al sincronizar");
-    synced = false;
-    return false;
+    // Antes de begin() no hay zona horaria ni servidor configurados
+    if (!sysConfig || synced || WiFi.status() != WL_CONNECTED) return;
+
+    // Sin respuesta todavía: relanzar SNTP (p.ej. servidor cambiado o
+    // WiFi que se conectó después de begin)
+    if (!sntpStarted || millis() - lastSyncRequest > NTP_RETRY_MS) {
+        syncTime();
+    }
+}
+
+void TimeManager::setSyncCallback(void (*callback)()) {
+    onSync = callback;
 }
 
 String TimeManager::getTimeString() {
@@ -0,0 +1,329 @@
+#include "TxScheduler.h"
+#include "Storage.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "DooyaBidir.h"
+#include "AOK_Protocol.h"
+#include "SomfyRemotes.h"
+#include "Logger.h"
+
+TxScheduler txScheduler;
+
+TxScheduler::TxScheduler() {
+    jobCount = 0;
+    doneSentAt = 0;
+}
+
+int8_t TxScheduler::getProtocolAction(const char* command) {
+    if (strcasecmp(command, "open") == 0 || strcasecmp(command, "up") == 0) return ACTION_UP;
+    if (strcasecmp(command, "close") == 0 || strcasecmp(command, "down") == 0) return ACTION_DOWN;
+    if (strcasecmp(command, "stop") == 0 || strcasecmp(command, "my") == 0) return ACTION_STOP;
+    if (strcasecmp(command, "prog") == 0) return ACTION_PROG;
+    return -1;
+}
+
+// Mismo mapeo que un comando a <base>/<id>/set
+int8_t TxScheduler::getSignalIndex(uint8_t type, const char* command) {
+    switch (type) {
+        case DEVICE_CURTAIN:
+            // Cortinas: OPEN, CLOSE, STOP (índices 0, 1, 2)
+            if (strcasecmp(command, "open") == 0) return 0;
+            if (strcasecmp(command, "close") == 0) return 1;
+            if (strcasecmp(command, "stop") == 0) return 2;
+            return -1;
+
+        case DEVICE_SWITCH:
+        case DEVICE_LIGHT:
+            // Interruptores/Luces: ON, OFF (índices 0, 1)
+            if (strcasecmp(command, "on") == 0) return 0;
+            if (strcasecmp(command, "off") == 0) return 1;
+            return -1;
+
+        case DEVICE_BUTTON:
+            // Botones: cualquier comando activa señal 0
+            return 0;
+
+        case DEVICE_GATE:
+            // Portones: TOGGLE o OPEN/CLOSE
+            if (strcasecmp(command, "toggle") == 0 || strcasecmp(command, "open") == 0) return 0;
+            if (strcasecmp(command, "close") == 0) return 1;
+            return -1;
+
+        case DEVICE_FAN:
+            // Ventiladores: ON, OFF, SPEED (índices 0, 1, 2)
+            if (strcasecmp(command, "on") == 0) return 0;
+            if (strcasecmp(command, "off") == 0) return 1;
+            if (strcasecmp(command, "speed") == 0) return 2;
+            return -1;
+
+        case DEVICE_DIMMER:
+            // Dimmers: ON, OFF, UP, DOWN (índices 0, 1, 2, 3)
+            if (strcasecmp(command, "on") == 0) return 0;
+            if (strcasecmp(command, "off") == 0) return 1;
+            if (strcasecmp(command, "up") == 0 || strcasecmp(command, "brightness_up") == 0) return 2;
+            if (strcasecmp(command, "down") == 0 || strcasecmp(command, "brightness_down") == 0) return 3;
+            return -1;
+
+        default:
+            // Para otros tipos, interpretar como índice numérico
+            return (int8_t)atoi(command);
+    }
+}
+
+const char* TxScheduler::getSignalCommand(uint8_t type, uint8_t signal) {
+    static const char* const CURTAIN[] = { "open", "close", "stop" };
+    static const char* const ON_OFF[] = { "on", "off" };
+    static const char* const GATE[] = { "open", "close" };
+    static const char* const FAN[] = { "on", "off", "speed" };
+    static const char* const DIMMER[] = { "on", "off", "up", "down" };
+
+    switch (type) {
+        case DEVICE_CURTAIN:
+        case DEVICE_CURTAIN_SOMFY:
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+        case DEVICE_CURTAIN_AOK:
+            return signal < 3 ? CURTAIN[signal] : nullptr;
+        case DEVICE_SWITCH:
+        case DEVICE_LIGHT:
+            return signal < 2 ? ON_OFF[signal] : nullptr;
+        case DEVICE_GATE:
+            return signal < 2 ? GATE[signal] : nullptr;
+        case DEVICE_FAN:
+            return signal < 3 ? FAN[signal] : nullptr;
+        case DEVICE_DIMMER:
+            return signal < 4 ? DIMMER[signal] : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+bool TxScheduler::submit(const SavedDevice* device, const char* command, TxDoneCallback onDone) {
+    switch (device->type) {
+        case DEVICE_CURTAIN_SOMFY:
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+        case DEVICE_CURTAIN_AOK:
+            break;
+        default: {
+            int8_t index = getSignalIndex(device->type, command);
+            if (index < 0) return false;
+            return submitSignal(device, index, command, onDone);
+        }
+    }
+
+    int8_t action = getProtocolAction(command);
+    if (action < 0) return false;
+
+    TxJob* job = reserve(device, command, onDone);
+    job->action = action;
+
+    if (device->type == DEVICE_CURTAIN_SOMFY) {
+        job->somfy = device->somfy;
+        somfyRemotes.applyRollingCode(device->id, &job->somfy);
+        job->profile = CC1101_RF::makeTxProfile(SOMFY_FREQUENCY, 2, RF_TX_MODE_ASYNC);
+    } else if (device->type == DEVICE_CURTAIN_DOOYA_BIDIR) {
+        job->dooyaBidir = device->dooyaBidir;
+        job->profile = CC1101_RF::makeTxProfile(DOOYA_BIDIR_FREQUENCY, DOOYA_BIDIR_MODULATION, RF_TX_MODE_FSK);
+    } else {
+        job->aok = device->aok;
+        job->profile = CC1101_RF::makeTxProfile(AOK_FREQUENCY, 2, RF_TX_MODE_ASYNC);
+    }
+
+    jobCount++;
+    return true;
+}
+
+bool TxScheduler::submitSignal(const SavedDevice* device, uint8_t signalIndex,
+                               const char* command, TxDoneCallback onDone) {
+    if (signalIndex >= device->signalCount || !device->signals[signalIndex].valid) {
+        return false;
+    }
+
+    RFSignal* signal = (RFSignal*)malloc(sizeof(RFSignal));
+    if (!signal) {
+        LOG_E("TxSched", "Sin memoria para la señal de %s", device->name);
+        return false;
+    }
+    memcpy(signal, &device->signals[signalIndex], sizeof(RFSignal));
+
+    TxJob* job = reserve(device, command, onDone);
+    job->action = signalIndex;
+    job->signal = signal;
+    // transmitRaw siempre usa OOK async: solo la frecuencia distingue el perfil
+    job->profile = CC1101_RF::makeTxProfile(signal->frequency, 2, RF_TX_MODE_ASYNC);
+
+    jobCount++;
+    return true;
+}
+
+// Cola llena: se transmite lo pendiente antes de aceptar el nuevo trabajo
+TxScheduler::TxJob* TxScheduler::reserve(const SavedDevice* device, const char* command, TxDoneCallback onDone) {
+    if (jobCount >= TX_SCHED_QUEUE_DEPTH) {
+        LOG_W("TxSched", "Cola llena, transmitiendo %d trabajos", jobCount);
+        flush();
+    }
+
+    TxJob& job = jobs[jobCount];
+    memset(&job, 0, sizeof(job));
+    strlcpy(job.deviceId, device->id, sizeof(job.deviceId));
+    strlcpy(job.command, command, sizeof(job.command));
+    job.type = device->type;
+    job.queuedAt = millis();
+    job.onDone = onDone;
+    return &job;
+}
+
+void TxScheduler::loop() {
+    if (jobCount == 0) return;
+    if (millis() - jobs[0].queuedAt < TX_SCHED_WINDOW_MS) return;
+    flush();
+}
+
+// Elegible = sin trabajos anteriores pendientes del mismo dispositivo.
+// Prioridad: el más antiguo si el reordenamiento ya lo demoró demasiado,
+// luego el perfil en curso, luego el más antiguo.
+int8_t TxScheduler::pickNext(const bool* done, uint32_t currentProfile) {
+    int8_t oldest = -1;
+    int8_t sameProfile = -1;
+
+    for (uint8_t i = 0; i < jobCount; i++) {
+        if (done[i]) continue;
+
+        bool blocked = false;
+        for (uint8_t j = 0; j < i && !blocked; j++) {
+            blocked = !done[j] && strcmp(jobs[j].deviceId, jobs[i].deviceId) == 0;
+        }
+        if (blocked) continue;
+
+        if (oldest < 0) {
+            oldest = i;
+            if (jobs[i].bypassedMs >= TX_SCHED_MAX_DELAY_MS) return i;
+        }
+        if (sameProfile < 0 && jobs[i].profile == currentProfile) {
+            sameProfile = i;
+        }
+    }
+
+    return sameProfile >= 0 ? sameProfile : oldest;
+}
+
+uint8_t TxScheduler::flush() {
+    if (jobCount == 0) return 0;
+
+    bool done[TX_SCHED_QUEUE_DEPTH] = {};
+    bool sent[TX_SCHED_QUEUE_DEPTH] = {};
+    uint32_t currentProfile = 0;
+    uint8_t profileChanges = 0;
+    uint8_t sentCount = 0;
+    unsigned long start = millis();
+
+    rfModule.beginBurst();
+    for (uint8_t n = 0; n < jobCount; n++) {
+        int8_t i = pickNext(done, currentProfile);
+        if (i < 0) break;
+
+        TxJob& job = jobs[i];
+        if (job.profile != currentProfile) {
+            currentProfile = job.profile;
+            profileChanges++;
+        }
+
+        if (n > 0) delay(TX_SCHED_GAP_MS);
+
+        unsigned long txStart = millis();
+        sent[i] = transmit(job);
+        job.sentAt = txStart;
+        done[i] = true;
+
+        // Los más antiguos que siguen pendientes esperaron por este trabajo
+        for (uint8_t j = 0; j < i; j++) {
+            if (!done[j]) jobs[j].bypassedMs += millis() - txStart;
+        }
+
+        if (!sent[i]) continue;
+        sentCount++;
+
+        // El siguiente comando al mismo control Somfy usa el código ya incrementado
+        if (job.type == DEVICE_CURTAIN_SOMFY) {
+            for (uint8_t j = i + 1; j < jobCount; j++) {
+                if (jobs[j].type == DEVICE_CURTAIN_SOMFY && strcmp(jobs[j].deviceId, job.deviceId) == 0) {
+                    jobs[j].somfy.rollingCode = job.somfy.rollingCode;
+                }
+            }
+        }
+    }
+    rfModule.endBurst();
+
+    LOG_I("TxSched", "Ráfaga: %d/%d trabajos, %d perfiles, %lu ms",
+          sentCount, jobCount, profileChanges, millis() - start);
+
+    // Fuera del camino de TX: rolling codes (último por control) y callbacks
+    uint8_t count = jobCount;
+    jobCount = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        TxJob& job = jobs[i];
+        if (sent[i]) {
+            if (job.type == DEVICE_CURTAIN_SOMFY) {
+                bool superseded = false;
+                for (uint8_t j = i + 1; j < count && !superseded; j++) {
+                    superseded = sent[j] && strcmp(jobs[j].deviceId, job.deviceId) == 0;
+                }
+                if (!superseded) storage.updateSomfyRollingCode(job.deviceId, job.somfy.rollingCode);
+            }
+            if (job.onDone) {
+                doneSentAt = job.sentAt;
+                job.onDone(job.deviceId, job.command);
+                doneSentAt = 0;
+            }
+        }
+        release(job);
+    }
+
+    return sentCount;
+}
+
+bool TxScheduler::transmit(TxJob& job) {
+    if (job.signal) {
+        rfModule.setFrequency(job.signal->frequency);
+        rfModule.setModulation(job.signal->modulation);
+        bool success = rfModule.transmitSignal(job.signal);
+        if (success) LOG_I("TxSched", "Señal %d transmitida (%s)", job.action, job.deviceId);
+        return success;
+    }
+
+    bool success = false;
+    switch (job.type) {
+        case DEVICE_CURTAIN_SOMFY:
+            // Configurar el módulo RF para Somfy (433.42 MHz)
+            rfModule.setFrequency(SOMFY_FREQUENCY);
+            somfyRTS.setRemote(&job.somfy);
+            if (job.action == ACTION_UP) success = somfyRTS.sendUp();
+            else if (job.action == ACTION_DOWN) success = somfyRTS.sendDown();
+            else if (job.action == ACTION_STOP) success = somfyRTS.sendStop();
+            else if (job.action == ACTION_PROG) success = somfyRTS.sendProg();
+            if (success) job.somfy.rollingCode = somfyRTS.getRollingCode();
+            break;
+
+        case DEVICE_CURTAIN_DOOYA_BIDIR:
+            dooyaBidir.setRemote(&job.dooyaBidir);
+            if (job.action == ACTION_UP) success = dooyaBidir.sendUp();
+            else if (job.action == ACTION_DOWN) success = dooyaBidir.sendDown();
+            else if (job.action == ACTION_STOP) success = dooyaBidir.sendStop();
+            else if (job.action == ACTION_PROG) success = dooyaBidir.sendProg();
+            break;
+
+        case DEVICE_CURTAIN_AOK:
+            aokProtocol.setRemoteId(job.aok.remoteId);
+            aokProtocol.setChannel(job.aok.channel);
+            if (job.action == ACTION_UP) success = aokProtocol.sendUp();
+            else if (job.action == ACTION_DOWN) success = aokProtocol.sendDown();
+            else if (job.action == ACTION_STOP) success = aokProtocol.sendStop();
+            else if (job.action == ACTION_PROG) success = aokProtocol.sendProgram();
+            break;
+    }
+    return success;
+}
+
+void TxScheduler::release(TxJob& job) {
+    free(job.signal);
+    job.signal = nullptr;
+}
@@ -0,0 +1,209 @@
+#include "TxTiming.h"
+#include <algorithm>
+
+#ifdef NATIVE_BUILD
+#include <NativeHAL.h>
+#else
+#include <driver/rmt.h>
+#include <driver/gpio.h>
+#include <esp_rom_gpio.h>
+#include <soc/gpio_sig_map.h>
+#endif
+
+TxTiming txTiming;
+
+static const uint16_t BUCKET_BOUNDS[TX_TIMING_BUCKETS] = {1, 2, 5, 10, 20, 50, 100, 0xFFFF};
+
+#ifdef NATIVE_BUILD
+static size_t nativeEdgeStart = 0;
+#else
+static RingbufHandle_t rmtRingbuf = nullptr;
+#endif
+
+TxTiming::TxTiming() {
+    enabled = false;
+    armed = false;
+    armedPin = 0;
+    driverReady = false;
+    reset();
+}
+
+void TxTiming::setEnabled(bool value) {
+    enabled = value;
+    Serial.printf("[TxTiming] Monitor de timing TX %s\n", enabled ? "activado" : "desactivado");
+}
+
+void TxTiming::reset() {
+    memset(&last, 0, sizeof(last));
+    transmissions = 0;
+    mismatches = 0;
+    worstUs = 0;
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void TxTiming::arm(uint8_t pin) {
+    armed = enabled && startCapture(pin);
+    armedPin = pin;
+}
+
+bool TxTiming::measure(const uint32_t* pulses, uint16_t pulseCount) {
+    if (!armed) return false;
+    armed = false;
+
+    uint16_t count = finishCapture();
+
+    // play() deja el pin en LOW: un LOW final no tiene flanco de cierre y no se compara
+    uint16_t expected = pulseCount;
+    if (expected > 0 && !(pulses[expected - 1] & PULSE_LEVEL_BIT)) expected--;
+    uint16_t compared = min(count, expected);
+
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < compared; i++) {
+        int32_t diff = (int32_t)measured[i] - (int32_t)(pulses[i] & PULSE_DURATION_MASK);
+        uint32_t error = diff < 0 ? -diff : diff;
+        errors[i] = error > 0xFFFF ? 0xFFFF : error;
+        sum += errors[i];
+
+        uint8_t bucket = 0;
+        while (bucket < TX_TIMING_BUCKETS - 1 && errors[i] > BUCKET_BOUNDS[bucket]) bucket++;
+        buckets[bucket]++;
+    }
+
+    last.pulses = compared;
+    last.countMismatch = count != expected;
+    last.meanUs = compared ? (float)sum / compared : 0;
+    if (compared) {
+        std::sort(errors, errors + compared);
+        last.p99Us = errors[(compared * 99) / 100];
+        last.maxUs = errors[compared - 1];
+    } else {
+        last.p99Us = 0;
+        last.maxUs = 0;
+    }
+
+    transmissions++;
+    if (last.countMismatch) mismatches++;
+    if (last.maxUs > worstUs) worstUs = last.maxUs;
+
+    Serial.printf("[TxTiming] pin %d: %u/%u pulsos, error medio %.1f us, p99 %u us, max %u us\n",
+                  armedPin, count, expected, last.meanUs, last.p99Us, last.maxUs);
+    return true;
+}
+
+uint16_t TxTiming::getBucketBound(uint8_t bucket) {
+    return bucket < TX_TIMING_BUCKETS ? BUCKET_BOUNDS[bucket] : 0;
+}
+
+uint32_t TxTiming::getBucketCount(uint8_t bucket) const {
+    return bucket < TX_TIMING_BUCKETS ? buckets[bucket] : 0;
+}
+
+String TxTiming::getStatusString() {
+    String status = "TxTiming: ";
+    if (!enabled) return status + "desactivado";
+
+    status += String(transmissions) + " TX, último: media " + String(last.meanUs, 1) +
+              " us, p99 " + String(last.p99Us) + " us, max " + String(last.maxUs) + " us";
+    return status;
+}
+
+#ifdef NATIVE_BUILD
+
+// Build nativo: los flancos escritos por el firmware quedan en NativeHAL
+bool TxTiming::startCapture(uint8_t pin) {
+    (void)pin;
+    nativeHAL.startRecording();
+    nativeEdgeStart = nativeHAL.getRecordedEdges().size();
+    return true;
+}
+
+uint16_t TxTiming::finishCapture() {
+    const std::vector<PinEdge>& edges = nativeHAL.getRecordedEdges();
+    uint16_t count = 0;
+    const PinEdge* previous = nullptr;
+
+    for (size_t i = nativeEdgeStart; i < edges.size() && count < TX_TIMING_MAX_PULSES; i++) {
+        const PinEdge& edge = edges[i];
+        if (edge.pin != armedPin) continue;
+
+        // Ignorar el LOW previo al primer flanco de subida y escrituras sin cambio
+        if (!previous) {
+            if (edge.level) previous = &edge;
+            continue;
+        }
+        if (edge.level == previous->level) continue;
+
+        measured[count++] = (uint32_t)(edge.timeUs - previous->timeUs);
+        previous = &edge;
+    }
+    return count;
+}
+
+#else
+
+bool TxTiming::startCapture(uint8_t pin) {
+    rmt_channel_t channel = (rmt_channel_t)TX_TIMING_RMT_CHANNEL;
+
+    if (!driverReady) {
+        rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)pin, channel);
+        config.clk_div = 80;                // 1 tick = 1 µs
+        config.mem_block_num = 8;
+        config.rx_config.filter_en = true;
+        config.rx_config.filter_ticks_thresh = 100;
+        config.rx_config.idle_threshold = TX_TIMING_IDLE_US;
+
+        if (rmt_config(&config) != ESP_OK ||
+            rmt_driver_install(channel, TX_TIMING_MAX_PULSES * sizeof(rmt_item32_t), 0) != ESP_OK ||
+            rmt_get_ringbuf_handle(channel, &rmtRingbuf) != ESP_OK) {
+            Serial.println("[TxTiming] Error: no se pudo iniciar RMT RX");
+            enabled = false;
+            return false;
+        }
+        driverReady = true;
+    }
+
+    // Loopback: el pad sigue como salida pero con el buffer de entrada
+    // habilitado y conectado a la entrada del canal RMT
+    gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT);
+    esp_rom_gpio_connect_in_signal(pin, RMT_SIG_IN0_IDX + channel, false);
+
+    // Descartar restos de una captura anterior
+    size_t size;
+    void* item;
+    while ((item = xRingbufferReceive(rmtRingbuf, &size, 0)) != nullptr) {
+        vRingbufferReturnItem(rmtRingbuf, item);
+    }
+
+    return rmt_rx_start(channel, true) == ESP_OK;
+}
+
+uint16_t TxTiming::finishCapture() {
+    rmt_channel_t channel = (rmt_channel_t)TX_TIMING_RMT_CHANNEL;
+    uint16_t count = 0;
+
+    // La captura termina sola tras TX_TIMING_IDLE_US sin flancos
+    size_t size = 0;
+    rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(rmtRingbuf, &size,
+                                                            pdMS_TO_TICKS(TX_TIMING_IDLE_US / 1000 + 20));
+    rmt_rx_stop(channel);
+    if (!items) return 0;
+
+    bool started = false;
+    size_t itemCount = size / sizeof(rmt_item32_t);
+    for (size_t i = 0; i < itemCount && count < TX_TIMING_MAX_PULSES; i++) {
+        uint16_t durations[2] = {(uint16_t)items[i].duration0, (uint16_t)items[i].duration1};
+        uint8_t levels[2] = {(uint8_t)items[i].level0, (uint8_t)items[i].level1};
+
+        for (int half = 0; half < 2 && count < TX_TIMING_MAX_PULSES; half++) {
+            if (durations[half] == 0) break;    // Fin (idle)
+            if (!started && !levels[half]) continue;    // LOW previo al primer flanco
+            started = true;
+            measured[count++] = durations[half];
+        }
+    }
+    vRingbufferReturnItem(rmtRingbuf, items);
+
+    return count;
+}
+
+#endif
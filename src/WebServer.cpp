@@ -5,6 +5,21 @@
 #include "DooyaBidir.h"
 #include "AOK_Protocol.h"
 #include "MQTTClient.h"
+#include "BootManager.h"
+#include "TimeManager.h"
+#include "TxTiming.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "HeapMonitor.h"
+#include "DeviceGroups.h"
+#include "Scenes.h"
+#include "CoverPositions.h"
+#include "Schedules.h"
+#include "DeviceStates.h"
+#include "SignalIndex.h"
+#include "RxMonitor.h"
+#include "SomfyRemotes.h"
+#include <StreamString.h>
 
 WebServerManager webServer;
 
@@ -28,13 +43,12 @@ bool WebServerManager::begin(SystemConfig* config) {
     server = new ::WebServer(80);
     tempCapturedSignal = new RFSignal();
 
-    if (config->wifi_configured && strlen(config->wifi_ssid) > 0) {
-        if (connectWiFi(config->wifi_ssid, config->wifi_password)) {
-            Serial.println("[Web] Conectado a WiFi");
-        } else {
-            Serial.println("[Web] No se pudo conectar a WiFi, iniciando AP...");
-            startAP();
-        }
+    // No esperar a la asociación WiFi: el AP queda activo mientras tanto
+    // y loop() lo apaga cuando la conexión STA se establece
+    if (config->wifi_configured && strlen(config->wifi_ssid) > 0 &&
+        WiFi.status() == WL_CONNECTED) {
+        wifiConnected = true;
+        Serial.println("[Web] Conectado a WiFi");
     } else {
         startAP();
     }
@@ -194,6 +208,8 @@ void WebServerManager::loop() {
         // Si lleva 30 minutos en modo AP sin reconectar, reiniciar
         if (apMode && (millis() - apModeStartTime > 1800000)) {
             Serial.println("[Web] 30 min sin WiFi, reiniciando sistema...");
+            deviceStates.flush();   // Estados a republicar al volver
+            somfyRemotes.flush();
             delay(1000);
             ESP.restart();
         }
@@ -256,40 +272,118 @@ void WebServerManager::setupRoutes() {
     server->on("/api/rf/test", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
     server->on("/api/signal/repeat", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
     server->on("/api/signal/invert", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
+    server->on("/api/groups", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
+    server->on("/api/groups/send", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
+    server->on("/api/scenes", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
+    server->on("/api/scenes/run", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
+    server->on("/api/schedules", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
     server->on("/api/restore", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
     server->on("/api/wifi/connect", HTTP_OPTIONS, [this]() { handleCORS(); server->send(204); });
 
-    server->on("/", HTTP_GET, [this]() { handleRoot(); });
-    server->on("/api/status", HTTP_GET, [this]() { handleGetStatus(); });
-    server->on("/api/config", HTTP_GET, [this]() { handleGetConfig(); });
-    server->on("/api/config", HTTP_POST, [this]() { handleSaveConfig(); });
-    server->on("/api/devices", HTTP_GET, [this]() { handleGetDevices(); });
-    server->on("/api/devices", HTTP_POST, [this]() { handleAddDevice(); });
-    server->on("/api/devices/update", HTTP_POST, [this]() { handleUpdateDevice(); });
-    server->on("/api/devices/delete", HTTP_GET, [this]() { handleDeleteDevice(); });
-    server->on("/api/rf/transmit", HTTP_GET, [this]() { handleTransmitSignal(); });
-    server->on("/api/rf/capture/start", HTTP_GET, [this]() { handleStartCapture(); });
-    server->on("/api/rf/capture/stop", HTTP_GET, [this]() { handleStopCapture(); });
-    server->on("/api/rf/capture/get", HTTP_GET, [this]() { handleGetCapture(); });
-    server->on("/api/rf/signal/save", HTTP_POST, [this]() { handleSaveSignal(); });
-    server->on("/api/rf/signal/delete", HTTP_POST, [this]() { handleDeleteSignal(); });
-    server->on("/api/rf/test", HTTP_POST, [this]() { handleTestSignal(); });
-    server->on("/api/signal/repeat", HTTP_POST, [this]() { handleUpdateSignalRepeat(); });
-    server->on("/api/signal/invert", HTTP_POST, [this]() { handleUpdateSignalInvert(); });
-    server->on("/api/rf/frequency", HTTP_GET, [this]() { handleSetFrequency(); });
-    server->on("/api/rf/scan", HTTP_GET, [this]() { handleScanFrequency(); });
-    server->on("/api/rf/identify", HTTP_GET, [this]() { handleIdentifySignal(); });
-    server->on("/api/rf/decode-aok", HTTP_POST, [this]() { handleDecodeAOK(); });
-    server->on("/api/backup", HTTP_GET, [this]() { handleBackup(); });
-    server->on("/api/restore", HTTP_POST, [this]() { handleRestore(); });
-    server->on("/api/wifi/scan", HTTP_GET, [this]() { handleWiFiScan(); });
-    server->on("/api/wifi/connect", HTTP_POST, [this]() { handleWiFiConnect(); });
-    server->on("/api/mqtt/rediscover", HTTP_POST, [this]() { handleMqttRediscover(); });
-    server->on("/api/reboot", HTTP_GET, [this]() { handleReboot(); });
-    server->on("/api/factory-reset", HTTP_GET, [this]() { handleFactoryReset(); });
+    route("/", HTTP_GET, &WebServerManager::handleRoot);
+    route("/api/status", HTTP_GET, &WebServerManager::handleGetStatus);
+    route("/api/config", HTTP_GET, &WebServerManager::handleGetConfig);
+    route("/api/config", HTTP_POST, &WebServerManager::handleSaveConfig);
+    route("/api/devices", HTTP_GET, &WebServerManager::handleGetDevices);
+    route("/api/devices", HTTP_POST, &WebServerManager::handleAddDevice);
+    route("/api/devices/update", HTTP_POST, &WebServerManager::handleUpdateDevice);
+    route("/api/devices/delete", HTTP_GET, &WebServerManager::handleDeleteDevice);
+    route("/api/groups", HTTP_GET, &WebServerManager::handleGetGroups);
+    route("/api/groups", HTTP_POST, &WebServerManager::handleSaveGroups);
+    route("/api/groups/send", HTTP_POST, &WebServerManager::handleSendGroup);
+    route("/api/scenes", HTTP_GET, &WebServerManager::handleGetScenes);
+    route("/api/scenes", HTTP_POST, &WebServerManager::handleSaveScenes);
+    route("/api/scenes/run", HTTP_POST, &WebServerManager::handleRunScene);
+    route("/api/schedules", HTTP_GET, &WebServerManager::handleGetSchedules);
+    route("/api/schedules", HTTP_POST, &WebServerManager::handleSaveSchedules);
+    route("/api/schedules/next", HTTP_GET, &WebServerManager::handleGetNextSchedules);
+    route("/api/rf/transmit", HTTP_GET, &WebServerManager::handleTransmitSignal);
+    route("/api/rf/capture/start", HTTP_GET, &WebServerManager::handleStartCapture);
+    route("/api/rf/capture/stop", HTTP_GET, &WebServerManager::handleStopCapture);
+    route("/api/rf/capture/get", HTTP_GET, &WebServerManager::handleGetCapture);
+    route("/api/rf/signal/save", HTTP_POST, &WebServerManager::handleSaveSignal);
+    route("/api/rf/signal/duplicates", HTTP_GET, &WebServerManager::handleSignalDuplicates);
+    route("/api/rf/somfy/remotes", HTTP_GET, &WebServerManager::handleGetSomfyRemotes);
+    route("/api/rf/signal/delete", HTTP_POST, &WebServerManager::handleDeleteSignal);
+    route("/api/rf/test", HTTP_POST, &WebServerManager::handleTestSignal);
+    route("/api/signal/repeat", HTTP_POST, &WebServerManager::handleUpdateSignalRepeat);
+    route("/api/signal/invert", HTTP_POST, &WebServerManager::handleUpdateSignalInvert);
+    route("/api/rf/frequency", HTTP_GET, &WebServerManager::handleSetFrequency);
+    route("/api/rf/scan", HTTP_GET, &WebServerManager::handleScanFrequency);
+    route("/api/rf/identify", HTTP_GET, &WebServerManager::handleIdentifySignal);
+    route("/api/rf/decode-aok", HTTP_POST, &WebServerManager::handleDecodeAOK);
+    route("/api/rf/trace/record", HTTP_GET, &WebServerManager::handleRecordTrace);
+    route("/api/rf/trace/download", HTTP_GET, &WebServerManager::handleDownloadTrace);
+    route("/api/metrics", HTTP_GET, &WebServerManager::handleGetMetrics);
+    route("/metrics", HTTP_GET, &WebServerManager::handlePrometheusMetrics);
+    route("/api/logs", HTTP_GET, &WebServerManager::handleGetLogs);
+    route("/api/metrics/tx-monitor", HTTP_GET, &WebServerManager::handleTxMonitor);
+    route("/api/backup", HTTP_GET, &WebServerManager::handleBackup);
+    route("/api/restore", HTTP_POST, &WebServerManager::handleRestore,
+          &WebServerManager::handleRestoreUpload);
+    route("/api/wifi/scan", HTTP_GET, &WebServerManager::handleWiFiScan);
+    route("/api/wifi/connect", HTTP_POST, &WebServerManager::handleWiFiConnect);
+    route("/api/mqtt/rediscover", HTTP_POST, &WebServerManager::handleMqttRediscover);
+    route("/api/reboot", HTTP_GET, &WebServerManager::handleReboot);
+    route("/api/factory-reset", HTTP_GET, &WebServerManager::handleFactoryReset);
     server->onNotFound([this]() { handleNotFound(); });
 }
 
+// Registra un handler midiendo su duración (METRIC_HTTP_HANDLER_US) y su uso de heap
+void WebServerManager::route(const char* uri, HTTPMethod method,
+                             void (WebServerManager::*handler)()) {
+    server->on(uri, method, [this, handler]() {
+        MetricScope scope(METRIC_HTTP_HANDLER_US);
+        HeapScope heap(HEAP_WEB);
+        (this->*handler)();
+    });
+}
+
+void WebServerManager::route(const char* uri, HTTPMethod method,
+                             void (WebServerManager::*handler)(),
+                             void (WebServerManager::*upload)()) {
+    server->on(uri, method, [this, handler]() {
+        MetricScope scope(METRIC_HTTP_HANDLER_US);
+        HeapScope heap(HEAP_WEB);
+        (this->*handler)();
+    }, [this, upload]() {
+        HeapScope heap(HEAP_WEB);
+        (this->*upload)();
+    });
+}
+
+// Respuesta chunked armada por partes de CHUNK bytes (sin Content-Length)
+class ChunkedResponse : public Print {
+public:
+    explicit ChunkedResponse(::WebServer* server) : server(server), used(0) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; i++) {
+            if (used == sizeof(buffer)) flush();
+            buffer[used++] = data[i];
+        }
+        return length;
+    }
+
+    void flush() {
+        if (used == 0) return;
+        server->sendContent(buffer, used);
+        used = 0;
+    }
+
+    void end() {
+        flush();
+        server->sendContent("");    // Chunk final
+    }
+
+private:
+    static const size_t CHUNK = 512;
+    ::WebServer* server;
+    char buffer[CHUNK];
+    size_t used;
+};
+
 void WebServerManager::handleRoot() {
     if (!checkAuth()) return;
 
@@ -343,8 +437,13 @@ void WebServerManager::handleGetStatus() {
     doc["rf_connected"] = rfConnected;
     doc["rf_frequency"] = rfConnected ? round(rfModule.getFrequency() * 100) / 100.0 : 0;
     doc["rf_capturing"] = rfConnected ? rfModule.isCapturing() : false;
+    doc["rf_listening"] = rfConnected ? rfModule.isListening() : false;
+    doc["rx_remote_presses"] = rxMonitor.getMatchCount();
+    doc["rx_noise_rejected"] = rfConnected ? rfModule.getListenNoise() : 0;
     doc["free_heap"] = ESP.getFreeHeap();
     doc["uptime"] = millis() / 1000;
+    doc["boot_rf_ready_ms"] = bootManager.getRadioReadyMs();
+    doc["boot_wifi_ready_ms"] = bootManager.getWifiReadyMs();
     doc["ota_url"] = "http://" + getIPAddress() + "/update";
     doc["version"] = FIRMWARE_VERSION;
 
@@ -366,6 +465,8 @@ void WebServerManager::handleGetConfig() {
     doc["mqtt_discovery"] = sysConfig->mqtt_discovery;
     doc["ntp_server"] = sysConfig->ntp_server;
     doc["timezone"] = sysConfig->timezone;
+    doc["latitude"] = sysConfig->latitude;
+    doc["longitude"] = sysConfig->longitude;
     doc["device_name"] = sysConfig->device_name;
     doc["default_frequency"] = sysConfig->default_frequency;
 
@@ -435,9 +536,23 @@ void WebServerManager::handleSaveConfig() {
     if (doc.containsKey("ntp_server")) {
         strlcpy(sysConfig->ntp_server, doc["ntp_server"] | "", sizeof(sysConfig->ntp_server));
     }
+    // Hora local y ubicación: cambian los próximos disparos de las programaciones
+    bool scheduleChanged = false;
     if (doc.containsKey("timezone")) {
+        scheduleChanged = true;
         strlcpy(sysConfig->timezone, doc["timezone"] | "", sizeof(sysConfig->timezone));
     }
+    if (doc.containsKey("latitude") || doc.containsKey("longitude")) {
+        float latitude = doc["latitude"] | sysConfig->latitude;
+        float longitude = doc["longitude"] | sysConfig->longitude;
+        if (latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180) {
+            sendJsonError(400, "latitude/longitude fuera de rango");
+            return;
+        }
+        scheduleChanged = true;
+        sysConfig->latitude = latitude;
+        sysConfig->longitude = longitude;
+    }
     if (doc.containsKey("device_name")) {
         strlcpy(sysConfig->device_name, doc["device_name"] | "", sizeof(sysConfig->device_name));
     }
@@ -454,6 +569,10 @@ void WebServerManager::handleSaveConfig() {
                 mqttClient.begin(sysConfig);
             }
         }
+        if (scheduleChanged) {
+            timeManager.setTimezone(sysConfig->timezone);
+            schedules.reschedule();
+        }
         sendJsonResponse(200, "{\"success\":true,\"message\":\"Configuracion guardada\"}");
     } else {
         sendJsonError(500, "Error al guardar configuracion");
@@ -475,16 +594,15 @@ void WebServerManager::handleGetDevices() {
         return;
     }
 
-    // Enviar el contenido del archivo directamente
-    String content = file.readString();
-    file.close();
-
-    if (content.length() == 0) {
+    if (file.size() == 0) {
+        file.close();
         sendJsonResponse(200, "[]");
         return;
     }
 
-    sendJsonResponse(200, content);
+    // Enviar el archivo en streaming (sin copiarlo completo a un String)
+    server->streamFile(file, "application/json");
+    file.close();
 }
 
 void WebServerManager::handleAddDevice() {
@@ -531,6 +649,15 @@ void WebServerManager::handleAddDevice() {
         device.aok.channel = doc.containsKey("aok_channel") ? (uint8_t)doc["aok_channel"].as<int>() : 1;
     }
 
+    // Recorrido medido en ms (cortinas): habilita la posición en Home Assistant
+    device.travelOpenMs = doc["travel_open_ms"] | 0UL;
+    device.travelCloseMs = doc["travel_close_ms"] | 0UL;
+    if (!CoverPositions::isValidTravel(device.travelOpenMs) ||
+        !CoverPositions::isValidTravel(device.travelCloseMs)) {
+        sendJsonError(400, "travel_open_ms/travel_close_ms fuera de rango");
+        return;
+    }
+
     if (storage.addDevice(&device)) {
         StaticJsonDocument<256> response;
         response["success"] = true;
@@ -589,6 +716,14 @@ void WebServerManager::handleUpdateDevice() {
     if (doc.containsKey("dooya_unit_code")) device.dooyaBidir.unitCode = doc["dooya_unit_code"];
     if (doc.containsKey("aok_remote_id")) device.aok.remoteId = doc["aok_remote_id"];
     if (doc.containsKey("aok_channel")) device.aok.channel = doc["aok_channel"];
+    if (doc.containsKey("travel_open_ms")) device.travelOpenMs = doc["travel_open_ms"];
+    if (doc.containsKey("travel_close_ms")) device.travelCloseMs = doc["travel_close_ms"];
+
+    if (!CoverPositions::isValidTravel(device.travelOpenMs) ||
+        !CoverPositions::isValidTravel(device.travelCloseMs)) {
+        sendJsonError(400, "travel_open_ms/travel_close_ms fuera de rango");
+        return;
+    }
 
     if (storage.updateDevice(id, &device)) {
         sendJsonResponse(200, "{\"success\":true,\"message\":\"Dispositivo actualizado\"}");
@@ -614,8 +749,198 @@ void WebServerManager::handleDeleteDevice() {
     }
 }
 
+void WebServerManager::handleGetGroups() {
+    handleCORS();
+    server->send(200, "application/json", storage.getGroupsJson());
+}
+
+void WebServerManager::handleSaveGroups() {
+    handleCORS();
+    if (!checkAuth()) return;
+
+    if (!server->hasArg("plain")) {
+        sendJsonError(400, "No data received");
+        return;
+    }
+
+    if (storage.saveGroups(server->arg("plain"))) {
+        sendJsonResponse(200, "{\"success\":true,\"message\":\"Grupos guardados\"}");
+    } else {
+        sendJsonError(400, "Grupos no válidos");
+    }
+}
+
+// {"room": "Living", "command": "close"} o {"group": "planta_baja", "command": "open"}
+void WebServerManager::handleSendGroup() {
+    handleCORS();
+    metrics.commandReceived();
+
+    if (!server->hasArg("plain")) {
+        sendJsonError(400, "No data received");
+        return;
+    }
+
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, server->arg("plain"))) {
+        sendJsonError(400, "Invalid JSON");
+        return;
+    }
+
+    const char* room = doc["room"] | "";
+    const char* group = doc["group"] | "";
+    const char* command = doc["command"] | "";
+    if ((strlen(room) == 0 && strlen(group) == 0) || strlen(command) == 0) {
+        sendJsonError(400, "room o group y command requeridos");
+        return;
+    }
+
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        sendJsonError(503, "Radio no disponible");
+        return;
+    }
+
+    uint8_t queued = strlen(room) > 0
+        ? deviceGroups.sendToRoom(room, command, onGroupMemberSent)
+        : deviceGroups.sendToGroup(group, command, onGroupMemberSent);
+
+    if (queued == 0) {
+        sendJsonError(404, "Ningún miembro acepta el comando");
+        return;
+    }
+
+    // La ráfaga sale desde loop() al cerrar la ventana del planificador
+    char response[64];
+    snprintf(response, sizeof(response), "{\"success\":true,\"queued\":%u}", queued);
+    sendJsonResponse(200, response);
+}
+
+void WebServerManager::onGroupMemberSent(const char* deviceId, const char* command) {
+    if (!coverPositions.onCommandSent(deviceId, command)) {
+        mqttClient.publishDeviceState(deviceId, command);
+    }
+}
+
+void WebServerManager::handleGetScenes() {
+    handleCORS();
+    server->send(200, "application/json", storage.getScenesJson());
+}
+
+void WebServerManager::handleSaveScenes() {
+    handleCORS();
+    if (!checkAuth()) return;
+
+    if (!server->hasArg("plain")) {
+        sendJsonError(400, "No data received");
+        return;
+    }
+
+    // Ids publicados antes del cambio, para retirar de HA los que ya no están
+    char previous[MAX_SCENES][SCENE_ID_LENGTH];
+    uint8_t previousCount = scenes.getCount();
+    for (uint8_t i = 0; i < previousCount; i++) {
+        strlcpy(previous[i], scenes.getId(i), SCENE_ID_LENGTH);
+    }
+
+    if (!storage.saveScenes(server->arg("plain"))) {
+        sendJsonError(400, "Escenas no válidas");
+        return;
+    }
+
+    // Se precompilan ahora: ejecutarlas después no lee Storage
+    scenes.reload();
+    for (uint8_t i = 0; i < previousCount; i++) {
+        if (scenes.find(previous[i]) < 0) mqttClient.removeSceneDiscovery(previous[i]);
+    }
+    mqttClient.publishDiscovery();
+
+    char response[96];
+    snprintf(response, sizeof(response), "{\"success\":true,\"scenes\":%u,\"compiled_bytes\":%u}",
+             scenes.getCount(), (unsigned)scenes.getCompiledBytes());
+    sendJsonResponse(200, response);
+}
+
+void WebServerManager::handleGetSchedules() {
+    handleCORS();
+    server->send(200, "application/json", storage.getSchedulesJson());
+}
+
+void WebServerManager::handleSaveSchedules() {
+    handleCORS();
+    if (!checkAuth()) return;
+
+    if (!server->hasArg("plain")) {
+        sendJsonError(400, "No data received");
+        return;
+    }
+
+    if (!storage.saveSchedules(server->arg("plain"))) {
+        sendJsonError(400, "Programaciones no válidas");
+        return;
+    }
+
+    // Las reglas con campos cron inválidos se ignoran: "active" lo refleja
+    schedules.reload();
+
+    char response[64];
+    snprintf(response, sizeof(response), "{\"success\":true,\"active\":%u}", schedules.getCount());
+    sendJsonResponse(200, response);
+}
+
+// [{"id": "...", "next": epoch}] de las reglas activas (0 = sin disparo o sin hora)
+void WebServerManager::handleGetNextSchedules() {
+    handleCORS();
+
+    DynamicJsonDocument doc(256 + schedules.getCount() * 96);
+    JsonArray list = doc.to<JsonArray>();
+    for (uint8_t i = 0; i < schedules.getCount(); i++) {
+        JsonObject item = list.createNestedObject();
+        item["id"] = schedules.getId(i);
+        item["next"] = (uint32_t)schedules.getNextFire(i);
+    }
+
+    String response;
+    serializeJson(doc, response);
+    sendJsonResponse(200, response);
+}
+
+// {"scene": "noche"}
+void WebServerManager::handleRunScene() {
+    handleCORS();
+    metrics.commandReceived();
+
+    if (!server->hasArg("plain")) {
+        sendJsonError(400, "No data received");
+        return;
+    }
+
+    StaticJsonDocument<128> doc;
+    if (deserializeJson(doc, server->arg("plain"))) {
+        sendJsonError(400, "Invalid JSON");
+        return;
+    }
+
+    const char* sceneId = doc["scene"] | "";
+    if (scenes.find(sceneId) < 0) {
+        sendJsonError(404, "Escena no encontrada");
+        return;
+    }
+
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        sendJsonError(503, "Radio no disponible");
+        return;
+    }
+
+    // Los tramos salen desde loop()
+    if (!scenes.run(sceneId)) {
+        sendJsonError(409, "Hay otra escena en curso");
+        return;
+    }
+    sendJsonResponse(200, "{\"success\":true}");
+}
+
 void WebServerManager::handleTransmitSignal() {
     handleCORS();
+    metrics.commandReceived();
 
     String deviceId = server->arg("id");
     int signalIndex = server->arg("signal").toInt();
@@ -637,6 +962,16 @@ void WebServerManager::handleTransmitSignal() {
     Serial.printf("[Web] Device found: %s, type=%d, signalCount=%d\n",
                   device.name, device.type, device.signalCount);
 
+    // La radio se inicializa en segundo plano durante el arranque
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        sendJsonError(503, "Radio no disponible");
+        return;
+    }
+
+    // Señales 0-3 de las cortinas, para el modelo de posición
+    static const char* const curtainCommands[] = {"open", "close", "stop", "prog"};
+    const char* curtainCommand = (signalIndex >= 0 && signalIndex < 4) ? curtainCommands[signalIndex] : "";
+
     // Somfy RTS
     if (device.type == DEVICE_CURTAIN_SOMFY) {
         // Verificar que tenga dirección configurada
@@ -651,12 +986,14 @@ void WebServerManager::handleTransmitSignal() {
         else if (signalIndex == 2) cmd = SOMFY_CMD_MY;
         else if (signalIndex == 3) cmd = SOMFY_CMD_PROG;
 
+        somfyRemotes.applyRollingCode(device.id, &device.somfy);
         somfyRTS.setRemote(&device.somfy);
         bool success = somfyRTS.sendCommand(cmd);
 
         if (success) {
             device.somfy.rollingCode++;
             storage.updateSomfyRollingCode(deviceId.c_str(), device.somfy.rollingCode);
+            coverPositions.onCommandSent(deviceId.c_str(), curtainCommand);
             sendJsonResponse(200, "{\"success\":true,\"message\":\"Comando Somfy enviado\"}");
         } else {
             sendJsonError(500, "Error al enviar comando Somfy");
@@ -682,6 +1019,7 @@ void WebServerManager::handleTransmitSignal() {
         bool success = dooyaBidir.sendCommand(cmd);
 
         if (success) {
+            coverPositions.onCommandSent(deviceId.c_str(), curtainCommand);
             sendJsonResponse(200, "{\"success\":true,\"message\":\"Comando Dooya enviado\"}");
         } else {
             sendJsonError(500, "Error al enviar comando Dooya");
@@ -709,6 +1047,7 @@ void WebServerManager::handleTransmitSignal() {
         bool success = aokProtocol.sendCommand(cmd);
 
         if (success) {
+            coverPositions.onCommandSent(deviceId.c_str(), curtainCommand);
             sendJsonResponse(200, "{\"success\":true,\"message\":\"Comando A-OK enviado\"}");
         } else {
             sendJsonError(500, "Error al enviar comando A-OK");
@@ -755,6 +1094,9 @@ void WebServerManager::handleTransmitSignal() {
                   device.signals[signalIndex].length, repeats);
 
     if (rfModule.transmitRaw(device.signals[signalIndex].data, device.signals[signalIndex].length, repeats, device.signals[signalIndex].inverted)) {
+        if (device.type == DEVICE_CURTAIN) {
+            coverPositions.onCommandSent(deviceId.c_str(), curtainCommand);
+        }
         if (onSignalTransmit) {
             onSignalTransmit(deviceId.c_str(), signalIndex);
         }
@@ -823,7 +1165,7 @@ void WebServerManager::handleGetCapture() {
                 Serial.printf("[Web] Señal guardada en tempCapturedSignal: %d bytes\n", signal.length);
             }
 
-            DynamicJsonDocument doc(2048);  // Use heap for large signal data
+            DynamicJsonDocument doc(3072);  // Use heap for large signal data
             doc["success"] = true;
             doc["valid"] = true;
             doc["frequency"] = round(signal.frequency * 100) / 100.0;  // Round to 2 decimals
@@ -840,6 +1182,9 @@ void WebServerManager::handleGetCapture() {
             }
             doc["data"] = hexData;
 
+            // Señales guardadas con la misma huella ("ya es el botón Y de X")
+            addSignalMatches(doc.createNestedArray("matches"), &signal, nullptr, -1);
+
             String response;
             serializeJson(doc, response);
             sendJsonResponse(200, response);
@@ -922,10 +1267,131 @@ void WebServerManager::handleSaveSignal() {
     Serial.printf("[Web] Saving signal: valid=%d, freq=%.2f, mod=%d, len=%d, repeat=%d\n",
                   signal.valid, signal.frequency, signal.modulation, signal.length, signal.repeatCount);
 
-    if (storage.saveSignalToDevice(deviceId, signalIndex, &signal, signalName)) {
-        sendJsonResponse(200, "{\"success\":true,\"message\":\"Senal guardada\"}");
-    } else {
+    if (!storage.saveSignalToDevice(deviceId, signalIndex, &signal, signalName)) {
         sendJsonError(500, "Error al guardar senal");
+        return;
+    }
+
+    // La misma señal ya guardada en otros botones: se informa, no se rechaza
+    // (un control puede mover dos dispositivos a propósito)
+    DynamicJsonDocument response(1536);
+    response["success"] = true;
+    response["message"] = "Senal guardada";
+    addSignalMatches(response.createNestedArray("duplicates"), &signal, deviceId, signalIndex);
+
+    String output;
+    serializeJson(response, output);
+    sendJsonResponse(200, output);
+}
+
+// Grupos de señales guardadas con la misma huella
+void WebServerManager::handleSignalDuplicates() {
+    handleCORS();
+
+    DynamicJsonDocument doc(4096);
+    JsonArray groups = doc.to<JsonArray>();
+
+    uint16_t count = signalIndex.getCount();
+    SignalMatch a, b;
+    SignalFingerprint fa, fb;
+
+    for (uint16_t i = 0; i < count; i++) {
+        signalIndex.getEntry(i, &a, &fa);
+
+        // Cada grupo sale una vez, desde su primera entrada
+        bool first = true;
+        for (uint16_t j = 0; j < i && first; j++) {
+            signalIndex.getEntry(j, &b, &fb);
+            if (SignalIndex::matches(fa, fb)) first = false;
+        }
+        if (!first) continue;
+
+        JsonArray members;
+        for (uint16_t j = i + 1; j < count; j++) {
+            signalIndex.getEntry(j, &b, &fb);
+            if (!SignalIndex::matches(fa, fb)) continue;
+
+            if (members.isNull()) {
+                JsonObject group = groups.createNestedObject();
+                char hash[9];
+                snprintf(hash, sizeof(hash), "%08lx", (unsigned long)fa.hash);
+                group["fingerprint"] = String(hash);
+                members = group.createNestedArray("signals");
+
+                JsonObject member = members.createNestedObject();
+                member["device"] = a.deviceId;
+                member["signal"] = a.signal;
+            }
+            JsonObject member = members.createNestedObject();
+            member["device"] = b.deviceId;
+            member["signal"] = b.signal;
+        }
+    }
+
+    String response;
+    serializeJson(doc, response);
+    sendJsonResponse(200, response);
+}
+
+// Controles Somfy físicos escuchados y las cortinas con su dirección
+void WebServerManager::handleGetSomfyRemotes() {
+    handleCORS();
+
+    DynamicJsonDocument doc(2048);
+    JsonArray remotes = doc.to<JsonArray>();
+    unsigned long now = millis();
+
+    for (uint8_t i = 0; i < somfyRemotes.getCount(); i++) {
+        const SomfyRemoteSeen* remote = somfyRemotes.get(i);
+
+        char address[9];
+        snprintf(address, sizeof(address), "0x%06lX", (unsigned long)remote->address);
+
+        JsonObject item = remotes.createNestedObject();
+        item["address"] = String(address);
+        item["rolling_code"] = remote->rollingCode;
+        item["command"] = remote->command;
+        item["last_seen_s"] = (now - remote->lastSeen) / 1000;
+
+        const char* ids[SIGNAL_MATCH_MAX];
+        uint8_t count = somfyRemotes.findDevices(remote->address, ids, SIGNAL_MATCH_MAX);
+        JsonArray devices = item.createNestedArray("devices");
+        for (uint8_t j = 0; j < count; j++) {
+            devices.add(ids[j]);
+        }
+    }
+
+    String response;
+    serializeJson(doc, response);
+    sendJsonResponse(200, response);
+}
+
+// [{"device","name","signal","signalName"}] de las señales guardadas con la
+// misma huella que signal, salvo (excludeId, excludeSignal)
+void WebServerManager::addSignalMatches(JsonArray matches, const RFSignal* signal,
+                                        const char* excludeId, int8_t excludeSignal) {
+    SignalFingerprint fp;
+    if (!SignalIndex::fingerprint(signal, &fp)) return;
+
+    SignalMatch found[SIGNAL_MATCH_MAX];
+    uint8_t count = signalIndex.find(fp, found, SIGNAL_MATCH_MAX);
+
+    SavedDevice device;     // Solo para los nombres de las coincidencias
+    for (uint8_t i = 0; i < count; i++) {
+        if (excludeId && found[i].signal == excludeSignal &&
+            strcmp(found[i].deviceId, excludeId) == 0) continue;
+
+        JsonObject match = matches.createNestedObject();
+        match["device"] = String(found[i].deviceId);
+        match["signal"] = found[i].signal;
+        if (storage.getDevice(found[i].deviceId, &device)) {
+            match["name"] = String(device.name);
+            if (device.type == DEVICE_CURTAIN_AOK) {
+                match["signalName"] = TxScheduler::getSignalCommand(device.type, found[i].signal);
+            } else {
+                match["signalName"] = String(device.signalNames[found[i].signal]);
+            }
+        }
     }
 }
 
@@ -965,6 +1431,7 @@ void WebServerManager::handleDeleteSignal() {
 
 void WebServerManager::handleTestSignal() {
     handleCORS();
+    metrics.commandReceived();
     Serial.println("[Web] handleTestSignal called");
 
     if (!server->hasArg("plain")) {
@@ -1338,26 +1805,217 @@ void WebServerManager::handleDecodeAOK() {
     sendJsonResponse(200, response);
 }
 
-void WebServerManager::handleBackup() {
+void WebServerManager::handleRecordTrace() {
     handleCORS();
+    if (!checkAuth()) return;
 
-    String backup = storage.createBackup();
-    server->sendHeader("Content-Disposition", "attachment; filename=rf_controller_backup.json");
-    server->send(200, "application/json", backup);
+    if (!bootManager.waitFor(BOOT_RADIO_READY, BOOT_RADIO_WAIT_MS)) {
+        sendJsonError(503, "Radio no disponible");
+        return;
+    }
+
+    int seconds = server->arg("seconds").toInt();
+    if (seconds <= 0) seconds = 10;
+    if (seconds > TRACE_MAX_SECONDS) seconds = TRACE_MAX_SECONDS;
+
+    float frequency = server->arg("frequency").toFloat();
+    if (frequency > 0) rfModule.setFrequency(frequency);
+    if (server->hasArg("modulation")) rfModule.setModulation(server->arg("modulation").toInt());
+
+    File file = LittleFS.open(TRACE_FILE, "w");
+    if (!file) {
+        sendJsonError(500, "No se pudo crear el archivo de grabación");
+        return;
+    }
+
+    uint32_t startUnix = timeManager.isSynced() ? (uint32_t)timeManager.getEpochTime() : 0;
+    int segments = rfModule.recordTrace(file, seconds * 1000UL, startUnix);
+    size_t bytes = file.size();
+    file.close();
+
+    if (segments < 0) {
+        sendJsonError(500, "Error al grabar");
+        return;
+    }
+
+    StaticJsonDocument<192> doc;
+    doc["success"] = true;
+    doc["segments"] = segments;
+    doc["bytes"] = bytes;
+    doc["frequency"] = rfModule.getFrequency();
+    doc["url"] = "/api/rf/trace/download";
+    String response;
+    serializeJson(doc, response);
+    sendJsonResponse(200, response);
 }
 
-void WebServerManager::handleRestore() {
+void WebServerManager::handleDownloadTrace() {
     handleCORS();
     if (!checkAuth()) return;
 
-    if (!server->hasArg("plain")) {
-        sendJsonError(400, "No data received");
+    if (!LittleFS.exists(TRACE_FILE)) {
+        sendJsonError(404, "No hay grabación");
         return;
     }
 
-    String body = server->arg("plain");
+    File file = LittleFS.open(TRACE_FILE, "r");
+    server->sendHeader("Content-Disposition", "attachment; filename=trace.ptr");
+    server->streamFile(file, "application/octet-stream");
+    file.close();
+}
+
+void WebServerManager::handleGetMetrics() {
+    handleCORS();
+
+    StaticJsonDocument<2048> doc;
+    JsonObject tx = doc.createNestedObject("tx_timing");
+    tx["enabled"] = txTiming.isEnabled();
+    tx["transmissions"] = txTiming.getTransmissions();
+    tx["count_mismatches"] = txTiming.getMismatches();
+    tx["worst_us"] = txTiming.getWorstUs();
+
+    const TxTimingStats& last = txTiming.getLastStats();
+    JsonObject lastObj = tx.createNestedObject("last");
+    lastObj["pulses"] = last.pulses;
+    lastObj["mean_us"] = round(last.meanUs * 10) / 10.0;
+    lastObj["p99_us"] = last.p99Us;
+    lastObj["max_us"] = last.maxUs;
+    lastObj["count_mismatch"] = last.countMismatch;
+
+    // Histograma de |error| por pulso: límite superior en µs -> cantidad
+    JsonArray histogram = tx.createNestedArray("histogram");
+    for (uint8_t i = 0; i < TX_TIMING_BUCKETS; i++) {
+        JsonObject bucket = histogram.createNestedObject();
+        if (i < TX_TIMING_BUCKETS - 1) {
+            bucket["le_us"] = TxTiming::getBucketBound(i);
+        } else {
+            bucket["le_us"] = "inf";
+        }
+        bucket["count"] = txTiming.getBucketCount(i);
+    }
 
-    if (storage.restoreBackup(body)) {
+    JsonObject heap = doc.createNestedObject("heap");
+    heap["free"] = heapMonitor.getFree();
+    heap["min_free"] = heapMonitor.getMinFree();
+    heap["largest_block"] = heapMonitor.getLargestBlock();
+    heap["largest_block_min"] = heapMonitor.getMinLargestBlock();
+    heap["fragmentation"] = heapMonitor.getFragmentation();
+    heap["alloc_failures"] = heapMonitor.getAllocFailures();
+    heap["alert"] = heapMonitor.isAlertActive();
+
+    JsonObject subsystems = heap.createNestedObject("subsystems");
+    for (uint8_t i = 0; i < HEAP_SUBSYSTEM_COUNT; i++) {
+        const HeapSubsystemStats& stats = heapMonitor.getStats((HeapSubsystem)i);
+        JsonObject entry = subsystems.createNestedObject(HeapMonitor::getSubsystemName((HeapSubsystem)i));
+        entry["calls"] = stats.calls;
+        entry["retained"] = stats.retainedBytes;
+        entry["peak_retained"] = stats.peakRetained;
+        entry["alloc_failures"] = stats.allocFailures;
+    }
+
+    String response;
+    serializeJson(doc, response);
+    sendJsonResponse(200, response);
+}
+
+// Formato de texto Prometheus (scrape directo, sin autenticación como /api/status)
+void WebServerManager::handlePrometheusMetrics() {
+    StreamString body;
+    metrics.writePrometheus(body);
+    server->send(200, "text/plain; version=0.0.4", body);
+}
+
+// Últimas líneas del logger; ?since=<next> devuelve solo las nuevas
+void WebServerManager::handleGetLogs() {
+    handleCORS();
+    if (!checkAuth()) return;
+
+    uint32_t cursor = logger.getOldest();
+    if (server->hasArg("since")) {
+        cursor = strtoul(server->arg("since").c_str(), nullptr, 10);
+    }
+
+    DynamicJsonDocument doc(LOG_RING_SIZE * (LOG_LINE_MAX + 48) + 128);
+    JsonArray lines = doc.createNestedArray("lines");
+
+    LogLine line;
+    uint32_t skipped = 0;
+    while (logger.read(cursor, line, &skipped)) {
+        JsonObject entry = lines.createNestedObject();
+        entry["seq"] = line.seq;
+        entry["ms"] = line.ms;
+        char level[2] = {Logger::levelChar(line.level), '\0'};
+        entry["level"] = level;         // char* -> ArduinoJson copia el texto
+        entry["msg"] = line.text;
+    }
+
+    doc["next"] = cursor;
+    doc["skipped"] = skipped;
+    doc["dropped"] = logger.getDropped();
+
+    String response;
+    serializeJson(doc, response);
+    sendJsonResponse(200, response);
+}
+
+void WebServerManager::handleTxMonitor() {
+    handleCORS();
+    if (!checkAuth()) return;
+
+    if (server->hasArg("enabled")) {
+        String value = server->arg("enabled");
+        txTiming.setEnabled(value == "1" || value == "true" || value == "on");
+    }
+    if (server->arg("reset") == "1") {
+        txTiming.reset();
+    }
+
+    sendJsonResponse(200, String("{\"success\":true,\"enabled\":") +
+                          (txTiming.isEnabled() ? "true" : "false") + "}");
+}
+
+void WebServerManager::handleBackup() {
+    handleCORS();
+
+    // El backup sale directo a la respuesta: su tamaño no depende de la RAM
+    server->sendHeader("Content-Disposition", "attachment; filename=rf_controller_backup.json");
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, "application/json", "");
+
+    ChunkedResponse response(server);
+    storage.createBackup(response);
+    response.end();
+}
+
+// El cuerpo llega en bloques de HTTP_RAW_BUFLEN antes de handleRestore()
+void WebServerManager::handleRestoreUpload() {
+    HTTPRaw& raw = server->raw();
+
+    switch (raw.status) {
+        case RAW_START:
+            if (server->authenticate(WEB_AUTH_USER, WEB_AUTH_PASSWORD)) {
+                storage.beginRestoreUpload();
+            }
+            break;
+        case RAW_WRITE:
+            storage.appendRestoreUpload(raw.buf, raw.currentSize);
+            break;
+        case RAW_ABORTED:
+            storage.abortRestoreUpload();
+            break;
+        default:
+            break;
+    }
+}
+
+void WebServerManager::handleRestore() {
+    handleCORS();
+    if (!checkAuth()) {
+        storage.abortRestoreUpload();
+        return;
+    }
+
+    if (storage.restoreUploaded()) {
         sendJsonResponse(200, "{\"success\":true,\"message\":\"Backup restaurado. Reiniciando...\"}");
         delay(1000);
         ESP.restart();
@@ -1448,6 +2106,8 @@ void WebServerManager::handleWiFiConnect() {
 
     sendJsonResponse(200, "{\"success\":true,\"message\":\"Conectando a WiFi... Reiniciando...\"}");
 
+    deviceStates.flush();
+    somfyRemotes.flush();
     delay(1000);
     ESP.restart();
 }
@@ -1460,8 +2120,8 @@ void WebServerManager::handleMqttRediscover() {
         return;
     }
 
-    mqttClient.publishDiscovery();
-    sendJsonResponse(200, "{\"success\":true,\"message\":\"Discovery publicado\"}");
+    mqttClient.publishDiscovery(true);
+    sendJsonResponse(200, "{\"success\":true,\"message\":\"Discovery en curso\"}");
 }
 
 void WebServerManager::handleReboot() {
@@ -1469,6 +2129,8 @@ void WebServerManager::handleReboot() {
     if (!checkAuth()) return;
 
     sendJsonResponse(200, "{\"success\":true,\"message\":\"Reiniciando...\"}");
+    deviceStates.flush();
+    somfyRemotes.flush();
     delay(1000);
     ESP.restart();
 }
@@ -6,29 +6,39 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <LittleFS.h>
 
 #include "config.h"
 #include "Storage.h"
 #include "CC1101_RF.h"
-#include "SomfyRTS.h"
-#include "DooyaBidir.h"
-#include "AOK_Protocol.h"
 #include "WebServerManager.h"
 #include "MQTTClient.h"
 #include "TimeManager.h"
+#include "BootManager.h"
+#include "Logger.h"
+#include "HeapMonitor.h"
+#include "TxScheduler.h"
+#include "Scenes.h"
+#include "CoverPositions.h"
+#include "Schedules.h"
+#include "DeviceStates.h"
+#include "MQTTTopics.h"
+#include "SignalIndex.h"
+#include "RxMonitor.h"
+#include "SomfyRemotes.h"
 
 // Configuración del sistema
 SystemConfig systemConfig;
 
 // Variables de estado
 bool systemReady = false;
+bool mqttStarted = false;
 unsigned long lastStatusPrint = 0;
 
 // Prototipos
 void initSystem();
 void printStatus();
-void handleRFCommand(const char* deviceId, const char* command);
+void handleHeapAlert(bool active, uint8_t fragmentation);
+void handleDeviceChanged(const char* id, const SavedDevice* device);
 void WiFiEvent(WiFiEvent_t event);
 
 // Callback para eventos WiFi
@@ -39,9 +49,11 @@ void WiFiEvent(WiFiEvent_t event) {
             break;
         case ARDUINO_EVENT_WIFI_STA_GOT_IP:
             Serial.printf("[WiFi] IP obtenida: %s\n", WiFi.localIP().toString().c_str());
+            bootManager.setReady(BOOT_WIFI_READY);
             break;
         case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
             Serial.println("[WiFi] Desconectado - reconectando...");
+            bootManager.clearReady(BOOT_WIFI_READY);
             if (systemConfig.wifi_configured && strlen(systemConfig.wifi_ssid) > 0) {
                 WiFi.reconnect();
             }
@@ -52,8 +64,12 @@ void WiFiEvent(WiFiEvent_t event) {
 }
 
 void setup() {
+    bootManager.begin();
+
     Serial.begin(115200);
-    delay(500);
+    logger.begin();
+    heapMonitor.begin();
+    heapMonitor.setAlertCallback(handleHeapAlert);
 
     Serial.println();
     Serial.println("==============================================");
@@ -72,11 +88,29 @@ void loop() {
     }
 
     webServer.loop();
+    timeManager.loop();
+    heapMonitor.loop();
+
+    // MQTT arranca cuando la asociación WiFi (en segundo plano) termina
+    if (!mqttStarted && systemConfig.mqtt_enabled && bootManager.isReady(BOOT_WIFI_READY)) {
+        Serial.println("[Main] WiFi listo, configurando MQTT...");
+        mqttClient.begin(&systemConfig);
+        mqttStarted = true;
+    }
 
     if (systemConfig.mqtt_enabled && WiFi.status() == WL_CONNECTED) {
         mqttClient.loop();
     }
 
+    // Ráfagas de TX agrupadas por perfil de radio
+    txScheduler.loop();
+    scenes.loop();
+    coverPositions.loop();
+    schedules.loop();
+    deviceStates.loop();
+    rxMonitor.loop();
+    somfyRemotes.loop();
+
     if (millis() - lastStatusPrint > 60000) {
         printStatus();
         lastStatusPrint = millis();
@@ -84,9 +118,12 @@ void loop() {
 }
 
 void initSystem() {
+    // Arranque por etapas: solo Storage es secuencial (la radio necesita la
+    // configuración). Radio, asociación WiFi y NTP corren en paralelo y
+    // publican su disponibilidad en bootManager.
+
     // 1. WiFi AP+STA (modo mixto para permitir escaneo de redes)
     Serial.println("[1/6] Configurando WiFi...");
-    Serial.flush();
 
     // Registrar callback de eventos WiFi para reconexión automática
     WiFi.onEvent(WiFiEvent);
@@ -100,111 +137,75 @@ void initSystem() {
     WiFi.mode(WIFI_AP_STA);
     WiFi.softAP(AP_SSID, AP_PASSWORD);
     Serial.println("[OK] WiFi AP iniciado (modo mixto)");
-    Serial.flush();
 
     // 2. Storage
     Serial.println("[2/6] Inicializando Storage...");
-    Serial.flush();
     if (!storage.begin()) {
         Serial.println("[ERROR] Storage falló!");
         return;
     }
     Serial.println("[OK] Storage inicializado");
-    Serial.flush();
 
     // Cargar configuración
     storage.setDefaultConfig(&systemConfig);
     storage.loadConfig(&systemConfig);
+    bootManager.setReady(BOOT_STORAGE_READY);
+
+    // Cachés derivadas de devices.json, con o sin MQTT
+    storage.setDeviceChangeCallback(handleDeviceChanged);
+
+    // Escenas precompiladas desde scenes.json + devices.json
+    scenes.begin();
+
+    // Posición estimada de las cortinas con recorrido medido
+    coverPositions.begin();
+
+    // Último estado de cada dispositivo (replay al reconectar MQTT)
+    deviceStates.begin();
+
+    // Huellas de las señales guardadas (coincidencias al capturar y al recibir)
+    signalIndex.begin();
+
+    // Cortinas Somfy que siguen el rolling code de su control físico
+    somfyRemotes.begin();
+
+    // Controles físicos: escucha continua cuando la radio queda libre
+    rxMonitor.begin(&systemConfig);
+
+    // Programaciones (cron y sol); empiezan a disparar al sincronizar la hora
+    schedules.begin(&systemConfig);
 
-    // Intentar WiFi cliente si está configurado (manteniendo AP activo)
+    // 3. CC1101 - en segundo plano, sin esperar a la red
+    Serial.println("[3/6] CC1101 (en segundo plano)...");
+    bootManager.startRadio(&systemConfig);
+
+    // Iniciar asociación WiFi sin bloquear (manteniendo AP activo).
+    // El evento GOT_IP marca BOOT_WIFI_READY; webServer.loop() apaga el AP.
     if (systemConfig.wifi_configured && strlen(systemConfig.wifi_ssid) > 0) {
-        Serial.printf("[INFO] Conectando a %s...\n", systemConfig.wifi_ssid);
+        Serial.printf("[INFO] Conectando a %s (en segundo plano)...\n", systemConfig.wifi_ssid);
         // Configurar hostname antes de conectar
         WiFi.setHostname(systemConfig.device_name);
         // Ya estamos en WIFI_AP_STA, solo iniciamos conexión
         WiFi.begin(systemConfig.wifi_ssid, systemConfig.wifi_password);
-
-        int attempts = 0;
-        while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-            delay(500);
-            Serial.print(".");
-            attempts++;
-        }
-
-        if (WiFi.status() == WL_CONNECTED) {
-            Serial.printf("\n[OK] Conectado! IP: %s\n", WiFi.localIP().toString().c_str());
-            // Apagar AP cuando hay WiFi conectado
-            WiFi.softAPdisconnect(true);
-            WiFi.mode(WIFI_STA);
-            Serial.println("[INFO] AP apagado (WiFi conectado)");
-        } else {
-            Serial.println("\n[WARNING] No se pudo conectar, AP sigue activo");
-        }
     }
 
-    // 3. CC1101 - Solo inicializar si hay WiFi conectado (evita interferencia)
-    Serial.println("[3/6] CC1101...");
-    Serial.flush();
-    if (WiFi.status() == WL_CONNECTED) {
-        if (!rfModule.begin()) {
-            Serial.println("[WARNING] CC1101 no detectado");
-        } else {
-            rfModule.setFrequency(systemConfig.default_frequency);
-            rfModule.setModulation(systemConfig.default_modulation);
-            Serial.println("[OK] CC1101 inicializado");
-            somfyRTS.begin(CC1101_GDO0);
-            dooyaBidir.begin();
-            aokProtocol.begin();
-        }
-    } else {
-        Serial.println("[INFO] CC1101 desactivado hasta conectar WiFi (evita interferencia)");
-    }
-    Serial.flush();
-
     // 4. WebServer
     Serial.println("[4/6] Iniciando WebServer...");
-    Serial.flush();
     if (!webServer.begin(&systemConfig)) {
         Serial.println("[WARNING] WebServer falló");
     } else {
         Serial.println("[OK] WebServer iniciado");
     }
-    Serial.flush();
 
-    // 5. Time
-    Serial.println("[5/6] Configurando hora...");
-    if (WiFi.status() == WL_CONNECTED) {
-        timeManager.begin(&systemConfig);
-    } else {
-        Serial.println("[INFO] Sin WiFi, hora no sincronizada");
-    }
+    // 5. Time - SNTP arranca desde timeManager.loop() al conectar WiFi
+    Serial.println("[5/6] Configurando hora (al conectar WiFi)...");
+    bootManager.startTimeSync(&systemConfig);
 
-    // 6. MQTT
-    Serial.println("[6/6] Configurando MQTT...");
-    if (systemConfig.mqtt_enabled && WiFi.status() == WL_CONNECTED) {
-        mqttClient.begin(&systemConfig);
-        mqttClient.setCommandCallback(handleRFCommand);
-        Serial.println("[OK] MQTT configurado");
-    } else {
-        Serial.println("[INFO] MQTT deshabilitado o sin WiFi");
-    }
+    // 6. MQTT - se inicia desde loop() cuando hay WiFi
+    Serial.println("[6/6] MQTT se configura al conectar WiFi");
 
-    // Contar dispositivos sin cargarlos todos en RAM
-    // NOTA: No cargamos el array completo porque consume demasiada RAM
-    uint8_t deviceCount = 0;
-    if (LittleFS.exists(DEVICES_FILE)) {
-        File f = LittleFS.open(DEVICES_FILE, "r");
-        if (f) {
-            // Contar llaves abiertas para estimar dispositivos
-            String content = f.readString();
-            f.close();
-            for (size_t i = 0; i < content.length(); i++) {
-                if (content[i] == '{') deviceCount++;
-            }
-            if (deviceCount > 0) deviceCount--; // El array tiene una llave extra
-        }
-    }
-    Serial.printf("[INFO] ~%d dispositivos guardados\n", deviceCount);
+    // Cuenta exacta desde la cabecera del catálogo (sin leer devices.json)
+    Serial.printf("[INFO] %d dispositivos guardados\n", storage.getDeviceCount());
 
     systemReady = true;
 
@@ -218,9 +219,7 @@ void initSystem() {
         Serial.printf("   SSID: %s\n", AP_SSID);
         Serial.printf("   Pass: %s\n", AP_PASSWORD);
     }
-    if (rfModule.isConnected()) {
-        Serial.printf("   RF: %.2f MHz\n", rfModule.getFrequency());
-    }
+    Serial.printf("   %s\n", bootManager.getStatusString().c_str());
     Serial.println("==============================================");
     Serial.printf("   Heap libre: %d bytes\n", ESP.getFreeHeap());
     Serial.println("==============================================");
@@ -228,90 +227,21 @@ void initSystem() {
 }
 
 void printStatus() {
-    Serial.printf("Uptime: %lu s | Heap: %d bytes\n", millis() / 1000, ESP.getFreeHeap());
+    Serial.printf("Uptime: %lu s | %s\n", millis() / 1000, heapMonitor.getStatusString().c_str());
 }
 
-void handleRFCommand(const char* deviceId, const char* command) {
-    Serial.printf("[Main] Comando: %s -> %s\n", deviceId, command);
-
-    // Cargar solo UN dispositivo (no el array completo)
-    SavedDevice device;
-    if (!storage.getDevice(deviceId, &device)) {
-        Serial.println("[Main] Dispositivo no encontrado");
-        return;
-    }
-
-    String cmd = String(command);
-    cmd.toLowerCase();
-
-    // Somfy RTS
-    if (device.type == DEVICE_CURTAIN_SOMFY) {
-        rfModule.setFrequency(SOMFY_FREQUENCY);
-        somfyRTS.setRemote(&device.somfy);
-
-        bool success = false;
-        if (cmd == "open" || cmd == "up") success = somfyRTS.sendUp();
-        else if (cmd == "close" || cmd == "down") success = somfyRTS.sendDown();
-        else if (cmd == "stop" || cmd == "my") success = somfyRTS.sendStop();
-        else if (cmd == "prog") success = somfyRTS.sendProg();
-
-        if (success) {
-            storage.updateSomfyRollingCode(deviceId, somfyRTS.getRollingCode());
-        }
-        return;
-    }
-
-    // Dooya Bidireccional
-    if (device.type == DEVICE_CURTAIN_DOOYA_BIDIR) {
-        dooyaBidir.setRemote(&device.dooyaBidir);
-
-        if (cmd == "open" || cmd == "up") dooyaBidir.sendUp();
-        else if (cmd == "close" || cmd == "down") dooyaBidir.sendDown();
-        else if (cmd == "stop") dooyaBidir.sendStop();
-        else if (cmd == "prog") dooyaBidir.sendProg();
-        return;
-    }
-
-    // A-OK AC114
-    if (device.type == DEVICE_CURTAIN_AOK) {
-        aokProtocol.setRemoteId(device.aok.remoteId);
-        aokProtocol.setChannel(device.aok.channel);
-
-        if (cmd == "open" || cmd == "up") aokProtocol.sendUp();
-        else if (cmd == "close" || cmd == "down") aokProtocol.sendDown();
-        else if (cmd == "stop") aokProtocol.sendStop();
-        else if (cmd == "prog") aokProtocol.sendProgram();
-        return;
-    }
-
-    // Dispositivos con señales capturadas
-    int signalIndex = -1;
-    switch (device.type) {
-        case DEVICE_CURTAIN:
-            if (cmd == "open" || cmd == "up") signalIndex = 0;
-            else if (cmd == "close" || cmd == "down") signalIndex = 1;
-            else if (cmd == "stop") signalIndex = 2;
-            break;
-        case DEVICE_SWITCH:
-        case DEVICE_LIGHT:
-            if (cmd == "on") signalIndex = 0;
-            else if (cmd == "off") signalIndex = 1;
-            break;
-        case DEVICE_BUTTON:
-            signalIndex = 0;
-            break;
-        case DEVICE_GATE:
-            if (cmd == "open" || cmd == "toggle") signalIndex = 0;
-            else if (cmd == "close") signalIndex = 1;
-            break;
-        default:
-            signalIndex = cmd.toInt();
-            break;
+// Publicar el diagnóstico en cuanto cambia la alerta de fragmentación
+void handleHeapAlert(bool active, uint8_t fragmentation) {
+    if (mqttStarted && mqttClient.isConnected()) {
+        mqttClient.publishSystemStatus();
     }
+}
 
-    if (signalIndex >= 0 && signalIndex < device.signalCount && device.signals[signalIndex].valid) {
-        rfModule.setFrequency(device.signals[signalIndex].frequency);
-        rfModule.setModulation(device.signals[signalIndex].modulation);
-        rfModule.transmitSignal(&device.signals[signalIndex]);
-    }
+// Storage admite un solo aviso: se reparte a cada caché del catálogo
+void handleDeviceChanged(const char* id, const SavedDevice* device) {
+    mqttTopics.onDeviceChanged(id, device);
+    coverPositions.onDeviceChanged(id, device);
+    deviceStates.onDeviceChanged(id, device);
+    signalIndex.onDeviceChanged(id, device);
+    somfyRemotes.onDeviceChanged(id, device);
 }
@@ -0,0 +1,452 @@
+/*
+ * ==============================================
+ * RF Controller - Benchmark de decodificadores (env:native)
+ * ==============================================
+ *   rf_sim bench [n=200] [jitter=0] [drop=0] [noise=0] [seed=1] [captura.txt ...]
+ *
+ * Mide detectProtocol() y AOK_Protocol::learnFromCapture() sobre:
+ *  - tramas sintéticas por protocolo (A-OK, Somfy, EV1527, PT2262, Dooya y
+ *    ruido puro), con tolerancia de oscilador del control (±5%) y las
+ *    degradaciones indicadas:
+ *      jitter = desvío estándar gaussiano por pulso (µs)
+ *      drop   = probabilidad por flanco de perderse (une dos pulsos)
+ *      noise  = probabilidad por pulso de una ráfaga de espurios
+ *  - capturas reales en texto, como las que junta serial_capture.py: cada
+ *    bloque de líneas numéricas es una traza ("[RF] Pulses (us): ..." también
+ *    vale). La etiqueta sale de una línea "# protocolo: aok" o del prefijo del
+ *    nombre de archivo (aok_1.txt). Sin etiqueta la traza solo suma tiempos.
+ *  - grabaciones PulseTrace (.ptr): cada segmento es una traza.
+ *
+ * Por decodificador y protocolo reporta tasa de decodificación, tasa de falsos
+ * positivos (trazas de otro protocolo reconocidas como éste) y tiempo de host
+ * por trama.
+ */
+
+#ifdef NATIVE_BUILD
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <HostFile.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "AOK_Protocol.h"
+#include "PulseTrain.h"
+#include "PulseTrace.h"
+
+#define BENCH_MAX_PULSES    (RF_MAX_SIGNAL_LENGTH / 2)  // Igual que el buffer de captura
+
+struct BenchTrace {
+    std::string label;          // "aok", "ev1527", ... o "" si se desconoce
+    std::vector<uint32_t> pulses;
+    uint32_t aokId;             // Esperado en trazas A-OK sintéticas (0 = no verificar)
+    uint8_t aokChannel;
+};
+
+struct BenchParams {
+    int frames = 200;
+    double jitterUs = 0;
+    double dropRate = 0;
+    double noiseRate = 0;
+    uint32_t seed = 1;
+};
+
+// Un decodificador reconoce a lo sumo un protocolo por traza
+struct BenchStats {
+    std::string decoder;
+    std::string protocol;
+    uint32_t positives = 0;     // Trazas con esta etiqueta
+    uint32_t decoded = 0;       // ... reconocidas correctamente
+    uint32_t negatives = 0;     // Trazas etiquetadas con otro protocolo
+    uint32_t falsePositives = 0;
+};
+
+static double benchUniform() {
+    return (nativeHAL.nextRandom() + 0.5) / 4294967296.0;
+}
+
+static double benchGaussian() {
+    // Box-Muller
+    double u1 = benchUniform();
+    double u2 = benchUniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static uint32_t benchRandomBits(uint8_t bits) {
+    return bits >= 32 ? nativeHAL.nextRandom() : nativeHAL.nextRandom() & ((1UL << bits) - 1);
+}
+
+static void trainToPulses(const PulseTrain& train, std::vector<uint32_t>& pulses) {
+    for (uint16_t i = 0; i < train.size(); i++) {
+        pulses.push_back(train.getDuration(i));
+    }
+}
+
+// Tramas con pulso corto/largo por bit (EV1527, PT2262, Dooya ASK):
+// sync + bits "1" = largo-corto, "0" = corto-largo
+static void appendPwmFrame(std::vector<uint32_t>& pulses, uint32_t syncHigh, uint32_t syncLow,
+                           uint32_t shortUs, uint32_t longUs, uint64_t bits, uint8_t bitCount) {
+    pulses.push_back(syncHigh);
+    pulses.push_back(syncLow);
+    for (int i = bitCount - 1; i >= 0; i--) {
+        bool bit = (bits >> i) & 1;
+        pulses.push_back(bit ? longUs : shortUs);
+        pulses.push_back(bit ? shortUs : longUs);
+    }
+}
+
+static BenchTrace makeSynthetic(const std::string& label) {
+    BenchTrace trace;
+    trace.label = label;
+    trace.aokId = 0;
+    trace.aokChannel = 0;
+
+    // Tolerancia del oscilador del control remoto
+    double scale = 0.95 + 0.10 * benchUniform();
+    PulseTrain* train = new PulseTrain();
+
+    if (label == "aok") {
+        static const uint8_t commands[] = {AOK_CMD_UP, AOK_CMD_DOWN, AOK_CMD_STOP, AOK_CMD_PROGRAM};
+        trace.aokId = 1 + benchRandomBits(24) % 0xFFFFFE;
+        trace.aokChannel = 1 + benchRandomBits(4);
+        aokProtocol.setRemoteId(trace.aokId);
+        aokProtocol.setChannel(trace.aokChannel);
+        aokProtocol.encodeCommand(commands[benchRandomBits(2)], *train);
+
+        // Dos repeticiones separadas por el silencio de radio
+        for (int rep = 0; rep < 2; rep++) {
+            trainToPulses(*train, trace.pulses);
+            trace.pulses.back() += AOK_RADIO_SILENCE;
+        }
+    } else if (label == "somfy") {
+        static const uint8_t commands[] = {SOMFY_CMD_UP, SOMFY_CMD_DOWN, SOMFY_CMD_MY, SOMFY_CMD_PROG};
+        somfyRTS.setRemote(benchRandomBits(24), (uint16_t)benchRandomBits(16));
+        somfyRTS.encodeCommand(commands[benchRandomBits(2)], *train);
+        trainToPulses(*train, trace.pulses);
+    } else if (label == "ev1527") {
+        // Te ~320µs, sync 1:31, 20 bits de dirección + 4 de datos
+        uint64_t bits = benchRandomBits(24);
+        for (int rep = 0; rep < 3; rep++) {
+            appendPwmFrame(trace.pulses, 320, 31 * 320, 320, 3 * 320, bits, 24);
+        }
+    } else if (label == "pt2262") {
+        // Te ~200µs, 12 trits (0 = "00", 1 = "11", F = "01"), sync 1:31
+        uint64_t bits = 0;
+        for (int t = 0; t < 12; t++) {
+            static const uint8_t trits[] = {0x0, 0x3, 0x1};
+            bits = (bits << 2) | trits[benchRandomBits(16) % 3];
+        }
+        for (int rep = 0; rep < 3; rep++) {
+            appendPwmFrame(trace.pulses, 200, 31 * 200, 200, 3 * 200, bits, 24);
+        }
+    } else if (label == "dooya") {
+        // Sync ~4900µs, bits 350/700µs, 40 bits
+        uint64_t bits = ((uint64_t)benchRandomBits(8) << 32) | benchRandomBits(32);
+        for (int rep = 0; rep < 3; rep++) {
+            appendPwmFrame(trace.pulses, 4900, 1500, 350, 700, bits, 40);
+        }
+    } else {
+        // Ruido: pulsos aleatorios de 50 a 3000µs
+        uint32_t count = 40 + benchRandomBits(16) % 200;
+        for (uint32_t i = 0; i < count; i++) {
+            trace.pulses.push_back(50 + benchRandomBits(16) % 2950);
+        }
+    }
+
+    for (uint32_t& d : trace.pulses) {
+        d = (uint32_t)(d * scale + 0.5);
+    }
+
+    delete train;
+    return trace;
+}
+
+static void applyImpairments(std::vector<uint32_t>& pulses, const BenchParams& params) {
+    std::vector<uint32_t> out;
+    out.reserve(pulses.size() + 16);
+
+    for (size_t i = 0; i < pulses.size(); i++) {
+        double d = pulses[i];
+        if (params.jitterUs > 0) d += benchGaussian() * params.jitterUs;
+        if (d < 1) d = 1;
+        uint32_t duration = (uint32_t)(d + 0.5);
+
+        // Ráfaga de ruido: 1-3 espurios cortos en medio del pulso
+        if (params.noiseRate > 0 && benchUniform() < params.noiseRate && duration > 200) {
+            int spikes = 1 + benchRandomBits(2) % 3;
+            uint32_t remaining = duration;
+            for (int s = 0; s < spikes && remaining > 120; s++) {
+                uint32_t before = 20 + benchRandomBits(16) % (remaining / 2);
+                uint32_t spike = 20 + benchRandomBits(16) % 100;
+                if (before + spike >= remaining) break;
+                out.push_back(before);
+                out.push_back(spike);
+                remaining -= before + spike;
+            }
+            duration = remaining;
+        }
+
+        // Flanco perdido: el pulso se une con el siguiente (y el nivel se corre)
+        if (params.dropRate > 0 && i + 1 < pulses.size() && benchUniform() < params.dropRate) {
+            pulses[i + 1] += duration;
+            continue;
+        }
+
+        out.push_back(duration);
+    }
+
+    pulses.swap(out);
+}
+
+// ============================================
+// Corpus de capturas (salida de serial_capture.py)
+// ============================================
+
+static bool isPulseLine(const std::string& line, std::vector<uint32_t>& values) {
+    // Prefijo opcional "[RF] Pulses (us):"
+    size_t start = 0;
+    size_t colon = line.find_last_of(':');
+    bool prefixed = colon != std::string::npos;
+    if (prefixed) start = colon + 1;
+
+    values.clear();
+    long value = 0;
+    bool inNumber = false;
+    for (size_t i = start; i <= line.size(); i++) {
+        char c = i < line.size() ? line[i] : ' ';
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            inNumber = true;
+        } else if (c == ' ' || c == ',' || c == '\t' || c == '\r' || c == '+' || c == '-') {
+            if (inNumber) values.push_back((uint32_t)value);
+            value = 0;
+            inNumber = false;
+        } else {
+            return false;
+        }
+    }
+
+    return prefixed ? values.size() >= 4 : !values.empty();
+}
+
+static std::string labelFromPath(const char* path) {
+    std::string name = path;
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+
+    size_t end = name.find_first_of("_-.");
+    name = name.substr(0, end);
+    for (char& c : name) c = tolower(c);
+
+    static const char* known[] = {"aok", "somfy", "ev1527", "pt2262", "dooya", "noise"};
+    for (const char* k : known) {
+        if (name == k) return name;
+    }
+    return "";
+}
+
+static int loadTraceFile(const char* path, std::vector<BenchTrace>& traces) {
+    HostFile in(path, "rb");
+    PulseTraceReader reader(in);
+    PulseTraceHeader header;
+    if (!reader.begin(header)) return -1;
+
+    BenchTrace trace;
+    trace.label = labelFromPath(path);
+    trace.aokId = 0;
+    trace.aokChannel = 0;
+
+    PulseTraceSegment segment;
+    uint32_t pulses[BENCH_MAX_PULSES];
+    uint16_t count;
+    int added = 0;
+    while (reader.readSegment(segment, pulses, BENCH_MAX_PULSES, count)) {
+        if (count < 10) continue;
+        trace.pulses.assign(pulses, pulses + count);
+        traces.push_back(trace);
+        added++;
+    }
+    return added;
+}
+
+static int loadCorpus(const char* path, std::vector<BenchTrace>& traces) {
+    size_t length = strlen(path);
+    if (length > 4 && strcmp(path + length - 4, ".ptr") == 0) {
+        int added = loadTraceFile(path, traces);
+        if (added < 0) fprintf(stderr, "%s no es un archivo PulseTrace válido\n", path);
+        return added;
+    }
+
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return -1;
+    }
+
+    std::string label = labelFromPath(path);
+    BenchTrace current;
+    current.aokId = 0;
+    current.aokChannel = 0;
+    int added = 0;
+
+    auto flush = [&]() {
+        if (current.pulses.size() >= 10) {
+            current.label = label;
+            if (current.pulses.size() > BENCH_MAX_PULSES) current.pulses.resize(BENCH_MAX_PULSES);
+            traces.push_back(current);
+            added++;
+        }
+        current.pulses.clear();
+    };
+
+    char buffer[1024];
+    std::vector<uint32_t> values;
+    while (fgets(buffer, sizeof(buffer), f)) {
+        std::string line = buffer;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+
+        if (line.rfind("# protocolo:", 0) == 0) {
+            flush();
+            label = line.substr(12);
+            label.erase(0, label.find_first_not_of(' '));
+            continue;
+        }
+
+        if (isPulseLine(line, values)) {
+            current.pulses.insert(current.pulses.end(), values.begin(), values.end());
+        } else {
+            flush();
+        }
+    }
+    flush();
+    fclose(f);
+
+    return added;
+}
+
+// ============================================
+// Ejecución
+// ============================================
+
+static const char* labelForProtocol(RFProtocol protocol) {
+    switch (protocol) {
+        case PROTOCOL_DOOYA: return "dooya";
+        case PROTOCOL_EV1527: return "ev1527";
+        case PROTOCOL_PT2262: return "pt2262";
+        case PROTOCOL_VERTILUX: return "vertilux";
+        default: return "";     // Genérico/desconocido no afirma ningún protocolo
+    }
+}
+
+static BenchStats& statsFor(std::vector<BenchStats>& stats, const char* decoder, const std::string& protocol) {
+    for (BenchStats& s : stats) {
+        if (s.decoder == decoder && s.protocol == protocol) return s;
+    }
+    stats.push_back(BenchStats());
+    stats.back().decoder = decoder;
+    stats.back().protocol = protocol;
+    return stats.back();
+}
+
+// Registra el resultado de un decodificador que afirma "claimed" ("" = nada)
+static void recordResult(std::vector<BenchStats>& stats, const char* decoder,
+                         const std::vector<std::string>& protocols, const BenchTrace& trace,
+                         const std::string& claimed, bool fieldsOk) {
+    if (trace.label.empty()) return;
+
+    for (const std::string& protocol : protocols) {
+        BenchStats& s = statsFor(stats, decoder, protocol);
+        if (trace.label == protocol) {
+            s.positives++;
+            if (claimed == protocol && fieldsOk) s.decoded++;
+        } else {
+            s.negatives++;
+            if (claimed == protocol) s.falsePositives++;
+        }
+    }
+}
+
+int runBench(int argc, char** argv) {
+    BenchParams params;
+    std::vector<BenchTrace> traces;
+
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "n=", 2) == 0) params.frames = atoi(arg + 2);
+        else if (strncmp(arg, "jitter=", 7) == 0) params.jitterUs = atof(arg + 7);
+        else if (strncmp(arg, "drop=", 5) == 0) params.dropRate = atof(arg + 5);
+        else if (strncmp(arg, "noise=", 6) == 0) params.noiseRate = atof(arg + 6);
+        else if (strncmp(arg, "seed=", 5) == 0) params.seed = strtoul(arg + 5, nullptr, 10);
+        else if (loadCorpus(arg, traces) < 0) return 1;
+    }
+    size_t corpusCount = traces.size();
+
+    nativeHAL.setSerialEcho(false);
+    nativeHAL.seedRandom(params.seed);
+
+    static const char* synthetic[] = {"aok", "somfy", "ev1527", "pt2262", "dooya", "noise"};
+    for (int f = 0; f < params.frames; f++) {
+        for (const char* label : synthetic) {
+            BenchTrace trace = makeSynthetic(label);
+            applyImpairments(trace.pulses, params);
+            if (trace.pulses.size() > BENCH_MAX_PULSES) trace.pulses.resize(BENCH_MAX_PULSES);
+            traces.push_back(trace);
+        }
+    }
+
+    const std::vector<std::string> detectProtocols = {"dooya", "ev1527", "pt2262", "vertilux"};
+    const std::vector<std::string> aokProtocols = {"aok"};
+    std::vector<BenchStats> stats;
+    double detectUs = 0, aokUs = 0;
+
+    RFSignal* signal = new RFSignal();
+    for (const BenchTrace& trace : traces) {
+        memset(signal, 0, sizeof(RFSignal));
+        for (uint32_t d : trace.pulses) {
+            uint16_t duration = d > 0xFFFF ? 0xFFFF : (uint16_t)d;
+            signal->data[signal->length++] = duration >> 8;
+            signal->data[signal->length++] = duration & 0xFF;
+        }
+        signal->modulation = 2;     // ASK/OOK (MOD_FORMAT del CC1101)
+        signal->valid = true;
+
+        auto t0 = std::chrono::steady_clock::now();
+        RFProtocol detected = rfModule.detectProtocol(signal);
+        auto t1 = std::chrono::steady_clock::now();
+        bool learned = aokProtocol.learnFromCapture(signal->data, signal->length);
+        auto t2 = std::chrono::steady_clock::now();
+
+        detectUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        aokUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+
+        recordResult(stats, "detect", detectProtocols, trace, labelForProtocol(detected), true);
+
+        bool fieldsOk = trace.aokId == 0 ||
+                        (aokProtocol.getRemoteId() == trace.aokId && aokProtocol.getChannel() == trace.aokChannel);
+        recordResult(stats, "aok", aokProtocols, trace, learned ? "aok" : "", fieldsOk);
+    }
+    delete signal;
+
+    printf("# bench: %d tramas sintéticas/protocolo + %zu de corpus, jitter %.0f us, drop %.3f, ruido %.3f, seed %u\n",
+           params.frames, corpusCount, params.jitterUs, params.dropRate, params.noiseRate, params.seed);
+    printf("%-8s %-9s %7s %7s %7s %7s %7s\n", "decoder", "protocolo", "tramas", "decod", "tasa", "fp", "tasa_fp");
+    for (const BenchStats& s : stats) {
+        if (s.positives == 0 && s.falsePositives == 0) continue;
+        printf("%-8s %-9s %7u %7u %6.1f%% %7u %6.2f%%\n", s.decoder.c_str(), s.protocol.c_str(),
+               s.positives, s.decoded, s.positives ? 100.0 * s.decoded / s.positives : 0.0,
+               s.falsePositives, s.negatives ? 100.0 * s.falsePositives / s.negatives : 0.0);
+    }
+    if (!traces.empty()) {
+        printf("# tiempo host por trama: detect %.2f us, aok %.2f us\n",
+               detectUs / traces.size(), aokUs / traces.size());
+    }
+    return 0;
+}
+
+#endif // NATIVE_BUILD
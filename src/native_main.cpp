@@ -0,0 +1,390 @@
+/*
+ * ==============================================
+ * RF Controller - Simulador en el host (env:native)
+ * ==============================================
+ * Ejecuta los módulos RF y Storage sobre la HAL simulada de lib/NativeHAL:
+ *
+ *   rf_sim tx somfy <address_hex> <rolling_code> <up|down|my|prog>
+ *   rf_sim tx aok <remote_id_hex> <channel> <up|down|stop|prog>
+ *   rf_sim tx dooya <device_id_hex> <unit> <up|down|stop|prog>
+ *   rf_sim tx raw <pulsos.txt>
+ *   rf_sim encode somfy <address_hex> <rolling_code> <up|down|my|prog> [key_hex]
+ *   rf_sim encode aok <remote_id_hex> <channel> <up|down|stop|prog>
+ *   rf_sim encode dooya <device_id_hex> <unit> <up|down|stop|prog>
+ *   rf_sim encode raw <pulsos.txt> [inv]
+ *   rf_sim rx <pulsos.txt>
+ *   rf_sim record <pulsos.txt> <salida.ptr>
+ *   rf_sim replay <grabacion.ptr>
+ *   rf_sim bench [n=200] [jitter=us] [drop=p] [noise=p] [seed=n] [capturas.txt ...]
+ *   rf_sim storage
+ *
+ * Los archivos de pulsos contienen duraciones en µs separadas por espacios,
+ * comas o saltos de línea (el signo, si existe, se ignora).
+ * "encode" imprime la salida del encoder sin transmitir (una línea "+640 -640 ..."
+ * o los bytes del frame FSK en Dooya): es la forma de onda de referencia contra la
+ * que se comparan los cambios en las rutas de temporización (diff de la salida).
+ * "record" inyecta los pulsos en GDO0 y los graba con CC1101_RF::recordTrace()
+ * (el mismo camino que /api/rf/trace/record); "replay" reinyecta cada segmento
+ * de un .ptr (grabado en el dispositivo o en el host) y lo pasa por la captura
+ * y los decodificadores.
+ * "bench" está en native_bench.cpp.
+ * LittleFS usa el directorio indicado en NATIVE_FS_ROOT (./.native_fs por defecto).
+ */
+
+#ifdef NATIVE_BUILD
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <HostFile.h>
+#include <cstdio>
+#include <vector>
+
+#include "config.h"
+#include "Storage.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "DooyaBidir.h"
+#include "AOK_Protocol.h"
+#include "PulseTrain.h"
+#include "PulseTrace.h"
+#include "TxTiming.h"
+#include "Metrics.h"
+
+int runBench(int argc, char** argv);
+
+static bool loadPulseFile(const char* path, std::vector<uint32_t>& pulses) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return false;
+    }
+
+    long value = 0;
+    bool inNumber = false;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            inNumber = true;
+        } else if (inNumber) {
+            pulses.push_back((uint32_t)value);
+            value = 0;
+            inNumber = false;
+        }
+    }
+    if (inNumber) pulses.push_back((uint32_t)value);
+    fclose(f);
+
+    return !pulses.empty();
+}
+
+static void printWaveform(uint8_t pin) {
+    std::vector<SimPulse> waveform = nativeHAL.getWaveform(pin);
+
+    printf("# pin %d: %zu pulsos\n", pin, waveform.size());
+    for (size_t i = 0; i < waveform.size(); i++) {
+        printf("%c%u%s", waveform[i].level ? '+' : '-', waveform[i].durationUs,
+               (i + 1) % 16 == 0 ? "\n" : " ");
+    }
+    printf("\n");
+}
+
+static void printRadioLog() {
+    uint32_t regWrites = 0, strobes = 0, calls = 0;
+    for (const CC1101SimOp& op : ELECHOUSE_cc1101.simGetLog()) {
+        if (op.type == CC1101_OP_WRITE_REG) regWrites++;
+        else if (op.type == CC1101_OP_STROBE) strobes++;
+        else calls++;
+    }
+    printf("# CC1101: %u Init, %u registros, %u strobes, %u llamadas de configuración\n",
+           ELECHOUSE_cc1101.simGetInitCount(), regWrites, strobes, calls);
+}
+
+static int runTx(int argc, char** argv) {
+    if (argc < 4) return 1;
+
+    const char* protocol = argv[2];
+    String cmd = String(argc > 5 ? argv[5] : "");
+
+    rfModule.begin();
+    ELECHOUSE_cc1101.simClearLog();
+    nativeHAL.startRecording();
+    txTiming.setEnabled(true);
+
+    if (strcmp(protocol, "somfy") == 0 && argc > 5) {
+        somfyRTS.begin(CC1101_GDO0);
+        somfyRTS.setRemote(strtoul(argv[3], nullptr, 16), (uint16_t)atoi(argv[4]));
+        if (cmd == "up") somfyRTS.sendUp();
+        else if (cmd == "down") somfyRTS.sendDown();
+        else if (cmd == "prog") somfyRTS.sendProg();
+        else somfyRTS.sendStop();
+        printWaveform(CC1101_GDO0);
+    } else if (strcmp(protocol, "aok") == 0 && argc > 5) {
+        aokProtocol.begin();
+        aokProtocol.setRemoteId(strtoul(argv[3], nullptr, 16));
+        aokProtocol.setChannel((uint8_t)atoi(argv[4]));
+        if (cmd == "up") aokProtocol.sendUp();
+        else if (cmd == "down") aokProtocol.sendDown();
+        else if (cmd == "prog") aokProtocol.sendProgram();
+        else aokProtocol.sendStop();
+        printWaveform(CC1101_GDO2);
+    } else if (strcmp(protocol, "dooya") == 0 && argc > 5) {
+        dooyaBidir.begin();
+        dooyaBidir.setRemote(strtoul(argv[3], nullptr, 16), (uint8_t)atoi(argv[4]));
+        if (cmd == "up") dooyaBidir.sendUp();
+        else if (cmd == "down") dooyaBidir.sendDown();
+        else if (cmd == "prog") dooyaBidir.sendProg();
+        else dooyaBidir.sendStop();
+        for (const std::vector<byte>& packet : ELECHOUSE_cc1101.simGetPackets()) {
+            printf("# paquete FSK:");
+            for (byte b : packet) printf(" %02X", b);
+            printf("\n");
+        }
+    } else if (strcmp(protocol, "raw") == 0) {
+        std::vector<uint32_t> pulses;
+        if (!loadPulseFile(argv[3], pulses)) return 1;
+
+        std::vector<uint8_t> data;
+        for (uint32_t d : pulses) {
+            data.push_back((d >> 8) & 0xFF);
+            data.push_back(d & 0xFF);
+        }
+        rfModule.transmitRaw(data.data(), data.size(), 1);
+        printWaveform(CC1101_GDO2);
+    } else {
+        return 1;
+    }
+
+    nativeHAL.stopRecording();
+    printRadioLog();
+    if (txTiming.getTransmissions() > 0) {
+        const TxTimingStats& timing = txTiming.getLastStats();
+        printf("# timing TX: %u pulsos, error medio %.1f us, p99 %u us, max %u us%s\n",
+               timing.pulses, timing.meanUs, timing.p99Us, timing.maxUs,
+               timing.countMismatch ? " (cantidad distinta)" : "");
+    }
+    printf("# metricas: %s\n", metrics.toCompactJson().c_str());
+    printf("# tiempo simulado: %llu us\n", (unsigned long long)nativeHAL.nowMicros());
+    return 0;
+}
+
+static int runEncode(int argc, char** argv) {
+    if (argc < 4) return 1;
+
+    const char* protocol = argv[2];
+    String cmd = String(argc > 5 ? argv[5] : "");
+    nativeHAL.setSerialEcho(false);
+
+    PulseTrain* train = new PulseTrain();
+    bool ok = false;
+
+    if (strcmp(protocol, "somfy") == 0 && argc > 5) {
+        uint8_t key = argc > 6 ? (uint8_t)strtoul(argv[6], nullptr, 16) : 0xA7;
+        somfyRTS.setRemote(strtoul(argv[3], nullptr, 16), (uint16_t)atoi(argv[4]), key);
+        uint8_t command = SOMFY_CMD_MY;
+        if (cmd == "up") command = SOMFY_CMD_UP;
+        else if (cmd == "down") command = SOMFY_CMD_DOWN;
+        else if (cmd == "prog") command = SOMFY_CMD_PROG;
+        ok = somfyRTS.encodeCommand(command, *train);
+    } else if (strcmp(protocol, "aok") == 0 && argc > 5) {
+        aokProtocol.setRemoteId(strtoul(argv[3], nullptr, 16));
+        aokProtocol.setChannel((uint8_t)atoi(argv[4]));
+        uint8_t command = AOK_CMD_STOP;
+        if (cmd == "up") command = AOK_CMD_UP;
+        else if (cmd == "down") command = AOK_CMD_DOWN;
+        else if (cmd == "prog") command = AOK_CMD_PROGRAM;
+        ok = aokProtocol.encodeCommand(command, *train);
+    } else if (strcmp(protocol, "dooya") == 0 && argc > 5) {
+        dooyaBidir.setRemote(strtoul(argv[3], nullptr, 16), (uint8_t)atoi(argv[4]));
+        uint8_t command = DOOYA_BIDIR_CMD_STOP;
+        if (cmd == "up") command = DOOYA_BIDIR_CMD_UP;
+        else if (cmd == "down") command = DOOYA_BIDIR_CMD_DOWN;
+        else if (cmd == "prog") command = DOOYA_BIDIR_CMD_PROG;
+
+        uint8_t frame[DOOYA_BIDIR_FRAME_LEN];
+        dooyaBidir.encodeFrame(command, frame);
+        for (int i = 0; i < DOOYA_BIDIR_FRAME_LEN; i++) {
+            printf("%02X%s", frame[i], i + 1 < DOOYA_BIDIR_FRAME_LEN ? " " : "\n");
+        }
+        delete train;
+        return 0;
+    } else if (strcmp(protocol, "raw") == 0) {
+        std::vector<uint32_t> pulses;
+        if (!loadPulseFile(argv[3], pulses)) {
+            delete train;
+            return 1;
+        }
+
+        std::vector<uint8_t> data;
+        for (uint32_t d : pulses) {
+            data.push_back((d >> 8) & 0xFF);
+            data.push_back(d & 0xFF);
+        }
+        bool inverted = argc > 4 && strcmp(argv[4], "inv") == 0;
+        ok = CC1101_RF::encodeRaw(data.data(), data.size(), inverted, *train);
+    } else {
+        delete train;
+        return 1;
+    }
+
+    printf("%s\n", train->toString().c_str());
+    printf("# %u pulsos, %lu us%s\n", train->size(), (unsigned long)train->getTotalDuration(),
+           ok ? "" : " (ERROR: tren incompleto)");
+    delete train;
+    return ok ? 0 : 2;
+}
+
+static int runRx(int argc, char** argv) {
+    if (argc < 3) return 1;
+
+    std::vector<uint32_t> pulses;
+    if (!loadPulseFile(argv[2], pulses)) return 1;
+
+    rfModule.begin();
+    ELECHOUSE_cc1101.simInjectRx(pulses.data(), pulses.size(), true, 1000);
+
+    RFSignal* signal = new RFSignal();
+    bool captured = rfModule.captureSignal(signal, 5000);
+    if (!captured) {
+        printf("# sin captura\n");
+        delete signal;
+        return 2;
+    }
+
+    printf("%s\n", rfModule.analyzeSignal(signal).c_str());
+    printf("# protocolo: %s\n", rfModule.getProtocolName(rfModule.detectProtocol(signal)).c_str());
+    delete signal;
+    return 0;
+}
+
+static int runRecord(int argc, char** argv) {
+    if (argc < 4) return 1;
+
+    std::vector<uint32_t> pulses;
+    if (!loadPulseFile(argv[2], pulses)) return 1;
+
+    HostFile out(argv[3], "wb");
+    if (!out) {
+        fprintf(stderr, "No se pudo crear %s\n", argv[3]);
+        return 1;
+    }
+
+    rfModule.begin();
+    nativeHAL.setSerialEcho(false);
+    ELECHOUSE_cc1101.simInjectRx(pulses.data(), pulses.size(), true, 1000);
+    int segments = rfModule.recordTrace(out, 3000);
+    out.close();
+
+    printf("# %d segmentos grabados en %s\n", segments, argv[3]);
+    return segments > 0 ? 0 : 2;
+}
+
+static int runReplay(int argc, char** argv) {
+    if (argc < 3) return 1;
+
+    HostFile in(argv[2], "rb");
+    PulseTraceHeader header;
+    if (!in || !PulseTraceReader(in).begin(header)) {
+        fprintf(stderr, "%s no es un archivo PulseTrace válido\n", argv[2]);
+        return 1;
+    }
+    in.close();
+
+    printf("# PulseTrace v%u: %.3f MHz, modulación %u, RSSI inicial %d dBm, inicio unix %lu\n",
+           header.version, header.frequencyKHz / 1000.0, header.modulation, header.rssi,
+           (unsigned long)header.startUnix);
+
+    HostFile file(argv[2], "rb");
+    PulseTraceReader reader(file);
+    reader.begin(header);
+
+    rfModule.begin();
+    rfModule.setFrequency(header.frequencyKHz / 1000.0f);
+    rfModule.setModulation(header.modulation);
+
+    PulseTraceSegment segment;
+    uint32_t* pulses = new uint32_t[RF_MAX_SIGNAL_LENGTH];
+    RFSignal* signal = new RFSignal();
+    uint16_t count;
+    int index = 0;
+
+    while (reader.readSegment(segment, pulses, RF_MAX_SIGNAL_LENGTH, count)) {
+        nativeHAL.setSerialEcho(false);
+        ELECHOUSE_cc1101.simSetRssi(-100, segment.rssi);
+        ELECHOUSE_cc1101.simInjectRx(pulses, count, header.flags & PULSE_TRACE_FLAG_START_HIGH, 1000);
+
+        bool captured = rfModule.captureSignal(signal, 5000);
+        RFProtocol protocol = captured ? rfModule.detectProtocol(signal) : PROTOCOL_UNKNOWN;
+        bool aok = captured && aokProtocol.learnFromCapture(signal->data, signal->length);
+        nativeHAL.setSerialEcho(true);
+
+        printf("segmento %d @%lu ms, RSSI %d dBm, %u pulsos: ", index++,
+               (unsigned long)segment.offsetMs, segment.rssi, count);
+        if (!captured) {
+            printf("sin captura\n");
+            continue;
+        }
+        printf("%s", rfModule.getProtocolName(protocol).c_str());
+        if (aok) {
+            printf(", A-OK id 0x%06lX canal %u", (unsigned long)aokProtocol.getRemoteId(),
+                   aokProtocol.getChannel());
+        }
+        printf("\n");
+    }
+
+    delete signal;
+    delete[] pulses;
+    return index > 0 ? 0 : 2;
+}
+
+static int runStorage() {
+    if (!storage.begin()) return 1;
+
+    SavedDevice* device = new SavedDevice();
+    memset(device, 0, sizeof(SavedDevice));
+    strncpy(device->id, storage.generateUUID().c_str(), sizeof(device->id) - 1);
+    snprintf(device->name, sizeof(device->name), "Sim %u", storage.getDeviceCount() + 1);
+    device->type = DEVICE_CURTAIN_SOMFY;
+    device->enabled = true;
+    device->somfy.address = 0x123456;
+    device->somfy.encryptionKey = 0xA7;
+
+    bool ok = storage.addDevice(device);
+    SavedDevice* loaded = new SavedDevice();
+    ok = ok && storage.getDevice(device->id, loaded) && strcmp(loaded->name, device->name) == 0;
+
+    printf("# addDevice/getDevice: %s\n", ok ? "OK" : "ERROR");
+    printf("# dispositivos: %u (generación %lu)\n", storage.getDeviceCount(),
+           (unsigned long)storage.getCatalogGeneration());
+    printf("%s", storage.listFiles().c_str());
+
+    delete loaded;
+    delete device;
+    return ok ? 0 : 1;
+}
+
+// Con pio test el main es el de cada test de test/native
+#ifndef PIO_UNIT_TESTING
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s tx|encode|rx|record|replay|bench|storage ...\n", argv[0]);
+        return 1;
+    }
+
+    int result = 1;
+    if (strcmp(argv[1], "tx") == 0) result = runTx(argc, argv);
+    else if (strcmp(argv[1], "encode") == 0) result = runEncode(argc, argv);
+    else if (strcmp(argv[1], "rx") == 0) result = runRx(argc, argv);
+    else if (strcmp(argv[1], "record") == 0) result = runRecord(argc, argv);
+    else if (strcmp(argv[1], "replay") == 0) result = runReplay(argc, argv);
+    else if (strcmp(argv[1], "bench") == 0) result = runBench(argc, argv);
+    else if (strcmp(argv[1], "storage") == 0) result = runStorage();
+
+    if (result == 1) {
+        fprintf(stderr, "Argumentos inválidos (ver encabezado de native_main.cpp)\n");
+    }
+    return result;
+}
+#endif // PIO_UNIT_TESTING
+
+#endif // NATIVE_BUILD
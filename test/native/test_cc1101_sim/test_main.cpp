@@ -0,0 +1,189 @@
+/*
+ * CC1101_RF sobre el CC1101 simulado de lib/NativeHAL: registros y strobes
+ * que quedan en el log del simulador, pulsos inyectados en GDO0 y forma de
+ * onda transmitida.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <NativeHAL.h>
+
+#include "config.h"
+#include "CC1101_RF.h"
+
+// Strobes del CC1101
+#define SRX     0x34
+#define STX     0x35
+#define SIDLE   0x36
+
+static RFSignal captured;
+
+void setUp(void) {
+    nativeHAL.reset();
+    nativeHAL.setSerialEcho(false);
+    ELECHOUSE_cc1101.simReset();
+    memset(&captured, 0, sizeof(captured));
+}
+
+void tearDown(void) {}
+
+static bool logHas(CC1101SimOpType type, uint8_t addr, float value = -1) {
+    for (const CC1101SimOp& op : ELECHOUSE_cc1101.simGetLog()) {
+        if (op.type == type && op.addr == addr && (value < 0 || op.value == value)) return true;
+    }
+    return false;
+}
+
+static uint16_t durationAt(const RFSignal& s, uint16_t index) {
+    return (s.data[index * 2] << 8) | s.data[index * 2 + 1];
+}
+
+void test_begin_detects_chip(void) {
+    TEST_ASSERT_TRUE(rfModule.begin());
+    TEST_ASSERT_EQUAL_UINT32(1, ELECHOUSE_cc1101.simGetInitCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 433.92, ELECHOUSE_cc1101.simGetFrequency());
+}
+
+void test_begin_without_chip(void) {
+    ELECHOUSE_cc1101.simSetPresent(false);
+    TEST_ASSERT_FALSE(rfModule.begin());
+    TEST_ASSERT_EQUAL_UINT32(0, ELECHOUSE_cc1101.simGetInitCount());
+    TEST_ASSERT_FALSE(rfModule.captureSignal(&captured, 100));
+}
+
+void test_capture_configures_async_rx(void) {
+    rfModule.begin();
+    ELECHOUSE_cc1101.simClearLog();
+
+    rfModule.captureSignal(&captured, 100);
+
+    // IOCFG0 = salida de datos serie en GDO0, luego SRX
+    TEST_ASSERT_TRUE(logHas(CC1101_OP_WRITE_REG, 0x02, 0x0D));
+    TEST_ASSERT_TRUE(logHas(CC1101_OP_STROBE, SRX));
+    TEST_ASSERT_EQUAL_HEX8(0x0D, ELECHOUSE_cc1101.simGetRegister(0x02));
+}
+
+void test_capture_without_signal(void) {
+    rfModule.begin();
+    TEST_ASSERT_FALSE(rfModule.captureSignal(&captured, 200));
+}
+
+void test_capture_gdo0_injection(void) {
+    rfModule.begin();
+
+    uint32_t pulses[40];
+    for (int i = 0; i < 40; i++) pulses[i] = (i % 2) ? 400 : 1200;
+    ELECHOUSE_cc1101.simInjectRx(pulses, 40, true, 1000);
+
+    TEST_ASSERT_TRUE(rfModule.captureSignal(&captured, 5000));
+    TEST_ASSERT_EQUAL_UINT16(80, captured.length);
+
+    // La primera duración es el silencio previo (desde el arranque de la
+    // pre-captura); el último pulso no tiene flanco de cierre
+    TEST_ASSERT_UINT32_WITHIN(10, 1000, durationAt(captured, 0));
+    for (uint16_t i = 1; i < captured.length / 2; i++) {
+        TEST_ASSERT_UINT32_WITHIN(2, pulses[i - 1], durationAt(captured, i));
+    }
+}
+
+static uint16_t drainListened(uint16_t* out, uint16_t maxCount) {
+    nativeHAL.advance(100000);
+    return rfModule.readListened(out, maxCount);
+}
+
+void test_listen_routes_carrier_sense(void) {
+    rfModule.begin();
+    TEST_ASSERT_TRUE(rfModule.startListening(433.92, 2));
+
+    // IOCFG2 = carrier sense mientras se escucha, tri-state al suspender
+    TEST_ASSERT_EQUAL_HEX8(0x0E, ELECHOUSE_cc1101.simGetRegister(0x00));
+    TEST_ASSERT_EQUAL_HEX8(0x40 | (RX_CARRIER_SENSE_DB & 0x0F), ELECHOUSE_cc1101.simGetRegister(0x1C));
+
+    rfModule.suspendListening();
+    TEST_ASSERT_EQUAL_HEX8(0x2E, ELECHOUSE_cc1101.simGetRegister(0x00));
+}
+
+void test_listen_accepts_carrier(void) {
+    rfModule.begin();
+    rfModule.startListening(433.92, 2);
+    uint32_t noiseBefore = rfModule.getListenNoise();
+
+    uint32_t pulses[20];
+    for (int i = 0; i < 20; i++) pulses[i] = (i % 2) ? 400 : 1200;
+    ELECHOUSE_cc1101.simInjectRx(pulses, 20, true, 1000);
+
+    // Primero el silencio previo y después alto/bajo tal cual; el último
+    // bajo no tiene alto que lo cierre
+    uint16_t out[32];
+    uint16_t count = drainListened(out, 32);
+    TEST_ASSERT_EQUAL_UINT16(20, count);
+    TEST_ASSERT_UINT32_WITHIN(10, 1000, out[0]);
+    for (uint16_t i = 1; i < count; i++) {
+        TEST_ASSERT_UINT32_WITHIN(2, pulses[i - 1], out[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(noiseBefore, rfModule.getListenNoise());
+    rfModule.suspendListening();
+}
+
+void test_listen_rejects_noise(void) {
+    rfModule.begin();
+    rfModule.startListening(433.92, 2);
+    uint32_t noiseBefore = rfModule.getListenNoise();
+
+    // Ruido por debajo del umbral de carrier sense: solo queda el silencio
+    // previo, ninguna duración del ruido
+    ELECHOUSE_cc1101.simSetRssi(-100, -100);
+    uint32_t noise[60];
+    for (int i = 0; i < 60; i++) noise[i] = 80 + (i * 37) % 300;
+    ELECHOUSE_cc1101.simInjectRx(noise, 60, true, 1000);
+
+    uint16_t out[64];
+    TEST_ASSERT_EQUAL_UINT16(1, drainListened(out, 64));
+    TEST_ASSERT_UINT32_WITHIN(10, 1000, out[0]);
+    TEST_ASSERT_EQUAL_UINT32(noiseBefore + 1, rfModule.getListenNoise());
+
+    // Una señal fuerte después del ruido empieza con separador
+    ELECHOUSE_cc1101.simSetRssi(-100, -40);
+    uint32_t pulses[6] = {400, 800, 400, 800, 400, 800};
+    ELECHOUSE_cc1101.simInjectRx(pulses, 6, true, 1000);
+    TEST_ASSERT_EQUAL_UINT16(6, drainListened(out, 64));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, out[0]);
+    TEST_ASSERT_UINT32_WITHIN(2, 400, out[1]);
+    rfModule.suspendListening();
+}
+
+void test_transmit_raw_waveform(void) {
+    rfModule.begin();
+    ELECHOUSE_cc1101.simClearLog();
+    nativeHAL.startRecording();
+
+    // +400 -800 +400 -1600, dos veces
+    const uint8_t data[] = {0x01, 0x90, 0x03, 0x20, 0x01, 0x90, 0x06, 0x40};
+    TEST_ASSERT_TRUE(rfModule.transmitRaw(data, sizeof(data), 2));
+
+    TEST_ASSERT_TRUE(logHas(CC1101_OP_STROBE, STX));
+    TEST_ASSERT_TRUE(logHas(CC1101_OP_STROBE, SIDLE));
+
+    std::vector<SimPulse> wave = ELECHOUSE_cc1101.simGetTxWaveform();
+    int high = 0;
+    for (const SimPulse& pulse : wave) {
+        if (!pulse.level) continue;
+        TEST_ASSERT_UINT32_WITHIN(2, 400, pulse.durationUs);
+        high++;
+    }
+    TEST_ASSERT_EQUAL_INT(4, high);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_detects_chip);
+    RUN_TEST(test_begin_without_chip);
+    RUN_TEST(test_capture_configures_async_rx);
+    RUN_TEST(test_capture_without_signal);
+    RUN_TEST(test_capture_gdo0_injection);
+    RUN_TEST(test_listen_routes_carrier_sense);
+    RUN_TEST(test_listen_accepts_carrier);
+    RUN_TEST(test_listen_rejects_noise);
+    RUN_TEST(test_transmit_raw_waveform);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#ifndef GOLDEN_FRAMES_H
+#define GOLDEN_FRAMES_H
+
+// ============================================
+// FORMAS DE ONDA DE REFERENCIA
+// Salida de los encoders en formato PulseTrain::toString() ("+alto -bajo",
+// µs). Un cambio en las rutas de temporización que altere un solo pulso
+// rompe el test: si el cambio es intencional, regenerar con
+// "program encode ..." (native_main.cpp) y revisar el diff.
+// ============================================
+
+// Somfy RTS: dirección 0x123456, rolling code 1, clave 0xA7, UP
+static const char* const SOMFY_123456_RC1_A7_UP =
+    "+2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 +4550 -1244 +1280 -640 "
+    "+640 -640 +640 -1280 +640 -640 +640 -640 +640 -640 +640 -640 "
+    "+1280 -1280 +1280 -1280 +640 -640 +1280 -640 +640 -1280 +1280 -1280 "
+    "+1280 -1280 +640 -640 +1280 -640 +640 -1280 +1280 -1280 +1280 -1280 "
+    "+640 -640 +1280 -1280 +640 -640 +640 -640 +640 -640 +640 -640 "
+    "+640 -640 +1280 -1280 +640 -640 +640 -640 +640 -640 +1280 -640 "
+    "+640 -1280 +640 -640 +640 -640 +640 -640 +640 -640 +640 -640 "
+    "+1280 -1280 +640 -640 +640 -640 +1280 -1280 +640 -30415 +2416 -2416 "
+    "+2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 "
+    "+4550 -1244 +1280 -640 +640 -640 +640 -1280 +640 -640 +640 -640 "
+    "+640 -640 +640 -640 +1280 -1280 +1280 -1280 +640 -640 +1280 -640 "
+    "+640 -1280 +1280 -1280 +1280 -1280 +640 -640 +1280 -640 +640 -1280 "
+    "+1280 -1280 +1280 -1280 +640 -640 +1280 -1280 +640 -640 +640 -640 "
+    "+640 -640 +640 -640 +640 -640 +1280 -1280 +640 -640 +640 -640 "
+    "+640 -640 +1280 -640 +640 -1280 +640 -640 +640 -640 +640 -640 "
+    "+640 -640 +640 -640 +1280 -1280 +640 -640 +640 -640 +1280 -1280 "
+    "+640 -30415 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 "
+    "+2416 -2416 +2416 -2416 +4550 -1244 +1280 -640 +640 -640 +640 -1280 "
+    "+640 -640 +640 -640 +640 -640 +640 -640 +1280 -1280 +1280 -1280 "
+    "+640 -640 +1280 -640 +640 -1280 +1280 -1280 +1280 -1280 +640 -640 "
+    "+1280 -640 +640 -1280 +1280 -1280 +1280 -1280 +640 -640 +1280 -1280 "
+    "+640 -640 +640 -640 +640 -640 +640 -640 +640 -640 +1280 -1280 "
+    "+640 -640 +640 -640 +640 -640 +1280 -640 +640 -1280 +640 -640 "
+    "+640 -640 +640 -640 +640 -640 +640 -640 +1280 -1280 +640 -640 "
+    "+640 -640 +1280 -1280 +640";
+
+// Somfy RTS: dirección 0xABCDEF, rolling code 0x1234, clave 0xA3, MY
+static const char* const SOMFY_ABCDEF_RC1234_A3_MY =
+    "+2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 +4550 -1244 +640 -640 "
+    "+1280 -640 +640 -1280 +640 -640 +640 -640 +640 -640 +640 -640 "
+    "+640 -640 +1280 -1280 +640 -640 +1280 -640 +640 -640 +640 -1280 "
+    "+640 -640 +1280 -640 +640 -1280 +1280 -1280 +1280 -1280 +640 -640 "
+    "+640 -640 +640 -640 +640 -640 +640 -640 +640 -640 +1280 -640 "
+    "+640 -640 +640 -640 +640 -1280 +1280 -640 +640 -640 +640 -1280 "
+    "+640 -640 +640 -640 +1280 -1280 +640 -640 +640 -640 +1280 -640 "
+    "+640 -640 +640 -1280 +640 -640 +640 -640 +1280 -1280 +640 -640 "
+    "+640 -640 +640 -30415 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 "
+    "+2416 -2416 +2416 -2416 +2416 -2416 +4550 -1244 +640 -640 +1280 -640 "
+    "+640 -1280 +640 -640 +640 -640 +640 -640 +640 -640 +640 -640 "
+    "+1280 -1280 +640 -640 +1280 -640 +640 -640 +640 -1280 +640 -640 "
+    "+1280 -640 +640 -1280 +1280 -1280 +1280 -1280 +640 -640 +640 -640 "
+    "+640 -640 +640 -640 +640 -640 +640 -640 +1280 -640 +640 -640 "
+    "+640 -640 +640 -1280 +1280 -640 +640 -640 +640 -1280 +640 -640 "
+    "+640 -640 +1280 -1280 +640 -640 +640 -640 +1280 -640 +640 -640 "
+    "+640 -1280 +640 -640 +640 -640 +1280 -1280 +640 -640 +640 -640 "
+    "+640 -30415 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 +2416 -2416 "
+    "+2416 -2416 +2416 -2416 +4550 -1244 +640 -640 +1280 -640 +640 -1280 "
+    "+640 -640 +640 -640 +640 -640 +640 -640 +640 -640 +1280 -1280 "
+    "+640 -640 +1280 -640 +640 -640 +640 -1280 +640 -640 +1280 -640 "
+    "+640 -1280 +1280 -1280 +1280 -1280 +640 -640 +640 -640 +640 -640 "
+    "+640 -640 +640 -640 +640 -640 +1280 -640 +640 -640 +640 -640 "
+    "+640 -1280 +1280 -640 +640 -640 +640 -1280 +640 -640 +640 -640 "
+    "+1280 -1280 +640 -640 +640 -640 +1280 -640 +640 -640 +640 -1280 "
+    "+640 -640 +640 -640 +1280 -1280 +640 -640 +640 -640 +640";
+
+// A-OK: id 0x1A2B3C, canal 1, DOWN
+static const char* const AOK_1A2B3C_CH1_DOWN =
+    "+5300 -530 +565 -270 +270 -565 +565 -270 +270 -565 +270 -565 "
+    "+270 -565 +565 -270 +565 -270 +270 -565 +270 -565 +270 -565 "
+    "+565 -270 +565 -270 +270 -565 +565 -270 +270 -565 +270 -565 "
+    "+270 -565 +565 -270 +270 -565 +565 -270 +270 -565 +565 -270 "
+    "+565 -270 +270 -565 +270 -565 +565 -270 +565 -270 +565 -270 "
+    "+565 -270 +270 -565 +270 -565 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +270 -565 "
+    "+565 -270 +270 -565 +565 -270 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +565 -270 +565 -270 +565 -270 +565 -270 +270 -565 "
+    "+270 -565 +270 -565 +565 -270 +270 -565 +565 -270 +565 -270";
+
+// A-OK: id 0x00F00D, canal 15, STOP
+static const char* const AOK_00F00D_CH15_STOP =
+    "+5300 -530 +565 -270 +270 -565 +565 -270 +270 -565 +270 -565 "
+    "+270 -565 +565 -270 +565 -270 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +565 -270 "
+    "+565 -270 +565 -270 +565 -270 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +565 -270 "
+    "+565 -270 +270 -565 +565 -270 +270 -565 +565 -270 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +270 -565 "
+    "+270 -565 +270 -565 +270 -565 +565 -270 +270 -565 +270 -565 "
+    "+270 -565 +565 -270 +565 -270 +270 -565 +565 -270 +565 -270 "
+    "+270 -565 +270 -565 +270 -565 +270 -565 +270 -565 +565 -270";
+
+// Dooya bidireccional: frame FSK (bytes)
+static const uint8_t DOOYA_2345678_U1_UP[DOOYA_BIDIR_FRAME_LEN] = {
+    0x09, 0x19, 0x15, 0x00, 0x23, 0x45, 0x67, 0x81, 0x00, 0x00
+};
+
+static const uint8_t DOOYA_0ABCDE_U5_STOP[DOOYA_BIDIR_FRAME_LEN] = {
+    0x09, 0x19, 0x15, 0x00, 0x00, 0xAB, 0xCD, 0xE5, 0x02, 0x00
+};
+
+// Señal raw capturada (duraciones de 16 bits big-endian, como RFSignal::data)
+static const uint8_t RAW_CAPTURE[] = {
+    0x14, 0xB4, 0x02, 0x12, 0x02, 0x35, 0x01, 0x0E, 0x01, 0x0E, 0x02, 0x35, 0x02, 0x35,
+    0x01, 0x0E, 0x01, 0x0E, 0x02, 0x35, 0x01, 0x0E, 0x02, 0x35, 0x02, 0x35, 0x1F, 0x40
+};
+
+static const char* const RAW_REPLAY =
+    "+5300 -530 +565 -270 +270 -565 +565 -270 +270 -565 +270 -565 "
+    "+565 -8000";
+
+static const char* const RAW_REPLAY_INVERTED =
+    "-5300 +530 -565 +270 -270 +565 -565 +270 -270 +565 -270 +565 "
+    "-565 +8000";
+
+#endif // GOLDEN_FRAMES_H
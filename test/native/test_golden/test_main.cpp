@@ -0,0 +1,111 @@
+/*
+ * Formas de onda de referencia de los encoders: cada caso fija dirección,
+ * rolling code, clave, id, canal o unidad y compara el PulseTrain (o el
+ * frame FSK de Dooya) pulso a pulso con golden_frames.h.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <NativeHAL.h>
+
+#include "config.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "AOK_Protocol.h"
+#include "DooyaBidir.h"
+#include "PulseTrain.h"
+#include "golden_frames.h"
+
+static PulseTrain train;
+
+void setUp(void) {
+    nativeHAL.reset();
+    nativeHAL.setSerialEcho(false);
+    ELECHOUSE_cc1101.simReset();
+    train.clear();
+}
+
+void tearDown(void) {}
+
+void test_somfy_up(void) {
+    somfyRTS.setRemote(0x123456, 1, 0xA7);
+    TEST_ASSERT_TRUE(somfyRTS.encodeCommand(SOMFY_CMD_UP, train));
+    TEST_ASSERT_EQUAL_STRING(SOMFY_123456_RC1_A7_UP, train.toString().c_str());
+    TEST_ASSERT_EQUAL_UINT32(378308, train.getTotalDuration());
+}
+
+void test_somfy_my(void) {
+    somfyRTS.setRemote(0xABCDEF, 0x1234, 0xA3);
+    TEST_ASSERT_TRUE(somfyRTS.encodeCommand(SOMFY_CMD_MY, train));
+    TEST_ASSERT_EQUAL_STRING(SOMFY_ABCDEF_RC1234_A3_MY, train.toString().c_str());
+}
+
+void test_somfy_rolling_code_changes_frame(void) {
+    somfyRTS.setRemote(0x123456, 2, 0xA7);
+    somfyRTS.encodeCommand(SOMFY_CMD_UP, train);
+    TEST_ASSERT_TRUE(strcmp(SOMFY_123456_RC1_A7_UP, train.toString().c_str()) != 0);
+}
+
+void test_aok_down(void) {
+    aokProtocol.setRemoteId(0x1A2B3C);
+    aokProtocol.setChannel(1);
+    TEST_ASSERT_TRUE(aokProtocol.encodeCommand(AOK_CMD_DOWN, train));
+    TEST_ASSERT_EQUAL_STRING(AOK_1A2B3C_CH1_DOWN, train.toString().c_str());
+    TEST_ASSERT_EQUAL_UINT32(60105, train.getTotalDuration());
+}
+
+void test_aok_stop(void) {
+    aokProtocol.setRemoteId(0x00F00D);
+    aokProtocol.setChannel(15);
+    TEST_ASSERT_TRUE(aokProtocol.encodeCommand(AOK_CMD_STOP, train));
+    TEST_ASSERT_EQUAL_STRING(AOK_00F00D_CH15_STOP, train.toString().c_str());
+}
+
+void test_dooya_frames(void) {
+    uint8_t frame[DOOYA_BIDIR_FRAME_LEN];
+
+    dooyaBidir.setRemote(0x2345678, 1);
+    dooyaBidir.encodeFrame(DOOYA_BIDIR_CMD_UP, frame);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(DOOYA_2345678_U1_UP, frame, DOOYA_BIDIR_FRAME_LEN);
+
+    dooyaBidir.setRemote(0x0ABCDE, 5);
+    dooyaBidir.encodeFrame(DOOYA_BIDIR_CMD_STOP, frame);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(DOOYA_0ABCDE_U5_STOP, frame, DOOYA_BIDIR_FRAME_LEN);
+}
+
+void test_dooya_transmitted_packets(void) {
+    rfModule.begin();
+    dooyaBidir.begin();
+    dooyaBidir.setRemote(0x2345678, 1);
+    TEST_ASSERT_TRUE(dooyaBidir.sendCommand(DOOYA_BIDIR_CMD_UP));
+
+    // Cada repetición sale por la FIFO tal cual el frame de referencia
+    const std::vector<std::vector<byte>>& packets = ELECHOUSE_cc1101.simGetPackets();
+    TEST_ASSERT_EQUAL(5, packets.size());
+    for (const std::vector<byte>& packet : packets) {
+        TEST_ASSERT_EQUAL(DOOYA_BIDIR_FRAME_LEN, packet.size());
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(DOOYA_2345678_U1_UP, packet.data(), DOOYA_BIDIR_FRAME_LEN);
+    }
+}
+
+void test_raw_replay(void) {
+    TEST_ASSERT_TRUE(CC1101_RF::encodeRaw(RAW_CAPTURE, sizeof(RAW_CAPTURE), false, train));
+    TEST_ASSERT_EQUAL_STRING(RAW_REPLAY, train.toString().c_str());
+
+    train.clear();
+    TEST_ASSERT_TRUE(CC1101_RF::encodeRaw(RAW_CAPTURE, sizeof(RAW_CAPTURE), true, train));
+    TEST_ASSERT_EQUAL_STRING(RAW_REPLAY_INVERTED, train.toString().c_str());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_somfy_up);
+    RUN_TEST(test_somfy_my);
+    RUN_TEST(test_somfy_rolling_code_changes_frame);
+    RUN_TEST(test_aok_down);
+    RUN_TEST(test_aok_stop);
+    RUN_TEST(test_dooya_frames);
+    RUN_TEST(test_dooya_transmitted_packets);
+    RUN_TEST(test_raw_replay);
+    return UNITY_END();
+}
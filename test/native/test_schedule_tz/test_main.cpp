@@ -0,0 +1,94 @@
+/*
+ * Zona horaria a través de la sincronización SNTP: una regla cron de las
+ * 07:00 tiene que disparar a las 07:00 locales también después de que
+ * TimeManager lance (o relance) SNTP.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_sntp.h>
+#include <NativeHAL.h>
+
+#include "config.h"
+#include "TimeManager.h"
+#include "CronSpec.h"
+
+#define MADRID_TZ       "CET-1CEST,M3.5.0,M10.5.0/3"
+
+static SystemConfig config;
+
+void setUp(void) {
+    nativeHAL.reset();
+    nativeHAL.setSerialEcho(false);
+    WiFi.simSetStatus(WL_CONNECTED);
+
+    memset(&config, 0, sizeof(config));
+    strlcpy(config.timezone, "Europe/Madrid", sizeof(config.timezone));
+    strlcpy(config.ntp_server, "pool.ntp.org", sizeof(config.ntp_server));
+    setenv("TZ", "UTC0", 1);
+    tzset();
+}
+
+void tearDown(void) {}
+
+static time_t nextSeven(time_t after) {
+    CronSpec cron;
+    return cron.parse("0 7 * * *") ? cron.next(after) : 0;
+}
+
+static int localHour(time_t when) {
+    struct tm date;
+    localtime_r(&when, &date);
+    return date.tm_hour;
+}
+
+void test_sync_keeps_timezone(void) {
+    TEST_ASSERT_TRUE(timeManager.begin(&config));
+    sntp_sim_sync();
+    timeManager.loop();
+
+    TEST_ASSERT_EQUAL_STRING(MADRID_TZ, getenv("TZ"));
+}
+
+void test_resync_keeps_timezone(void) {
+    timeManager.begin(&config);
+    timeManager.setNTPServer("time.cloudflare.com");   // Relanza SNTP
+    TEST_ASSERT_TRUE(timeManager.syncTime());
+
+    TEST_ASSERT_EQUAL_STRING(MADRID_TZ, getenv("TZ"));
+}
+
+void test_seven_am_rule_fires_at_local_seven(void) {
+    timeManager.begin(&config);
+    sntp_sim_sync();
+
+    // 15/01/2026 00:00 UTC: CET (UTC+1) -> 06:00 UTC
+    time_t winter = nextSeven(1768435200);
+    TEST_ASSERT_EQUAL_INT32(1768456800, winter);
+    TEST_ASSERT_EQUAL_INT(7, localHour(winter));
+
+    // 15/07/2026 00:00 UTC: CEST (UTC+2) -> 05:00 UTC
+    time_t summer = nextSeven(1784073600);
+    TEST_ASSERT_EQUAL_INT32(1784091600, summer);
+    TEST_ASSERT_EQUAL_INT(7, localHour(summer));
+}
+
+void test_unknown_timezone_uses_utc_offset(void) {
+    strlcpy(config.timezone, "Mars/Olympus", sizeof(config.timezone));
+    config.utc_offset = -3;
+    timeManager.begin(&config);
+
+    // 15/01/2026 00:00 UTC con UTC-3 -> 10:00 UTC
+    TEST_ASSERT_EQUAL_STRING("UTC3", getenv("TZ"));
+    TEST_ASSERT_EQUAL_INT32(1768471200, nextSeven(1768435200));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sync_keeps_timezone);
+    RUN_TEST(test_resync_keeps_timezone);
+    RUN_TEST(test_seven_am_rule_fires_at_local_seven);
+    RUN_TEST(test_unknown_timezone_uses_utc_offset);
+    return UNITY_END();
+}
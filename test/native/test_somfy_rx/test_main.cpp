@@ -0,0 +1,133 @@
+/*
+ * Decodificación de controles Somfy físicos: el tren de encodeCommand se
+ * corta en frames por SIGNAL_FP_GAP_US como en RxMonitor::addDuration y cada
+ * frame pasa por SomfyRTS::decodePulses. Los rechazos (checksum, nibble de
+ * la clave) se prueban sobre el frame crudo con decodeFrame.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <NativeHAL.h>
+
+#include "config.h"
+#include "CC1101_RF.h"
+#include "SomfyRTS.h"
+#include "PulseTrain.h"
+
+static PulseTrain train;
+static uint16_t durations[PULSE_TRAIN_MAX_PULSES];
+static SomfyFrame decoded;
+
+void setUp(void) {
+    nativeHAL.reset();
+    nativeHAL.setSerialEcho(false);
+    ELECHOUSE_cc1101.simReset();
+    train.clear();
+    memset(&decoded, 0, sizeof(decoded));
+}
+
+void tearDown(void) {}
+
+// Corta el tren como RxMonitor: una duración >= SIGNAL_FP_GAP_US cierra el
+// frame. Devuelve cuántos frames decodificó decodePulses (el último en decoded)
+static int decodeTrain(void) {
+    int frames = 0;
+    uint16_t length = 0;
+
+    for (uint16_t i = 0; i <= train.size(); i++) {
+        uint32_t duration = i < train.size() ? train.getDuration(i) : SIGNAL_FP_GAP_US;
+        if (duration < SIGNAL_FP_GAP_US) {
+            durations[length++] = duration;
+            continue;
+        }
+        SomfyFrame frame;
+        if (length > 0 && SomfyRTS::decodePulses(durations, length, &frame)) {
+            decoded = frame;
+            frames++;
+        }
+        length = 0;
+    }
+    return frames;
+}
+
+// Frame crudo como lo arma buildFrame(): checksum en el nibble bajo del
+// byte 1 y ofuscado con XOR encadenado
+static void makeRaw(uint8_t key, uint8_t command, uint16_t rollingCode,
+                    uint32_t address, uint8_t* raw) {
+    raw[0] = key;
+    raw[1] = command << 4;
+    raw[2] = rollingCode >> 8;
+    raw[3] = rollingCode & 0xFF;
+    raw[4] = address & 0xFF;
+    raw[5] = (address >> 8) & 0xFF;
+    raw[6] = (address >> 16) & 0xFF;
+
+    uint8_t checksum = 0;
+    for (int i = 0; i < SOMFY_FRAME_LENGTH; i++) {
+        checksum ^= raw[i] ^ (raw[i] >> 4);
+    }
+    raw[1] |= checksum & 0x0F;
+
+    for (int i = 1; i < SOMFY_FRAME_LENGTH; i++) {
+        raw[i] ^= raw[i - 1];
+    }
+}
+
+void test_round_trip_up(void) {
+    somfyRTS.setRemote(0x123456, 0x0102, 0x0A);
+    TEST_ASSERT_TRUE(somfyRTS.encodeCommand(SOMFY_CMD_UP, train));
+
+    // Los hardware syncs quedan en su propio tramo y no decodifican. El
+    // último bit ofuscado es 1: su medio LOW se funde con el silencio
+    TEST_ASSERT_EQUAL_INT(SOMFY_TOTAL_FRAMES, decodeTrain());
+    TEST_ASSERT_EQUAL_HEX32(0x123456, decoded.address);
+    TEST_ASSERT_EQUAL_UINT16(0x0102, decoded.rollingCode);
+    TEST_ASSERT_EQUAL_HEX8(SOMFY_CMD_UP, decoded.command);
+    TEST_ASSERT_EQUAL_HEX8(0xA, decoded.key >> 4);
+}
+
+void test_round_trip_my_down(void) {
+    // Aquí el último bit ofuscado es 0 y el frame cierra con su medio HIGH
+    somfyRTS.setRemote(0xABCDEF, 0xFFFF, 0x0A);
+    TEST_ASSERT_TRUE(somfyRTS.encodeCommand(SOMFY_CMD_MY_DOWN, train));
+
+    TEST_ASSERT_EQUAL_INT(SOMFY_TOTAL_FRAMES, decodeTrain());
+    TEST_ASSERT_EQUAL_HEX32(0xABCDEF, decoded.address);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, decoded.rollingCode);
+    TEST_ASSERT_EQUAL_HEX8(SOMFY_CMD_MY_DOWN, decoded.command);
+}
+
+void test_key_without_a_nibble_is_rejected(void) {
+    // buildFrame() manda el nibble bajo de la clave: 0xA7 sale como 0x70
+    somfyRTS.setRemote(0x123456, 1, 0xA7);
+    TEST_ASSERT_TRUE(somfyRTS.encodeCommand(SOMFY_CMD_UP, train));
+    TEST_ASSERT_EQUAL_INT(0, decodeTrain());
+
+    uint8_t raw[SOMFY_FRAME_LENGTH];
+    makeRaw(0xA3, SOMFY_CMD_UP, 1, 0x123456, raw);
+    TEST_ASSERT_TRUE(SomfyRTS::decodeFrame(raw, &decoded));
+    TEST_ASSERT_EQUAL_HEX8(0xA3, decoded.key);
+
+    makeRaw(0x53, SOMFY_CMD_UP, 1, 0x123456, raw);
+    TEST_ASSERT_FALSE(SomfyRTS::decodeFrame(raw, &decoded));
+}
+
+void test_bad_checksum_is_rejected(void) {
+    uint8_t raw[SOMFY_FRAME_LENGTH];
+    makeRaw(0xA7, SOMFY_CMD_DOWN, 0x1234, 0x0A0B0C, raw);
+    TEST_ASSERT_TRUE(SomfyRTS::decodeFrame(raw, &decoded));
+    TEST_ASSERT_EQUAL_HEX8(SOMFY_CMD_DOWN, decoded.command);
+
+    // Un bit cambiado en el último byte solo altera ese nibble
+    raw[SOMFY_FRAME_LENGTH - 1] ^= 0x01;
+    TEST_ASSERT_FALSE(SomfyRTS::decodeFrame(raw, &decoded));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_up);
+    RUN_TEST(test_round_trip_my_down);
+    RUN_TEST(test_key_without_a_nibble_is_rejected);
+    RUN_TEST(test_bad_checksum_is_rejected);
+    return UNITY_END();
+}
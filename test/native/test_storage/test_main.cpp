@@ -0,0 +1,190 @@
+/*
+ * Storage sobre LittleFS en disco (directorio NATIVE_FS_ROOT, ./.native_fs
+ * por defecto): catálogo de dispositivos, cabecera y recuperación de una
+ * reescritura interrumpida de devices.json.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <NativeHAL.h>
+
+#include "config.h"
+#include "Storage.h"
+
+static SavedDevice device;
+static SavedDevice loaded;
+
+void setUp(void) {
+    nativeHAL.reset();
+    nativeHAL.setSerialEcho(false);
+    storage.format();
+    TEST_ASSERT_TRUE(storage.begin());
+}
+
+void tearDown(void) {}
+
+static const SavedDevice* makeSomfy(const char* name, uint32_t address) {
+    memset(&device, 0, sizeof(device));
+    strlcpy(device.id, storage.generateUUID().c_str(), sizeof(device.id));
+    strlcpy(device.name, name, sizeof(device.name));
+    device.type = DEVICE_CURTAIN_SOMFY;
+    device.enabled = true;
+    device.somfy.address = address;
+    device.somfy.rollingCode = 1;
+    device.somfy.encryptionKey = 0xA7;
+    return &device;
+}
+
+void test_add_and_get_device(void) {
+    TEST_ASSERT_EQUAL_UINT16(0, storage.getDeviceCount());
+    TEST_ASSERT_TRUE(storage.addDevice(makeSomfy("Salón", 0x123456)));
+
+    TEST_ASSERT_EQUAL_UINT16(1, storage.getDeviceCount());
+    TEST_ASSERT_TRUE(storage.getDevice(device.id, &loaded));
+    TEST_ASSERT_EQUAL_STRING("Salón", loaded.name);
+    TEST_ASSERT_EQUAL(DEVICE_CURTAIN_SOMFY, loaded.type);
+    TEST_ASSERT_EQUAL_HEX32(0x123456, loaded.somfy.address);
+    TEST_ASSERT_EQUAL_HEX8(0xA7, loaded.somfy.encryptionKey);
+}
+
+void test_update_bumps_generation(void) {
+    storage.addDevice(makeSomfy("Cocina", 0x000001));
+    uint32_t generation = storage.getCatalogGeneration();
+
+    strlcpy(device.name, "Cocina norte", sizeof(device.name));
+    TEST_ASSERT_TRUE(storage.updateDevice(device.id, &device));
+
+    // Las cachés derivadas cuentan con exactamente +1 por escritura
+    TEST_ASSERT_EQUAL_UINT32(generation + 1, storage.getCatalogGeneration());
+    TEST_ASSERT_TRUE(storage.getDevice(device.id, &loaded));
+    TEST_ASSERT_EQUAL_STRING("Cocina norte", loaded.name);
+}
+
+void test_update_rolling_code(void) {
+    storage.addDevice(makeSomfy("Dormitorio", 0x0A0B0C));
+
+    TEST_ASSERT_TRUE(storage.updateSomfyRollingCode(device.id, 42));
+    TEST_ASSERT_TRUE(storage.getDevice(device.id, &loaded));
+    TEST_ASSERT_EQUAL_UINT16(42, loaded.somfy.rollingCode);
+
+    // forwardOnly no retrocede ni reescribe devices.json
+    uint32_t generation = storage.getCatalogGeneration();
+    TEST_ASSERT_TRUE(storage.updateSomfyRollingCode(device.id, 40, true));
+    TEST_ASSERT_EQUAL_UINT32(generation, storage.getCatalogGeneration());
+    TEST_ASSERT_TRUE(storage.updateSomfyRollingCode(device.id, 43, true));
+    TEST_ASSERT_TRUE(storage.getDevice(device.id, &loaded));
+    TEST_ASSERT_EQUAL_UINT16(43, loaded.somfy.rollingCode);
+}
+
+void test_delete_device(void) {
+    storage.addDevice(makeSomfy("A", 0x000001));
+    char first[sizeof(device.id)];
+    strlcpy(first, device.id, sizeof(first));
+    storage.addDevice(makeSomfy("B", 0x000002));
+
+    TEST_ASSERT_TRUE(storage.deleteDevice(first));
+    TEST_ASSERT_EQUAL_UINT16(1, storage.getDeviceCount());
+    TEST_ASSERT_FALSE(storage.getDevice(first, &loaded));
+    TEST_ASSERT_TRUE(storage.getDeviceByIndex(0, &loaded));
+    TEST_ASSERT_EQUAL_STRING("B", loaded.name);
+}
+
+void test_catalog_survives_remount(void) {
+    storage.addDevice(makeSomfy("A", 0x000001));
+    storage.addDevice(makeSomfy("B", 0x000002));
+    uint32_t generation = storage.getCatalogGeneration();
+
+    // Cabecera válida: se confía en ella sin recalcular
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_EQUAL_UINT16(2, storage.getDeviceCount());
+    TEST_ASSERT_EQUAL_UINT32(generation, storage.getCatalogGeneration());
+}
+
+void test_missing_header_rebuilds(void) {
+    storage.addDevice(makeSomfy("A", 0x000001));
+    storage.addDevice(makeSomfy("B", 0x000002));
+    LittleFS.remove(CATALOG_FILE);
+
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_EQUAL_UINT16(2, storage.getDeviceCount());
+    TEST_ASSERT_TRUE(storage.fileExists(CATALOG_FILE));
+}
+
+void test_torn_rewrite_is_discarded(void) {
+    storage.addDevice(makeSomfy("A", 0x000001));
+
+    // Reescritura cortada a la mitad: no coincide con la cabecera
+    File tmp = LittleFS.open(DEVICES_TMP_FILE, "w");
+    tmp.print("[{\"id\":\"roto\"");
+    tmp.close();
+
+    TEST_ASSERT_TRUE(storage.begin());
+    TEST_ASSERT_FALSE(LittleFS.exists(DEVICES_TMP_FILE));
+    TEST_ASSERT_EQUAL_UINT16(1, storage.getDeviceCount());
+    TEST_ASSERT_TRUE(storage.getDevice(device.id, &loaded));
+    TEST_ASSERT_EQUAL_STRING("A", loaded.name);
+}
+
+static bool restoreFrom(const char* json) {
+    File out = LittleFS.open("/backup.json", "w");
+    out.print(json);
+    out.close();
+    File in = LittleFS.open("/backup.json", "r");
+    bool ok = storage.restoreBackup(in);
+    in.close();
+    return ok;
+}
+
+void test_restore_finds_root_devices_key(void) {
+    storage.addDevice(makeSomfy("Viejo", 0x000001));
+
+    // "devices" dentro de un valor de config no es la lista de dispositivos
+    TEST_ASSERT_TRUE(restoreFrom(
+        "{\"config\":{\"device_name\":\"\\\"devices\\\": []\"},"
+        "\"devices\":[{\"id\":\"a\",\"name\":\"Nuevo\",\"type\":1}]}"));
+
+    SystemConfig config;
+    TEST_ASSERT_TRUE(storage.loadConfig(&config));
+    TEST_ASSERT_EQUAL_STRING("\"devices\": []", config.device_name);
+    TEST_ASSERT_EQUAL_UINT16(1, storage.getDeviceCount());
+    TEST_ASSERT_TRUE(storage.getDevice("a", &loaded));
+    TEST_ASSERT_EQUAL_STRING("Nuevo", loaded.name);
+}
+
+void test_restore_over_cap_keeps_config(void) {
+    SystemConfig config;
+    memset(&config, 0, sizeof(config));
+    strlcpy(config.device_name, "Actual", sizeof(config.device_name));
+    TEST_ASSERT_TRUE(storage.saveConfig(&config));
+    storage.addDevice(makeSomfy("A", 0x000001));
+
+    // Más de MAX_DEVICES: falla entero, sin config nueva con dispositivos viejos
+    String json = "{\"config\":{\"device_name\":\"Backup\"},\"devices\":[";
+    for (int i = 0; i <= MAX_DEVICES; i++) {
+        if (i) json += ',';
+        json += "{\"id\":\"d" + String(i) + "\",\"name\":\"D\"}";
+    }
+    json += "]}";
+    TEST_ASSERT_FALSE(restoreFrom(json.c_str()));
+
+    TEST_ASSERT_TRUE(storage.loadConfig(&config));
+    TEST_ASSERT_EQUAL_STRING("Actual", config.device_name);
+    TEST_ASSERT_FALSE(LittleFS.exists(DEVICES_TMP_FILE));
+    TEST_ASSERT_EQUAL_UINT16(1, storage.getDeviceCount());
+    TEST_ASSERT_TRUE(storage.getDevice(device.id, &loaded));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_add_and_get_device);
+    RUN_TEST(test_update_bumps_generation);
+    RUN_TEST(test_update_rolling_code);
+    RUN_TEST(test_delete_device);
+    RUN_TEST(test_catalog_survives_remount);
+    RUN_TEST(test_missing_header_rebuilds);
+    RUN_TEST(test_torn_rewrite_is_discarded);
+    RUN_TEST(test_restore_finds_root_devices_key);
+    RUN_TEST(test_restore_over_cap_keeps_config);
+    return UNITY_END();
+}